@@ -79,7 +79,22 @@ static void (* tun_input_callback)(void);
 #define MIN_MTU_SIZE 1500
 static int config_mtu = MIN_MTU_SIZE;
 
+/*
+ * The maximum number of packets read from the tun device each time it
+ * becomes readable. Packets queued in the device are processed without
+ * a main loop round each, while the bound lets other processes and file
+ * descriptors run in between when the device is flooded.
+ */
+#ifdef TUN6_NET_CONF_INPUT_BATCH
+#define TUN6_NET_INPUT_BATCH TUN6_NET_CONF_INPUT_BATCH
+#else /* TUN6_NET_CONF_INPUT_BATCH */
+#define TUN6_NET_INPUT_BATCH 32
+#endif /* TUN6_NET_CONF_INPUT_BATCH */
+
 static int tunfd = -1;
+/* Cleared when a read finds no more packets in the tun device, or when
+   the input callback pauses the input. */
+static bool input_pending;
 
 static int set_fd(fd_set *rset, fd_set *wset);
 static void handle_fd(fd_set *rset, fd_set *wset);
@@ -405,6 +420,11 @@ tun6_net_init(void (* tun_input)(void))
 
   LOG_INFO("Tun open:%d\n", tunfd);
 
+  /* The input is read until the device is empty. */
+  if(fcntl(tunfd, F_SETFL, fcntl(tunfd, F_GETFL) | O_NONBLOCK) == -1) {
+    err(EXIT_FAILURE, "tun6_net_init: fcntl");
+  }
+
   select_set_callback(tunfd, &tun_select_callback);
 
   fprintf(stderr, "opened %s device ``/dev/%s''\n",
@@ -458,6 +478,10 @@ tun6_net_input(uint8_t *data, int maxlen)
   }
 
   if((size = read(tunfd, data, maxlen)) == -1) {
+    if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      input_pending = false;
+      return 0;
+    }
     err(EXIT_FAILURE, "tun6_net_input: read");
   }
 
@@ -475,6 +499,12 @@ tun6_net_input(uint8_t *data, int maxlen)
 
   return size;
 }
+/*---------------------------------------------------------------------------*/
+void
+tun6_net_input_pause(void)
+{
+  input_pending = false;
+}
 
 /*---------------------------------------------------------------------------*/
 /* tun select callback                                                       */
@@ -493,13 +523,18 @@ set_fd(fd_set *rset, fd_set *wset)
 static void
 handle_fd(fd_set *rset, fd_set *wset)
 {
+  int i;
+
   if(tunfd == -1) {
     /* tun is not open */
     return;
   }
 
   if(FD_ISSET(tunfd, rset)) {
-    tun_input_callback();
+    input_pending = true;
+    for(i = 0; i < TUN6_NET_INPUT_BATCH && input_pending; i++) {
+      tun_input_callback();
+    }
   }
 }
 
@@ -511,8 +546,10 @@ tun_input(void)
 {
   int size = tun6_net_input(uip_buf, sizeof(uip_buf));
   LOG_DBG("TUN data incoming read:%d\n", size);
-  uip_len = size;
-  tcpip_input();
+  if(size > 0) {
+    uip_len = size;
+    tcpip_input();
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
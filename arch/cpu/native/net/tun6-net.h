@@ -51,5 +51,8 @@ void tun6_net_set_mtu(int mtu_size);
 bool tun6_net_init(void (* tun_input)(void));
 int tun6_net_output(uint8_t *data, int len);
 int tun6_net_input(uint8_t *data, int maxlen);
+/* Stop reading packets until the tun device is readable again in a later
+   main loop round, when the input callback cannot take more packets. */
+void tun6_net_input_pause(void);
 
 #endif /* TUN6_NET_H_ */
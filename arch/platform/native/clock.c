@@ -83,6 +83,16 @@ clock_time(void)
   return ts.tv_sec * CLOCK_SECOND + ts.tv_nsec / (1000000000 / CLOCK_SECOND);
 }
 /*---------------------------------------------------------------------------*/
+uint64_t
+clock_usecs(void)
+{
+  clock_timespec_t ts;
+
+  get_time(&ts);
+
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
 unsigned long
 clock_seconds(void)
 {
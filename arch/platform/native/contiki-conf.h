@@ -86,15 +86,53 @@ typedef unsigned int uip_stats_t;
 #define QUEUEBUF_CONF_NUM 64
 #endif /* QUEUEBUF_CONF_NUM */
 
+#ifndef SICSLOWPAN_CONF_REASS_BITMAP
+#define SICSLOWPAN_CONF_REASS_BITMAP 1
+#endif /* SICSLOWPAN_CONF_REASS_BITMAP */
+
+#ifndef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_CONF_REASS_CONTEXTS 16
+#endif /* SICSLOWPAN_CONF_REASS_CONTEXTS */
+
 #define UIP_CONF_IPV6_QUEUE_PKT  1
 #define UIP_ARCH_IPCHKSUM        1
 
 #endif /* NETSTACK_CONF_WITH_IPV6 */
 
+#ifndef QUEUEBUF_CONF_REF
+#define QUEUEBUF_CONF_REF 1
+#endif /* QUEUEBUF_CONF_REF */
+
 #include <ctype.h>
 
 #define CLOCK_CONF_SECOND 1000
 
+/* Native nodes such as border routers may run many event timers. */
+#ifndef ETIMER_CONF_HEAP
+#define ETIMER_CONF_HEAP 1
+#endif /* ETIMER_CONF_HEAP */
+
+#ifndef MEMB_CONF_FREE_LIST
+#define MEMB_CONF_FREE_LIST 1
+#endif /* MEMB_CONF_FREE_LIST */
+
+#ifndef PROCESS_CONF_POLL_LIST
+#define PROCESS_CONF_POLL_LIST 1
+#endif /* PROCESS_CONF_POLL_LIST */
+
+/* The rtimer ticks in milliseconds, which is too coarse for profiling
+   single process invocations. */
+uint64_t clock_usecs(void);
+#ifndef PROFILE_CONF_CURRENT_TIME
+#define PROFILE_CONF_CURRENT_TIME clock_usecs
+#define PROFILE_CONF_SECOND 1000000
+#define PROFILE_CONF_TIME_T uint64_t
+#endif /* PROFILE_CONF_CURRENT_TIME */
+
+#ifndef HEAPMEM_CONF_BINS
+#define HEAPMEM_CONF_BINS 16
+#endif /* HEAPMEM_CONF_BINS */
+
 #define LOG_CONF_ENABLED 1
 
 #define PLATFORM_SUPPORTS_BUTTON_HAL 1
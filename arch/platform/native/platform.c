@@ -42,11 +42,14 @@
  * @{
  */
 
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/select.h>
 #include <errno.h>
+#include <err.h>
 
 #include "contiki.h"
 #include "net/netstack.h"
@@ -113,11 +116,46 @@
 #else
 #define SELECT_STDIN 1
 #endif
+
+/*
+ * Uses epoll instead of select to wait for the monitored file descriptors.
+ * Only available on Linux.
+ */
+#ifdef SELECT_CONF_EPOLL
+#define SELECT_EPOLL SELECT_CONF_EPOLL
+#elif defined(__linux__)
+#define SELECT_EPOLL 1
+#else
+#define SELECT_EPOLL 0
+#endif
 /** @} */
 /*---------------------------------------------------------------------------*/
 
+#if SELECT_MAX > FD_SETSIZE
+#error "SELECT_CONF_MAX must not be larger than FD_SETSIZE"
+#endif
+
+#if SELECT_EPOLL
+#include <sys/epoll.h>
+#endif /* SELECT_EPOLL */
+
 static const struct select_callback *select_callback[SELECT_MAX];
+
+#if SELECT_EPOLL
+/* The monitored file descriptors, packed so that the main loop only
+   visits descriptors that have a callback. */
+static int select_fds[SELECT_MAX];
+static int select_pos[SELECT_MAX];
+static int select_count;
+/* The events that epoll currently monitors for each descriptor. */
+static uint32_t select_events[SELECT_MAX];
+/* Descriptors that epoll does not support, such as regular files and
+   /dev/null. As with select, they are always ready. */
+static bool select_always_ready[SELECT_MAX];
+static int epoll_fd = -1;
+#else /* SELECT_EPOLL */
 static int select_max = 0;
+#endif /* SELECT_EPOLL */
 
 #ifdef PLATFORM_CONF_MAC_ADDR
 static uint8_t mac_addr[] = PLATFORM_CONF_MAC_ADDR;
@@ -126,6 +164,45 @@ static uint8_t mac_addr[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
 #endif /* PLATFORM_CONF_MAC_ADDR */
 
 /*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+int
+select_set_callback(int fd, const struct select_callback *callback)
+{
+  int last;
+
+  if(fd < 0 || fd >= SELECT_MAX) {
+    return 0;
+  }
+
+  /* Check that the callback functions are set */
+  if(callback != NULL &&
+     (callback->set_fd == NULL || callback->handle_fd == NULL)) {
+    callback = NULL;
+  }
+
+  if(callback != NULL && select_callback[fd] == NULL) {
+    /* The descriptor is added to epoll by the main loop, once the
+       callback asks for any events. */
+    select_pos[fd] = select_count;
+    select_fds[select_count++] = fd;
+  } else if(callback == NULL && select_callback[fd] != NULL) {
+    if(select_events[fd] != 0 && !select_always_ready[fd]) {
+      /* Fails if the descriptor has been closed already, which also
+         removes it from epoll. */
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    select_events[fd] = 0;
+    select_always_ready[fd] = false;
+
+    last = select_fds[--select_count];
+    select_fds[select_pos[fd]] = last;
+    select_pos[last] = select_pos[fd];
+  }
+
+  select_callback[fd] = callback;
+  return 1;
+}
+#else /* SELECT_EPOLL */
 int
 select_set_callback(int fd, const struct select_callback *callback)
 {
@@ -157,6 +234,7 @@ select_set_callback(int fd, const struct select_callback *callback)
   }
   return 0;
 }
+#endif /* SELECT_EPOLL */
 /*---------------------------------------------------------------------------*/
 #if SELECT_STDIN
 static int
@@ -271,47 +349,199 @@ platform_init_stage_three()
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the time in msec until the next event timer expires, bounded by
+   SELECT_TIMEOUT. */
+static int
+select_timeout(void)
+{
+  clock_time_t now;
+  clock_time_t next;
+
+  if(!etimer_pending()) {
+    return SELECT_TIMEOUT;
+  }
+
+  now = clock_time();
+  next = etimer_next_expiration_time();
+  if(!CLOCK_LT(now, next)) {
+    return 0;
+  }
+  if(next - now >= (clock_time_t)SELECT_TIMEOUT * CLOCK_SECOND / 1000) {
+    return SELECT_TIMEOUT;
+  }
+  /* Round up so that the timer has expired when we wake up. */
+  return ((next - now) * 1000 + CLOCK_SECOND - 1) / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+static void
+epoll_update(int fd, uint32_t events)
+{
+  struct epoll_event ev;
+  int op;
+  int ret;
+
+  if(select_events[fd] == 0) {
+    op = EPOLL_CTL_ADD;
+  } else if(events == 0) {
+    op = EPOLL_CTL_DEL;
+  } else {
+    op = EPOLL_CTL_MOD;
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.fd = fd;
+  ret = epoll_ctl(epoll_fd, op, fd, &ev);
+  if(ret < 0 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+    /* The descriptor was closed, which removed it from epoll, and its
+       number has been reused since. Register the new descriptor. */
+    op = EPOLL_CTL_ADD;
+    ret = epoll_ctl(epoll_fd, op, fd, &ev);
+  }
+  if(ret < 0) {
+    if(op == EPOLL_CTL_ADD && errno == EPERM) {
+      select_always_ready[fd] = true;
+    } else if(op != EPOLL_CTL_DEL) {
+      perror("epoll_ctl");
+      return;
+    }
+  }
+  select_events[fd] = events;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wait_fds(int timeout)
+{
+  static struct epoll_event events[SELECT_MAX];
+  static int ready[SELECT_MAX];
+  fd_set fdr;
+  fd_set fdw;
+  uint32_t wanted;
+  int num_ready;
+  int fd;
+  int i;
+  int n;
+
+  /* The callbacks tell which events they want through the descriptor
+     sets, as with select. Only changes are passed on to epoll. */
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  for(i = 0; i < select_count; i++) {
+    select_callback[select_fds[i]]->set_fd(&fdr, &fdw);
+  }
+
+  num_ready = 0;
+  for(i = 0; i < select_count; i++) {
+    fd = select_fds[i];
+    wanted = 0;
+    if(FD_ISSET(fd, &fdr)) {
+      wanted |= EPOLLIN;
+    }
+    if(FD_ISSET(fd, &fdw)) {
+      wanted |= EPOLLOUT;
+    }
+
+    if(!select_always_ready[fd] && wanted != select_events[fd]) {
+      epoll_update(fd, wanted);
+    }
+
+    if(select_always_ready[fd]) {
+      select_events[fd] = wanted;
+      if(wanted != 0) {
+        ready[num_ready++] = fd;
+      }
+    } else {
+      FD_CLR(fd, &fdr);
+      FD_CLR(fd, &fdw);
+    }
+  }
+
+  n = epoll_wait(epoll_fd, events, SELECT_MAX, num_ready > 0 ? 0 : timeout);
+  if(n < 0) {
+    if(errno != EINTR) {
+      perror("epoll_wait");
+    }
+    n = 0;
+  }
+
+  for(i = 0; i < n; i++) {
+    fd = events[i].data.fd;
+    if((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) &&
+       (select_events[fd] & EPOLLIN)) {
+      FD_SET(fd, &fdr);
+    }
+    if((events[i].events & (EPOLLOUT | EPOLLERR)) &&
+       (select_events[fd] & EPOLLOUT)) {
+      FD_SET(fd, &fdw);
+    }
+    ready[num_ready++] = fd;
+  }
+
+  for(i = 0; i < num_ready; i++) {
+    fd = ready[i];
+    /* A callback may have been removed by an earlier callback. */
+    if(select_callback[fd] != NULL) {
+      select_callback[fd]->handle_fd(&fdr, &fdw);
+    }
+  }
+}
+#else /* SELECT_EPOLL */
+static void
+wait_fds(int timeout)
+{
+  fd_set fdr;
+  fd_set fdw;
+  int maxfd;
+  int i;
+  int retval;
+  struct timeval tv;
+
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = (timeout % 1000) * 1000;
+
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  maxfd = 0;
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
+      maxfd = i;
+    }
+  }
+
+  retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
+  if(retval < 0) {
+    if(errno != EINTR) {
+      perror("select");
+    }
+  } else if(retval > 0) {
+    /* timeout => retval == 0 */
+    for(i = 0; i <= maxfd; i++) {
+      if(select_callback[i] != NULL) {
+        select_callback[i]->handle_fd(&fdr, &fdw);
+      }
+    }
+  }
+}
+#endif /* SELECT_EPOLL */
+/*---------------------------------------------------------------------------*/
 void
 platform_main_loop()
 {
+#if SELECT_EPOLL
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if(epoll_fd < 0) {
+    err(EXIT_FAILURE, "epoll_create1");
+  }
+#endif /* SELECT_EPOLL */
 #if SELECT_STDIN
   select_set_callback(STDIN_FILENO, &stdin_fd);
 #endif /* SELECT_STDIN */
   while(1) {
-    fd_set fdr;
-    fd_set fdw;
-    int maxfd;
-    int i;
-    int retval;
-    struct timeval tv;
-
-    retval = process_run();
-
-    tv.tv_sec = retval ? 0 : SELECT_TIMEOUT / 1000;
-    tv.tv_usec = retval ? 1 : (SELECT_TIMEOUT * 1000) % 1000000;
-
-    FD_ZERO(&fdr);
-    FD_ZERO(&fdw);
-    maxfd = 0;
-    for(i = 0; i <= select_max; i++) {
-      if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
-        maxfd = i;
-      }
-    }
-
-    retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
-    if(retval < 0) {
-      if(errno != EINTR) {
-        perror("select");
-      }
-    } else if(retval > 0) {
-      /* timeout => retval == 0 */
-      for(i = 0; i <= maxfd; i++) {
-        if(select_callback[i] != NULL) {
-          select_callback[i]->handle_fd(&fdr, &fdw);
-        }
-      }
-    }
+    /* Sleep until the next event timer expires or a monitored file
+       descriptor becomes ready, unless there are more events to
+       process. */
+    wait_fds(process_run() ? 0 : select_timeout());
 
     etimer_request_poll();
   }
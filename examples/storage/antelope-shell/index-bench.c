@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	A benchmark of range selections over an attribute that is
+ *	inserted in an arbitrary order. The same rows are stored in a
+ *	relation without an index, in one with a MaxHeap index, and in
+ *	one with a B+-tree index.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "contiki.h"
+
+#include "antelope.h"
+
+/* The number of rows in each relation. */
+#ifdef INDEX_BENCH_CONF_ROWS
+#define INDEX_BENCH_ROWS INDEX_BENCH_CONF_ROWS
+#else
+#define INDEX_BENCH_ROWS 2000
+#endif
+
+/* The number of times that each query is run. */
+#ifdef INDEX_BENCH_CONF_RUNS
+#define INDEX_BENCH_RUNS INDEX_BENCH_CONF_RUNS
+#else
+#define INDEX_BENCH_RUNS 1000
+#endif
+
+/* The rows are inserted in this stride, which must be coprime with
+   the number of rows for every time value to be inserted once. */
+#define INDEX_BENCH_STEP 7
+
+/* The first time value, and the distance between two time values. */
+#define INDEX_BENCH_TIME_BASE 1000
+#define INDEX_BENCH_TIME_STEP 10
+
+PROCESS(index_bench, "Index benchmark");
+AUTOSTART_PROCESSES(&index_bench);
+
+static int
+query(const char *format, ...)
+{
+  char query_string[AQL_MAX_QUERY_LENGTH];
+  db_result_t result;
+  va_list ap;
+
+  va_start(ap, format);
+  vsnprintf(query_string, sizeof(query_string), format, ap);
+  va_end(ap);
+
+  result = db_query(NULL, "%s", query_string);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n",
+           query_string, db_get_result_message(result));
+    return 0;
+  }
+  return 1;
+}
+
+static int
+create_relation(const char *name, const char *index)
+{
+  unsigned i;
+  unsigned row;
+
+  if(!query("REMOVE RELATION %s;", name) ||
+     !query("CREATE RELATION %s;", name) ||
+     !query("CREATE ATTRIBUTE time DOMAIN LONG IN %s;", name) ||
+     !query("CREATE ATTRIBUTE value DOMAIN INT IN %s;", name)) {
+    return 0;
+  }
+
+  if(index != NULL &&
+     !query("CREATE INDEX %s.time TYPE %s;", name, index)) {
+    return 0;
+  }
+
+  for(i = 0; i < INDEX_BENCH_ROWS; i++) {
+    row = (i * INDEX_BENCH_STEP) % INDEX_BENCH_ROWS;
+    if(!query("INSERT (%lu, %u) INTO %s;",
+              INDEX_BENCH_TIME_BASE +
+              (unsigned long)row * INDEX_BENCH_TIME_STEP, i, name)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void
+run_query(const char *title, const char *name, unsigned long first,
+          unsigned long rows)
+{
+  static db_handle_t handle;
+  db_result_t result;
+  clock_time_t start;
+  clock_time_t time;
+  unsigned long found;
+  unsigned long low;
+  unsigned run;
+  int indexed;
+
+  low = INDEX_BENCH_TIME_BASE + first * INDEX_BENCH_TIME_STEP;
+
+  result = DB_OK;
+  found = 0;
+  indexed = 0;
+  start = clock_time();
+  for(run = 0; run < INDEX_BENCH_RUNS && !DB_ERROR(result); run++) {
+    found = 0;
+    result = db_query(&handle, "SELECT time, value FROM %s "
+                      "WHERE time >= %lu AND time < %lu;",
+                      name, low, low + rows * INDEX_BENCH_TIME_STEP);
+    while(!DB_ERROR(result) && result != DB_FINISHED) {
+      result = db_process(&handle);
+      if(result == DB_GOT_ROW) {
+        found++;
+      }
+    }
+    indexed = (handle.flags & DB_HANDLE_FLAG_SEARCH_INDEX) != 0;
+    db_free(&handle);
+  }
+  time = clock_time() - start;
+
+  if(DB_ERROR(result)) {
+    printf("%-8s %-7s failed: %s\n",
+           name, title, db_get_result_message(result));
+    return;
+  }
+
+  printf("%-8s %-7s %4lu rows selected by %-5s in %7lu us per query\n",
+         name, title, found, indexed ? "index" : "scan",
+         (unsigned long)time * 1000000UL / CLOCK_SECOND / INDEX_BENCH_RUNS);
+}
+
+static void
+run_queries(const char *name)
+{
+  run_query("Point", name, INDEX_BENCH_ROWS / 3, 1);
+  run_query("Narrow", name, INDEX_BENCH_ROWS / 2, 3);
+  run_query("1%", name, INDEX_BENCH_ROWS / 4, INDEX_BENCH_ROWS / 100);
+  run_query("10%", name, INDEX_BENCH_ROWS / 5, INDEX_BENCH_ROWS / 10);
+}
+
+PROCESS_THREAD(index_bench, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  printf("Selecting ranges from %u rows inserted in an arbitrary order\n",
+         INDEX_BENCH_ROWS);
+
+  if(create_relation("scanned", NULL)) {
+    run_queries("scanned");
+  }
+  query("REMOVE RELATION scanned;");
+
+  if(create_relation("heaped", "MAXHEAP")) {
+    run_queries("heaped");
+  }
+  query("REMOVE RELATION heaped;");
+
+#if DB_FEATURE_BPLUSTREE
+  if(create_relation("tree", "BPLUSTREE")) {
+    run_queries("tree");
+  }
+  query("REMOVE RELATION tree;");
+#else
+  printf("B+-tree indexes are disabled (DB_FEATURE_BPLUSTREE)\n");
+#endif /* DB_FEATURE_BPLUSTREE */
+
+  printf("Benchmark finished\n");
+
+  PROCESS_END();
+}
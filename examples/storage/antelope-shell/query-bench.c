@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	A benchmark of the query plans of the database system. Each
+ *	query is timed from parsing to the last result row.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "contiki.h"
+
+#include "antelope.h"
+
+/* The number of rows in the large relations. */
+#ifdef QUERY_BENCH_CONF_ROWS
+#define QUERY_BENCH_ROWS QUERY_BENCH_CONF_ROWS
+#else
+#define QUERY_BENCH_ROWS 2000
+#endif
+
+/* The number of rows in the small relation of a join. */
+#ifdef QUERY_BENCH_CONF_SMALL_ROWS
+#define QUERY_BENCH_SMALL_ROWS QUERY_BENCH_CONF_SMALL_ROWS
+#else
+#define QUERY_BENCH_SMALL_ROWS 50
+#endif
+
+/* The number of distinct join keys. */
+#define QUERY_BENCH_NODES 100
+
+PROCESS(query_bench, "Query benchmark");
+AUTOSTART_PROCESSES(&query_bench);
+
+static int
+query(const char *format, ...)
+{
+  char query_string[AQL_MAX_QUERY_LENGTH];
+  db_result_t result;
+  va_list ap;
+
+  va_start(ap, format);
+  vsnprintf(query_string, sizeof(query_string), format, ap);
+  va_end(ap);
+
+  result = db_query(NULL, "%s", query_string);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n",
+           query_string, db_get_result_message(result));
+    return 0;
+  }
+  return 1;
+}
+
+static int
+create_relation(const char *name, const char *value_attr, const char *index)
+{
+  if(!query("REMOVE RELATION %s;", name) ||
+     !query("CREATE RELATION %s;", name) ||
+     !query("CREATE ATTRIBUTE node DOMAIN INT IN %s;", name) ||
+     !query("CREATE ATTRIBUTE %s DOMAIN INT IN %s;", value_attr, name)) {
+    return 0;
+  }
+
+  /* Indexes are created before the relation is populated, so that
+     they are ready without a background load. */
+  return index == NULL ||
+         query("CREATE INDEX %s.node TYPE %s;", name, index);
+}
+
+static int
+fill_relation(const char *name, unsigned rows, unsigned step, int sorted)
+{
+  unsigned i;
+  unsigned node;
+
+  if(sorted) {
+    /* Insert the rows in the order of their join keys, as required by
+       inline indexes. */
+    for(node = 0; node < QUERY_BENCH_NODES; node++) {
+      for(i = 0; i < rows; i++) {
+        if((i * step) % QUERY_BENCH_NODES == node &&
+           !query("INSERT (%u, %u) INTO %s;", node, i, name)) {
+          return 0;
+        }
+      }
+    }
+    return 1;
+  }
+
+  for(i = 0; i < rows; i++) {
+    if(!query("INSERT (%u, %u) INTO %s;",
+              (i * step) % QUERY_BENCH_NODES, i, name)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void
+run_query(const char *title, const char *query_string)
+{
+  static db_handle_t handle;
+  db_result_t result;
+  clock_time_t start;
+  clock_time_t time;
+  unsigned long rows;
+
+  start = clock_time();
+  result = db_query(&handle, "%s", query_string);
+  for(rows = 0; !DB_ERROR(result) && result != DB_FINISHED;) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      rows++;
+    }
+  }
+  time = clock_time() - start;
+  db_free(&handle);
+
+  if(DB_ERROR(result)) {
+    printf("%-24s failed: %s\n", title, db_get_result_message(result));
+    return;
+  }
+
+  printf("%-24s %6lu rows in %6lu ms",
+         title, rows, (unsigned long)time * 1000 / CLOCK_SECOND);
+  if(time > 0) {
+    printf(", %7lu rows/s", rows * CLOCK_SECOND / time);
+  }
+  printf("\n");
+}
+
+PROCESS_THREAD(query_bench, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  printf("Joining %u and %u rows on %u keys\n",
+         QUERY_BENCH_SMALL_ROWS, QUERY_BENCH_ROWS, QUERY_BENCH_NODES);
+
+  if(!create_relation("small", "room", NULL) ||
+     !fill_relation("small", QUERY_BENCH_SMALL_ROWS, 3, 0) ||
+     !create_relation("large", "value", NULL) ||
+     !fill_relation("large", QUERY_BENCH_ROWS, 7, 0)) {
+    PROCESS_EXIT();
+  }
+
+#if DB_FEATURE_HASH_JOIN
+  run_query("Hash join",
+            "JOIN small, large ON node PROJECT room, value;");
+
+  if(create_relation("large2", "level", NULL) &&
+     fill_relation("large2", QUERY_BENCH_ROWS, 11, 0)) {
+    run_query("Hash join, large",
+              "JOIN large2, large ON node PROJECT level, value;");
+  }
+  query("REMOVE RELATION large2;");
+#else
+  printf("Hash joins are disabled (DB_FEATURE_HASH_JOIN)\n");
+#endif /* DB_FEATURE_HASH_JOIN */
+
+  if(create_relation("heaped", "value", "MAXHEAP") &&
+     fill_relation("heaped", QUERY_BENCH_ROWS, 7, 0)) {
+    run_query("Index join, MaxHeap",
+              "JOIN small, heaped ON node PROJECT room, value;");
+  }
+  query("REMOVE RELATION heaped;");
+
+  if(create_relation("sorted", "value", "INLINE") &&
+     fill_relation("sorted", QUERY_BENCH_ROWS, 7, 1)) {
+    run_query("Index join, inline",
+              "JOIN small, sorted ON node PROJECT room, value;");
+  }
+  query("REMOVE RELATION sorted;");
+
+  query("REMOVE RELATION small;");
+  query("REMOVE RELATION large;");
+
+  printf("Benchmark finished\n");
+
+  PROCESS_END();
+}
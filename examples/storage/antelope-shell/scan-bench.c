@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	A benchmark of selections, which reports the number of rows
+ *	scanned per second for conditions of different kinds. Build it
+ *	with DB_FEATURE_BLOCK_SCAN set to 0 to compare with row-by-row
+ *	scans that evaluate the condition of each row in the logic engine.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "contiki.h"
+
+#include "antelope.h"
+
+/* The number of rows in the relation. */
+#ifdef SCAN_BENCH_CONF_ROWS
+#define SCAN_BENCH_ROWS SCAN_BENCH_CONF_ROWS
+#else
+#define SCAN_BENCH_ROWS 2000
+#endif
+
+/* The number of times that each query is run. */
+#ifdef SCAN_BENCH_CONF_RUNS
+#define SCAN_BENCH_RUNS SCAN_BENCH_CONF_RUNS
+#else
+#define SCAN_BENCH_RUNS 10
+#endif
+
+PROCESS(scan_bench, "Scan benchmark");
+AUTOSTART_PROCESSES(&scan_bench);
+
+static int
+query(const char *format, ...)
+{
+  char query_string[AQL_MAX_QUERY_LENGTH];
+  db_result_t result;
+  va_list ap;
+
+  va_start(ap, format);
+  vsnprintf(query_string, sizeof(query_string), format, ap);
+  va_end(ap);
+
+  result = db_query(NULL, "%s", query_string);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n",
+           query_string, db_get_result_message(result));
+    return 0;
+  }
+  return 1;
+}
+
+static void
+run_query(const char *title, const char *condition)
+{
+  static db_handle_t handle;
+  db_result_t result;
+  clock_time_t start;
+  clock_time_t time;
+  unsigned long rows;
+  unsigned run;
+
+  result = DB_OK;
+  rows = 0;
+  start = clock_time();
+  for(run = 0; run < SCAN_BENCH_RUNS && !DB_ERROR(result); run++) {
+    rows = 0;
+    result = db_query(&handle, "SELECT time, level FROM samples%s%s;",
+                      *condition != '\0' ? " WHERE " : "", condition);
+    while(!DB_ERROR(result) && result != DB_FINISHED) {
+      result = db_process(&handle);
+      if(result == DB_GOT_ROW) {
+        rows++;
+      }
+    }
+    db_free(&handle);
+  }
+  time = clock_time() - start;
+
+  if(DB_ERROR(result)) {
+    printf("%-20s failed: %s\n", title, db_get_result_message(result));
+    return;
+  }
+
+  printf("%-20s %5lu rows selected, %u runs in %6lu ms",
+         title, rows, SCAN_BENCH_RUNS,
+         (unsigned long)time * 1000 / CLOCK_SECOND);
+  if(time > 0) {
+    printf(", %8lu rows/s scanned",
+           (unsigned long)SCAN_BENCH_ROWS * SCAN_BENCH_RUNS * CLOCK_SECOND /
+           time);
+  }
+  printf("\n");
+}
+
+PROCESS_THREAD(scan_bench, ev, data)
+{
+  unsigned i;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  printf("Scanning %u rows, block scans %s\n", SCAN_BENCH_ROWS,
+         DB_FEATURE_BLOCK_SCAN ? "enabled" : "disabled");
+
+  if(!query("REMOVE RELATION samples;") ||
+     !query("CREATE RELATION samples;") ||
+     !query("CREATE ATTRIBUTE time DOMAIN LONG IN samples;") ||
+     !query("CREATE ATTRIBUTE level DOMAIN INT IN samples;")) {
+    PROCESS_EXIT();
+  }
+
+  /* The times are increasing, so that ranges of time are stored in
+     few blocks, while the levels are spread over all blocks. */
+  for(i = 0; i < SCAN_BENCH_ROWS; i++) {
+    if(!query("INSERT (%lu, %u) INTO samples;",
+              100000UL + i * 10, (i * 37) % 1000)) {
+      PROCESS_EXIT();
+    }
+  }
+
+  run_query("No condition", "");
+  run_query("Value", "level = 17");
+  run_query("Range", "level >= 100 AND level < 200");
+  run_query("Clustered range", "time >= 105000 AND time < 106000");
+  run_query("Partial range", "level > 500 AND level <> 700");
+  run_query("Expression", "level * 2 < 200");
+
+  query("REMOVE RELATION samples;");
+
+  printf("Benchmark finished\n");
+
+  PROCESS_END();
+}
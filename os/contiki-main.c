@@ -45,6 +45,7 @@
 #include "sys/node-id.h"
 #include "sys/platform.h"
 #include "sys/energest.h"
+#include "sys/profile.h"
 #include "sys/stack-check.h"
 #include "dev/watchdog.h"
 
@@ -202,6 +203,7 @@ main(void)
   watchdog_init();
 
   energest_init();
+  profile_init();
 
 #if STACK_CHECK_ENABLED
   stack_check_init();
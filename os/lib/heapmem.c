@@ -104,6 +104,23 @@
 #define ALIGN(size)						\
   (((size) + (HEAPMEM_ALIGNMENT - 1)) & ~(HEAPMEM_ALIGNMENT - 1))
 
+/*
+ * The HEAPMEM_CONF_BINS parameter sets the number of size classes
+ * that are kept in segregated free lists ("bins") in front of the
+ * general free list. Bin i holds free chunks of exactly (i + 1) *
+ * HEAPMEM_ALIGNMENT bytes, and each zone has its own set of bins.
+ * An allocation that hits a bin takes constant time and does not
+ * defragment the free list. A zero value disables the bins.
+ */
+#ifdef HEAPMEM_CONF_BINS
+#define HEAPMEM_BINS HEAPMEM_CONF_BINS
+#else
+#define HEAPMEM_BINS 0
+#endif /* HEAPMEM_CONF_BINS */
+
+#define BIN_MAX_SIZE (HEAPMEM_BINS * HEAPMEM_ALIGNMENT)
+#define BIN_INDEX(size) ((size) / HEAPMEM_ALIGNMENT - 1)
+
 /* Macros for chunk iteration. */
 #define NEXT_CHUNK(chunk)						\
   ((chunk_t *)((char *)(chunk) + sizeof(chunk_t) + (chunk)->size))
@@ -119,11 +136,14 @@
 
 /* Macros for determining the status of a chunk. */
 #define CHUNK_FLAG_ALLOCATED            0x1
+#define CHUNK_FLAG_BINNED               0x2
 
 #define CHUNK_ALLOCATED(chunk)			\
   ((chunk)->flags & CHUNK_FLAG_ALLOCATED)
+/* Binned chunks are neither allocated nor on the free list, so they
+   must not be coalesced with their neighbors. */
 #define CHUNK_FREE(chunk)			\
-  (~(chunk)->flags & CHUNK_FLAG_ALLOCATED)
+  (!((chunk)->flags & (CHUNK_FLAG_ALLOCATED | CHUNK_FLAG_BINNED)))
 
 /*
  * A heapmem zone denotes a logical subdivision of the heap that is
@@ -180,6 +200,13 @@ static size_t max_heap_usage;
 
 static chunk_t *free_list;
 
+#if HEAPMEM_BINS
+/* Single-linked lists of free chunks per zone and size class. */
+static chunk_t *bins[HEAPMEM_MAX_ZONES][HEAPMEM_BINS];
+static size_t bin_hits;
+static size_t bin_misses;
+#endif /* HEAPMEM_BINS */
+
 #define IN_HEAP(ptr) ((ptr) != NULL && \
                      (char *)(ptr) >= (char *)heap_base) && \
                      ((char *)(ptr) < (char *)heap_base + heap_usage)
@@ -206,7 +233,7 @@ extend_space(size_t size)
 static void
 free_chunk(chunk_t * const chunk)
 {
-  chunk->flags &= ~CHUNK_FLAG_ALLOCATED;
+  chunk->flags &= ~(CHUNK_FLAG_ALLOCATED | CHUNK_FLAG_BINNED);
 
   if(IS_LAST_CHUNK(chunk)) {
     /* Release the chunk back into the wilderness. */
@@ -330,6 +357,110 @@ get_free_chunk(const size_t size)
   return best;
 }
 
+/* get_heap_chunk: Get a chunk from the free list, or by extending
+   the heap space if no suitable free chunk exists. */
+static chunk_t *
+get_heap_chunk(const size_t size)
+{
+  chunk_t *chunk = get_free_chunk(size);
+  if(chunk == NULL) {
+    chunk = extend_space(sizeof(chunk_t) + size);
+    if(chunk != NULL) {
+      chunk->size = size;
+    }
+  }
+  return chunk;
+}
+
+#if HEAPMEM_BINS
+/* put_chunk_in_bin: Keep a deallocated chunk in the bin of its zone
+   and size class. */
+static void
+put_chunk_in_bin(chunk_t * const chunk)
+{
+  chunk_t **bin = &bins[chunk->zone][BIN_INDEX(chunk->size)];
+
+  chunk->flags = CHUNK_FLAG_BINNED;
+  chunk->prev = NULL;
+  chunk->next = *bin;
+  *bin = chunk;
+}
+
+/* get_binned_chunk: Take a chunk of the requested size from the bin
+   of a zone, if there is one. */
+static chunk_t *
+get_binned_chunk(heapmem_zone_t zone, const size_t size)
+{
+  chunk_t **bin = &bins[zone][BIN_INDEX(size)];
+  chunk_t *chunk = *bin;
+
+  if(chunk == NULL) {
+    bin_misses++;
+    return NULL;
+  }
+
+  bin_hits++;
+  *bin = chunk->next;
+  chunk->next = NULL;
+  return chunk;
+}
+
+/* flush_bins: Move all binned chunks to the free list, where they can
+   be coalesced with adjacent free chunks. Returns the number of bytes
+   that were moved. */
+static size_t
+flush_bins(void)
+{
+  size_t flushed = 0;
+
+  for(heapmem_zone_t zone = 0; zone < HEAPMEM_MAX_ZONES; zone++) {
+    for(int i = 0; i < HEAPMEM_BINS; i++) {
+      while(bins[zone][i] != NULL) {
+        chunk_t *chunk = bins[zone][i];
+        bins[zone][i] = chunk->next;
+        flushed += chunk->size;
+        free_chunk(chunk);
+      }
+    }
+  }
+
+  return flushed;
+}
+#endif /* HEAPMEM_BINS */
+
+/*
+ * allocate_chunk: Find a chunk for an allocation in a zone. Small
+ * allocations are first served from the bins of the zone. On a bin
+ * miss, we fall back to the free list and the heap space, which is
+ * also where defragmentation takes place. If that fails too, the
+ * memory held in the bins of all zones is released, and we try once
+ * more.
+ */
+static chunk_t *
+allocate_chunk(heapmem_zone_t zone, const size_t size)
+{
+  chunk_t *chunk;
+
+#if HEAPMEM_BINS
+  if(size <= BIN_MAX_SIZE) {
+    chunk = get_binned_chunk(zone, size);
+    if(chunk != NULL) {
+      return chunk;
+    }
+  }
+#endif /* HEAPMEM_BINS */
+
+  chunk = get_heap_chunk(size);
+
+#if HEAPMEM_BINS
+  if(chunk == NULL && flush_bins() > 0) {
+    chunk = get_heap_chunk(size);
+  }
+#endif /* HEAPMEM_BINS */
+
+  return chunk;
+}
+
 /*
  * heapmem_zone_register: Register a new zone, which is essentially a
  * subdivision of the heap with a reserved allocation space. This
@@ -377,7 +508,9 @@ heapmem_zone_register(const char *name, size_t zone_size)
  * found, we pick a larger chunk that is as close in size as possible,
  * and possibly split it so that the remaining part becomes a chunk
  * available for allocation. At most CHUNK_SEARCH_MAX chunks on the
- * free list will be examined.
+ * free list will be examined. Allocations that fit in a size class
+ * are first served from the bins of the zone, if HEAPMEM_CONF_BINS is
+ * set.
  *
  * As a last resort, heapmem_alloc() will try to extend the heap
  * space, and thereby create a new chunk available for use.
@@ -407,13 +540,9 @@ heapmem_zone_alloc(heapmem_zone_t zone, size_t size)
     return NULL;
   }
 
-  chunk_t *chunk = get_free_chunk(size);
+  chunk_t *chunk = allocate_chunk(zone, size);
   if(chunk == NULL) {
-    chunk = extend_space(sizeof(chunk_t) + size);
-    if(chunk == NULL) {
-      return NULL;
-    }
-    chunk->size = size;
+    return NULL;
   }
 
   chunk->flags = CHUNK_FLAG_ALLOCATED;
@@ -441,6 +570,9 @@ heapmem_zone_alloc(heapmem_zone_t zone, size_t size)
  * When deallocating a chunk, the chunk will be inserted into the free
  * list. Moreover, all free chunks that are adjacent in memory will be
  * merged into a single chunk in order to mitigate fragmentation.
+ * Small chunks are instead kept in the bin of their zone and size
+ * class if HEAPMEM_CONF_BINS is set, and are only merged when the
+ * bins are flushed.
  */
 bool
 #if HEAPMEM_DEBUG
@@ -469,6 +601,13 @@ heapmem_free(void *ptr)
 
   zones[chunk->zone].allocated -= sizeof(chunk_t) + chunk->size;
 
+#if HEAPMEM_BINS
+  if(chunk->size <= BIN_MAX_SIZE && !IS_LAST_CHUNK(chunk)) {
+    put_chunk_in_bin(chunk);
+    return true;
+  }
+#endif /* HEAPMEM_BINS */
+
   free_chunk(chunk);
   return true;
 }
@@ -620,18 +759,44 @@ heapmem_stats(heapmem_stats_t *stats)
 {
   memset(stats, 0, sizeof(*stats));
 
+#if HEAPMEM_BINS
+  /* The bins are only read, so that the statistics do not change the
+     bins or their hit rate. */
+  for(heapmem_zone_t zone = 0; zone < HEAPMEM_MAX_ZONES; zone++) {
+    for(int i = 0; i < HEAPMEM_BINS; i++) {
+      for(chunk_t *chunk = bins[zone][i]; chunk != NULL;
+          chunk = chunk->next) {
+        stats->binned += chunk->size;
+        stats->binned_chunks++;
+      }
+    }
+  }
+  stats->bin_hits = bin_hits;
+  stats->bin_misses = bin_misses;
+#endif /* HEAPMEM_BINS */
+
   for(chunk_t *chunk = (chunk_t *)heap_base;
       (char *)chunk < &heap_base[heap_usage];
       chunk = NEXT_CHUNK(chunk)) {
     if(CHUNK_ALLOCATED(chunk)) {
       stats->allocated += chunk->size;
       stats->overhead += sizeof(chunk_t);
-    } else {
+    } else if(CHUNK_FREE(chunk)) {
       coalesce_chunks(chunk);
       stats->available += chunk->size;
+      stats->free_chunks++;
+      if(chunk->size > stats->largest_free) {
+        stats->largest_free = chunk->size;
+      }
     }
   }
+  /* Binned memory is returned to the free list when the heap runs
+     out, so it is available for allocation. */
+  stats->available += stats->binned;
   stats->available += HEAPMEM_ARENA_SIZE - heap_usage;
+  if(HEAPMEM_ARENA_SIZE - heap_usage > stats->largest_free) {
+    stats->largest_free = HEAPMEM_ARENA_SIZE - heap_usage;
+  }
   stats->footprint = heap_usage;
   stats->max_footprint = max_heap_usage;
   stats->chunks = stats->overhead / sizeof(chunk_t);
@@ -653,6 +818,12 @@ heapmem_print_debug_info(bool print_chunks)
   HEAPMEM_PRINTF("* Allocated chunks: %zu\n", stats.chunks);
   HEAPMEM_PRINTF("* Chunk size: %zu\n", sizeof(chunk_t));
   HEAPMEM_PRINTF("* Total chunk overhead: %zu\n", stats.overhead);
+  HEAPMEM_PRINTF("* Free chunks: %zu\n", stats.free_chunks);
+  HEAPMEM_PRINTF("* Largest free space: %zu\n", stats.largest_free);
+  HEAPMEM_PRINTF("* Binned memory: %zu in %zu chunks\n",
+                 stats.binned, stats.binned_chunks);
+  HEAPMEM_PRINTF("* Bin hits: %zu, misses: %zu\n",
+                 stats.bin_hits, stats.bin_misses);
 
   if(print_chunks) {
     HEAPMEM_PRINTF("* Allocated chunks:\n");
@@ -45,6 +45,12 @@
  * adds some memory overhead compared to a single-linked list, it
  * improves the performance of list management.
  *
+ * If HEAPMEM_CONF_BINS is set, freed chunks of small sizes are kept in
+ * per-zone bins of fixed size classes, from which later allocations
+ * of the same size are served in constant time. The memory held in
+ * the bins is returned to the general free list when an allocation
+ * cannot be satisfied otherwise.
+ *
  * Internally, allocated chunks can be retrieved using the pointer to
  * the allocated memory returned by heapmem_alloc() and
  * heapmem_realloc(), because the chunk structure immediately precedes
@@ -91,6 +97,15 @@ typedef struct heapmem_stats {
   size_t footprint;
   size_t max_footprint;
   size_t chunks;
+  /* Fragmentation of the free space. */
+  size_t free_chunks;
+  size_t largest_free;
+  /* Size-class bins (HEAPMEM_CONF_BINS). "binned" tells how much
+     memory the bins hold, which is also counted as available. */
+  size_t binned;
+  size_t binned_chunks;
+  size_t bin_hits;
+  size_t bin_misses;
 } heapmem_stats_t;
 /*****************************************************************************/
 typedef uint8_t heapmem_zone_t;
@@ -51,10 +51,90 @@
 void
 memb_init(struct memb *m)
 {
+#if MEMB_WITH_USED_FLAGS
   memset(m->used, 0, m->num);
+#endif /* MEMB_WITH_USED_FLAGS */
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_FREE_LIST
+  m->free_list = NULL;
+  m->fresh = 0;
+#endif /* MEMB_FREE_LIST */
+#if MEMB_FREE_LIST || MEMB_STATS
+  m->allocated = 0;
+#endif /* MEMB_FREE_LIST || MEMB_STATS */
+#if MEMB_STATS
+  m->max_allocated = 0;
+  m->failed_allocations = 0;
+#endif /* MEMB_STATS */
 }
 /*---------------------------------------------------------------------------*/
+#if MEMB_FREE_LIST
+void *
+memb_alloc(struct memb *m)
+{
+  void *block;
+
+  if(m->free_list != NULL) {
+    block = m->free_list;
+    m->free_list = *(void **)block;
+  } else if(m->fresh < m->num) {
+    block = (char *)m->mem + (m->fresh++ * m->size);
+  } else {
+#if MEMB_STATS
+    m->failed_allocations++;
+#endif /* MEMB_STATS */
+    return NULL;
+  }
+
+#if MEMB_CHECK_DOUBLE_FREE
+  m->used[((char *)block - (char *)m->mem) / m->size] = true;
+#endif /* MEMB_CHECK_DOUBLE_FREE */
+
+  m->allocated++;
+#if MEMB_STATS
+  if(m->allocated > m->max_allocated) {
+    m->max_allocated = m->allocated;
+  }
+#endif /* MEMB_STATS */
+
+  return block;
+}
+/*---------------------------------------------------------------------------*/
+int
+memb_free(struct memb *m, void *ptr)
+{
+  size_t offset;
+  size_t i;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+
+  i = offset / m->size;
+  if(i >= m->fresh) {
+    /* The block has never been allocated. */
+    return -1;
+  }
+
+#if MEMB_CHECK_DOUBLE_FREE
+  if(m->used[i] == false) {
+    return -1;
+  }
+  m->used[i] = false;
+#endif /* MEMB_CHECK_DOUBLE_FREE */
+
+  *(void **)ptr = m->free_list;
+  m->free_list = ptr;
+  m->allocated--;
+
+  return 0;
+}
+#else /* MEMB_FREE_LIST */
 void *
 memb_alloc(struct memb *m)
 {
@@ -65,12 +145,20 @@ memb_alloc(struct memb *m)
       /* If this block was unused, we set the used flag on
 	 and return a pointer to the memory block. */
       m->used[i] = true;
+#if MEMB_STATS
+      if(++m->allocated > m->max_allocated) {
+        m->max_allocated = m->allocated;
+      }
+#endif /* MEMB_STATS */
       return (void *)((char *)m->mem + (i * m->size));
     }
   }
 
   /* No free block was found, so we return NULL to indicate failure to
      allocate block. */
+#if MEMB_STATS
+  m->failed_allocations++;
+#endif /* MEMB_STATS */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -90,12 +178,16 @@ memb_free(struct memb *m, void *ptr)
       if (m->used[i] == false)
         return -1;
       m->used[i] = false;
+#if MEMB_STATS
+      m->allocated--;
+#endif /* MEMB_STATS */
       return 0;
     }
     ptr2 += m->size;
   }
   return -1;
 }
+#endif /* MEMB_FREE_LIST */
 /*---------------------------------------------------------------------------*/
 int
 memb_inmemb(struct memb *m, void *ptr)
@@ -107,6 +199,9 @@ memb_inmemb(struct memb *m, void *ptr)
 size_t
 memb_numfree(struct memb *m)
 {
+#if MEMB_FREE_LIST || MEMB_STATS
+  return m->num - m->allocated;
+#else /* MEMB_FREE_LIST || MEMB_STATS */
   int i;
   size_t num_free = 0;
 
@@ -117,5 +212,19 @@ memb_numfree(struct memb *m)
   }
 
   return num_free;
+#endif /* MEMB_FREE_LIST || MEMB_STATS */
+}
+/*---------------------------------------------------------------------------*/
+void
+memb_stats(struct memb *m, memb_stats_t *stats)
+{
+  stats->allocated = m->num - memb_numfree(m);
+#if MEMB_STATS
+  stats->max_allocated = m->max_allocated;
+  stats->failed_allocations = m->failed_allocations;
+#else /* MEMB_STATS */
+  stats->max_allocated = 0;
+  stats->failed_allocations = 0;
+#endif /* MEMB_STATS */
 }
 /** @} */
@@ -64,9 +64,60 @@
 #define MEMB_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include "sys/cc.h"
 
+/**
+ * \brief Manage free blocks in an intrusive free list.
+ *
+ * By default, memb_alloc() and memb_free() scan the block array,
+ * which is linear in the number of blocks. With this option
+ * enabled, free blocks are instead linked through their own memory,
+ * so that allocation pops the head of the free list and
+ * deallocation computes the block index from the address. Blocks
+ * are padded to hold at least a pointer.
+ */
+#ifdef MEMB_CONF_FREE_LIST
+#define MEMB_FREE_LIST MEMB_CONF_FREE_LIST
+#else /* MEMB_CONF_FREE_LIST */
+#define MEMB_FREE_LIST 0
+#endif /* MEMB_CONF_FREE_LIST */
+
+/**
+ * \brief Detect double frees when using the free list.
+ *
+ * Keeps the per-block allocation flags so that memb_free() can
+ * reject blocks that are not allocated. Without the flags, freeing
+ * a block twice corrupts the free list. The option has no effect
+ * without MEMB_FREE_LIST, because the flags are then always needed.
+ */
+#ifdef MEMB_CONF_CHECK_DOUBLE_FREE
+#define MEMB_CHECK_DOUBLE_FREE MEMB_CONF_CHECK_DOUBLE_FREE
+#else /* MEMB_CONF_CHECK_DOUBLE_FREE */
+#define MEMB_CHECK_DOUBLE_FREE 1
+#endif /* MEMB_CONF_CHECK_DOUBLE_FREE */
+
+/**
+ * \brief Keep per-pool allocation statistics, see memb_stats().
+ */
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else /* MEMB_CONF_STATS */
+#define MEMB_STATS 0
+#endif /* MEMB_CONF_STATS */
+
+#define MEMB_WITH_USED_FLAGS (!MEMB_FREE_LIST || MEMB_CHECK_DOUBLE_FREE)
+
+#if MEMB_WITH_USED_FLAGS
+#define MEMB_USED_FLAGS(name, num) \
+        static bool CC_CONCAT(name,_memb_used)[num];
+#define MEMB_USED_INIT(name) CC_CONCAT(name,_memb_used),
+#else /* MEMB_WITH_USED_FLAGS */
+#define MEMB_USED_FLAGS(name, num)
+#define MEMB_USED_INIT(name)
+#endif /* MEMB_WITH_USED_FLAGS */
+
 /**
  * Declare a memory block.
  *
@@ -88,20 +139,57 @@ MEMB(connections, struct connection, 16);
  * \param num The total number of memory chunks in the block.
  *
  */
+#if MEMB_FREE_LIST
+#define MEMB(name, structure, num) \
+        MEMB_USED_FLAGS(name, num) \
+        static union { \
+          structure block; \
+          void *next_free; \
+        } CC_CONCAT(name,_memb_mem)[num]; \
+        static struct memb name = {sizeof(CC_CONCAT(name,_memb_mem)[0]), num, \
+                                   MEMB_USED_INIT(name) \
+                                   (void *)CC_CONCAT(name,_memb_mem)}
+#else /* MEMB_FREE_LIST */
 #define MEMB(name, structure, num) \
-        static bool CC_CONCAT(name,_memb_used)[num]; \
+        MEMB_USED_FLAGS(name, num) \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
-                                          CC_CONCAT(name,_memb_used), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                   MEMB_USED_INIT(name) \
+                                   (void *)CC_CONCAT(name,_memb_mem)}
+#endif /* MEMB_FREE_LIST */
 
 struct memb {
   unsigned short size;
   unsigned short num;
+#if MEMB_WITH_USED_FLAGS
   bool *used;
+#endif /* MEMB_WITH_USED_FLAGS */
   void *mem;
+#if MEMB_FREE_LIST
+  /* Blocks that have been allocated and freed again. */
+  void *free_list;
+  /* Blocks from this index onwards have never been allocated, which
+     makes a zero-initialized memb usable before memb_init(). */
+  unsigned short fresh;
+#endif /* MEMB_FREE_LIST */
+#if MEMB_FREE_LIST || MEMB_STATS
+  unsigned short allocated;
+#endif /* MEMB_FREE_LIST || MEMB_STATS */
+#if MEMB_STATS
+  unsigned short max_allocated;
+  uint32_t failed_allocations;
+#endif /* MEMB_STATS */
 };
 
+/**
+ * Allocation statistics of a memory block, as reported by memb_stats().
+ */
+typedef struct memb_stats {
+  size_t allocated;
+  size_t max_allocated;
+  size_t failed_allocations;
+} memb_stats_t;
+
 /**
  * Initialize a memory block that was declared with MEMB().
  *
@@ -150,6 +238,15 @@ int memb_inmemb(struct memb *m, void *ptr);
  */
 size_t memb_numfree(struct memb *m);
 
+/**
+ * Obtain allocation statistics for a memory block.
+ * The high watermark and the allocation failure count are only
+ * maintained if MEMB_CONF_STATS is enabled, and are zero otherwise.
+ * \param m m A set of memory blocks previously declared with MEMB().
+ * \param stats A pointer to an object that receives the statistics.
+ */
+void memb_stats(struct memb *m, memb_stats_t *stats);
+
 /** @} */
 /** @} */
 
@@ -112,6 +112,46 @@
 #define COAP_OBSERVER_URL_LEN 20
 #endif
 
+/* Render a notification once and send it to all observers, changing only
+   the type, MID, token and observe option. Otherwise, the resource handler
+   is called once per observer. */
+#ifdef COAP_CONF_OBSERVE_BATCH
+#define COAP_OBSERVE_BATCH COAP_CONF_OBSERVE_BATCH
+#else
+#define COAP_OBSERVE_BATCH 1
+#endif
+
+/* Minimal interval in milliseconds between two notifications for the same
+   URL. Notifications triggered within the interval are coalesced into one
+   that is sent when the interval has passed. 0 disables the limit. */
+#ifdef COAP_CONF_OBSERVE_MIN_INTERVAL
+#define COAP_OBSERVE_MIN_INTERVAL COAP_CONF_OBSERVE_MIN_INTERVAL
+#else
+#define COAP_OBSERVE_MIN_INTERVAL 0
+#endif
+
+/* Number of URLs for which the notification interval is limited */
+#ifdef COAP_CONF_OBSERVE_MAX_LIMITED
+#define COAP_OBSERVE_MAX_LIMITED COAP_CONF_OBSERVE_MAX_LIMITED
+#else
+#define COAP_OBSERVE_MAX_LIMITED 4
+#endif
+
+/* Look up the resource of a request in a hash table of resource URLs
+   instead of comparing the URL of every activated resource */
+#ifdef COAP_CONF_RESOURCE_INDEX
+#define COAP_RESOURCE_INDEX COAP_CONF_RESOURCE_INDEX
+#else
+#define COAP_RESOURCE_INDEX 0
+#endif
+
+/* Number of buckets in the resource hash table */
+#ifdef COAP_CONF_RESOURCE_HASH_SIZE
+#define COAP_RESOURCE_HASH_SIZE COAP_CONF_RESOURCE_HASH_SIZE
+#else
+#define COAP_RESOURCE_HASH_SIZE 16
+#endif
+
 /* Enable the well-known resource (well-known/core) by default */
 #ifdef COAP_CONF_WELL_KNOWN_RESOURCE_ENABLED
 #define COAP_WELL_KNOWN_RESOURCE_ENABLED  COAP_CONF_WELL_KNOWN_RESOURCE_ENABLED
@@ -71,6 +71,11 @@ static int invoke_coap_resource_service(coap_message_t *request,
 LIST(coap_handlers);
 LIST(coap_resource_services);
 static uint8_t is_initialized = 0;
+/* Changed whenever resources are moved within the list. */
+static uint16_t resource_generation;
+#if COAP_RESOURCE_INDEX
+static coap_resource_t *resource_hash[COAP_RESOURCE_HASH_SIZE];
+#endif /* COAP_RESOURCE_INDEX */
 
 /*---------------------------------------------------------------------------*/
 /*- CoAP service handlers---------------------------------------------------*/
@@ -393,6 +398,7 @@ coap_engine_init(void)
 
   list_init(coap_handlers);
   list_init(coap_resource_services);
+  resource_generation++;
 
 #if COAP_WELL_KNOWN_RESOURCE_ENABLED
   coap_activate_resource(&res_well_known_core, ".well-known/core");
@@ -402,6 +408,60 @@ coap_engine_init(void)
   coap_init_connection();
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_RESOURCE_INDEX
+static coap_resource_t **
+resource_bucket(const char *url, int url_len)
+{
+  uint32_t h = 2166136261;
+  int i;
+
+  for(i = 0; i < url_len; i++) {
+    h = (h ^ (uint8_t)url[i]) * 16777619;
+  }
+  return &resource_hash[h % COAP_RESOURCE_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static void
+resource_hash_add(coap_resource_t *resource)
+{
+  coap_resource_t **r;
+
+  /* Append, so that the resource activated first is found first */
+  for(r = resource_bucket(resource->url, strlen(resource->url)); *r != NULL;
+      r = &(*r)->hash_next);
+  resource->hash_next = NULL;
+  *r = resource;
+}
+/*---------------------------------------------------------------------------*/
+static void
+resource_hash_remove(coap_resource_t *resource)
+{
+  coap_resource_t **r;
+
+  for(r = resource_bucket(resource->url, strlen(resource->url)); *r != NULL;
+      r = &(*r)->hash_next) {
+    if(*r == resource) {
+      *r = resource->hash_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static coap_resource_t *
+resource_hash_lookup(const char *url, int url_len, uint8_t sub_resource)
+{
+  coap_resource_t *r;
+
+  for(r = *resource_bucket(url, url_len); r != NULL; r = r->hash_next) {
+    if((!sub_resource || (r->flags & HAS_SUB_RESOURCES))
+       && strncmp(r->url, url, url_len) == 0 && r->url[url_len] == '\0') {
+      return r;
+    }
+  }
+  return NULL;
+}
+#endif /* COAP_RESOURCE_INDEX */
+/*---------------------------------------------------------------------------*/
 /**
  * \brief Makes a resource available under the given URI path
  *
@@ -413,7 +473,18 @@ void
 coap_activate_resource(coap_resource_t *resource, const char *path)
 {
   coap_periodic_resource_t *periodic;
+  if(list_contains(coap_resource_services, resource)) {
+    /* Activated again, possibly under another path. The resource is
+       moved to the end of the list below. */
+    resource_generation++;
+#if COAP_RESOURCE_INDEX
+    resource_hash_remove(resource);
+#endif /* COAP_RESOURCE_INDEX */
+  }
   resource->url = path;
+#if COAP_RESOURCE_INDEX
+  resource_hash_add(resource);
+#endif /* COAP_RESOURCE_INDEX */
   list_add(coap_resource_services, resource);
 
   LOG_INFO("Activating: %s\n", resource->url);
@@ -446,6 +517,50 @@ coap_get_next_resource(coap_resource_t *resource)
   return list_item_next(resource);
 }
 /*---------------------------------------------------------------------------*/
+uint16_t
+coap_get_resource_generation(void)
+{
+  return resource_generation;
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the resource that handles the URL: a resource with the URL itself
+   or a resource with sub-resources whose URL is a path prefix of it */
+static coap_resource_t *
+find_resource(const char *url, int url_len)
+{
+  coap_resource_t *resource;
+#if COAP_RESOURCE_INDEX
+  int len = url_len;
+
+  /* Try the URL and then its path prefixes, longest first */
+  for(;;) {
+    resource = resource_hash_lookup(url, len, len < url_len);
+    if(resource != NULL || len == 0) {
+      return resource;
+    }
+    while(len > 0 && url[--len] != '/');
+    if(url[len] != '/') {
+      return NULL;
+    }
+  }
+#else /* COAP_RESOURCE_INDEX */
+  int res_url_len;
+
+  for(resource = list_head(coap_resource_services);
+      resource; resource = resource->next) {
+    res_url_len = strlen(resource->url);
+    if((url_len == res_url_len
+        || (url_len > res_url_len
+            && (resource->flags & HAS_SUB_RESOURCES)
+            && url[res_url_len] == '/'))
+       && strncmp(resource->url, url, res_url_len) == 0) {
+      return resource;
+    }
+  }
+  return NULL;
+#endif /* COAP_RESOURCE_INDEX */
+}
+/*---------------------------------------------------------------------------*/
 static int
 invoke_coap_resource_service(coap_message_t *request, coap_message_t *response,
                              uint8_t *buffer, uint16_t buffer_size,
@@ -456,44 +571,34 @@ invoke_coap_resource_service(coap_message_t *request, coap_message_t *response,
 
   coap_resource_t *resource = NULL;
   const char *url = NULL;
-  int url_len, res_url_len;
+  int url_len;
 
   url_len = coap_get_header_uri_path(request, &url);
-  for(resource = list_head(coap_resource_services);
-      resource; resource = resource->next) {
-
-    /* if the web service handles that kind of requests and urls matches */
-    res_url_len = strlen(resource->url);
-    if((url_len == res_url_len
-        || (url_len > res_url_len
-            && (resource->flags & HAS_SUB_RESOURCES)
-            && url[res_url_len] == '/'))
-       && strncmp(resource->url, url, res_url_len) == 0) {
-      coap_resource_flags_t method = coap_get_method_type(request);
-      found = 1;
-
-      LOG_INFO("/%s, method %u, resource->flags %u\n", resource->url,
-               (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
+  resource = find_resource(url, url_len);
+  if(resource != NULL) {
+    coap_resource_flags_t method = coap_get_method_type(request);
+    found = 1;
+
+    LOG_INFO("/%s, method %u, resource->flags %u\n", resource->url,
+             (uint16_t)method, resource->flags);
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
                                offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        coap_set_status_code(response, METHOD_NOT_ALLOWED_4_05);
-      }
-      break;
+    } else {
+      allowed = 0;
+      coap_set_status_code(response, METHOD_NOT_ALLOWED_4_05);
     }
   }
   if(!found) {
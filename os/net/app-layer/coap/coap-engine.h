@@ -111,6 +111,9 @@ struct coap_resource_s {
     coap_resource_trigger_handler_t trigger;
     coap_resource_trigger_handler_t resume;
   };
+#if COAP_RESOURCE_INDEX
+  coap_resource_t *hash_next;       /* next resource in the same hash bucket */
+#endif /* COAP_RESOURCE_INDEX */
 };
 
 struct coap_periodic_resource_s {
@@ -167,6 +170,14 @@ coap_resource_t *coap_get_first_resource(void);
  */
 coap_resource_t *coap_get_next_resource(coap_resource_t *resource);
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief      Returns a number that changes when registered resources are
+ *             reordered, such as when a resource is activated again.
+ *             Appending new resources does not change it.
+ * \return     The generation of the resource list.
+ */
+uint16_t coap_get_resource_generation(void);
+/*---------------------------------------------------------------------------*/
 
 #include "coap-transactions.h"
 #include "coap-observe.h"
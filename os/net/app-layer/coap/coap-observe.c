@@ -56,6 +56,17 @@
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
+#if COAP_OBSERVE_MIN_INTERVAL > 0
+typedef struct {
+  char url[COAP_OBSERVER_URL_LEN];
+  coap_resource_t *resource;
+  uint64_t last_notification;
+  coap_timer_t timer;
+  uint8_t pending;
+} notification_limit_t;
+
+static notification_limit_t limits[COAP_OBSERVE_MAX_LIMITED];
+#endif /* COAP_OBSERVE_MIN_INTERVAL > 0 */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -97,8 +108,8 @@ coap_remove_observer(coap_observer_t *o)
   LOG_INFO("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0],
            o->token[1]);
 
-  memb_free(&observers_memb, o);
   list_remove(observers_list, o);
+  memb_free(&observers_memb, o);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -106,12 +117,14 @@ coap_remove_observer_by_client(const coap_endpoint_t *endpoint)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
   LOG_DBG("Remove check client ");
   LOG_DBG_COAP_EP(endpoint);
   LOG_DBG_("\n");
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+      obs = next) {
+    next = obs->next;
     if(coap_endpoint_cmp(&obs->endpoint, endpoint)) {
       coap_remove_observer(obs);
       removed++;
@@ -126,9 +139,11 @@ coap_remove_observer_by_token(const coap_endpoint_t *endpoint,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+      obs = next) {
+    next = obs->next;
     LOG_DBG("Remove check Token 0x%02X%02X\n", token[0], token[1]);
     if(coap_endpoint_cmp(&obs->endpoint, endpoint)
        && obs->token_len == token_len
@@ -146,9 +161,11 @@ coap_remove_observer_by_uri(const coap_endpoint_t *endpoint,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+      obs = next) {
+    next = obs->next;
     LOG_DBG("Remove check URL %p\n", uri);
     if((endpoint == NULL
         || (coap_endpoint_cmp(&obs->endpoint, endpoint)))
@@ -165,9 +182,11 @@ coap_remove_observer_by_mid(const coap_endpoint_t *endpoint, uint16_t mid)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+      obs = next) {
+    next = obs->next;
     LOG_DBG("Remove check MID %u\n", mid);
     if(coap_endpoint_cmp(&obs->endpoint, endpoint)
        && obs->last_mid == mid) {
@@ -185,36 +204,53 @@ coap_notify_observers(coap_resource_t *resource)
 {
   coap_notify_observers_sub(resource, NULL);
 }
-/* Can be used either for sub - or when there is not resource - just
-   a handler */
-void
-coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
+/*---------------------------------------------------------------------------*/
+static void
+render_notification(coap_resource_t *resource, coap_message_t *request,
+                    coap_message_t *notification, uint8_t *buffer)
+{
+  int32_t new_offset = 0;
+
+  /* Either old style get_handler or the full handler */
+  if(coap_call_handlers(request, notification, buffer, COAP_MAX_CHUNK_SIZE,
+                        &new_offset) > 0) {
+    LOG_DBG("Notification on new handlers\n");
+  } else {
+    if(resource != NULL) {
+      resource->get_handler(request, notification, buffer,
+                            COAP_MAX_CHUNK_SIZE, &new_offset);
+    } else {
+      /* What to do here? */
+      notification->code = BAD_REQUEST_4_00;
+    }
+  }
+
+  if(new_offset != 0) {
+    coap_set_header_block2(notification,
+                           0,
+                           new_offset != -1,
+                           COAP_MAX_BLOCK_SIZE);
+    coap_set_payload(notification,
+                     notification->payload,
+                     MIN(notification->payload_len,
+                         COAP_MAX_BLOCK_SIZE));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+notify_observers(coap_resource_t *resource, const char *url)
 {
   /* build notification */
   coap_message_t notification[1]; /* this way the message can be treated as pointer as usual */
   coap_message_t request[1]; /* this way the message can be treated as pointer as usual */
   coap_observer_t *obs = NULL;
   int url_len, obs_url_len;
-  char url[COAP_OBSERVER_URL_LEN];
   uint8_t sub_ok = 0;
-
-  if(resource != NULL) {
-    url_len = strlen(resource->url);
-    strncpy(url, resource->url, COAP_OBSERVER_URL_LEN - 1);
-    if(url_len < COAP_OBSERVER_URL_LEN - 1 && subpath != NULL) {
-      strncpy(&url[url_len], subpath, COAP_OBSERVER_URL_LEN - url_len - 1);
-    }
-  } else if(subpath != NULL) {
-    strncpy(url, subpath, COAP_OBSERVER_URL_LEN - 1);
-  } else {
-    /* No resource, no subpath */
-    return;
-  }
-
-  /* Ensure url is null terminated because strncpy does not guarantee this */
-  url[COAP_OBSERVER_URL_LEN - 1] = '\0';
-  /* url now contains the notify URL that needs to match the observer */
-  LOG_INFO("Notification from %s\n", url);
+#if COAP_OBSERVE_BATCH
+  /* +1 for the terminating '\0', as in the transaction buffer */
+  static uint8_t notification_buffer[COAP_MAX_CHUNK_SIZE + 1];
+  uint8_t rendered = 0;
+#endif /* COAP_OBSERVE_BATCH */
 
   coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
   /* create a "fake" request for the URI */
@@ -241,10 +277,19 @@ coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
        && strncmp(url, obs->url, url_len) == 0) {
       coap_transaction_t *transaction = NULL;
 
-      /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
-
       if((transaction = coap_new_transaction(coap_get_mid(), &obs->endpoint))) {
+#if COAP_OBSERVE_BATCH
+        /* The representation is the same for all observers: render it for
+           the first one and serialize the same message for the others */
+        if(!rendered) {
+          render_notification(resource, request, notification,
+                              notification_buffer);
+          rendered = 1;
+        }
+#endif /* COAP_OBSERVE_BATCH */
+
         /* if COAP_OBSERVE_REFRESH_INTERVAL is zero, never send observations as confirmable messages */
+        notification->type = COAP_TYPE_NON;
         if(COAP_OBSERVE_REFRESH_INTERVAL != 0
             && (obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0)) {
           LOG_DBG("           Force Confirmable for\n");
@@ -261,23 +306,10 @@ coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
         /* prepare response */
         notification->mid = transaction->mid;
 
-	int32_t new_offset = 0;
-
-        /* Either old style get_handler or the full handler */
-        if(coap_call_handlers(request, notification, transaction->message +
-                              COAP_MAX_HEADER_SIZE, COAP_MAX_CHUNK_SIZE,
-                              &new_offset) > 0) {
-          LOG_DBG("Notification on new handlers\n");
-        } else {
-          if(resource != NULL) {
-            resource->get_handler(request, notification,
-                                  transaction->message + COAP_MAX_HEADER_SIZE,
-                                  COAP_MAX_CHUNK_SIZE, &new_offset);
-          } else {
-            /* What to do here? */
-            notification->code = BAD_REQUEST_4_00;
-          }
-        }
+#if !COAP_OBSERVE_BATCH
+        render_notification(resource, request, notification,
+                            transaction->message + COAP_MAX_HEADER_SIZE);
+#endif /* !COAP_OBSERVE_BATCH */
 
         if(notification->code < BAD_REQUEST_4_00) {
           coap_set_header_observe(notification, (obs->obs_counter)++);
@@ -286,17 +318,6 @@ coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
         }
         coap_set_token(notification, obs->token, obs->token_len);
 
-	if(new_offset != 0) {
-	  coap_set_header_block2(notification,
-				 0,
-				 new_offset != -1,
-				 COAP_MAX_BLOCK_SIZE);
-	  coap_set_payload(notification,
-			   notification->payload,
-			   MIN(notification->payload_len,
-			       COAP_MAX_BLOCK_SIZE));
-	}
-
         transaction->message_len =
           coap_serialize_message(notification, transaction->message);
 
@@ -306,6 +327,101 @@ coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_MIN_INTERVAL > 0
+static void
+limited_notification_expired(coap_timer_t *timer)
+{
+  notification_limit_t *limit = coap_timer_get_user_data(timer);
+
+  limit->pending = 0;
+  limit->last_notification = coap_timer_uptime();
+  notify_observers(limit->resource, limit->url);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns 1 if the notification has been deferred or coalesced */
+static int
+limit_notification(coap_resource_t *resource, const char *url)
+{
+  notification_limit_t *limit = NULL;
+  uint64_t now = coap_timer_uptime();
+  int i;
+
+  for(i = 0; i < COAP_OBSERVE_MAX_LIMITED; i++) {
+    if(strcmp(limits[i].url, url) == 0) {
+      limit = &limits[i];
+      break;
+    }
+  }
+
+  if(limit == NULL) {
+    /* Take over the URL that was notified least recently */
+    for(i = 0; i < COAP_OBSERVE_MAX_LIMITED; i++) {
+      if(!limits[i].pending
+         && (limit == NULL
+             || limits[i].last_notification < limit->last_notification)) {
+        limit = &limits[i];
+      }
+    }
+    if(limit == NULL) {
+      /* All URLs have a pending notification, do not limit this one */
+      return 0;
+    }
+    strcpy(limit->url, url);
+  } else if(limit->pending) {
+    LOG_DBG("Coalescing notification for %s\n", url);
+    limit->resource = resource;
+    return 1;
+  } else if(now - limit->last_notification < COAP_OBSERVE_MIN_INTERVAL) {
+    LOG_DBG("Deferring notification for %s\n", url);
+    limit->resource = resource;
+    limit->pending = 1;
+    coap_timer_set_callback(&limit->timer, limited_notification_expired);
+    coap_timer_set_user_data(&limit->timer, limit);
+    coap_timer_set(&limit->timer, limit->last_notification +
+                   COAP_OBSERVE_MIN_INTERVAL - now);
+    return 1;
+  }
+
+  limit->last_notification = now;
+  return 0;
+}
+#endif /* COAP_OBSERVE_MIN_INTERVAL > 0 */
+/*---------------------------------------------------------------------------*/
+/* Can be used either for sub - or when there is not resource - just
+   a handler */
+void
+coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
+{
+  int url_len;
+  char url[COAP_OBSERVER_URL_LEN];
+
+  if(resource != NULL) {
+    url_len = strlen(resource->url);
+    strncpy(url, resource->url, COAP_OBSERVER_URL_LEN - 1);
+    if(url_len < COAP_OBSERVER_URL_LEN - 1 && subpath != NULL) {
+      strncpy(&url[url_len], subpath, COAP_OBSERVER_URL_LEN - url_len - 1);
+    }
+  } else if(subpath != NULL) {
+    strncpy(url, subpath, COAP_OBSERVER_URL_LEN - 1);
+  } else {
+    /* No resource, no subpath */
+    return;
+  }
+
+  /* Ensure url is null terminated because strncpy does not guarantee this */
+  url[COAP_OBSERVER_URL_LEN - 1] = '\0';
+  /* url now contains the notify URL that needs to match the observer */
+  LOG_INFO("Notification from %s\n", url);
+
+#if COAP_OBSERVE_MIN_INTERVAL > 0
+  if(limit_notification(resource, url)) {
+    return;
+  }
+#endif /* COAP_OBSERVE_MIN_INTERVAL > 0 */
+
+  notify_observers(resource, url);
+}
+/*---------------------------------------------------------------------------*/
 void
 coap_observe_handler(const coap_resource_t *resource, coap_message_t *coap_req,
                      coap_message_t *coap_res)
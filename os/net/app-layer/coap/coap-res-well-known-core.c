@@ -75,6 +75,17 @@
 /*---------------------------------------------------------------------------*/
 /*- Resource Handlers -------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+/*
+ * The resource at which the last block ended and its position in the link
+ * format, so that the next block does not walk all resources before it.
+ * Appending resources leaves the position valid, but activating a resource
+ * again moves it to the end of the list and may change its URL, so the
+ * cursor is only used within the same generation of the resource list.
+ */
+static coap_resource_t *cursor_resource;
+static size_t cursor_strpos;
+static uint16_t cursor_generation;
+/*---------------------------------------------------------------------------*/
 static void
 well_known_core_get_handler(coap_message_t *request, coap_message_t *response,
                             uint8_t *buffer, uint16_t preferred_size,
@@ -83,7 +94,9 @@ well_known_core_get_handler(coap_message_t *request, coap_message_t *response,
   size_t strpos = 0;            /* position in overall string (which is larger than the buffer) */
   size_t bufpos = 0;            /* position within buffer (bytes written) */
   size_t tmplen = 0;
+  size_t resource_strpos = 0;   /* position of the current resource */
   coap_resource_t *resource = NULL;
+  uint8_t use_cursor = 1;       /* the cursor is for the unfiltered list */
 
 #if COAP_LINK_FORMAT_FILTERING
   /* For filtering. */
@@ -112,11 +125,20 @@ well_known_core_get_handler(coap_message_t *request, coap_message_t *response,
 
     lastchar = value[len - 1];
     value[len - 1] = '\0';
+    use_cursor = 0;
   }
 #endif /* COAP_LINK_FORMAT_FILTERING */
 
-  for(resource = coap_get_first_resource(); resource;
-      resource = coap_get_next_resource(resource)) {
+  resource = coap_get_first_resource();
+  if(use_cursor && cursor_resource != NULL && cursor_strpos <= *offset &&
+     cursor_generation == coap_get_resource_generation()) {
+    resource = cursor_resource;
+    strpos = cursor_strpos;
+  }
+
+  for(; resource; resource = coap_get_next_resource(resource)) {
+    resource_strpos = strpos;
+
 #if COAP_LINK_FORMAT_FILTERING
     /* Filtering */
     if(len) {
@@ -204,6 +226,11 @@ well_known_core_get_handler(coap_message_t *request, coap_message_t *response,
   } else {
     LOG_DBG("MORE at %s (%p)\n", resource->url, resource);
     *offset += preferred_size;
+    if(use_cursor) {
+      cursor_resource = resource;
+      cursor_strpos = resource_strpos;
+      cursor_generation = coap_get_resource_generation();
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -249,7 +249,14 @@ call_event(struct mqtt_connection *conn,
 static void
 reset_defaults(struct mqtt_connection *conn)
 {
+#if MQTT_MAX_INFLIGHT > 1
+  /* Keep the message IDs of retransmitted messages unique */
+  if(conn->inflight_count == 0) {
+    conn->mid_counter = 1;
+  }
+#else
   conn->mid_counter = 1;
+#endif
   PT_INIT(&conn->out_proto_thread);
   conn->waiting_for_pingresp = 0;
 
@@ -350,7 +357,7 @@ write_byte(struct mqtt_connection *conn, uint8_t data)
 }
 /*---------------------------------------------------------------------------*/
 static int
-write_bytes(struct mqtt_connection *conn, uint8_t *data, uint16_t len)
+write_bytes(struct mqtt_connection *conn, const uint8_t *data, uint16_t len)
 {
   uint16_t write_bytes;
   write_bytes =
@@ -827,11 +834,122 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+#if MQTT_MAX_INFLIGHT > 1
+static struct mqtt_inflight *
+inflight_get(struct mqtt_connection *conn, uint8_t i)
+{
+  return &conn->inflight[(conn->inflight_head + i) % MQTT_MAX_INFLIGHT];
+}
+/*---------------------------------------------------------------------------*/
+static void
+inflight_add(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *msg;
+
+  msg = inflight_get(conn, conn->inflight_count);
+  conn->inflight_count++;
+
+  msg->mid = conn->out_packet.mid;
+  msg->acked = 0;
+  msg->resend = 0;
+  msg->topic = conn->out_packet.topic;
+  msg->topic_length = conn->out_packet.topic_length;
+  msg->payload = conn->out_packet.payload;
+  msg->payload_size = conn->out_packet.payload_size;
+  msg->payload_iov = conn->out_packet.payload_iov;
+  msg->payload_iovcnt = conn->out_packet.payload_iovcnt;
+  msg->retain = conn->out_packet.retain;
+#if MQTT_5
+  msg->topic_alias = conn->out_packet.topic_alias;
+  msg->props = conn->out_props;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+inflight_ack(struct mqtt_connection *conn, uint16_t mid)
+{
+  struct mqtt_inflight *msg;
+  uint8_t i;
+
+  for(i = 0; i < conn->inflight_count; i++) {
+    msg = inflight_get(conn, i);
+    if(msg->mid == mid) {
+      msg->acked = 1;
+      break;
+    }
+  }
+  if(i == conn->inflight_count) {
+    DBG("MQTT - Warning, got PUBACK for unknown MID %u\n", mid);
+  }
+
+  /* Report the acknowledgements in the order the messages were published */
+  while(conn->inflight_count > 0 && inflight_get(conn, 0)->acked) {
+    mid = inflight_get(conn, 0)->mid;
+    conn->inflight_head = (conn->inflight_head + 1) % MQTT_MAX_INFLIGHT;
+    conn->inflight_count--;
+    call_event(conn, MQTT_EVENT_PUBACK, &mid);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+inflight_mark_resend(struct mqtt_connection *conn)
+{
+  uint8_t i;
+
+  for(i = 0; i < conn->inflight_count; i++) {
+    inflight_get(conn, i)->resend = 1;
+  }
+
+  /* Retransmit unacknowledged messages before accepting new ones */
+  if(conn->inflight_count > 0) {
+    conn->out_queue_full = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Loads the oldest message that is marked for retransmission into the out
+ * packet. Returns 0 if there is none.
+ */
+static int
+inflight_load_resend(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *msg;
+  uint8_t i;
+
+  for(i = 0; i < conn->inflight_count; i++) {
+    msg = inflight_get(conn, i);
+    if(msg->resend) {
+      msg->resend = 0;
+      conn->out_packet.mid = msg->mid;
+      conn->out_packet.topic = msg->topic;
+      conn->out_packet.topic_length = msg->topic_length;
+      conn->out_packet.payload = msg->payload;
+      conn->out_packet.payload_size = msg->payload_size;
+      conn->out_packet.payload_iov = msg->payload_iov;
+      conn->out_packet.payload_iovcnt = msg->payload_iovcnt;
+      conn->out_packet.retain = msg->retain;
+      conn->out_packet.qos = MQTT_QOS_LEVEL_1;
+      conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
+      conn->out_packet.dup = 1;
+#if MQTT_5
+      conn->out_packet.topic_alias = msg->topic_alias;
+      conn->out_props = msg->props;
+#endif
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* MQTT_MAX_INFLIGHT > 1 */
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
 {
   PT_BEGIN(pt);
 
+  /* A previous QoS 0 PUBLISH may still be on its way out */
+  PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+
   DBG("MQTT - Sending publish message! topic %s topic_length %i\n",
       conn->out_packet.topic,
       conn->out_packet.topic_length);
@@ -869,7 +987,15 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
   /* The DUP flag MUST be set to 0 for all QoS 0 messages */
   if(conn->out_packet.qos == MQTT_QOS_LEVEL_0) {
     conn->out_packet.fhdr &= ~MQTT_FHDR_DUP_FLAG;
+  } else if(conn->out_packet.dup) {
+    conn->out_packet.fhdr |= MQTT_FHDR_DUP_FLAG;
+  }
+
+#if MQTT_MAX_INFLIGHT > 1
+  if(conn->out_packet.qos == MQTT_QOS_LEVEL_1 && !conn->out_packet.dup) {
+    inflight_add(conn);
   }
+#endif
 
   /* Write Fixed Header */
   PT_MQTT_WRITE_BYTE(conn, conn->out_packet.fhdr);
@@ -891,9 +1017,19 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
 #endif
 
   /* Write Payload */
-  PT_MQTT_WRITE_BYTES(conn,
-                      conn->out_packet.payload,
-                      conn->out_packet.payload_size);
+  if(conn->out_packet.payload_iov == NULL) {
+    PT_MQTT_WRITE_BYTES(conn,
+                        conn->out_packet.payload,
+                        conn->out_packet.payload_size);
+  } else {
+    for(conn->out_packet.payload_iov_pos = 0;
+        conn->out_packet.payload_iov_pos < conn->out_packet.payload_iovcnt;
+        conn->out_packet.payload_iov_pos++) {
+      PT_MQTT_WRITE_BYTES(conn,
+                          conn->out_packet.payload_iov[conn->out_packet.payload_iov_pos].data,
+                          conn->out_packet.payload_iov[conn->out_packet.payload_iov_pos].len);
+    }
+  }
 
   send_out_buffer(conn);
   timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
@@ -906,6 +1042,11 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
    */
   if(conn->out_packet.qos == 0) {
     process_post(conn->app_process, mqtt_update_event, NULL);
+#if MQTT_MAX_INFLIGHT > 1
+  } else if(conn->out_packet.qos == 1) {
+    /* The PUBACK is handled when it arrives, see inflight_ack() */
+    process_post(conn->app_process, mqtt_update_event, NULL);
+#else
   } else if(conn->out_packet.qos == 1) {
     /* Wait for PUBACK */
     reset_packet(&conn->in_packet);
@@ -918,6 +1059,7 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
       DBG("MQTT - Warning, got PUBACK with none matching MID. Currently there "
           "is no support for several concurrent PUBLISH messages.\n");
     }
+#endif
   } else if(conn->out_packet.qos == 2) {
     DBG("MQTT - QoS not implemented yet.\n");
     /* Should wait for PUBREC, send PUBREL and then wait for PUBCOMP */
@@ -1058,6 +1200,10 @@ handle_connack(struct mqtt_connection *conn)
   ctimer_set(&conn->keep_alive_timer, conn->keep_alive * CLOCK_SECOND,
              keep_alive_callback, conn);
 
+#if MQTT_MAX_INFLIGHT > 1
+  inflight_mark_resend(conn);
+#endif
+
   /* Always reset packet before callback since it might be used directly */
   conn->state = MQTT_CONN_STATE_CONNECTED_TO_BROKER;
   call_event(conn, MQTT_EVENT_CONNECTED, &connack_event);
@@ -1146,9 +1292,13 @@ handle_puback(struct mqtt_connection *conn)
 {
   DBG("MQTT - Got PUBACK\n");
 
+#if MQTT_MAX_INFLIGHT > 1
+  inflight_ack(conn, conn->in_packet.mid);
+#else
   conn->out_packet.qos_state = MQTT_QOS_STATE_GOT_ACK;
 
   call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
+#endif
 }
 /*---------------------------------------------------------------------------*/
 static mqtt_pub_status_t
@@ -1337,28 +1487,31 @@ parse_vhdr(struct mqtt_connection *conn)
 #endif
 }
 /*---------------------------------------------------------------------------*/
+static uint32_t
+packet_bytes_left(struct mqtt_connection *conn)
+{
+  return MQTT_FHDR_SIZE + conn->in_packet.remaining_length_bytes +
+    conn->in_packet.remaining_length - conn->in_packet.byte_counter;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Reads at most one packet from the input data and returns the number of
+ * bytes consumed.
+ */
 static int
-tcp_input(struct tcp_socket *s,
-          void *ptr,
-          const uint8_t *input_data_ptr,
-          int input_data_len)
+input_packet(struct mqtt_connection *conn,
+             const uint8_t *input_data_ptr,
+             int input_data_len)
 {
-  struct mqtt_connection *conn = ptr;
   uint32_t pos = 0;
   uint32_t copy_bytes = 0;
   mqtt_pub_status_t pub_status;
   uint8_t remaining_length_bytes;
 
-  if(input_data_len == 0) {
-    return 0;
-  }
-
   if(conn->in_packet.packet_received) {
     reset_packet(&conn->in_packet);
   }
 
-  DBG("tcp_input with %i bytes of data:\n", input_data_len);
-
   /* Read the fixed header field, if we do not have it */
   if(!conn->in_packet.fhdr) {
     conn->in_packet.fhdr = input_data_ptr[pos++];
@@ -1367,7 +1520,7 @@ tcp_input(struct tcp_socket *s,
     DBG("MQTT - Read VHDR '%02X'\n", conn->in_packet.fhdr);
 
     if(pos >= input_data_len) {
-      return 0;
+      return pos;
     }
   }
 
@@ -1380,11 +1533,12 @@ tcp_input(struct tcp_socket *s,
 
     if(remaining_length_bytes == 0) {
       call_event(conn, MQTT_EVENT_ERROR, NULL);
-      return 0;
+      return input_data_len;
     }
 
     DBG("MQTT - Finished reading remaining length byte\n");
     conn->in_packet.has_remaining_length = 1;
+    conn->in_packet.remaining_length_bytes = remaining_length_bytes;
   }
 
   /*
@@ -1398,12 +1552,12 @@ tcp_input(struct tcp_socket *s,
 
     PRINTF("MQTT - Error, unsupported payload size for non-PUBLISH message\n");
 
-    conn->in_packet.byte_counter += input_data_len;
-    if(conn->in_packet.byte_counter >=
-       (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
+    copy_bytes = MIN(input_data_len - pos, packet_bytes_left(conn));
+    conn->in_packet.byte_counter += copy_bytes;
+    if(packet_bytes_left(conn) == 0) {
       conn->in_packet.packet_received = 1;
     }
-    return 0;
+    return pos + copy_bytes;
   }
 
   /*
@@ -1412,17 +1566,40 @@ tcp_input(struct tcp_socket *s,
    * Note: There will always be at least one byte left to read when we enter
    *       this loop.
    */
-  while(conn->in_packet.byte_counter <
-        (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
+  while(packet_bytes_left(conn) > 0) {
 
     if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH &&
        conn->in_packet.topic_received == 0) {
       parse_publish_vhdr(conn, &pos, input_data_ptr, input_data_len);
     }
 
+#if MQTT_STREAM_INPUT && !MQTT_5
+    /* Hand the payload to the app straight from the socket input buffer */
+    if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH &&
+       conn->in_packet.topic_received) {
+      copy_bytes = MIN(input_data_len - pos, conn->in_publish_msg.payload_left);
+      if(copy_bytes == 0 && conn->in_publish_msg.payload_left > 0) {
+        return pos;
+      }
+
+      conn->in_publish_msg.payload_chunk = (uint8_t *)&input_data_ptr[pos];
+      conn->in_publish_msg.payload_chunk_length = copy_bytes;
+      conn->in_publish_msg.payload_left -= copy_bytes;
+      conn->in_packet.byte_counter += copy_bytes;
+      pos += copy_bytes;
+
+      (void)handle_publish(conn);
+      if(conn->in_publish_msg.payload_left == 0) {
+        conn->in_packet.packet_received = 1;
+      }
+      return pos;
+    }
+#endif
+
     /* Read in as much as we can into the packet payload */
     copy_bytes = MIN(input_data_len - pos,
                      MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos);
+    copy_bytes = MIN(copy_bytes, packet_bytes_left(conn));
     DBG("- Copied %i payload bytes\n", copy_bytes);
     memcpy(&conn->in_packet.payload[conn->in_packet.payload_pos],
            &input_data_ptr[pos],
@@ -1467,13 +1644,12 @@ tcp_input(struct tcp_socket *s,
       conn->in_packet.payload_pos = 0;
 
       if(pub_status != MQTT_PUBLISH_OK) {
-        return 0;
+        return input_data_len;
       }
     }
 
-    if(pos >= input_data_len &&
-       (conn->in_packet.byte_counter < (MQTT_FHDR_SIZE + conn->in_packet.remaining_length))) {
-      return 0;
+    if(pos >= input_data_len && packet_bytes_left(conn) > 0) {
+      return pos;
     }
   }
 
@@ -1485,7 +1661,8 @@ tcp_input(struct tcp_socket *s,
   DBG("MQTT - Finished reading packet!\n");
   /* What to return? */
   DBG("MQTT - total data was %i bytes of data. \n",
-      (MQTT_FHDR_SIZE + conn->in_packet.remaining_length));
+      (MQTT_FHDR_SIZE + conn->in_packet.remaining_length_bytes +
+       conn->in_packet.remaining_length));
 
 #if MQTT_5
   if(conn->in_packet.has_reason_code &&
@@ -1496,7 +1673,7 @@ tcp_input(struct tcp_socket *s,
                MQTT_EVENT_ERROR,
                NULL);
     abort_connection(conn);
-    return 0;
+    return input_data_len;
   }
 #endif
 
@@ -1563,6 +1740,26 @@ tcp_input(struct tcp_socket *s,
 
   conn->in_packet.packet_received = 1;
 
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+tcp_input(struct tcp_socket *s,
+          void *ptr,
+          const uint8_t *input_data_ptr,
+          int input_data_len)
+{
+  struct mqtt_connection *conn = ptr;
+  int pos = 0;
+
+  DBG("tcp_input with %i bytes of data:\n", input_data_len);
+
+  /* A segment may carry several packets, e.g. the PUBACKs of a window */
+  while(pos < input_data_len &&
+        conn->state != MQTT_CONN_STATE_NOT_CONNECTED) {
+    pos += input_packet(conn, &input_data_ptr[pos], input_data_len - pos);
+  }
+
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -1589,9 +1786,12 @@ tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
     call_event(conn, MQTT_EVENT_DISCONNECTED, &event);
     abort_connection(conn);
 
-    /* If connecting retry */
+    /*
+     * If connecting retry. Queue the connect behind the abort event posted
+     * above, which would otherwise tear down the new connection.
+     */
     if(conn->auto_reconnect == 1) {
-      connect_tcp(conn);
+      process_post(&mqtt_process, mqtt_do_connect_tcp_event, conn);
     }
     break;
   }
@@ -1653,6 +1853,17 @@ PROCESS_THREAD(mqtt_process, ev, data)
               conn->state != MQTT_CONN_STATE_ABORT_IMMEDIATE) {
           PT_MQTT_WAIT_SEND();
         }
+#if MQTT_MAX_INFLIGHT > 1
+        while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
+              inflight_load_resend(conn)) {
+          conn->out_queue_full = 1;
+          PT_INIT(&conn->out_proto_thread);
+          while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
+                publish_pt(&conn->out_proto_thread, conn) < PT_EXITED) {
+            PT_MQTT_WAIT_SEND();
+          }
+        }
+#endif
       }
     }
     if(ev == mqtt_do_disconnect_mqtt_event) {
@@ -1717,8 +1928,12 @@ PROCESS_THREAD(mqtt_process, ev, data)
       conn = data;
       DBG("MQTT - Got mqtt_do_publish_mqtt_event!\n");
 
-      if(conn->out_buffer_sent == 1 &&
-         conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+      /*
+       * The app may publish again as soon as the previous QoS 0 PUBLISH has
+       * been handed to TCP, so publish_pt waits for the out buffer itself
+       * rather than dropping the event and leaving the out queue full.
+       */
+      if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
         PT_INIT(&conn->out_proto_thread);
         while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
               publish_pt(&conn->out_proto_thread, conn) < PT_EXITED) {
@@ -1998,10 +2213,18 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
     DBG("MQTT - Not accepted!\n");
     return MQTT_STATUS_OUT_QUEUE_FULL;
   }
+#if MQTT_MAX_INFLIGHT > 1
+  if(qos_level == MQTT_QOS_LEVEL_1 &&
+     conn->inflight_count == MQTT_MAX_INFLIGHT) {
+    DBG("MQTT - Not accepted, window full!\n");
+    return MQTT_STATUS_OUT_QUEUE_FULL;
+  }
+#endif
   conn->out_queue_full = 1;
   DBG("MQTT - Accepted!\n");
 
   conn->out_packet.mid = INCREMENT_MID(conn);
+  conn->out_packet.dup = 0;
   conn->out_packet.retain = retain;
 #if MQTT_5
   if(topic_alias_en == MQTT_TOPIC_ALIAS_ON) {
@@ -2022,6 +2245,8 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
 #endif
   conn->out_packet.payload = payload;
   conn->out_packet.payload_size = payload_size;
+  conn->out_packet.payload_iov = NULL;
+  conn->out_packet.payload_iovcnt = 0;
   conn->out_packet.qos = qos_level;
   conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
 
@@ -2037,6 +2262,43 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
   return MQTT_STATUS_OK;
 }
 /*----------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_publish_iov(struct mqtt_connection *conn, uint16_t *mid, char *topic,
+                 const struct mqtt_iovec *iov, uint8_t iovcnt,
+                 mqtt_qos_level_t qos_level,
+#if MQTT_5
+                 mqtt_retain_t retain,
+                 uint8_t topic_alias, mqtt_topic_alias_en_t topic_alias_en,
+                 struct mqtt_prop_list *prop_list)
+#else
+                 mqtt_retain_t retain)
+#endif
+{
+  mqtt_status_t status;
+  uint32_t payload_size;
+  uint8_t i;
+
+  payload_size = 0;
+  for(i = 0; i < iovcnt; i++) {
+    payload_size += iov[i].len;
+  }
+
+#if MQTT_5
+  status = mqtt_publish(conn, mid, topic, NULL, payload_size, qos_level,
+                        retain, topic_alias, topic_alias_en, prop_list);
+#else
+  status = mqtt_publish(conn, mid, topic, NULL, payload_size, qos_level,
+                        retain);
+#endif
+
+  /* The publish event is handled later on by mqtt_process */
+  if(status == MQTT_STATUS_OK) {
+    conn->out_packet.payload_iov = iov;
+    conn->out_packet.payload_iovcnt = iovcnt;
+  }
+  return status;
+}
+/*----------------------------------------------------------------------------*/
 void
 mqtt_set_username_password(struct mqtt_connection *conn, char *username,
                            char *password)
@@ -127,6 +127,32 @@
 
 #define MQTT_INPUT_BUFF_SIZE 512
 #define MQTT_MAX_TOPIC_LENGTH 64
+
+/*
+ * Hand PUBLISH payload chunks to the application straight from the TCP
+ * socket input buffer instead of first collecting them in the
+ * MQTT_INPUT_BUFF_SIZE packet buffer. Each TCP segment then results in one
+ * MQTT_EVENT_PUBLISH per message it carries payload for. Ignored with MQTTv5,
+ * where the properties precede the payload.
+ */
+#ifdef MQTT_CONF_STREAM_INPUT
+#define MQTT_STREAM_INPUT MQTT_CONF_STREAM_INPUT
+#else
+#define MQTT_STREAM_INPUT 0
+#endif
+
+/*
+ * Number of QoS 1 PUBLISH messages that may wait for their PUBACK at the
+ * same time. With 1, a QoS 1 PUBLISH keeps the connection busy until its
+ * PUBACK arrives. With more, messages are pipelined: they are kept until
+ * acknowledged, retransmitted after a reconnect and MQTT_EVENT_PUBACK is
+ * delivered in the order they were published.
+ */
+#ifdef MQTT_CONF_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT MQTT_CONF_MAX_INFLIGHT
+#else
+#define MQTT_MAX_INFLIGHT 1
+#endif
 #define MQTT_MAX_TOPICS_PER_SUBSCRIBE 1
 
 #define MQTT_FHDR_SIZE 1
@@ -435,6 +461,7 @@ struct mqtt_in_packet {
 
   /* Helper variables needed to decode the remaining_length */
   uint8_t has_remaining_length;
+  uint8_t remaining_length_bytes;
 
   /* Not the same as payload in the MQTT sense, it also contains the variable
    * header.
@@ -464,6 +491,15 @@ struct mqtt_in_packet {
 #endif
 };
 
+/*
+ * One segment of a PUBLISH payload that is scattered over several
+ * caller-owned buffers, see mqtt_publish_iov().
+ */
+struct mqtt_iovec {
+  const uint8_t *data;
+  uint32_t len;
+};
+
 /* This struct represents a packet sent to the MQTT server. */
 struct mqtt_out_packet {
   uint8_t fhdr;
@@ -475,6 +511,10 @@ struct mqtt_out_packet {
   uint16_t topic_length;
   uint8_t *payload;
   uint32_t payload_size;
+  const struct mqtt_iovec *payload_iov;
+  uint8_t payload_iovcnt;
+  uint8_t payload_iov_pos;
+  uint8_t dup;
   mqtt_qos_level_t qos;
   mqtt_qos_state_t qos_state;
   mqtt_retain_t retain;
@@ -485,6 +525,26 @@ struct mqtt_out_packet {
   uint8_t auth_reason_code;
 #endif
 };
+
+#if MQTT_MAX_INFLIGHT > 1
+/* A QoS 1 PUBLISH message that waits for its PUBACK */
+struct mqtt_inflight {
+  uint16_t mid;
+  uint8_t acked;
+  uint8_t resend;
+  char *topic;
+  uint16_t topic_length;
+  uint8_t *payload;
+  uint32_t payload_size;
+  const struct mqtt_iovec *payload_iov;
+  uint8_t payload_iovcnt;
+  mqtt_retain_t retain;
+#if MQTT_5
+  uint8_t topic_alias;
+  struct mqtt_prop_list *props;
+#endif
+};
+#endif
 /*---------------------------------------------------------------------------*/
 /**
  * \brief           MQTT event callback function
@@ -552,6 +612,12 @@ struct mqtt_connection {
   struct pt out_proto_thread;
   uint32_t out_write_pos;
   uint16_t max_segment_size;
+#if MQTT_MAX_INFLIGHT > 1
+  /* Unacknowledged QoS 1 messages, oldest first */
+  struct mqtt_inflight inflight[MQTT_MAX_INFLIGHT];
+  uint8_t inflight_head;
+  uint8_t inflight_count;
+#endif
 
   /* Incoming data related */
   uint8_t in_buffer[MQTT_TCP_INPUT_BUFF_SIZE];
@@ -698,6 +764,10 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  * \return MQTT_STATUS_OK or some error status
  *
  * This function publishes to a topic on a MQTT broker.
+ *
+ * With MQTT_MAX_INFLIGHT > 1, the topic and payload of a QoS 1 message must
+ * stay untouched until its MQTT_EVENT_PUBACK, since they are retransmitted
+ * if the connection is lost before then.
  */
 mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            uint16_t *mid,
@@ -714,6 +784,42 @@ mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            mqtt_retain_t retain);
 #endif
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Publish a payload scattered over several buffers to a MQTT topic.
+ * \param conn A pointer to the MQTT connection.
+ * \param mid A pointer to message ID.
+ * \param topic A pointer to the topic to publish to.
+ * \param iov An array of payload segments.
+ * \param iovcnt Number of segments in \p iov.
+ * \param qos_level Quality Of Service level to use. Currently supports 0, 1.
+ * \param retain The RETAIN flag, see mqtt_publish().
+ * \param topic_alias Topic alias to send (MQTTv5-only).
+ * \param topic_alias_en Control whether or not to discard topic and only send
+ *        topic alias s(MQTTv5-only).
+ * \param prop_list Output properties (MQTTv5-only).
+ * \return MQTT_STATUS_OK or some error status
+ *
+ * Works like mqtt_publish(), but the payload is the concatenation of the
+ * \p iovcnt segments. The segments are written to the TCP socket output
+ * buffer in place, without being assembled first. The array and the
+ * buffers it points to are owned by the caller and must stay untouched
+ * until the application is notified that the publish is complete.
+ */
+mqtt_status_t mqtt_publish_iov(struct mqtt_connection *conn,
+                               uint16_t *mid,
+                               char *topic,
+                               const struct mqtt_iovec *iov,
+                               uint8_t iovcnt,
+                               mqtt_qos_level_t qos_level,
+#if MQTT_5
+                               mqtt_retain_t retain,
+                               uint8_t topic_alias,
+                               mqtt_topic_alias_en_t topic_alias_en,
+                               struct mqtt_prop_list *prop_list);
+#else
+                               mqtt_retain_t retain);
+#endif
+/*---------------------------------------------------------------------------*/
 /**
  * \brief Set the user name and password for a MQTT client.
  * \param conn A pointer to the MQTT connection.
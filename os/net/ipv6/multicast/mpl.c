@@ -157,6 +157,10 @@ struct mpl_msg {
   uint16_t size; /* Side of the data stored above */
   uint8_t seq; /* The sequence number of the message */
   uint8_t e; /* Expiration count for trickle timer */
+#if MPL_HASH_INDEX
+  struct mpl_msg *older; /* The message buffered before this one */
+  struct mpl_msg *newer; /* The message buffered after this one */
+#endif /* MPL_HASH_INDEX */
   uint8_t data[UIP_BUFSIZE]; /* Message payload */
 };
 /**
@@ -208,6 +212,12 @@ struct mpl_seed {
   uint8_t count; /* Only used for determining largest msg set during reclaim */
   LIST_STRUCT(min_seq); /* Pointer to the first msg in this seed's set */
   struct mpl_domain *domain; /* The domain this seed belongs to */
+#if MPL_HASH_INDEX
+  struct mpl_seed *hash_next; /* Next seed in the same hash bucket */
+  struct mpl_msg *max_seq; /* Pointer to the last msg in this seed's set */
+  uint8_t window[32]; /* Bit vector of the buffered sequence numbers */
+  uint8_t present; /* Set if the seed is listed in a control message */
+#endif /* MPL_HASH_INDEX */
 };
 /**
  * \brief Get the state of the used flag in the buffered message set entry
@@ -226,6 +236,9 @@ struct mpl_domain {
   uip_ip6addr_t ctrl_addr; /* Link-local scoped version of data address */
   struct trickle_timer tt;
   uint8_t e; /* Expiration count for trickle timer */
+#if MPL_HASH_INDEX
+  struct mpl_domain *hash_next; /* Next domain in the same hash bucket */
+#endif /* MPL_HASH_INDEX */
 };
 /**
  * \brief Get the state of the used flag in the buffered message set entry
@@ -399,6 +412,14 @@ static struct mpl_stats stats;
 static struct mpl_msg buffered_message_set[MPL_BUFFERED_MESSAGE_SET_SIZE];
 static struct mpl_seed seed_set[MPL_SEED_SET_SIZE];
 static struct mpl_domain domain_set[MPL_DOMAIN_SET_SIZE];
+#if MPL_HASH_INDEX
+static struct mpl_seed *seed_hash[MPL_SEED_HASH_SIZE];
+static struct mpl_domain *domain_hash[MPL_DOMAIN_SET_SIZE];
+/* Buffered messages in the order they were allocated */
+static struct mpl_msg *msg_oldest;
+static struct mpl_msg *msg_newest;
+LIST(msg_free_list);
+#endif /* MPL_HASH_INDEX */
 static uint16_t last_seq;
 static seed_id_t local_seed_id;
 #if MPL_SUB_TO_ALL_FORWARDERS
@@ -449,6 +470,12 @@ extern uint16_t uip_slen;
  * b: The 0-indexed bit to set
  */
 #define BIT_VECTOR_SET_BIT(v, b) (v[b / 8] |= (0x80 >> b % 8))
+/**
+ * \brief Clear a single bit within a bit vector that spans multiple bytes
+ * v: The bit vector
+ * b: The 0-indexed bit to clear
+ */
+#define BIT_VECTOR_CLR_BIT(v, b) (v[b / 8] &= ~(0x80 >> b % 8))
 /**
  * \brief Get the value of a bit in a bit vector
  * v: The bit vector
@@ -466,9 +493,122 @@ extern uint16_t uip_slen;
 static void icmp_in(void);
 UIP_ICMP6_HANDLER(mpl_icmp_handler, ICMP6_MPL, 0, icmp_in);
 
+#if MPL_HASH_INDEX
+static void
+msg_age_add(struct mpl_msg *msg)
+{
+  /* Append to the newest end of the buffered messages */
+  msg->older = msg_newest;
+  msg->newer = NULL;
+  if(msg_newest != NULL) {
+    msg_newest->newer = msg;
+  } else {
+    msg_oldest = msg;
+  }
+  msg_newest = msg;
+}
+static void
+msg_age_remove(struct mpl_msg *msg)
+{
+  if(msg->older != NULL) {
+    msg->older->newer = msg->newer;
+  } else {
+    msg_oldest = msg->newer;
+  }
+  if(msg->newer != NULL) {
+    msg->newer->older = msg->older;
+  } else {
+    msg_newest = msg->older;
+  }
+  msg->older = NULL;
+  msg->newer = NULL;
+}
+static unsigned
+seed_hash_bucket(const seed_id_t *seed_id, const struct mpl_domain *domain)
+{
+  uint32_t h = 2166136261;
+  int i;
+
+  /* FNV-1a over the seed id and the index of the domain */
+  for(i = 0; i < 16; i++) {
+    h = (h ^ seed_id->id[i]) * 16777619;
+  }
+  h = (h ^ (uint8_t)(domain - domain_set)) * 16777619;
+  return h % MPL_SEED_HASH_SIZE;
+}
+static void
+seed_hash_add(struct mpl_seed *s)
+{
+  unsigned bucket = seed_hash_bucket(&s->seed_id, s->domain);
+
+  s->hash_next = seed_hash[bucket];
+  seed_hash[bucket] = s;
+}
+static void
+seed_hash_remove(struct mpl_seed *s)
+{
+  struct mpl_seed **sp = &seed_hash[seed_hash_bucket(&s->seed_id, s->domain)];
+
+  while(*sp != NULL) {
+    if(*sp == s) {
+      *sp = s->hash_next;
+      break;
+    }
+    sp = &(*sp)->hash_next;
+  }
+  s->hash_next = NULL;
+}
+static unsigned
+domain_hash_bucket(const uip_ip6addr_t *address)
+{
+  uint32_t h = 2166136261;
+  int i;
+
+  /*
+   * FNV-1a over the address. The flags and scope byte is skipped, so that
+   * the data and the control address of a domain share a bucket.
+   */
+  for(i = 0; i < 16; i++) {
+    if(i != 1) {
+      h = (h ^ address->u8[i]) * 16777619;
+    }
+  }
+  return h % MPL_DOMAIN_SET_SIZE;
+}
+static void
+domain_hash_add(struct mpl_domain *d)
+{
+  unsigned bucket = domain_hash_bucket(&d->data_addr);
+
+  d->hash_next = domain_hash[bucket];
+  domain_hash[bucket] = d;
+}
+static void
+domain_hash_remove(struct mpl_domain *d)
+{
+  struct mpl_domain **dp = &domain_hash[domain_hash_bucket(&d->data_addr)];
+
+  while(*dp != NULL) {
+    if(*dp == d) {
+      *dp = d->hash_next;
+      break;
+    }
+    dp = &(*dp)->hash_next;
+  }
+  d->hash_next = NULL;
+}
+#endif /* MPL_HASH_INDEX */
 static struct mpl_msg *
 buffer_allocate(void)
 {
+#if MPL_HASH_INDEX
+  locmmptr = list_pop(msg_free_list);
+  if(locmmptr != NULL) {
+    memset(locmmptr, 0, sizeof(struct mpl_msg));
+    msg_age_add(locmmptr);
+  }
+  return locmmptr;
+#else /* MPL_HASH_INDEX */
   for(locmmptr = &buffered_message_set[MPL_BUFFERED_MESSAGE_SET_SIZE - 1]; locmmptr >= buffered_message_set; locmmptr--) {
     if(!MSG_SET_IS_USED(locmmptr)) {
       memset(locmmptr, 0, sizeof(struct mpl_msg));
@@ -476,6 +616,7 @@ buffer_allocate(void)
     }
   }
   return NULL;
+#endif /* MPL_HASH_INDEX */
 }
 static void
 buffer_free(struct mpl_msg *msg)
@@ -484,22 +625,33 @@ buffer_free(struct mpl_msg *msg)
     trickle_timer_stop(&msg->tt);
   }
   MSG_SET_CLEAR_USED(msg);
+#if MPL_HASH_INDEX
+  msg_age_remove(msg);
+  list_push(msg_free_list, msg);
+#endif /* MPL_HASH_INDEX */
 }
 static struct mpl_msg *
 buffer_reclaim(void)
 {
+#if !MPL_HASH_INDEX
   static struct mpl_seed *ssptr; /* Can't use locssptr since it's used by calling function */
-  static struct mpl_seed *largest;
+#endif /* !MPL_HASH_INDEX */
+  static struct mpl_seed *victim;
   static struct mpl_msg *reclaim;
 
-  /* Reclaim the message with min_seq in the largest seed set */
-  largest = NULL;
   reclaim = NULL;
-  for(ssptr = &seed_set[MPL_SEED_SET_SIZE]; ssptr >= seed_set; ssptr--) {
-    if(SEED_SET_IS_USED(ssptr) && (largest == NULL || ssptr->count > largest->count)) {
-      largest = ssptr;
+#if MPL_HASH_INDEX
+  /* Reclaim the message with min_seq in the seed set of the oldest message */
+  victim = msg_oldest != NULL ? msg_oldest->seed : NULL;
+#else /* MPL_HASH_INDEX */
+  /* Reclaim the message with min_seq in the largest seed set */
+  victim = NULL;
+  for(ssptr = &seed_set[MPL_SEED_SET_SIZE - 1]; ssptr >= seed_set; ssptr--) {
+    if(SEED_SET_IS_USED(ssptr) && (victim == NULL || ssptr->count > victim->count)) {
+      victim = ssptr;
     }
   }
+#endif /* MPL_HASH_INDEX */
   /**
    * To reclaim this, we need to increment the min seq number to
    *   the next largest sequence number in the set.
@@ -508,13 +660,23 @@ buffer_reclaim(void)
    *   order messages are sent.
    * We've already worked out what this new value is.
    */
-  if(largest != NULL) {
-    reclaim = list_pop(largest->min_seq);
-    largest->min_seqno = list_item_next(reclaim) == NULL ? reclaim->seq : ((struct mpl_msg *)list_item_next(reclaim))->seq;
-    largest->count--;
+  if(victim != NULL) {
+    reclaim = list_pop(victim->min_seq);
+    victim->min_seqno = list_item_next(reclaim) == NULL ? reclaim->seq : ((struct mpl_msg *)list_item_next(reclaim))->seq;
+    victim->count--;
+#if MPL_HASH_INDEX
+    BIT_VECTOR_CLR_BIT(victim->window, reclaim->seq);
+    if(victim->max_seq == reclaim) {
+      victim->max_seq = NULL;
+    }
+    msg_age_remove(reclaim);
+#endif /* MPL_HASH_INDEX */
     trickle_timer_stop(&reclaim->tt);
     mpl_trickle_timer_reset(reclaim->seed->domain);
     memset(reclaim, 0, sizeof(struct mpl_msg));
+#if MPL_HASH_INDEX
+    msg_age_add(reclaim);
+#endif /* MPL_HASH_INDEX */
   }
   return reclaim;
 }
@@ -564,6 +726,9 @@ domain_set_allocate(uip_ip6addr_t *address)
         DOMAIN_SET_CLEAR_USED(locdsptr);
         return NULL;
       }
+#if MPL_HASH_INDEX
+      domain_hash_add(locdsptr);
+#endif /* MPL_HASH_INDEX */
       return locdsptr;
     }
   }
@@ -573,12 +738,42 @@ domain_set_allocate(uip_ip6addr_t *address)
 static struct mpl_seed *
 seed_set_lookup(seed_id_t *seed_id, struct mpl_domain *domain)
 {
+#if MPL_HASH_INDEX
+  for(locssptr = seed_hash[seed_hash_bucket(seed_id, domain)]; locssptr != NULL; locssptr = locssptr->hash_next) {
+    if(seed_id_cmp(seed_id, &locssptr->seed_id) && locssptr->domain == domain) {
+      return locssptr;
+    }
+  }
+  return NULL;
+#else /* MPL_HASH_INDEX */
   for(locssptr = &seed_set[MPL_SEED_SET_SIZE - 1]; locssptr >= seed_set; locssptr--) {
     if(SEED_SET_IS_USED(locssptr) && seed_id_cmp(seed_id, &locssptr->seed_id) && locssptr->domain == domain) {
       return locssptr;
     }
   }
   return NULL;
+#endif /* MPL_HASH_INDEX */
+}
+/* Lookup a buffered message of a seed by its sequence number */
+static struct mpl_msg *
+seed_msg_lookup(struct mpl_seed *s, uint8_t seq)
+{
+  static struct mpl_msg *msg;
+#if MPL_HASH_INDEX
+  if(!BIT_VECTOR_GET_BIT(s->window, seq)) {
+    return NULL;
+  }
+  /* Duplicates of the latest message are the most common */
+  if(s->max_seq->seq == seq) {
+    return s->max_seq;
+  }
+#endif /* MPL_HASH_INDEX */
+  for(msg = list_head(s->min_seq); msg != NULL; msg = list_item_next(msg)) {
+    if(SEQ_VAL_IS_EQ(seq, msg->seq)) {
+      return msg;
+    }
+  }
+  return NULL;
 }
 static struct mpl_seed *
 seed_set_allocate(void)
@@ -598,11 +793,23 @@ seed_set_free(struct mpl_seed *s)
   while((locmmptr = list_pop(s->min_seq)) != NULL) {
     buffer_free(locmmptr);
   }
+#if MPL_HASH_INDEX
+  seed_hash_remove(s);
+#endif /* MPL_HASH_INDEX */
   SEED_SET_CLEAR_USED(s);
 }
 static struct mpl_domain *
 domain_set_lookup(uip_ip6addr_t *domain)
 {
+#if MPL_HASH_INDEX
+  for(locdsptr = domain_hash[domain_hash_bucket(domain)]; locdsptr != NULL; locdsptr = locdsptr->hash_next) {
+    if(uip_ip6addr_cmp(domain, &locdsptr->data_addr)
+       || uip_ip6addr_cmp(domain, &locdsptr->ctrl_addr)) {
+      return locdsptr;
+    }
+  }
+  return NULL;
+#else /* MPL_HASH_INDEX */
   for(locdsptr = &domain_set[MPL_DOMAIN_SET_SIZE - 1]; locdsptr >= domain_set; locdsptr--) {
     if(DOMAIN_SET_IS_USED(locdsptr)) {
       if(uip_ip6addr_cmp(domain, &locdsptr->data_addr)
@@ -612,13 +819,14 @@ domain_set_lookup(uip_ip6addr_t *domain)
     }
   }
   return NULL;
+#endif /* MPL_HASH_INDEX */
 }
 static void
 domain_set_free(struct mpl_domain *domain)
 {
   uip_ds6_maddr_t *addr;
   /* Must include freeing seeds otherwise we leak memory */
-  for(locssptr = &seed_set[MPL_SEED_SET_SIZE]; locssptr >= seed_set; locssptr--) {
+  for(locssptr = &seed_set[MPL_SEED_SET_SIZE - 1]; locssptr >= seed_set; locssptr--) {
     if(SEED_SET_IS_USED(locssptr) && locssptr->domain == domain) {
       seed_set_free(locssptr);
     }
@@ -634,6 +842,9 @@ domain_set_free(struct mpl_domain *domain)
   if(trickle_timer_is_running(&domain->tt)) {
     trickle_timer_stop(&domain->tt);
   }
+#if MPL_HASH_INDEX
+  domain_hash_remove(domain);
+#endif /* MPL_HASH_INDEX */
   DOMAIN_SET_CLEAR_USED(domain);
 }
 static void
@@ -657,8 +868,8 @@ seed_id_net_to_host(seed_id_t *dst, void *src, uint8_t s)
   case 1:
     /* 16 bit seed ID */
     dst->s = 1;
-    for(i = 2; i < 15; i++) {
-      /* Clear the first 13 bytes in the id */
+    for(i = 2; i < 16; i++) {
+      /* Clear the upper 14 bytes in the id */
       dst->id[i] = 0;
     }
     dst->id[0] = ptr[1];
@@ -1059,6 +1270,20 @@ lifetime_timer_expiration(void *ptr)
   ctimer_reset(&lifetime_timer);
 }
 static void
+seed_set_reset_timers(struct mpl_seed *s)
+{
+  /* Reset the timers of all messages in the seed set */
+  static struct mpl_msg *msg;
+  for(msg = list_head(s->min_seq); msg != NULL; msg = list_item_next(msg)) {
+    LOG_DBG("Resetting timer for messages\n");
+    if(!trickle_timer_is_running(&msg->tt)) {
+      LOG_DBG("Starting timer for messages\n");
+      mpl_data_trickle_timer_start(msg);
+    }
+    mpl_trickle_timer_inconsistency(msg);
+  }
+}
+static void
 icmp_in(void)
 {
   static seed_id_t seed_id;
@@ -1122,6 +1347,12 @@ icmp_in(void)
   l_missing = 0;
   r_missing = 0;
 
+#if MPL_HASH_INDEX
+  /* Seeds are marked as present while iterating over the remote seed info */
+  for(locssptr = &seed_set[MPL_SEED_SET_SIZE - 1]; locssptr >= seed_set; locssptr--) {
+    locssptr->present = 0;
+  }
+#else /* MPL_HASH_INDEX */
   /* Iterate over our seed set and check all are present in the remote seed sed */
   locsiptr = (struct seed_info *)UIP_ICMP_PAYLOAD;
   for(locssptr = &seed_set[MPL_SEED_SET_SIZE - 1]; locssptr >= seed_set; locssptr--) {
@@ -1167,21 +1398,13 @@ icmp_in(void)
       LOG_DBG_SEED(locssptr->seed_id);
       LOG_DBG_("\n");
       r_missing = 1;
-      if(list_head(locssptr->min_seq) != NULL) {
-        for(locmmptr = list_head(locssptr->min_seq); locmmptr != NULL; locmmptr = list_item_next(locmmptr)) {
-          LOG_DBG("Resetting timer for messages\n");
-          if(!trickle_timer_is_running(&locmmptr->tt)) {
-            LOG_DBG("Starting timer for messages\n");
-            mpl_data_trickle_timer_start(locmmptr);
-          }
-          mpl_trickle_timer_inconsistency(locmmptr);
-        }
-      }
+      seed_set_reset_timers(locssptr);
       /* Otherwise we jump here and continute */
 seed_present:
       continue;
     }
   }
+#endif /* MPL_HASH_INDEX */
 
   /* Iterate over remote seed info and they're present locally. Additionally check messages match */
   locsiptr = (struct seed_info *)UIP_ICMP_PAYLOAD;
@@ -1207,6 +1430,9 @@ seed_present:
       l_missing = 1;
       goto next;
     }
+#if MPL_HASH_INDEX
+    locssptr->present = 1;
+#endif /* MPL_HASH_INDEX */
 
     /* Work out where remote bit vector starts */
     vector_len = SEED_INFO_GET_LEN(locsiptr) * 8;
@@ -1367,6 +1593,19 @@ next:
     }
   }
 
+#if MPL_HASH_INDEX
+  /* Check that all our seeds are present in the remote seed set */
+  for(locssptr = &seed_set[MPL_SEED_SET_SIZE - 1]; locssptr >= seed_set; locssptr--) {
+    if(SEED_SET_IS_USED(locssptr) && locssptr->domain == locdsptr && !locssptr->present) {
+      LOG_DBG("Remote is missing seed ");
+      LOG_DBG_SEED(locssptr->seed_id);
+      LOG_DBG_("\n");
+      r_missing = 1;
+      seed_set_reset_timers(locssptr);
+    }
+  }
+#endif /* MPL_HASH_INDEX */
+
   /* Now sort out control message timers */
   if(l_missing && !trickle_timer_is_running(&locdsptr->tt)) {
     mpl_control_trickle_timer_start(locdsptr);
@@ -1508,20 +1747,17 @@ accept(uint8_t in)
       UIP_MCAST6_STATS_ADD(mcast_dropped);
       return UIP_MCAST6_DROP;
     }
-    if(list_head(locssptr->min_seq) != NULL) {
-      for(locmmptr = list_head(locssptr->min_seq); locmmptr != NULL; locmmptr = list_item_next(locmmptr)) {
-        if(SEQ_VAL_IS_EQ(seq_val, locmmptr->seq)) {
-          /* Seen before , drop */
-          LOG_INFO("Seen before\n");
-          if(HBH_GET_M(lochbhmptr) && list_item_next(locmmptr) != NULL) {
-            mpl_trickle_timer_inconsistency(locmmptr);
-          } else {
-            trickle_timer_consistency(&locmmptr->tt);
-          }
-          UIP_MCAST6_STATS_ADD(mcast_dropped);
-          return UIP_MCAST6_DROP;
-        }
+    locmmptr = seed_msg_lookup(locssptr, seq_val);
+    if(locmmptr != NULL) {
+      /* Seen before , drop */
+      LOG_INFO("Seen before\n");
+      if(HBH_GET_M(lochbhmptr) && list_item_next(locmmptr) != NULL) {
+        mpl_trickle_timer_inconsistency(locmmptr);
+      } else {
+        trickle_timer_consistency(&locmmptr->tt);
       }
+      UIP_MCAST6_STATS_ADD(mcast_dropped);
+      return UIP_MCAST6_DROP;
     }
   }
   /* We have not seen this message before */
@@ -1540,6 +1776,9 @@ accept(uint8_t in)
     LIST_STRUCT_INIT(locssptr, min_seq);
     seed_id_cpy(&locssptr->seed_id, &seed_id);
     locssptr->domain = locdsptr;
+#if MPL_HASH_INDEX
+    seed_hash_add(locssptr);
+#endif /* MPL_HASH_INDEX */
   }
 
   /* Allocate a buffer */
@@ -1591,6 +1830,12 @@ accept(uint8_t in)
   if(list_head(locssptr->min_seq) == NULL) {
     list_push(locssptr->min_seq, locmmptr);
     locssptr->min_seqno = locmmptr->seq;
+#if MPL_HASH_INDEX
+  } else if(SEQ_VAL_IS_GT(locmmptr->seq, locssptr->max_seq->seq)) {
+    /* In order, append without walking the set */
+    locmmptr->next = NULL;
+    locssptr->max_seq->next = locmmptr;
+#endif /* MPL_HASH_INDEX */
   } else {
     for(mmiterptr = list_head(locssptr->min_seq); mmiterptr != NULL; mmiterptr = list_item_next(mmiterptr)) {
       if(list_item_next(mmiterptr) == NULL
@@ -1600,6 +1845,12 @@ accept(uint8_t in)
       }
     }
   }
+#if MPL_HASH_INDEX
+  if(list_item_next(locmmptr) == NULL) {
+    locssptr->max_seq = locmmptr;
+  }
+  BIT_VECTOR_SET_BIT(locssptr->window, locmmptr->seq);
+#endif /* MPL_HASH_INDEX */
   locssptr->count++;
 
 #if MPL_PROACTIVE_FORWARDING
@@ -1771,6 +2022,16 @@ init(void)
   memset(domain_set, 0, sizeof(struct mpl_domain) * MPL_DOMAIN_SET_SIZE);
   memset(seed_set, 0, sizeof(struct mpl_seed) * MPL_SEED_SET_SIZE);
   memset(buffered_message_set, 0, sizeof(struct mpl_msg) * MPL_BUFFERED_MESSAGE_SET_SIZE);
+#if MPL_HASH_INDEX
+  memset(seed_hash, 0, sizeof(seed_hash));
+  memset(domain_hash, 0, sizeof(domain_hash));
+  msg_oldest = NULL;
+  msg_newest = NULL;
+  list_init(msg_free_list);
+  for(locmmptr = &buffered_message_set[MPL_BUFFERED_MESSAGE_SET_SIZE - 1]; locmmptr >= buffered_message_set; locmmptr--) {
+    list_push(msg_free_list, locmmptr);
+  }
+#endif /* MPL_HASH_INDEX */
 
   /* Register the ICMPv6 input handler */
   uip_icmp6_register_input_handler(&mpl_icmp_handler);
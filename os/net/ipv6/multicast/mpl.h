@@ -216,6 +216,27 @@
 #define MPL_BUFFERED_MESSAGE_SET_SIZE MPL_CONF_BUFFERED_MESSAGE_SET_SIZE
 #endif
 /*---------------------------------------------------------------------------*/
+/**
+ * Seed Set Index
+ * Find seeds and domains through hash indexes instead of scanning the
+ * sets, keep a bit vector of the buffered sequence numbers of each seed,
+ * and reclaim the buffer of the oldest message in constant time. Enabled
+ * by default for seed sets that are large enough to benefit from it.
+ */
+#ifndef MPL_CONF_HASH_INDEX
+#define MPL_HASH_INDEX                      (MPL_SEED_SET_SIZE >= 8)
+#else
+#define MPL_HASH_INDEX MPL_CONF_HASH_INDEX
+#endif
+/**
+ * The number of buckets of the seed set hash index
+ */
+#ifndef MPL_CONF_SEED_HASH_SIZE
+#define MPL_SEED_HASH_SIZE                  MPL_SEED_SET_SIZE
+#else
+#define MPL_SEED_HASH_SIZE MPL_CONF_SEED_HASH_SIZE
+#endif
+/*---------------------------------------------------------------------------*/
 /**
  * MPL Forwarding Strategy
  * Two forwarding strategies are defined for MPL. With Proactive forwarding
@@ -239,6 +239,235 @@ static uint16_t my_tag;
 /* Assuming that the worst growth for uncompression is 38 bytes */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
 
+/* SICSLOWPAN_CONF_REASS_BITMAP selects a reassembly engine that writes
+ * every fragment directly into a per-context buffer of UIP_BUFSIZE
+ * bytes, and keeps a bitmap of the 8-byte units that have been
+ * received. Contexts are found by hashing the sender and the tag, and
+ * the oldest context is evicted when a new packet arrives and all
+ * contexts are in use. Fragments may arrive in any order, and
+ * duplicates are ignored. SICSLOWPAN_FRAGMENT_BUFFERS is not used
+ * by this engine.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_BITMAP
+#define SICSLOWPAN_REASS_BITMAP SICSLOWPAN_CONF_REASS_BITMAP
+#else
+#define SICSLOWPAN_REASS_BITMAP 0
+#endif
+
+#if SICSLOWPAN_REASS_BITMAP
+
+#if SICSLOWPAN_REASS_CONTEXTS > 127
+#error SICSLOWPAN_CONF_REASS_CONTEXTS must be at most 127.
+#endif
+
+/* Hash chains hold context indices plus one, so that zero ends a chain
+   and the chains are valid without initialization. */
+#define REASS_NONE 0
+
+/* The number of 8-byte units in a reassembly buffer */
+#define REASS_UNITS ((UIP_BUFSIZE + 7) / 8)
+
+/* A packet that is being reassembled */
+struct sicslowpan_reass {
+  /** Units of the packet that have been received, one bit per unit */
+  uint32_t received[(REASS_UNITS + 31) / 32];
+  /** The reassembled packet */
+  uint8_t buf[UIP_BUFSIZE];
+  /** The source address of the fragments being merged */
+  linkaddr_t sender;
+  /** The tag in the fragments being merged */
+  uint16_t tag;
+  /** Total length of the fragmented packet, zero if unused */
+  uint16_t len;
+  /** The number of units that have been received */
+  uint16_t units;
+  /** Next context in the same hash bucket, plus one */
+  uint8_t next;
+  /** Reassembly %process %timer. */
+  struct timer reass_timer;
+};
+
+static struct sicslowpan_reass reass[SICSLOWPAN_REASS_CONTEXTS];
+static uint8_t reass_buckets[SICSLOWPAN_REASS_CONTEXTS];
+/*---------------------------------------------------------------------------*/
+static uint8_t
+reass_hash(const linkaddr_t *sender, uint16_t tag)
+{
+  uint16_t hash = tag;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = hash * 31 + sender->u8[i];
+  }
+  return hash % SICSLOWPAN_REASS_CONTEXTS;
+}
+/*---------------------------------------------------------------------------*/
+static int
+clear_fragments(uint8_t context)
+{
+  struct sicslowpan_reass *r = &reass[context];
+  uint8_t *p;
+
+  if(r->len == 0) {
+    return 0;
+  }
+
+  for(p = &reass_buckets[reass_hash(&r->sender, r->tag)];
+      *p != REASS_NONE; p = &reass[*p - 1].next) {
+    if(*p == context + 1) {
+      *p = r->next;
+      break;
+    }
+  }
+  r->len = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int8_t
+reass_lookup(const linkaddr_t *sender, uint16_t tag)
+{
+  uint8_t next;
+  int8_t i;
+
+  for(next = reass_buckets[reass_hash(sender, tag)]; next != REASS_NONE;
+      next = reass[i].next) {
+    i = next - 1;
+    if(reass[i].tag == tag && linkaddr_cmp(&reass[i].sender, sender)) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static int8_t
+reass_alloc(const linkaddr_t *sender, uint16_t tag, uint16_t len)
+{
+  struct sicslowpan_reass *r;
+  uint8_t bucket;
+  int8_t context;
+  int i;
+
+  /* Take a free context, or else evict the oldest one */
+  context = 0;
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(reass[i].len == 0) {
+      context = i;
+      break;
+    }
+    if(CLOCK_LT(reass[i].reass_timer.start,
+                reass[context].reass_timer.start)) {
+      context = i;
+    }
+  }
+  if(reass[context].len > 0) {
+    LOG_WARN("reassembly: evicting session - tag: %d\n", reass[context].tag);
+    clear_fragments(context);
+  }
+  r = &reass[context];
+
+  linkaddr_copy(&r->sender, sender);
+  r->tag = tag;
+  r->len = len;
+  r->units = 0;
+  memset(r->received, 0, sizeof(r->received));
+  timer_set(&r->reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  bucket = reass_hash(sender, tag);
+  r->next = reass_buckets[bucket];
+  reass_buckets[bucket] = context + 1;
+  return context;
+}
+/*---------------------------------------------------------------------------*/
+/* Mark the bytes [offset, offset + len) of a packet as received */
+static void
+reass_mark(uint8_t context, uint16_t offset, uint16_t len)
+{
+  struct sicslowpan_reass *r = &reass[context];
+  uint16_t unit = offset >> 3;
+  uint16_t end = (MIN(offset + len, r->len) + 7) >> 3;
+
+  while(unit < end) {
+    uint16_t bits = MIN(32 - (unit & 31), end - unit);
+    uint32_t mask = (bits == 32 ? 0xffffffff : (((uint32_t)1 << bits) - 1))
+      << (unit & 31);
+    uint32_t new_bits = mask & ~r->received[unit >> 5];
+
+    /* Count the units that were not received before */
+    for(; new_bits != 0; new_bits &= new_bits - 1) {
+      r->units++;
+    }
+    r->received[unit >> 5] |= mask;
+    unit += bits;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static bool
+reass_complete(uint8_t context)
+{
+  return reass[context].units == (reass[context].len + 7) >> 3;
+}
+/*---------------------------------------------------------------------------*/
+/* Find or create the context of a fragment, and store the payload of
+   subsequent fragments */
+static int8_t
+add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  uint16_t byte_offset = (uint16_t)offset << 3;
+  int8_t context;
+  int len;
+
+  if(frag_size == 0 || frag_size > UIP_BUFSIZE) {
+    LOG_WARN("reassembly: invalid packet size %u - tag: %d\n", frag_size, tag);
+    return -1;
+  }
+
+  context = reass_lookup(sender, tag);
+  if(context >= 0 && (reass[context].len != frag_size ||
+                      (offset == 0 &&
+                       timer_expired(&reass[context].reass_timer)))) {
+    /* The sender has reused the tag for another packet */
+    clear_fragments(context);
+    context = -1;
+  }
+  if(context < 0) {
+    context = reass_alloc(sender, tag, frag_size);
+  }
+
+  if(offset == 0) {
+    /* The first fragment is uncompressed directly into the buffer */
+    return context;
+  }
+
+  len = packetbuf_datalen() - packetbuf_hdr_len;
+  if(len <= 0 || len > SICSLOWPAN_FRAGMENT_SIZE || byte_offset >= frag_size) {
+    LOG_WARN("reassembly: invalid fragment - tag: %d offset: %d\n", tag, offset);
+    return -1;
+  }
+
+  /* Extraneous bytes after the end of the packet are ignored */
+  len = MIN(len, frag_size - byte_offset);
+  memcpy(reass[context].buf + byte_offset, packetbuf_ptr + packetbuf_hdr_len, len);
+  reass_mark(context, byte_offset, len);
+  return context;
+}
+/*---------------------------------------------------------------------------*/
+/* Copy a reassembled packet into uip */
+static bool
+copy_frags2uip(int context)
+{
+  memcpy((uint8_t *)UIP_IP_BUF, reass[context].buf, reass[context].len);
+  clear_fragments(context);
+  return true;
+}
+/*---------------------------------------------------------------------------*/
+size_t
+sicslowpan_reass_memory(unsigned *contexts)
+{
+  *contexts = SICSLOWPAN_REASS_CONTEXTS;
+  return sizeof(reass) + sizeof(reass_buckets);
+}
+#else /* SICSLOWPAN_REASS_BITMAP */
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
@@ -446,6 +675,14 @@ copy_frags2uip(int context)
 
   return true;
 }
+/*---------------------------------------------------------------------------*/
+size_t
+sicslowpan_reass_memory(unsigned *contexts)
+{
+  *contexts = SICSLOWPAN_REASS_CONTEXTS;
+  return sizeof(frag_info) + sizeof(frag_buf);
+}
+#endif /* SICSLOWPAN_REASS_BITMAP */
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 /* -------------------------------------------------------------------------- */
@@ -1922,8 +2159,13 @@ input(void)
         return;
       }
 
+#if SICSLOWPAN_REASS_BITMAP
+      buffer = reass[frag_context].buf;
+      buffer_size = UIP_BUFSIZE;
+#else /* SICSLOWPAN_REASS_BITMAP */
       buffer = frag_info[frag_context].first_frag;
       buffer_size = SICSLOWPAN_FIRST_FRAGMENT_SIZE;
+#endif /* SICSLOWPAN_REASS_BITMAP */
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
       /*
@@ -1948,9 +2190,15 @@ input(void)
          we should not store more */
       buffer = NULL;
 
+#if SICSLOWPAN_REASS_BITMAP
+      if(reass_complete(frag_context)) {
+        last_fragment = 1;
+      }
+#else /* SICSLOWPAN_REASS_BITMAP */
       if(frag_info[frag_context].reassembled_len >= frag_size) {
         last_fragment = 1;
       }
+#endif /* SICSLOWPAN_REASS_BITMAP */
       is_fragment = 1;
       break;
     default:
@@ -2056,13 +2304,23 @@ input(void)
   if(frag_size > 0) {
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
+#if SICSLOWPAN_REASS_BITMAP
+      reass_mark(frag_context, 0, uncomp_hdr_len + packetbuf_payload_len);
+      /* The first fragment may be the last one to arrive */
+      if(reass_complete(frag_context)) {
+        last_fragment = 1;
+      }
+#else /* SICSLOWPAN_REASS_BITMAP */
       frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
       frag_info[frag_context].first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
+#endif /* SICSLOWPAN_REASS_BITMAP */
     }
     /* For the last fragment, we are OK if there is extrenous bytes at
        the end of the packet. */
     if(last_fragment != 0) {
+#if !SICSLOWPAN_REASS_BITMAP
       frag_info[frag_context].reassembled_len = frag_size;
+#endif /* !SICSLOWPAN_REASS_BITMAP */
       /* copy to uip */
       if(!copy_frags2uip(frag_context)) {
         return;
@@ -296,5 +296,13 @@ struct sicslowpan_nh_compressor {
 
 extern const struct network_driver sicslowpan_driver;
 
+/**
+ * \brief      Get the RAM used for fragment reassembly
+ * \param contexts Set to the number of packets that can be reassembled
+ *             concurrently
+ * \return     The number of bytes used by the reassembly buffers
+ */
+size_t sicslowpan_reass_memory(unsigned *contexts);
+
 #endif /* SICSLOWPAN_H_ */
 /** @} */
@@ -165,6 +165,8 @@ appcall(void *state)
 	   s->listen_port == uip_htons(uip_conn->lport)) {
 	  s->flags &= ~TCP_SOCKET_FLAGS_LISTENING;
           s->output_data_max_seg = uip_mss();
+          /* Needed to poll the connection when sending outside callbacks */
+          s->c = uip_conn;
 	  tcp_markconn(uip_conn, s);
 	  call_event(s, TCP_SOCKET_CONNECTED);
 	  break;
@@ -351,7 +353,10 @@ tcp_socket_send(struct tcp_socket *s,
 
   len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
 
-  memmove(&s->output_data_ptr[s->output_data_len], data, len);
+  /* Data that was written in place into the output buffer stays there */
+  if(data != &s->output_data_ptr[s->output_data_len]) {
+    memmove(&s->output_data_ptr[s->output_data_len], data, len);
+  }
   s->output_data_len += len;
 
   if(s->output_senddata_len == 0) {
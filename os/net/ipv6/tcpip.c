@@ -47,6 +47,7 @@
 #include "net/ipv6/uip-ds6-nbr.h"
 #include "net/linkaddr.h"
 #include "net/routing/routing.h"
+#include "sys/profile.h"
 
 #include <string.h>
 
@@ -167,6 +168,9 @@ static void
 packet_input(void)
 {
   if(uip_len > 0) {
+    struct profile_frame frame;
+
+    PROFILE_ENTER(&frame);
     LOG_INFO("input: received %u bytes\n", uip_len);
 
     check_for_tcp_syn();
@@ -187,6 +191,7 @@ packet_input(void)
     if(uip_len > 0) {
       tcpip_ipv6_output();
     }
+    PROFILE_EXIT(&frame, PROFILE_TYPE_HANDLER, packet_input, "IPv6 input");
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -799,6 +804,9 @@ PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
 
+  /* Handle network events before those of application processes. */
+  process_set_priority(PROCESS_CURRENT(), PROCESS_PRIORITY_HIGH);
+
 #if UIP_TCP
   memset(s.listenports, 0, UIP_LISTENPORTS*sizeof(*(s.listenports)));
   s.p = PROCESS_CURRENT();
@@ -85,6 +85,21 @@ MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_HASH_INDEX
+#if UIP_DS6_ROUTE_NB < 256
+typedef uint8_t route_count_t;
+#else
+typedef uint16_t route_count_t;
+#endif
+/* Routes hashed on their prefix and prefix length. */
+static uip_ds6_route_t *route_hash[UIP_DS6_ROUTE_HASH_SIZE];
+/* The number of routes of each prefix length. */
+static route_count_t length_count[129];
+/* The prefix lengths in use, sorted from the longest to the shortest. */
+static uint8_t lengths[129];
+static uint8_t num_lengths;
+#endif /* UIP_DS6_ROUTE_HASH_INDEX */
+
 #endif /* (UIP_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -162,12 +177,102 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_HASH_INDEX
+static unsigned
+prefix_hash(const uip_ipaddr_t *addr, uint8_t length)
+{
+  uint32_t h = 2166136261;
+  int i;
+
+  /* FNV-1a over the prefix bytes, followed by the prefix length. Only
+     whole bytes are hashed, as uip_ipaddr_prefixcmp() only compares
+     whole bytes. */
+  for(i = 0; i < length / 8; i++) {
+    h = (h ^ addr->u8[i]) * 16777619;
+  }
+  h = (h ^ length) * 16777619;
+
+  return h % UIP_DS6_ROUTE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_index_add(uip_ds6_route_t *r)
+{
+  unsigned bucket = prefix_hash(&r->ipaddr, r->length);
+  int i;
+
+  r->hash_next = route_hash[bucket];
+  route_hash[bucket] = r;
+
+  if(length_count[r->length]++ == 0) {
+    /* Insert the new prefix length, keeping the array sorted. */
+    for(i = num_lengths; i > 0 && lengths[i - 1] < r->length; i--) {
+      lengths[i] = lengths[i - 1];
+    }
+    lengths[i] = r->length;
+    num_lengths++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_index_remove(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **rp;
+  int i;
+
+  for(rp = &route_hash[prefix_hash(&r->ipaddr, r->length)];
+      *rp != NULL;
+      rp = &(*rp)->hash_next) {
+    if(*rp == r) {
+      *rp = r->hash_next;
+      r->hash_next = NULL;
+      break;
+    }
+  }
+
+  if(--length_count[r->length] == 0) {
+    for(i = 0; lengths[i] != r->length; i++);
+    for(num_lengths--; i < num_lengths; i++) {
+      lengths[i] = lengths[i + 1];
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+route_index_lookup(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  uint8_t length;
+  int i;
+
+  /* Probe the longest prefix length first, so that the first match is
+     the longest match. */
+  for(i = 0; i < num_lengths; i++) {
+    length = lengths[i];
+    for(r = route_hash[prefix_hash(addr, length)];
+        r != NULL;
+        r = r->hash_next) {
+      if(r->length == length &&
+         uip_ipaddr_prefixcmp(addr, &r->ipaddr, length)) {
+        return r;
+      }
+    }
+  }
+  return NULL;
+}
+#endif /* UIP_DS6_ROUTE_HASH_INDEX */
+/*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
 {
 #if (UIP_MAX_ROUTES != 0)
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_HASH_INDEX
+  memset(route_hash, 0, sizeof(route_hash));
+  memset(length_count, 0, sizeof(length_count));
+  num_lengths = 0;
+#endif /* UIP_DS6_ROUTE_HASH_INDEX */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_MAX_ROUTES != 0) */
@@ -275,9 +380,7 @@ uip_ds6_route_t *
 uip_ds6_route_lookup(const uip_ipaddr_t *addr)
 {
 #if (UIP_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
-  uint8_t longestmatch;
 
   LOG_INFO("Looking up route for ");
   LOG_INFO_6ADDR(addr);
@@ -287,6 +390,12 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     return NULL;
   }
 
+#if UIP_DS6_ROUTE_HASH_INDEX
+  found_route = route_index_lookup(addr);
+#else /* UIP_DS6_ROUTE_HASH_INDEX */
+  uip_ds6_route_t *r;
+  uint8_t longestmatch;
+
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -302,6 +411,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_HASH_INDEX */
 
   if(found_route != NULL) {
     LOG_INFO("Found route: ");
@@ -313,6 +423,10 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     LOG_INFO("No route found\n");
   }
 
+  /* With the index, the list order only matters for evicting the least
+     recently used route. Moving a route to the front takes a walk
+     through the list, so it is skipped unless needed. */
+#if !UIP_DS6_ROUTE_HASH_INDEX || UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -322,6 +436,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* !UIP_DS6_ROUTE_HASH_INDEX || UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
 
   return found_route;
 #else /* (UIP_MAX_ROUTES != 0) */
@@ -345,6 +460,11 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
     return NULL;
   }
 
+  if(length > 128) {
+    LOG_WARN("Add: invalid prefix length %u\n", length);
+    return NULL;
+  }
+
   /* Get link-layer address of next hop, make sure it is in neighbor table */
   const uip_lladdr_t *nexthop_lladdr = uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
   if(nexthop_lladdr == NULL) {
@@ -446,6 +566,7 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
       /* This should not happen, as we explicitly deallocated one
          route table entry above. */
       LOG_ERR("Add: could not allocate neighbor route list entry\n");
+      list_remove(routelist, r);
       memb_free(&routememb, r);
       return NULL;
     }
@@ -464,6 +585,9 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH_INDEX
+  route_index_add(r);
+#endif /* UIP_DS6_ROUTE_HASH_INDEX */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -509,6 +633,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_HASH_INDEX
+    route_index_remove(route);
+#endif /* UIP_DS6_ROUTE_HASH_INDEX */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -111,6 +111,24 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_MAX_ROUTES */
 
+/** \brief Index the routing table by destination prefix. Routes are
+ *  kept in a hash table keyed on prefix and prefix length, and a lookup
+ *  probes it once per prefix length in use, from the longest to the
+ *  shortest. This avoids walking the whole routing table for each
+ *  forwarded packet. */
+#ifdef UIP_DS6_ROUTE_CONF_HASH_INDEX
+#define UIP_DS6_ROUTE_HASH_INDEX UIP_DS6_ROUTE_CONF_HASH_INDEX
+#else /* UIP_DS6_ROUTE_CONF_HASH_INDEX */
+#define UIP_DS6_ROUTE_HASH_INDEX (UIP_DS6_ROUTE_NB >= 32)
+#endif /* UIP_DS6_ROUTE_CONF_HASH_INDEX */
+
+/** \brief The number of hash buckets of the routing table index. */
+#ifdef UIP_DS6_ROUTE_CONF_HASH_SIZE
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_DS6_ROUTE_CONF_HASH_SIZE
+#else /* UIP_DS6_ROUTE_CONF_HASH_SIZE */
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_DS6_ROUTE_NB
+#endif /* UIP_DS6_ROUTE_CONF_HASH_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -176,6 +194,10 @@ typedef struct uip_ds6_route {
      belong to the neighbor table entry that this routing table entry
      uses. */
   struct uip_ds6_route_neighbor_routes *neighbor_routes;
+#if UIP_DS6_ROUTE_HASH_INDEX
+  /* The next route in the same hash bucket. */
+  struct uip_ds6_route *hash_next;
+#endif /* UIP_DS6_ROUTE_HASH_INDEX */
   uip_ipaddr_t ipaddr;
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
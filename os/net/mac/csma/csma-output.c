@@ -40,6 +40,7 @@
  */
 
 #include "net/mac/csma/csma.h"
+#include "net/mac/csma/csma-output.h"
 #include "net/mac/csma/csma-security.h"
 #include "net/mac/mac-sequence.h"
 #include "net/packetbuf.h"
@@ -52,6 +53,7 @@
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "lib/assert.h"
+#include <string.h>
 
 /* Log configuration */
 #include "sys/log.h"
@@ -88,30 +90,68 @@
 #define CSMA_MAX_FRAME_RETRIES 7
 #endif
 
+/* The maximum number of co-existing neighbor queues */
+#ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
+#define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
+#else
+#define CSMA_MAX_NEIGHBOR_QUEUES 2
+#endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
+
+/* Find neighbor queues through a hash index instead of walking the
+ * list of neighbor queues */
+#ifdef CSMA_CONF_NEIGHBOR_HASH_INDEX
+#define CSMA_NEIGHBOR_HASH_INDEX CSMA_CONF_NEIGHBOR_HASH_INDEX
+#else
+#define CSMA_NEIGHBOR_HASH_INDEX (CSMA_MAX_NEIGHBOR_QUEUES >= 8)
+#endif /* CSMA_CONF_NEIGHBOR_HASH_INDEX */
+
+/* The number of buckets of the neighbor queue hash index */
+#ifdef CSMA_CONF_NEIGHBOR_HASH_SIZE
+#define CSMA_NEIGHBOR_HASH_SIZE CSMA_CONF_NEIGHBOR_HASH_SIZE
+#else
+#define CSMA_NEIGHBOR_HASH_SIZE CSMA_MAX_NEIGHBOR_QUEUES
+#endif /* CSMA_CONF_NEIGHBOR_HASH_SIZE */
+
+/* The maximum number of frames sent back-to-back to a neighbor. After a
+ * successful transmission, the next frame queued for the same neighbor
+ * is sent at once instead of after a new backoff, until the burst has
+ * this many frames. 0 disables bursts. */
+#ifdef CSMA_CONF_BURST_MAX_LEN
+#define CSMA_BURST_MAX_LEN CSMA_CONF_BURST_MAX_LEN
+#else
+#define CSMA_BURST_MAX_LEN 0
+#endif /* CSMA_CONF_BURST_MAX_LEN */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
   void *cptr;
   uint8_t max_transmissions;
+#if CSMA_STATS
+  clock_time_t queued_at;
+#endif /* CSMA_STATS */
 };
 
 /* Every neighbor has its own packet queue */
 struct neighbor_queue {
   struct neighbor_queue *next;
+#if CSMA_NEIGHBOR_HASH_INDEX
+  struct neighbor_queue *hash_next;
+#endif /* CSMA_NEIGHBOR_HASH_INDEX */
+#if CSMA_STATS
+  struct csma_nbr_stats *stats;
+#endif /* CSMA_STATS */
   linkaddr_t addr;
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
+#if CSMA_BURST_MAX_LEN > 0
+  /* Frames sent in the current burst */
+  uint8_t burst_len;
+#endif /* CSMA_BURST_MAX_LEN > 0 */
   LIST_STRUCT(packet_queue);
 };
 
-/* The maximum number of co-existing neighbor queues */
-#ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
-#define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
-#else
-#define CSMA_MAX_NEIGHBOR_QUEUES 2
-#endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
-
 /* The maximum number of pending packet per neighbor */
 #ifdef CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
 #define CSMA_MAX_PACKET_PER_NEIGHBOR CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
@@ -132,16 +172,50 @@ MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct packet_queue, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
+#if CSMA_NEIGHBOR_HASH_INDEX
+static struct neighbor_queue *neighbor_hash[CSMA_NEIGHBOR_HASH_SIZE];
+#endif /* CSMA_NEIGHBOR_HASH_INDEX */
+#if CSMA_STATS
+static struct csma_nbr_stats nbr_stats[CSMA_STATS_MAX_NEIGHBORS];
+#endif /* CSMA_STATS */
+#if CSMA_BURST_MAX_LEN > 0
+/* The neighbor whose next packet is to be sent without backoff */
+static struct neighbor_queue *burst_neighbor;
+#endif /* CSMA_BURST_MAX_LEN > 0 */
 
 static void packet_sent(struct neighbor_queue *n,
     struct packet_queue *q,
     int status,
     int num_transmissions);
 static void transmit_from_queue(void *ptr);
+#if CSMA_NEIGHBOR_HASH_INDEX
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash_lladdr(const linkaddr_t *addr)
+{
+  uint32_t h = 2166136261;
+  int i;
+
+  /* FNV-1a */
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h ^ addr->u8[i]) * 16777619;
+  }
+  return h % CSMA_NEIGHBOR_HASH_SIZE;
+}
+#endif /* CSMA_NEIGHBOR_HASH_INDEX */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
+#if CSMA_NEIGHBOR_HASH_INDEX
+  struct neighbor_queue *n = neighbor_hash[hash_lladdr(addr)];
+  while(n != NULL) {
+    if(linkaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+    n = n->hash_next;
+  }
+#else /* CSMA_NEIGHBOR_HASH_INDEX */
   struct neighbor_queue *n = list_head(neighbor_list);
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
@@ -149,8 +223,109 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
     }
     n = list_item_next(n);
   }
+#endif /* CSMA_NEIGHBOR_HASH_INDEX */
   return NULL;
 }
+#if CSMA_STATS
+/*---------------------------------------------------------------------------*/
+/* Returns the statistics entry of a neighbor, or a new one. NULL if the
+ * neighbor is not tracked because all entries are in use. */
+static struct csma_nbr_stats *
+nbr_stats_from_addr(const linkaddr_t *addr)
+{
+  struct csma_nbr_stats *free_entry = NULL;
+  int i;
+
+  for(i = 0; i < CSMA_STATS_MAX_NEIGHBORS; i++) {
+    if(!nbr_stats[i].used) {
+      if(free_entry == NULL) {
+        free_entry = &nbr_stats[i];
+      }
+    } else if(linkaddr_cmp(&nbr_stats[i].addr, addr)) {
+      return &nbr_stats[i];
+    }
+  }
+  if(free_entry != NULL) {
+    memset(free_entry, 0, sizeof(*free_entry));
+    free_entry->used = 1;
+    linkaddr_copy(&free_entry->addr, addr);
+  }
+  return free_entry;
+}
+/*---------------------------------------------------------------------------*/
+int
+csma_output_get_stats(const struct csma_nbr_stats **entries, int max)
+{
+  int count = 0;
+  int i;
+
+  for(i = 0; i < CSMA_STATS_MAX_NEIGHBORS && count < max; i++) {
+    if(nbr_stats[i].used) {
+      entries[count++] = &nbr_stats[i];
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+void
+csma_output_reset_stats(void)
+{
+  struct neighbor_queue *n;
+
+  memset(nbr_stats, 0, sizeof(nbr_stats));
+  /* Queued packets are accounted to new entries */
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    n->stats = nbr_stats_from_addr(&n->addr);
+  }
+}
+#endif /* CSMA_STATS */
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_add(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n = memb_alloc(&neighbor_memb);
+  if(n != NULL) {
+    /* Init neighbor entry */
+    linkaddr_copy(&n->addr, addr);
+    n->transmissions = 0;
+    n->collisions = 0;
+#if CSMA_BURST_MAX_LEN > 0
+    n->burst_len = 0;
+#endif /* CSMA_BURST_MAX_LEN > 0 */
+#if CSMA_STATS
+    n->stats = nbr_stats_from_addr(addr);
+#endif /* CSMA_STATS */
+    /* Init packet queue for this neighbor */
+    LIST_STRUCT_INIT(n, packet_queue);
+    /* Add neighbor to the neighbor list */
+    list_add(neighbor_list, n);
+#if CSMA_NEIGHBOR_HASH_INDEX
+    {
+      unsigned bucket = hash_lladdr(addr);
+      n->hash_next = neighbor_hash[bucket];
+      neighbor_hash[bucket] = n;
+    }
+#endif /* CSMA_NEIGHBOR_HASH_INDEX */
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_free(struct neighbor_queue *n)
+{
+#if CSMA_NEIGHBOR_HASH_INDEX
+  struct neighbor_queue **p = &neighbor_hash[hash_lladdr(&n->addr)];
+  while(*p != NULL) {
+    if(*p == n) {
+      *p = n->hash_next;
+      break;
+    }
+    p = &(*p)->hash_next;
+  }
+#endif /* CSMA_NEIGHBOR_HASH_INDEX */
+  list_remove(neighbor_list, n);
+  memb_free(&neighbor_memb, n);
+}
 /*---------------------------------------------------------------------------*/
 static clock_time_t
 backoff_period(void)
@@ -255,21 +430,43 @@ send_one_packet(struct neighbor_queue *n, struct packet_queue *q)
 }
 /*---------------------------------------------------------------------------*/
 static void
+transmit_first_packet(struct neighbor_queue *n)
+{
+  struct packet_queue *q = list_head(n->packet_queue);
+  if(q != NULL) {
+    LOG_INFO("preparing packet for ");
+    LOG_INFO_LLADDR(&n->addr);
+    LOG_INFO_(", seqno %u, tx %u, queue %d\n",
+      queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO),
+      n->transmissions, list_length(n->packet_queue));
+    /* Send first packet in the neighbor queue */
+#if LLSEC802154_ENABLED
+    /* Frame security encrypts the payload in place */
+    queuebuf_to_packetbuf(q->buf);
+#else /* LLSEC802154_ENABLED */
+    queuebuf_to_packetbuf_ref(q->buf);
+#endif /* LLSEC802154_ENABLED */
+    send_one_packet(n, q);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
 transmit_from_queue(void *ptr)
 {
   struct neighbor_queue *n = ptr;
   if(n) {
-    struct packet_queue *q = list_head(n->packet_queue);
-    if(q != NULL) {
-      LOG_INFO("preparing packet for ");
-      LOG_INFO_LLADDR(&n->addr);
-      LOG_INFO_(", seqno %u, tx %u, queue %d\n",
-        queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO),
-        n->transmissions, list_length(n->packet_queue));
-      /* Send first packet in the neighbor queue */
-      queuebuf_to_packetbuf(q->buf);
-      send_one_packet(n, q);
-    }
+#if CSMA_BURST_MAX_LEN > 0
+    /* A burst starts after every backoff */
+    n->burst_len = 0;
+    do {
+      burst_neighbor = NULL;
+      transmit_first_packet(n);
+      /* free_packet() sets burst_neighbor only if the queue of n is
+         not empty, so n is still allocated */
+    } while(burst_neighbor == n);
+#else /* CSMA_BURST_MAX_LEN > 0 */
+    transmit_first_packet(n);
+#endif /* CSMA_BURST_MAX_LEN > 0 */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -309,13 +506,19 @@ free_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
       /* There is a next packet. We reset current tx information */
       n->transmissions = 0;
       n->collisions = 0;
+#if CSMA_BURST_MAX_LEN > 0
+      if(status == MAC_TX_OK && ++n->burst_len < CSMA_BURST_MAX_LEN) {
+        /* Send the next packet right away, from transmit_from_queue() */
+        burst_neighbor = n;
+        return;
+      }
+#endif /* CSMA_BURST_MAX_LEN > 0 */
       /* Schedule next transmissions */
       schedule_transmission(n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
       ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
     }
   }
 }
@@ -339,6 +542,20 @@ tx_done(int status, struct packet_queue *q, struct neighbor_queue *n)
               packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
               status, n->transmissions, n->collisions);
 
+#if CSMA_STATS
+  if(n->stats != NULL) {
+    clock_time_t latency = clock_time() - metadata->queued_at;
+    n->stats->packets++;
+    if(status != MAC_TX_OK) {
+      n->stats->failed++;
+    }
+    n->stats->latency_sum += latency;
+    if(latency > n->stats->latency_max) {
+      n->stats->latency_max = latency;
+    }
+  }
+#endif /* CSMA_STATS */
+
   free_packet(n, q, status);
   mac_call_sent_callback(sent, cptr, status, ntx);
 }
@@ -452,17 +669,7 @@ csma_output_packet(mac_callback_t sent, void *ptr)
   n = neighbor_queue_from_addr(addr);
   if(n == NULL) {
     /* Allocate a new neighbor entry */
-    n = memb_alloc(&neighbor_memb);
-    if(n != NULL) {
-      /* Init neighbor entry */
-      linkaddr_copy(&n->addr, addr);
-      n->transmissions = 0;
-      n->collisions = 0;
-      /* Init packet queue for this neighbor */
-      LIST_STRUCT_INIT(n, packet_queue);
-      /* Add neighbor to the neighbor list */
-      list_add(neighbor_list, n);
-    }
+    n = neighbor_queue_add(addr);
   }
 
   if(n != NULL) {
@@ -484,6 +691,18 @@ csma_output_packet(mac_callback_t sent, void *ptr)
             metadata->sent = sent;
             metadata->cptr = ptr;
             list_add(n->packet_queue, q);
+#if CSMA_STATS
+            metadata->queued_at = clock_time();
+            if(n->stats != NULL) {
+              /* Queue depth seen by the packet, including itself */
+              uint16_t depth = list_length(n->packet_queue);
+              n->stats->queued++;
+              n->stats->depth_sum += depth;
+              if(depth > n->stats->depth_max) {
+                n->stats->depth_max = depth;
+              }
+            }
+#endif /* CSMA_STATS */
 
             LOG_INFO("sending to ");
             LOG_INFO_LLADDR(addr);
@@ -505,8 +724,7 @@ csma_output_packet(mac_callback_t sent, void *ptr)
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->packet_queue) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+        neighbor_queue_free(n);
       }
     } else {
       LOG_WARN("Neighbor queue full\n");
@@ -44,8 +44,58 @@
 
 #include "contiki.h"
 #include "net/mac/mac.h"
+#include "net/linkaddr.h"
+
+/* Keep per-neighbor queue depth and latency statistics */
+#ifdef CSMA_CONF_STATS
+#define CSMA_STATS CSMA_CONF_STATS
+#else /* CSMA_CONF_STATS */
+#define CSMA_STATS 0
+#endif /* CSMA_CONF_STATS */
+
+/* The number of neighbors with statistics. Packets to further
+ * neighbors are not accounted. */
+#ifdef CSMA_CONF_STATS_MAX_NEIGHBORS
+#define CSMA_STATS_MAX_NEIGHBORS CSMA_CONF_STATS_MAX_NEIGHBORS
+#else /* CSMA_CONF_STATS_MAX_NEIGHBORS */
+#define CSMA_STATS_MAX_NEIGHBORS 16
+#endif /* CSMA_CONF_STATS_MAX_NEIGHBORS */
+
+/** \brief Transmission statistics of a neighbor */
+struct csma_nbr_stats {
+  linkaddr_t addr;
+  /** Packets that were queued */
+  uint32_t queued;
+  /** Packets that left the queue, sent or dropped */
+  uint32_t packets;
+  /** Packets dropped after their last transmission attempt */
+  uint32_t failed;
+  /** Sum of the queue depths seen by queued packets, themselves included */
+  uint32_t depth_sum;
+  /** Sum of the times from queueing to completion, in clock ticks */
+  uint32_t latency_sum;
+  /** The longest time from queueing to completion, in clock ticks */
+  clock_time_t latency_max;
+  uint16_t depth_max;
+  uint8_t used;
+};
 
 void csma_output_packet(mac_callback_t sent, void *ptr);
 void csma_output_init(void);
 
+#if CSMA_STATS
+/**
+ * \brief Get the statistics of the neighbors
+ * \param entries An array where pointers to the statistics are stored
+ * \param max The size of the array
+ * \return The number of neighbors stored in the array
+ */
+int csma_output_get_stats(const struct csma_nbr_stats **entries, int max);
+
+/**
+ * \brief Clear the statistics of all neighbors
+ */
+void csma_output_reset_stats(void);
+#endif /* CSMA_STATS */
+
 #endif /* CSMA_OUTPUT_H_ */
@@ -353,6 +353,16 @@
 #define TSCH_SCHEDULE_MAX_LINKS 32
 #endif
 
+/* Keep a per-slotframe index of the links sorted by timeslot, so that
+ * the next active link is found with a binary search per slotframe
+ * instead of a walk over all links. Costs one pointer per possible
+ * link in every slotframe. */
+#ifdef TSCH_SCHEDULE_CONF_INDEX
+#define TSCH_SCHEDULE_INDEX TSCH_SCHEDULE_CONF_INDEX
+#else
+#define TSCH_SCHEDULE_INDEX 0
+#endif
+
 /* To include Sixtop Implementation */
 #ifdef TSCH_CONF_WITH_SIXTOP
 #define TSCH_WITH_SIXTOP TSCH_CONF_WITH_SIXTOP
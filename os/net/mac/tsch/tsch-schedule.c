@@ -68,6 +68,56 @@ MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
 
+#if TSCH_SCHEDULE_INDEX
+/*---------------------------------------------------------------------------*/
+/* Returns the position of the first link in the index of a slotframe
+ * with a timeslot not smaller than the given one */
+static uint16_t
+index_lower_bound(const struct tsch_slotframe *sf, uint32_t timeslot)
+{
+  uint16_t low = 0;
+  uint16_t high = sf->index_len;
+
+  while(low < high) {
+    uint16_t mid = (low + high) / 2;
+    if(sf->index[mid]->timeslot < timeslot) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+/*---------------------------------------------------------------------------*/
+/* Adds a link to the index, after the links with the same timeslot */
+static void
+index_add(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint16_t pos = index_lower_bound(sf, l->timeslot + 1);
+
+  memmove(&sf->index[pos + 1], &sf->index[pos],
+          (sf->index_len - pos) * sizeof(sf->index[0]));
+  sf->index[pos] = l;
+  sf->index_len++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint16_t pos;
+
+  for(pos = index_lower_bound(sf, l->timeslot); pos < sf->index_len; pos++) {
+    if(sf->index[pos] == l) {
+      sf->index_len--;
+      memmove(&sf->index[pos], &sf->index[pos + 1],
+              (sf->index_len - pos) * sizeof(sf->index[0]));
+      return;
+    }
+  }
+}
+#endif /* TSCH_SCHEDULE_INDEX */
+/*---------------------------------------------------------------------------*/
+
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
 tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
@@ -88,6 +138,9 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       sf->handle = handle;
       TSCH_ASN_DIVISOR_INIT(sf->size, size);
       LIST_STRUCT_INIT(sf, links_list);
+#if TSCH_SCHEDULE_INDEX
+      sf->index_len = 0;
+#endif /* TSCH_SCHEDULE_INDEX */
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
     }
@@ -126,8 +179,8 @@ tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
     if(tsch_get_lock()) {
       LOG_INFO("Remove slotframe %u, size %u\n",
                slotframe->handle, slotframe->size.val);
-      memb_free(&slotframe_memb, slotframe);
       list_remove(slotframe_list, slotframe);
+      memb_free(&slotframe_memb, slotframe);
       tsch_release_lock();
       return 1;
     }
@@ -262,6 +315,9 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
           address = &linkaddr_null;
         }
         linkaddr_copy(&l->addr, address);
+#if TSCH_SCHEDULE_INDEX
+        index_add(slotframe, l);
+#endif /* TSCH_SCHEDULE_INDEX */
 
         LOG_INFO("add_link sf=%u opt=%s type=%s ts=%u ch=%u addr=",
                  slotframe->handle,
@@ -315,6 +371,9 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
       LOG_INFO_("\n");
 
       list_remove(slotframe->links_list, l);
+#if TSCH_SCHEDULE_INDEX
+      index_remove(slotframe, l);
+#endif /* TSCH_SCHEDULE_INDEX */
       memb_free(&link_memb, l);
 
       /* Release the lock before we update the neighbor (will take the lock) */
@@ -372,6 +431,18 @@ tsch_schedule_get_link_by_offsets(struct tsch_slotframe *slotframe,
 {
   if(!tsch_is_locked()) {
     if(slotframe != NULL) {
+#if TSCH_SCHEDULE_INDEX
+      uint16_t pos;
+      for(pos = index_lower_bound(slotframe, timeslot);
+          pos < slotframe->index_len
+            && slotframe->index[pos]->timeslot == timeslot;
+          pos++) {
+        if(slotframe->index[pos]->channel_offset == channel_offset) {
+          return slotframe->index[pos];
+        }
+      }
+      return NULL;
+#else /* TSCH_SCHEDULE_INDEX */
       struct tsch_link *l = list_head(slotframe->links_list);
       /* Loop over all items. Assume there is max one link per timeslot
          and channel_offset */
@@ -382,6 +453,7 @@ tsch_schedule_get_link_by_offsets(struct tsch_slotframe *slotframe,
         l = list_item_next(l);
       }
       return l;
+#endif /* TSCH_SCHEDULE_INDEX */
     }
   }
   return NULL;
@@ -394,6 +466,14 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe,
 {
   if(!tsch_is_locked()) {
     if(slotframe != NULL) {
+#if TSCH_SCHEDULE_INDEX
+      uint16_t pos = index_lower_bound(slotframe, timeslot);
+      if(pos < slotframe->index_len
+         && slotframe->index[pos]->timeslot == timeslot) {
+        return slotframe->index[pos];
+      }
+      return NULL;
+#else /* TSCH_SCHEDULE_INDEX */
       struct tsch_link *l = list_head(slotframe->links_list);
       /* Loop over all items. Assume there is max one link per timeslot */
       while(l != NULL) {
@@ -403,6 +483,7 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe,
         l = list_item_next(l);
       }
       return l;
+#endif /* TSCH_SCHEDULE_INDEX */
     }
   }
   return NULL;
@@ -430,6 +511,62 @@ default_tsch_link_comparator(struct tsch_link *a, struct tsch_link *b)
   return a;
 }
 
+/*---------------------------------------------------------------------------*/
+/* Considers link 'l', 'time_to_timeslot' slots away, as the next active
+ * link. Updates the current best link and its backup link accordingly. */
+static void
+select_link(struct tsch_link *l, uint16_t time_to_timeslot,
+            struct tsch_link **curr_best, uint16_t *time_to_curr_best,
+            struct tsch_link **curr_backup)
+{
+  if(*curr_best == NULL || time_to_timeslot < *time_to_curr_best) {
+    *time_to_curr_best = time_to_timeslot;
+    *curr_best = l;
+    *curr_backup = NULL;
+  } else if(time_to_timeslot == *time_to_curr_best) {
+    struct tsch_link *best = *curr_best;
+    struct tsch_link *backup = *curr_backup;
+    struct tsch_link *new_best = NULL;
+    /* Two links are overlapping, we need to select one of them.
+     * By standard: prioritize Tx links first, second by lowest handle */
+    if((best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
+      /* Both or neither links have Tx, select the one with lowest handle */
+      if(l->slotframe_handle != best->slotframe_handle) {
+        if(l->slotframe_handle < best->slotframe_handle) {
+          new_best = l;
+        }
+      } else {
+        /* compare the link against the current best link and return the newly selected one */
+        new_best = TSCH_LINK_COMPARATOR(best, l);
+      }
+    } else {
+      /* Select the link that has the Tx option */
+      if(l->link_options & LINK_OPTION_TX) {
+        new_best = l;
+      }
+    }
+
+    /* Maintain backup_link */
+    /* Check if 'l' best can be used as backup */
+    if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
+      if(backup == NULL || l->slotframe_handle < backup->slotframe_handle) {
+        backup = l;
+      }
+    }
+    /* Check if curr_best can be used as backup */
+    if(new_best != best && (best->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
+      if(backup == NULL || best->slotframe_handle < backup->slotframe_handle) {
+        backup = best;
+      }
+    }
+    *curr_backup = backup;
+
+    /* Maintain curr_best */
+    if(new_best != NULL) {
+      *curr_best = new_best;
+    }
+  }
+}
 /*---------------------------------------------------------------------------*/
 /* Returns the next active link after a given ASN, and a backup link (for the same ASN, with Rx flag) */
 struct tsch_link *
@@ -448,59 +585,40 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
       uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
+#if TSCH_SCHEDULE_INDEX
+      /* Only the links at the first timeslot after the current one can
+       * be selected. Look them up in the index, wrapping around to the
+       * start of the slotframe. */
+      if(sf->index_len > 0) {
+        uint16_t pos = index_lower_bound(sf, timeslot + 1);
+        uint16_t next_timeslot;
+        uint16_t time_to_timeslot;
+        if(pos == sf->index_len) {
+          pos = 0;
+        }
+        next_timeslot = sf->index[pos]->timeslot;
+        time_to_timeslot =
+          next_timeslot > timeslot ?
+          next_timeslot - timeslot :
+          sf->size.val + next_timeslot - timeslot;
+        do {
+          select_link(sf->index[pos], time_to_timeslot,
+                      &curr_best, &time_to_curr_best, &curr_backup);
+          pos++;
+        } while(pos < sf->index_len && sf->index[pos]->timeslot == next_timeslot);
+      }
+#else /* TSCH_SCHEDULE_INDEX */
       struct tsch_link *l = list_head(sf->links_list);
       while(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
           l->timeslot - timeslot :
           sf->size.val + l->timeslot - timeslot;
-        if(curr_best == NULL || time_to_timeslot < time_to_curr_best) {
-          time_to_curr_best = time_to_timeslot;
-          curr_best = l;
-          curr_backup = NULL;
-        } else if(time_to_timeslot == time_to_curr_best) {
-          struct tsch_link *new_best = NULL;
-          /* Two links are overlapping, we need to select one of them.
-           * By standard: prioritize Tx links first, second by lowest handle */
-          if((curr_best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
-            /* Both or neither links have Tx, select the one with lowest handle */
-            if(l->slotframe_handle != curr_best->slotframe_handle) {
-              if(l->slotframe_handle < curr_best->slotframe_handle) {
-                new_best = l;
-              }
-            } else {
-              /* compare the link against the current best link and return the newly selected one */
-              new_best = TSCH_LINK_COMPARATOR(curr_best, l);
-            }
-          } else {
-            /* Select the link that has the Tx option */
-            if(l->link_options & LINK_OPTION_TX) {
-              new_best = l;
-            }
-          }
-
-          /* Maintain backup_link */
-          /* Check if 'l' best can be used as backup */
-          if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
-            if(curr_backup == NULL || l->slotframe_handle < curr_backup->slotframe_handle) {
-              curr_backup = l;
-            }
-          }
-          /* Check if curr_best can be used as backup */
-          if(new_best != curr_best && (curr_best->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
-            if(curr_backup == NULL || curr_best->slotframe_handle < curr_backup->slotframe_handle) {
-              curr_backup = curr_best;
-            }
-          }
-
-          /* Maintain curr_best */
-          if(new_best != NULL) {
-            curr_best = new_best;
-          }
-        }
-
+        select_link(l, time_to_timeslot,
+                    &curr_best, &time_to_curr_best, &curr_backup);
         l = list_item_next(l);
       }
+#endif /* TSCH_SCHEDULE_INDEX */
       sf = list_item_next(sf);
     }
     if(time_offset != NULL) {
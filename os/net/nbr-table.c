@@ -70,6 +70,21 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH_INDEX
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error NBR_TABLE_HASH_SIZE must be larger than NBR_TABLE_MAX_NEIGHBORS
+#endif
+/* Hash index from link-layer address to neighbor index. Each slot holds
+ * the neighbor index plus one, or zero if the slot is empty. Collisions
+ * are resolved with linear probing. */
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t hash_slot_t;
+#else
+typedef uint16_t hash_slot_t;
+#endif
+static hash_slot_t hash_index[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_HASH_INDEX */
+
 /*---------------------------------------------------------------------------*/
 static void remove_key(nbr_table_key_t *key, bool do_free);
 /*---------------------------------------------------------------------------*/
@@ -115,16 +130,85 @@ key_from_item(const nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH_INDEX
+static unsigned
+hash_lladdr(const linkaddr_t *lladdr)
+{
+  uint32_t h = 2166136261;
+  int i;
+
+  /* FNV-1a */
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h ^ lladdr->u8[i]) * 16777619;
+  }
+  return h % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_insert(const nbr_table_key_t *key)
+{
+  unsigned slot = hash_lladdr(&key->lladdr);
+
+  /* There is always a free slot, as the index is larger than the table. */
+  while(hash_index[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_index[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(const nbr_table_key_t *key)
+{
+  hash_slot_t entry = index_from_key(key) + 1;
+  unsigned slot = hash_lladdr(&key->lladdr);
+  unsigned next;
+  unsigned home;
+
+  while(hash_index[slot] != entry) {
+    if(hash_index[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+
+  /* Shift back the following entries of the probe sequence to fill the
+   * hole, so that lookups can stop at the first empty slot. */
+  for(next = (slot + 1) % NBR_TABLE_HASH_SIZE;
+      hash_index[next] != 0;
+      next = (next + 1) % NBR_TABLE_HASH_SIZE) {
+    home = hash_lladdr(&key_from_index(hash_index[next] - 1)->lladdr);
+    /* Move the entry unless its home slot lies cyclically in (slot, next]. */
+    if((next > slot && (home <= slot || home > next)) ||
+       (next < slot && (home <= slot && home > next))) {
+      hash_index[slot] = hash_index[next];
+      slot = next;
+    }
+  }
+  hash_index[slot] = 0;
+}
+#endif /* NBR_TABLE_HASH_INDEX */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
-  nbr_table_key_t *key;
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH_INDEX
+  unsigned slot;
+  for(slot = hash_lladdr(lladdr);
+      hash_index[slot] != 0;
+      slot = (slot + 1) % NBR_TABLE_HASH_SIZE) {
+    if(linkaddr_cmp(lladdr, &key_from_index(hash_index[slot] - 1)->lladdr)) {
+      return hash_index[slot] - 1;
+    }
+  }
+  return -1;
+#else /* NBR_TABLE_HASH_INDEX */
+  nbr_table_key_t *key;
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -133,6 +217,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     key = list_item_next(key);
   }
   return -1;
+#endif /* NBR_TABLE_HASH_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
@@ -183,6 +268,9 @@ remove_key(nbr_table_key_t *key, bool do_free)
   locked_map[index_from_key(key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, key);
+#if NBR_TABLE_HASH_INDEX
+  hash_remove(key);
+#endif /* NBR_TABLE_HASH_INDEX */
   if(do_free) {
     /* Release the memory */
     memb_free(&neighbor_addr_mem, key);
@@ -430,6 +518,9 @@ nbr_table_add_lladdr(const nbr_table_t *table, const linkaddr_t *lladdr,
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH_INDEX
+    hash_insert(key);
+#endif /* NBR_TABLE_HASH_INDEX */
   }
 
   /* Get item in the current table */
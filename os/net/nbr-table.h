@@ -55,6 +55,23 @@ typedef enum {
 
 #define NBR_TABLE_MAX_NEIGHBORS NBR_TABLE_CONF_MAX_NEIGHBORS
 
+/* Index the neighbors by link-layer address in an open-addressing hash
+ * table, so that lookups do not have to walk all neighbor keys. Enabled
+ * by default for tables that are large enough to benefit from it. */
+#ifdef NBR_TABLE_CONF_HASH_INDEX
+#define NBR_TABLE_HASH_INDEX NBR_TABLE_CONF_HASH_INDEX
+#else /* NBR_TABLE_CONF_HASH_INDEX */
+#define NBR_TABLE_HASH_INDEX (NBR_TABLE_MAX_NEIGHBORS >= 32)
+#endif /* NBR_TABLE_CONF_HASH_INDEX */
+
+/* The number of slots in the hash index. Must be larger than
+ * NBR_TABLE_MAX_NEIGHBORS; twice as large keeps the probe sequences short. */
+#ifdef NBR_TABLE_CONF_HASH_SIZE
+#define NBR_TABLE_HASH_SIZE NBR_TABLE_CONF_HASH_SIZE
+#else /* NBR_TABLE_CONF_HASH_SIZE */
+#define NBR_TABLE_HASH_SIZE (2 * NBR_TABLE_MAX_NEIGHBORS)
+#endif /* NBR_TABLE_CONF_HASH_SIZE */
+
 #ifdef NBR_TABLE_CONF_GC_GET_WORST
 #define NBR_TABLE_GC_GET_WORST NBR_TABLE_CONF_GC_GET_WORST
 #else /* NBR_TABLE_CONF_GC_GET_WORST */
@@ -62,6 +62,12 @@ static uint8_t hdrlen;
 static uint32_t packetbuf_aligned[(PACKETBUF_SIZE + 3) / 4];
 static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
 
+/* The external buffer referenced by the packetbuf, if any. Headers are
+   allocated from the headroom in front of a referenced packet. */
+static uint16_t headroom;
+static void (*release_callback)(void *ptr);
+static void *release_ptr;
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -70,10 +76,26 @@ static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+release_reference(void)
+{
+  void (*release)(void *ptr) = release_callback;
+
+  if(packetbuf != (uint8_t *)packetbuf_aligned) {
+    packetbuf = (uint8_t *)packetbuf_aligned;
+    headroom = 0;
+    release_callback = NULL;
+    if(release != NULL) {
+      release(release_ptr);
+    }
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_clear(void)
 {
+  release_reference();
   buflen = bufptr = 0;
   hdrlen = 0;
 
@@ -112,6 +134,15 @@ packetbuf_hdralloc(int size)
     return 0;
   }
 
+  if(size <= headroom) {
+    /* Put the header in front of the referenced packet */
+    packetbuf -= size;
+    headroom -= size;
+    hdrlen += size;
+    return 1;
+  }
+  packetbuf_detach();
+
   /* shift data to the right */
   for(i = packetbuf_totlen() - 1; i >= 0; i--) {
     packetbuf[i + size] = packetbuf[i];
@@ -133,6 +164,27 @@ packetbuf_hdrreduce(int size)
 }
 /*---------------------------------------------------------------------------*/
 void
+packetbuf_reference(void *buf, uint16_t len, uint16_t room,
+                    void (*release)(void *ptr), void *ptr)
+{
+  packetbuf_clear();
+  packetbuf = buf;
+  headroom = room;
+  release_callback = release;
+  release_ptr = ptr;
+  buflen = MIN(PACKETBUF_SIZE, len);
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_detach(void)
+{
+  if(packetbuf != (uint8_t *)packetbuf_aligned) {
+    memcpy(packetbuf_aligned, packetbuf, packetbuf_totlen());
+    release_reference();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
 packetbuf_set_datalen(uint16_t len)
 {
   PRINTF("packetbuf_set_len: len %d\n", len);
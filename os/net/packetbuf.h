@@ -192,6 +192,43 @@ int packetbuf_hdralloc(int size);
  */
 int packetbuf_hdrreduce(int size);
 
+/**
+ * \brief      Let the packetbuf refer to an external buffer instead of copying it
+ * \param buf  A pointer to the packet in the external buffer
+ * \param len  The length of the packet
+ * \param headroom The number of writable bytes in front of \p buf
+ * \param release Called with \p ptr when the packetbuf no longer refers to
+ *             the external buffer, or NULL
+ * \param ptr  An opaque pointer passed to \p release
+ *
+ *             This function clears the packetbuf and makes it point
+ *             at an external buffer, without copying the packet. The
+ *             external buffer must be able to accomodate at least
+ *             PACKETBUF_SIZE bytes after \p buf. Headers allocated
+ *             with packetbuf_hdralloc() are placed in the headroom,
+ *             which leaves the packet in the external buffer intact.
+ *
+ *             The reference is dropped by packetbuf_clear(),
+ *             packetbuf_copyfrom(), packetbuf_detach() and the next
+ *             call to this function. Code that modifies the packet in
+ *             place, other than by allocating headers, must call
+ *             packetbuf_detach() first.
+ *
+ */
+void packetbuf_reference(void *buf, uint16_t len, uint16_t headroom,
+                         void (*release)(void *ptr), void *ptr);
+
+/**
+ * \brief      Copy a referenced packet into the packetbuf
+ *
+ *             This function copies the packet from the external
+ *             buffer given to packetbuf_reference() into the packetbuf
+ *             and drops the reference. It does nothing if the
+ *             packetbuf holds its own copy of the packet.
+ *
+ */
+void packetbuf_detach(void);
+
 /* Packet attributes stuff below: */
 
 typedef uint16_t packetbuf_attr_t;
@@ -49,6 +49,8 @@
 #include "cfs/cfs.h"
 #endif
 
+#include <stddef.h> /* for offsetof() */
+#include <stdio.h> /* for printf() in queuebuf_debug_print() */
 #include <string.h> /* for memcpy() */
 
 /* Structure pointing to a buffer either stored
@@ -73,8 +75,15 @@ struct queuebuf {
 
 /* The actual queuebuf data */
 struct queuebuf_data {
+#if QUEUEBUF_REF
+  uint8_t headroom[QUEUEBUF_REF_HEADROOM];
+#endif /* QUEUEBUF_REF */
   uint8_t data[PACKETBUF_SIZE];
   uint16_t len;
+#if QUEUEBUF_REF
+  /* The queuebuf and the packetbuf may both refer to the data */
+  uint8_t refs;
+#endif /* QUEUEBUF_REF */
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
 };
@@ -82,6 +91,11 @@ struct queuebuf_data {
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
 MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
 
+#if QUEUEBUF_REF
+static_assert(offsetof(struct queuebuf_data, data) == QUEUEBUF_REF_HEADROOM,
+              "The headroom must immediately precede the queuebuf data");
+#endif /* QUEUEBUF_REF */
+
 #if WITH_SWAP
 
 /* Swapping allows to store up to QUEUEBUF_NUM - QUEUEBUFRAM_NUM
@@ -125,14 +139,15 @@ LIST(queuebuf_list);
 #define PRINTF(...)
 #endif
 
-#ifdef QUEUEBUF_CONF_STATS
-#define QUEUEBUF_STATS QUEUEBUF_CONF_STATS
-#else
-#define QUEUEBUF_STATS 0
-#endif /* QUEUEBUF_CONF_STATS */
+#define ATTRS_SIZE (sizeof(struct packetbuf_attr) * PACKETBUF_NUM_ATTRS + \
+                    sizeof(struct packetbuf_addr) * PACKETBUF_NUM_ADDRS)
 
 #if QUEUEBUF_STATS
 uint8_t queuebuf_len, queuebuf_max_len;
+uint32_t queuebuf_copied_bytes;
+#define STATS_ADD_COPIED(bytes) (queuebuf_copied_bytes += (bytes))
+#else /* QUEUEBUF_STATS */
+#define STATS_ADD_COPIED(bytes)
 #endif /* QUEUEBUF_STATS */
 
 #if WITH_SWAP
@@ -277,6 +292,25 @@ queuebuf_load_to_ram(struct queuebuf *b)
 }
 #endif /* WITH_SWAP */
 /*---------------------------------------------------------------------------*/
+static void
+queuebuf_data_unref(struct queuebuf_data *data)
+{
+#if QUEUEBUF_REF
+  if(--data->refs > 0) {
+    return;
+  }
+#endif /* QUEUEBUF_REF */
+  memb_free(&buframmem, data);
+}
+/*---------------------------------------------------------------------------*/
+#if QUEUEBUF_REF
+static void
+packetbuf_released(void *ptr)
+{
+  queuebuf_data_unref(ptr);
+}
+#endif /* QUEUEBUF_REF */
+/*---------------------------------------------------------------------------*/
 void
 queuebuf_init(void)
 {
@@ -291,6 +325,7 @@ queuebuf_init(void)
   memb_init(&bufmem);
 #if QUEUEBUF_STATS
   queuebuf_max_len = 0;
+  queuebuf_copied_bytes = 0;
 #endif /* QUEUEBUF_STATS */
 }
 /*---------------------------------------------------------------------------*/
@@ -320,6 +355,16 @@ queuebuf_new_from_packetbuf(void)
     buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
     buf->ram_ptr = memb_alloc(&buframmem);
+#if QUEUEBUF_REF
+    if(buf->ram_ptr == NULL) {
+      /* The packetbuf may hold the last reference to freed data */
+      packetbuf_detach();
+      buf->ram_ptr = memb_alloc(&buframmem);
+    }
+    if(buf->ram_ptr != NULL) {
+      buf->ram_ptr->refs = 1;
+    }
+#endif /* QUEUEBUF_REF */
 #if WITH_SWAP
     /* If the allocation failed, store the qbuf in swap files */
     if(buf->ram_ptr != NULL) {
@@ -334,6 +379,9 @@ queuebuf_new_from_packetbuf(void)
 #else
     if(buf->ram_ptr == NULL) {
       PRINTF("queuebuf_new_from_packetbuf: could not queuebuf data\n");
+#if QUEUEBUF_DEBUG
+      list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
       memb_free(&bufmem, buf);
       return NULL;
     }
@@ -342,11 +390,15 @@ queuebuf_new_from_packetbuf(void)
 
     buframptr->len = packetbuf_copyto(buframptr->data);
     packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+    STATS_ADD_COPIED(buframptr->len + ATTRS_SIZE);
 
 #if WITH_SWAP
     if(buf->location == IN_CFS) {
       if(queuebuf_flush_tmpdata() == -1) {
         /* We were unable to write the data in the swap */
+#if QUEUEBUF_DEBUG
+        list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
         memb_free(&bufmem, buf);
         return NULL;
       }
@@ -372,6 +424,7 @@ queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+  STATS_ADD_COPIED(ATTRS_SIZE);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
@@ -383,8 +436,13 @@ void
 queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
+#if QUEUEBUF_REF
+  /* The packetbuf may refer to the data that is overwritten */
+  packetbuf_detach();
+#endif /* QUEUEBUF_REF */
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
   buframptr->len = packetbuf_copyto(buframptr->data);
+  STATS_ADD_COPIED(buframptr->len + ATTRS_SIZE);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
@@ -398,21 +456,21 @@ queuebuf_free(struct queuebuf *buf)
   if(memb_inmemb(&bufmem, buf)) {
 #if WITH_SWAP
     if(buf->location == IN_RAM) {
-      memb_free(&buframmem, buf->ram_ptr);
+      queuebuf_data_unref(buf->ram_ptr);
     } else {
       queuebuf_remove_from_file(buf->swap_id);
     }
 #else
-    memb_free(&buframmem, buf->ram_ptr);
+    queuebuf_data_unref(buf->ram_ptr);
 #endif
+#if QUEUEBUF_DEBUG
+    list_remove(queuebuf_list, buf);
+#endif /* QUEUEBUF_DEBUG */
     memb_free(&bufmem, buf);
 #if QUEUEBUF_STATS
     --queuebuf_len;
     PRINTF("#A q=%d\n", queuebuf_len);
 #endif /* QUEUEBUF_STATS */
-#if QUEUEBUF_DEBUG
-    list_remove(queuebuf_list, buf);
-#endif /* QUEUEBUF_DEBUG */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -423,7 +481,25 @@ queuebuf_to_packetbuf(struct queuebuf *b)
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
     packetbuf_copyfrom(buframptr->data, buframptr->len);
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+    STATS_ADD_COPIED(buframptr->len + ATTRS_SIZE);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+queuebuf_to_packetbuf_ref(struct queuebuf *b)
+{
+#if QUEUEBUF_REF
+  if(memb_inmemb(&bufmem, b)) {
+    struct queuebuf_data *buframptr = b->ram_ptr;
+    buframptr->refs++;
+    packetbuf_reference(buframptr->data, buframptr->len,
+                        QUEUEBUF_REF_HEADROOM, packetbuf_released, buframptr);
+    packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+    STATS_ADD_COPIED(ATTRS_SIZE);
   }
+#else /* QUEUEBUF_REF */
+  queuebuf_to_packetbuf(b);
+#endif /* QUEUEBUF_REF */
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -86,6 +86,29 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* QUEUEBUF_CONF_REF lets the packetbuf refer to the data of a
+   queuebuf instead of copying it, see queuebuf_to_packetbuf_ref().
+   The data is reference counted, and link-layer headers are written
+   into QUEUEBUF_REF_HEADROOM bytes in front of the queued packet.
+   References require all queuebufs to be stored in RAM. */
+#ifdef QUEUEBUF_CONF_REF
+#define QUEUEBUF_REF (QUEUEBUF_CONF_REF && !WITH_SWAP)
+#else /* QUEUEBUF_CONF_REF */
+#define QUEUEBUF_REF 0
+#endif /* QUEUEBUF_CONF_REF */
+
+#ifdef QUEUEBUF_CONF_REF_HEADROOM
+#define QUEUEBUF_REF_HEADROOM QUEUEBUF_CONF_REF_HEADROOM
+#else /* QUEUEBUF_CONF_REF_HEADROOM */
+#define QUEUEBUF_REF_HEADROOM 32
+#endif /* QUEUEBUF_CONF_REF_HEADROOM */
+
+#ifdef QUEUEBUF_CONF_STATS
+#define QUEUEBUF_STATS QUEUEBUF_CONF_STATS
+#else
+#define QUEUEBUF_STATS 0
+#endif /* QUEUEBUF_CONF_STATS */
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -94,6 +117,12 @@
 
 struct queuebuf;
 
+#if QUEUEBUF_STATS
+extern uint8_t queuebuf_len, queuebuf_max_len;
+/* The number of packet and attribute bytes copied to and from queuebufs */
+extern uint32_t queuebuf_copied_bytes;
+#endif /* QUEUEBUF_STATS */
+
 void queuebuf_init(void);
 
 #if QUEUEBUF_DEBUG
@@ -106,6 +135,23 @@ void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
 void queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
+
+/**
+ * \brief      Let the packetbuf refer to the data of a queuebuf
+ * \param b    The queuebuf
+ *
+ *             This function works like queuebuf_to_packetbuf(), but
+ *             makes the packetbuf point at the queued packet instead
+ *             of copying it when QUEUEBUF_REF is enabled. Headers
+ *             allocated in the packetbuf are written in front of the
+ *             queued packet, so the queuebuf can be sent again. The
+ *             data stays valid until the packetbuf is cleared, even
+ *             if the queuebuf is freed in the meantime.
+ *
+ *             The caller must not modify the packet in place other
+ *             than by allocating headers, see packetbuf_reference().
+ */
+void queuebuf_to_packetbuf_ref(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
 
 void *queuebuf_dataptr(struct queuebuf *b);
@@ -146,12 +146,71 @@ static struct {
 COAP_HANDLER(lwm2m_handler, lwm2m_handler_callback);
 LIST(object_list);
 LIST(generic_object_list);
+#if LWM2M_ENGINE_HASH_INDEX
+/* The lists keep the registration order for the RD payload and discovery */
+static lwm2m_object_instance_t *instance_hash[LWM2M_ENGINE_HASH_SIZE];
+static lwm2m_object_t *object_hash[LWM2M_ENGINE_HASH_SIZE];
+#endif /* LWM2M_ENGINE_HASH_INDEX */
 
+/*---------------------------------------------------------------------------*/
+#if LWM2M_ENGINE_HASH_INDEX
+static lwm2m_object_instance_t **
+instance_bucket(uint16_t object_id, uint16_t instance_id)
+{
+  uint32_t h = ((uint32_t)object_id << 16) | instance_id;
+
+  h = (h ^ (h >> 15)) * 2654435761UL;
+  return &instance_hash[(h >> 16) % LWM2M_ENGINE_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static lwm2m_object_t **
+object_bucket(uint16_t object_id)
+{
+  return &object_hash[object_id % LWM2M_ENGINE_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static void
+instance_hash_remove(lwm2m_object_instance_t *instance)
+{
+  lwm2m_object_instance_t **i;
+
+  for(i = instance_bucket(instance->object_id, instance->instance_id);
+      *i != NULL; i = &(*i)->hash_next) {
+    if(*i == instance) {
+      *i = instance->hash_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+object_hash_remove(lwm2m_object_t *object)
+{
+  lwm2m_object_t **o;
+
+  for(o = object_bucket(object->impl->object_id); *o != NULL;
+      o = &(*o)->hash_next) {
+    if(*o == object) {
+      *o = object->hash_next;
+      return;
+    }
+  }
+}
+#endif /* LWM2M_ENGINE_HASH_INDEX */
 /*---------------------------------------------------------------------------*/
 static lwm2m_object_t *
 get_object(uint16_t object_id)
 {
   lwm2m_object_t *object;
+#if LWM2M_ENGINE_HASH_INDEX
+  for(object = *object_bucket(object_id);
+      object != NULL;
+      object = object->hash_next) {
+    if(object->impl->object_id == object_id) {
+      return object;
+    }
+  }
+#else /* LWM2M_ENGINE_HASH_INDEX */
   for(object = list_head(generic_object_list);
       object != NULL;
       object = object->next) {
@@ -159,6 +218,7 @@ get_object(uint16_t object_id)
       return object;
     }
   }
+#endif /* LWM2M_ENGINE_HASH_INDEX */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -177,15 +237,26 @@ has_non_generic_object(uint16_t object_id)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Find a registered object instance, or the first registered instance of
+   the object if instance_id is LWM2M_OBJECT_INSTANCE_NONE */
 static lwm2m_object_instance_t *
-get_instance(uint16_t object_id, uint16_t instance_id, lwm2m_object_t **o)
+find_instance(uint16_t object_id, uint16_t instance_id)
 {
   lwm2m_object_instance_t *instance;
-  lwm2m_object_t *object;
 
-  if(o) {
-    *o = NULL;
+#if LWM2M_ENGINE_HASH_INDEX
+  if(instance_id != LWM2M_OBJECT_INSTANCE_NONE) {
+    for(instance = *instance_bucket(object_id, instance_id);
+        instance != NULL;
+        instance = instance->hash_next) {
+      if(instance->object_id == object_id &&
+         instance->instance_id == instance_id) {
+        return instance;
+      }
+    }
+    return NULL;
   }
+#endif /* LWM2M_ENGINE_HASH_INDEX */
 
   for(instance = list_head(object_list);
       instance != NULL;
@@ -197,6 +268,23 @@ get_instance(uint16_t object_id, uint16_t instance_id, lwm2m_object_t **o)
       }
     }
   }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static lwm2m_object_instance_t *
+get_instance(uint16_t object_id, uint16_t instance_id, lwm2m_object_t **o)
+{
+  lwm2m_object_instance_t *instance;
+  lwm2m_object_t *object;
+
+  if(o) {
+    *o = NULL;
+  }
+
+  instance = find_instance(object_id, instance_id);
+  if(instance != NULL) {
+    return instance;
+  }
 
   object = get_object(object_id);
   if(object != NULL) {
@@ -257,8 +345,8 @@ double_buffer_flush(lwm2m_buffer_t *ctxbuf, lwm2m_buffer_t *outbuf, int size)
     LOG_DBG("Double buffer - copying out %d bytes remaining: %d\n",
             size, ctxbuf->len - size);
     memcpy(outbuf->buffer, ctxbuf->buffer, size);
-    memcpy(ctxbuf->buffer, &ctxbuf->buffer[size],
-           ctxbuf->len - size);
+    memmove(ctxbuf->buffer, &ctxbuf->buffer[size],
+            ctxbuf->len - size);
     ctxbuf->len -= size;
     outbuf->len = size;
     return outbuf->len;
@@ -508,6 +596,10 @@ lwm2m_engine_init(void)
 {
   list_init(object_list);
   list_init(generic_object_list);
+#if LWM2M_ENGINE_HASH_INDEX
+  memset(instance_hash, 0, sizeof(instance_hash));
+  memset(object_hash, 0, sizeof(object_hash));
+#endif /* LWM2M_ENGINE_HASH_INDEX */
 
 #ifdef LWM2M_ENGINE_CLIENT_ENDPOINT_NAME
   const char *endpoint = LWM2M_ENGINE_CLIENT_ENDPOINT_NAME;
@@ -645,6 +737,76 @@ lwm2m_engine_select_reader(lwm2m_context_t *context, unsigned int content_format
 static uint32_t last_instance_id = NO_INSTANCE;
 static int last_rsc_pos;
 
+/*
+ * Where a block-wise multi read stopped. A request for the next block from
+ * the same endpoint continues from here. Any other request for a later block,
+ * e.g. a block that is requested again, regenerates the output from the
+ * start and discards everything before the requested offset.
+ */
+static struct {
+  coap_endpoint_t endpoint;
+  lwm2m_object_t *object;
+  lwm2m_object_instance_t *instance;
+  uint32_t offset; /* offset of the next block, 0 if none */
+  unsigned int content_type;
+  uint8_t operation;
+  uint8_t writer_flags;
+} read_cursor;
+
+/*---------------------------------------------------------------------------*/
+static int
+read_cursor_match(const lwm2m_context_t *ctx)
+{
+  const coap_endpoint_t *ep;
+
+  ep = coap_get_src_endpoint(ctx->request);
+  return read_cursor.offset > 0 &&
+    read_cursor.offset == ctx->offset &&
+    read_cursor.operation == ctx->operation &&
+    read_cursor.content_type == ctx->content_type &&
+    lwm2m_buf_lock[0] != 0 &&
+    lwm2m_buf_lock[1] == ctx->object_id &&
+    lwm2m_buf_lock[2] == ctx->object_instance_id &&
+    lwm2m_buf_lock[3] == ctx->resource_id &&
+    ep != NULL && coap_endpoint_cmp(&read_cursor.endpoint, ep);
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_cursor_save(const lwm2m_context_t *ctx, lwm2m_object_t *object)
+{
+  const coap_endpoint_t *ep;
+
+  ep = coap_get_src_endpoint(ctx->request);
+  if(ep == NULL) {
+    read_cursor.offset = 0;
+    return;
+  }
+  coap_endpoint_copy(&read_cursor.endpoint, ep);
+  read_cursor.object = object;
+  read_cursor.offset = ctx->offset;
+  read_cursor.content_type = ctx->content_type;
+  read_cursor.operation = ctx->operation;
+  read_cursor.writer_flags = ctx->writer_flags & ~WRITER_HAS_MORE;
+}
+/*---------------------------------------------------------------------------*/
+/* Drop regenerated output that comes before the requested block */
+static void
+discard_output(lwm2m_context_t *ctx, uint32_t *skip)
+{
+  uint32_t len;
+
+  if(*skip == 0) {
+    return;
+  }
+  len = MIN(*skip, ctx->outbuf->len);
+  memmove(ctx->outbuf->buffer, &ctx->outbuf->buffer[len],
+          ctx->outbuf->len - len);
+  ctx->outbuf->len -= len;
+  ctx->offset += len;
+  *skip -= len;
+}
+/*---------------------------------------------------------------------------*/
+
 /* Multi read will handle read of JSON / TLV or Discovery (Link Format) */
 static lwm2m_status_t
 perform_multi_resource_read_op(lwm2m_object_t *object,
@@ -655,6 +817,7 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
   int len = 0;
   uint8_t initialized = 0; /* used for commas, etc */
   uint8_t num_read = 0;
+  uint32_t skip = 0;
   lwm2m_buffer_t *outbuf;
 
   if(instance == NULL) {
@@ -691,11 +854,19 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
   /* Make use of the double buffer */
   ctx->outbuf = &lwm2m_buf;
 
+  if(ctx->offset > 0 && !read_cursor_match(ctx)) {
+    /* Not the block after the previous one - start over */
+    LOG_DBG("MultiRead: regenerating up to offset %"PRIu32"\n", ctx->offset);
+    skip = ctx->offset;
+    ctx->offset = 0;
+  }
+
   if(ctx->offset == 0) {
     /* First GET request - need to setup all buffers and reset things here */
     last_instance_id =
       ((uint32_t)instance->object_id << 16) | instance->instance_id;
     last_rsc_pos = 0;
+    read_cursor.instance = instance;
     /* reset any callback */
     current_opaque_callback = NULL;
     /* reset lwm2m_buf_len - so that we can use the double-size buffer */
@@ -706,17 +877,20 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
     lwm2m_buf.len = 0;
     /* Here we should print top node */
   } else {
-    /* offset > 0 - assume that we are already in a disco or multi get*/
-    instance = get_instance(last_instance_id >> 16, last_instance_id & 0xffff,
-                            &object);
+    /* offset > 0 - continue the disco or multi get where it stopped */
+    object = read_cursor.object;
+    if(last_instance_id == NO_INSTANCE) {
+      instance = NULL;
+    } else if(object != NULL) {
+      /* Instances of generic objects may come and go - look it up again */
+      instance = object->impl->get_by_id(last_instance_id & 0xffff, NULL);
+    } else {
+      instance = read_cursor.instance;
+    }
 
     /* we assume that this was initialized */
     initialized = 1;
-    ctx->writer_flags |= WRITER_OUTPUT_VALUE;
-    if(instance == NULL) {
-      ctx->offset = -1;
-      ctx->outbuf->buffer[0] = ' ';
-    }
+    ctx->writer_flags = read_cursor.writer_flags;
   }
   lwm2m_buf_lock_timeout = coap_timer_uptime() + 1000;
 
@@ -751,6 +925,7 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
             /* here we have "read" out something */
             num_read++;
             ctx->outbuf->len += len;
+            discard_output(ctx, &skip);
             if(len < 0 || ctx->outbuf->len >= size) {
               double_buffer_flush(ctx->outbuf, outbuf, size);
 
@@ -759,6 +934,7 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
               ctx->outbuf = outbuf;
               ctx->writer_flags |= WRITER_HAS_MORE;
               ctx->offset += size;
+              read_cursor_save(ctx, object);
               return LWM2M_STATUS_OK;
             }
             /* ---------- Read operation ------------- */
@@ -859,6 +1035,7 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
           LOG_DBG("Opaque is set - continue with that.\n");
         }
 
+        discard_output(ctx, &skip);
         if(ctx->outbuf->len >= COAP_MAX_BLOCK_SIZE) {
           LOG_DBG("**** CoAP MAX BLOCK Reached!!! **** SEND\n");
           /* If the produced data is larger than a CoAP block we need to send
@@ -872,6 +1049,7 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
             ctx->outbuf = outbuf;
             ctx->writer_flags |= WRITER_HAS_MORE;
             ctx->offset += size;
+            read_cursor_save(ctx, object);
             /* OK - everything went well... but we have more. - keep the lock here! */
             return LWM2M_STATUS_OK;
           } else {
@@ -888,6 +1066,7 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
     } else {
       last_instance_id = NO_INSTANCE;
     }
+    read_cursor.instance = instance;
     if(ctx->operation == LWM2M_OP_READ) {
       LOG_DBG("END Writer %d ->", ctx->outbuf->len);
       len = ctx->writer->end_write(ctx);
@@ -900,12 +1079,13 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
   }
 
   /* did not read anything even if we should have - on single item */
-  if(num_read == 0 && ctx->level == 3) {
+  if(num_read == 0 && ctx->level == 3 && ctx->offset == 0) {
     lwm2m_buf_lock[0] = 0;
     return LWM2M_STATUS_NOT_FOUND;
   }
 
   /* seems like we are done! - flush buffer */
+  discard_output(ctx, &skip);
   len = double_buffer_flush(ctx->outbuf, outbuf, size);
   ctx->outbuf = outbuf;
   ctx->offset += len;
@@ -914,6 +1094,7 @@ perform_multi_resource_read_op(lwm2m_object_t *object,
      callback */
   if(lwm2m_buf.len > 0) {
     ctx->writer_flags |= WRITER_HAS_MORE;
+    read_cursor_save(ctx, object);
   } else {
     /* OK - everything went well we are done, unlock and return */
     lwm2m_buf_lock[0] = 0;
@@ -1234,28 +1415,28 @@ lwm2m_engine_add_object(lwm2m_object_instance_t *object)
     return 0;
   }
 
-  for(instance = list_head(object_list);
-      instance != NULL;
-      instance = instance->next) {
-    if(object->object_id == instance->object_id) {
-      if(object->instance_id == instance->instance_id) {
-        LOG_DBG("object with id %u/%u already registered\n",
-               instance->object_id, instance->instance_id);
-        return 0;
-      }
-
-      found++;
-      if(instance->instance_id > max_id) {
-        max_id = instance->instance_id;
-      }
-      if(instance->instance_id < min_id) {
-        min_id = instance->instance_id;
+  if(object->instance_id != LWM2M_OBJECT_INSTANCE_NONE) {
+    if(find_instance(object->object_id, object->instance_id) != NULL) {
+      LOG_DBG("object with id %u/%u already registered\n",
+              object->object_id, object->instance_id);
+      return 0;
+    }
+  } else {
+    /* No instance id has been assigned yet */
+    for(instance = list_head(object_list);
+        instance != NULL;
+        instance = instance->next) {
+      if(object->object_id == instance->object_id) {
+        found++;
+        if(instance->instance_id > max_id) {
+          max_id = instance->instance_id;
+        }
+        if(instance->instance_id < min_id) {
+          min_id = instance->instance_id;
+        }
       }
     }
-  }
 
-  if(object->instance_id == LWM2M_OBJECT_INSTANCE_NONE) {
-    /* No instance id has been assigned yet */
     if(found == 0) {
       /* First object with this id */
       object->instance_id = 0;
@@ -1266,6 +1447,10 @@ lwm2m_engine_add_object(lwm2m_object_instance_t *object)
     }
   }
   list_add(object_list, object);
+#if LWM2M_ENGINE_HASH_INDEX
+  object->hash_next = *instance_bucket(object->object_id, object->instance_id);
+  *instance_bucket(object->object_id, object->instance_id) = object;
+#endif /* LWM2M_ENGINE_HASH_INDEX */
 #if USE_RD_CLIENT
   lwm2m_rd_client_set_update_rd();
 #endif
@@ -1276,6 +1461,13 @@ void
 lwm2m_engine_remove_object(lwm2m_object_instance_t *object)
 {
   list_remove(object_list, object);
+#if LWM2M_ENGINE_HASH_INDEX
+  instance_hash_remove(object);
+#endif /* LWM2M_ENGINE_HASH_INDEX */
+  if(read_cursor.instance == object) {
+    /* A read in progress can no longer continue from this instance */
+    read_cursor.offset = 0;
+  }
 #if USE_RD_CLIENT
   lwm2m_rd_client_set_update_rd();
 #endif
@@ -1304,6 +1496,10 @@ lwm2m_engine_add_generic_object(lwm2m_object_t *object)
     return 0;
   }
   list_add(generic_object_list, object);
+#if LWM2M_ENGINE_HASH_INDEX
+  object->hash_next = *object_bucket(object->impl->object_id);
+  *object_bucket(object->impl->object_id) = object;
+#endif /* LWM2M_ENGINE_HASH_INDEX */
 
 #if USE_RD_CLIENT
   lwm2m_rd_client_set_update_rd();
@@ -1316,6 +1512,12 @@ void
 lwm2m_engine_remove_generic_object(lwm2m_object_t *object)
 {
   list_remove(generic_object_list, object);
+#if LWM2M_ENGINE_HASH_INDEX
+  object_hash_remove(object);
+#endif /* LWM2M_ENGINE_HASH_INDEX */
+  if(read_cursor.object == object) {
+    read_cursor.offset = 0;
+  }
 #if USE_RD_CLIENT
   lwm2m_rd_client_set_update_rd();
 #endif
@@ -48,6 +48,21 @@
 #include "lwm2m-object.h"
 #include "lwm2m-queue-mode-conf.h"
 
+/* Look up object instances and generic objects in hash tables keyed on
+   their ids instead of walking the lists of all registered ones */
+#ifdef LWM2M_ENGINE_CONF_HASH_INDEX
+#define LWM2M_ENGINE_HASH_INDEX LWM2M_ENGINE_CONF_HASH_INDEX
+#else
+#define LWM2M_ENGINE_HASH_INDEX 0
+#endif
+
+/* Number of buckets in each of the hash tables */
+#ifdef LWM2M_ENGINE_CONF_HASH_SIZE
+#define LWM2M_ENGINE_HASH_SIZE LWM2M_ENGINE_CONF_HASH_SIZE
+#else
+#define LWM2M_ENGINE_HASH_SIZE 32
+#endif
+
 #define LWM2M_FLOAT32_BITS  10
 #define LWM2M_FLOAT32_FRAC (1L << LWM2M_FLOAT32_BITS)
 
@@ -84,6 +99,9 @@ struct lwm2m_object_instance {
   /* the callback for requests */
   lwm2m_object_instance_callback_t callback;
   lwm2m_resource_dim_callback_t resource_dim_callback;
+#if LWM2M_ENGINE_HASH_INDEX
+  lwm2m_object_instance_t *hash_next; /* next instance in the same bucket */
+#endif
 };
 
 typedef struct {
@@ -102,6 +120,9 @@ typedef struct lwm2m_object lwm2m_object_t;
 struct lwm2m_object {
   lwm2m_object_t *next;
   const lwm2m_object_impl_t *impl;
+#if LWM2M_ENGINE_HASH_INDEX
+  lwm2m_object_t *hash_next; /* next object in the same bucket */
+#endif
 };
 
 lwm2m_object_instance_t *lwm2m_engine_get_instance_buffer(void);
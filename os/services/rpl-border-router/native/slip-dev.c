@@ -309,7 +309,7 @@ slip_send(int fd, unsigned char c)
 }
 /*---------------------------------------------------------------------------*/
 int
-slip_empty()
+slip_empty(void)
 {
   return slip_packet_end == 0;
 }
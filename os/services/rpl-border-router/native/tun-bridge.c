@@ -60,11 +60,22 @@ tun_input_callback(void)
   /* Base delay times number of 6lowpan fragments to be sent */
   if(!slip_config_basedelay || timer_expired(&delay_timer)) {
     uip_len = tun6_net_input(uip_buf, sizeof(uip_buf));
-    tcpip_input();
+    if(uip_len > 0) {
+      tcpip_input();
+    }
 
     if(slip_config_basedelay) {
       timer_set(&delay_timer, slip_config_basedelay);
+      tun6_net_input_pause();
     }
+  } else {
+    tun6_net_input_pause();
+  }
+
+  /* The SLIP buffer is only drained from the main loop, so read no more
+     packets until the queued frames have been written to the radio. */
+  if(!slip_empty()) {
+    tun6_net_input_pause();
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -63,9 +63,11 @@
 #endif /* MAC_CONF_WITH_TSCH */
 #if MAC_CONF_WITH_CSMA
 #include "net/mac/csma/csma.h"
+#include "net/mac/csma/csma-output.h"
 #endif
 #include "net/routing/routing.h"
 #include "net/mac/llsec802154.h"
+#include "sys/profile.h"
 
 /* For RPL-specific commands */
 #if ROUTING_CONF_RPL_LITE
@@ -74,6 +76,7 @@
 #include "net/routing/rpl-classic/rpl.h"
 #endif
 
+#include <inttypes.h>
 #include <stdlib.h>
 
 #define PING_TIMEOUT (5 * CLOCK_SECOND)
@@ -809,6 +812,80 @@ PT_THREAD(cmd_reboot(struct pt *pt, shell_output_func output, char *args))
   watchdog_reboot();
   PT_END(pt);
 }
+#if PROFILE_ON
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_profile(struct pt *pt, shell_output_func output, char *args))
+{
+  const struct profile_entry *entries[PROFILE_MAX_ENTRIES];
+  char *next_args;
+  int count;
+
+  PT_BEGIN(pt);
+
+  SHELL_ARGS_INIT(args, next_args);
+  SHELL_ARGS_NEXT(args, next_args);
+  if(args != NULL && !strcmp(args, "reset")) {
+    profile_reset();
+    SHELL_OUTPUT(output, "Profile reset\n");
+    PT_EXIT(pt);
+  }
+
+  count = profile_get_entries(entries, PROFILE_MAX_ENTRIES);
+  SHELL_OUTPUT(output, "Profile: %d entries, %"PRIu32" dropped invocations\n",
+               count, profile_dropped());
+  for(int i = 0; i < count; i++) {
+    const struct profile_entry *e = entries[i];
+    SHELL_OUTPUT(output, "-- %-7s %p %-20s calls %8"PRIu32", time %10"PRIu64
+                 " us, max %8"PRIu64" us\n",
+                 profile_type_name(e->type), (void *)e->key,
+                 e->name != NULL ? e->name : "-", e->calls,
+                 e->time * 1000000 / PROFILE_SECOND,
+                 (uint64_t)e->max_time * 1000000 / PROFILE_SECOND);
+  }
+
+  PT_END(pt);
+}
+#endif /* PROFILE_ON */
+#if MAC_CONF_WITH_CSMA && CSMA_STATS
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_csma_stats(struct pt *pt, shell_output_func output, char *args))
+{
+  const struct csma_nbr_stats *entries[CSMA_STATS_MAX_NEIGHBORS];
+  char *next_args;
+  int count;
+
+  PT_BEGIN(pt);
+
+  SHELL_ARGS_INIT(args, next_args);
+  SHELL_ARGS_NEXT(args, next_args);
+  if(args != NULL && !strcmp(args, "reset")) {
+    csma_output_reset_stats();
+    SHELL_OUTPUT(output, "CSMA statistics reset\n");
+    PT_EXIT(pt);
+  }
+
+  count = csma_output_get_stats(entries, CSMA_STATS_MAX_NEIGHBORS);
+  SHELL_OUTPUT(output, "CSMA neighbors: %d\n", count);
+  for(int i = 0; i < count; i++) {
+    const struct csma_nbr_stats *e = entries[i];
+    uint32_t queued = e->queued > 0 ? e->queued : 1;
+    uint32_t packets = e->packets > 0 ? e->packets : 1;
+    SHELL_OUTPUT(output, "-- ");
+    shell_output_lladdr(output, &e->addr);
+    SHELL_OUTPUT(output, " packets %"PRIu32", failed %"PRIu32
+                 ", queue avg %"PRIu32" max %u, latency avg %"PRIu32
+                 " ms max %"PRIu32" ms\n",
+                 e->packets, e->failed, e->depth_sum / queued, e->depth_max,
+                 (uint32_t)((uint64_t)e->latency_sum * 1000 / CLOCK_SECOND)
+                 / packets,
+                 (uint32_t)((uint64_t)e->latency_max * 1000 / CLOCK_SECOND));
+  }
+
+  PT_END(pt);
+}
+#endif /* MAC_CONF_WITH_CSMA && CSMA_STATS */
 #if MAC_CONF_WITH_TSCH
 /*---------------------------------------------------------------------------*/
 static
@@ -997,6 +1074,12 @@ const struct shell_command_t builtin_shell_commands[] = {
   { "help",                 cmd_help,                 "'> help': Shows this help" },
   { "reboot",               cmd_reboot,               "'> reboot': Reboot the board by watchdog_reboot()" },
   { "log",                  cmd_log,                  "'> log module level': Sets log level (0--4) for a given module (or \"all\"). For module \"mac\", level 4 also enables per-slot logging." },
+#if PROFILE_ON
+  { "profile",              cmd_profile,              "'> profile [reset]': Shows the CPU time of processes, callbacks and handlers, or resets the profile" },
+#endif /* PROFILE_ON */
+#if MAC_CONF_WITH_CSMA && CSMA_STATS
+  { "csma-stats",           cmd_csma_stats,           "'> csma-stats [reset]': Shows the queue depth and latency of packets to each neighbor, or resets them" },
+#endif /* MAC_CONF_WITH_CSMA && CSMA_STATS */
   { "mac-addr",             cmd_macaddr,               "'> mac-addr': Shows the node's MAC address" },
 #if NETSTACK_CONF_WITH_IPV6
   { "ip-addr",              cmd_ipaddr,               "'> ip-addr': Shows all IPv6 addresses" },
@@ -655,6 +655,11 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+#if DB_FEATURE_BPLUSTREE
+  case BPLUSTREE:
+    type = INDEX_BPLUSTREE;
+    break;
+#endif /* DB_FEATURE_BPLUSTREE */
   default:
     return NONE;
   };
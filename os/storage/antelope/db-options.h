@@ -70,6 +70,26 @@
 #define DB_FEATURE_INTEGRITY		0
 #endif /* DB_FEATURE_INTEGRITY */
 
+/* Join relations without an index on the join attribute through a
+   hash join, which spills to storage if the smaller relation does
+   not fit in the hash table. */
+#ifndef DB_FEATURE_HASH_JOIN
+#define DB_FEATURE_HASH_JOIN		0
+#endif /* DB_FEATURE_HASH_JOIN */
+
+/* Scan relations in blocks of rows, filter the rows by the value ranges
+   that can be derived from the condition of a query, and skip blocks
+   whose rows are all outside of these ranges. */
+#ifndef DB_FEATURE_BLOCK_SCAN
+#define DB_FEATURE_BLOCK_SCAN		0
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
+/* Support B+-tree indexes, which serve range queries over attribute
+   values that are inserted in any order. */
+#ifndef DB_FEATURE_BPLUSTREE
+#define DB_FEATURE_BPLUSTREE		0
+#endif /* DB_FEATURE_BPLUSTREE */
+
 /*----------------------------------------------------------------------------*/
 
 /* Configuration parameters that may be trimmed to save space. */
@@ -161,6 +181,13 @@
 #define DB_MAX_CHAR_SIZE_PER_ROW	64
 #endif /* DB_MAX_CHAR_SIZE_PER_ROW */
 
+/* The number of rows in a block of a relation. The range of the values
+   of each attribute in a block is stored in a summary, which allows scans
+   to skip the block. */
+#ifndef DB_SCAN_BLOCK_ROWS
+#define DB_SCAN_BLOCK_ROWS		8
+#endif /* DB_SCAN_BLOCK_ROWS */
+
 /* The maximum file name length to use for creating various database file. */
 #ifndef DB_MAX_FILENAME_LENGTH
 #define DB_MAX_FILENAME_LENGTH		16
@@ -215,6 +242,69 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BPLUSTREE_INDEX_LIMIT
+#define DB_BPLUSTREE_INDEX_LIMIT	1
+#endif /* DB_BPLUSTREE_INDEX_LIMIT */
+
+/* The maximum number of keys in a B+-tree node. */
+#ifndef DB_BPLUSTREE_ORDER
+#define DB_BPLUSTREE_ORDER		15
+#endif /* DB_BPLUSTREE_ORDER */
+
+/* The maximum number of nodes in a B+-tree, for which space is
+   reserved when the index is created. */
+#ifndef DB_BPLUSTREE_NODE_LIMIT
+#define DB_BPLUSTREE_NODE_LIMIT		256
+#endif /* DB_BPLUSTREE_NODE_LIMIT */
+
+/* The maximum number of nodes cached in the B+-tree indexes. */
+#ifndef DB_BPLUSTREE_CACHE_LIMIT
+#define DB_BPLUSTREE_CACHE_LIMIT	4
+#endif /* DB_BPLUSTREE_CACHE_LIMIT */
+
+/* The number of rewritten nodes that the micro log of a B+-tree file
+   holds before Coffee merges the log into the file. */
+#ifndef DB_BPLUSTREE_LOG_NODES
+#define DB_BPLUSTREE_LOG_NODES		16
+#endif /* DB_BPLUSTREE_LOG_NODES */
+
+/*----------------------------------------------------------------------------*/
+
+/* Join options. */
+
+/* The maximum number of tuples in the hash table of a hash join. */
+#ifndef DB_JOIN_HASH_SIZE
+#define DB_JOIN_HASH_SIZE		64
+#endif /* DB_JOIN_HASH_SIZE */
+
+/* The maximum number of partitions that a hash join spills to storage
+   when the smaller relation does not fit in the hash table. Partitions
+   that are still too large are joined in several passes. */
+#ifndef DB_JOIN_PARTITIONS
+#define DB_JOIN_PARTITIONS		4
+#endif /* DB_JOIN_PARTITIONS */
+
+/* The number of tuple references buffered for each partition before
+   they are written to storage. */
+#ifndef DB_JOIN_SPILL_BUFFER
+#define DB_JOIN_SPILL_BUFFER		8
+#endif /* DB_JOIN_SPILL_BUFFER */
+
+/* The name prefix of the partition files of a hash join. */
+#ifndef DB_JOIN_SPILL_FILE
+#define DB_JOIN_SPILL_FILE		"db-join"
+#endif /* DB_JOIN_SPILL_FILE */
+
+/*----------------------------------------------------------------------------*/
+
+/* Scan options. */
+
+/* The number of block summaries that a scan reads at a time. */
+#ifndef DB_SCAN_SUMMARY_CACHE
+#define DB_SCAN_SUMMARY_CACHE		4
+#endif /* DB_SCAN_SUMMARY_CACHE */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
@@ -228,7 +318,7 @@
 /* The maximum variable identifier number in the LVM. The default 
    value corresponds to the highest attribute ID. */
 #ifndef LVM_MAX_VARIABLE_ID
-#define LVM_MAX_VARIABLE_ID		AQL_ATTRIBUTE_LIMIT - 1
+#define LVM_MAX_VARIABLE_ID		(AQL_ATTRIBUTE_LIMIT - 1)
 #endif /* LVM_MAX_VARIABLE_ID */
 
 /* Specify whether floats should be used or not inside the LVM. */
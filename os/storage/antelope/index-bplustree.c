@@ -0,0 +1,710 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	A B+-tree index for flash memory, which supports range queries
+ *	over attribute values that are inserted in any order.
+ *
+ *	The nodes of the tree are stored in node-sized slots of a single
+ *	file, following a slot for the header of the tree. The leaves
+ *	hold the keys together with the tuple ids of the rows, and are
+ *	chained in key order. A range query thereby descends once to the
+ *	first key in the range, and then iterates through the leaves.
+ *
+ *	Nodes are updated in place. The micro log of the file is
+ *	configured to store one node per record, so that Coffee can
+ *	keep rewritten nodes in the log. A node that is full when an
+ *	entry is appended to it, which is common when keys are inserted
+ *	in increasing order, keeps all of its entries when it is split.
+ *
+ *	Like the MaxHeap index, the tree refers to rows by their tuple
+ *	ids, so it must be recreated after rows have been removed.
+ */
+
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ipv6/uip-debug.h"
+
+#if DB_FEATURE_BPLUSTREE
+
+#if DB_BPLUSTREE_ORDER < 3 || DB_BPLUSTREE_ORDER > 255
+#error "DB_BPLUSTREE_ORDER must be between 3 and 255."
+#endif
+
+/* The maximum number of levels in a tree. */
+#define MAX_HEIGHT	16
+
+/* The slot of the header, which cannot be referenced as a node. */
+#define NO_NODE		0
+
+/* Keys have the range of db_value_to_long(), as the bounds of a range
+   query do, so that the index orders values as a scan compares them. */
+typedef long bplustree_key_t;
+typedef uint16_t node_id_t;
+
+struct node {
+  uint8_t leaf;
+  uint8_t key_count;
+  /* The next leaf in key order. */
+  node_id_t next;
+  bplustree_key_t keys[DB_BPLUSTREE_ORDER];
+  /* The children of an internal node, or the tuple ids of a leaf. */
+  uint32_t pointers[DB_BPLUSTREE_ORDER + 1];
+};
+typedef struct node node_t;
+
+struct tree_header {
+  node_id_t root;
+  node_id_t node_count;
+  uint8_t height;
+};
+
+struct tree {
+  int fd;
+  struct tree_header header;
+};
+typedef struct tree tree_t;
+
+struct node_cache {
+  tree_t *tree;
+  node_id_t node_id;
+  uint16_t last_use;
+  node_t node;
+};
+
+/* Keep a cache of nodes read from storage. */
+static struct node_cache node_cache[DB_BPLUSTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+MEMB(trees, tree_t, DB_BPLUSTREE_INDEX_LIMIT);
+
+/* The position of the latest iteration in the leaves of a tree. */
+static struct {
+  index_iterator_t *iterator;
+  tree_t *tree;
+  node_t leaf;
+  uint8_t position;
+} iteration;
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_bplustree = {
+  INDEX_BPLUSTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+static struct node_cache *
+get_cache(tree_t *tree, node_id_t node_id)
+{
+  int i;
+
+  for(i = 0; i < DB_BPLUSTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree && node_cache[i].node_id == node_id) {
+      node_cache[i].last_use = ++cache_clock;
+      return &node_cache[i];
+    }
+  }
+  return NULL;
+}
+
+/* Take a free cache entry or, if there is none, the least recently
+   used one. */
+static struct node_cache *
+get_cache_free(tree_t *tree, node_id_t node_id)
+{
+  struct node_cache *cache;
+  int i;
+
+  cache = &node_cache[0];
+  for(i = 0; i < DB_BPLUSTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == NULL) {
+      cache = &node_cache[i];
+      break;
+    }
+    if((uint16_t)(cache_clock - node_cache[i].last_use) >
+       (uint16_t)(cache_clock - cache->last_use)) {
+      cache = &node_cache[i];
+    }
+  }
+
+  cache->tree = tree;
+  cache->node_id = node_id;
+  cache->last_use = ++cache_clock;
+  return cache;
+}
+
+static void
+invalidate_cache(tree_t *tree)
+{
+  int i;
+
+  for(i = 0; i < DB_BPLUSTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree) {
+      node_cache[i].tree = NULL;
+    }
+  }
+}
+
+static int
+node_read(tree_t *tree, node_id_t node_id, node_t *node)
+{
+  struct node_cache *cache;
+
+  cache = get_cache(tree, node_id);
+  if(cache == NULL) {
+    cache = get_cache_free(tree, node_id);
+    if(DB_ERROR(storage_read(tree->fd, &cache->node,
+                             (unsigned long)node_id * sizeof(node_t),
+                             sizeof(node_t)))) {
+      PRINTF("DB: Failed to read B+-tree node %u\n", (unsigned)node_id);
+      cache->tree = NULL;
+      return 0;
+    }
+  }
+
+  memcpy(node, &cache->node, sizeof(*node));
+  return 1;
+}
+
+static int
+node_write(tree_t *tree, node_id_t node_id, node_t *node)
+{
+  struct node_cache *cache;
+
+  cache = get_cache(tree, node_id);
+  if(DB_ERROR(storage_write(tree->fd, node,
+                            (unsigned long)node_id * sizeof(node_t),
+                            sizeof(node_t)))) {
+    PRINTF("DB: Failed to write B+-tree node %u\n", (unsigned)node_id);
+    if(cache != NULL) {
+      cache->tree = NULL;
+    }
+    return 0;
+  }
+
+  if(cache == NULL) {
+    cache = get_cache_free(tree, node_id);
+  }
+  memcpy(&cache->node, node, sizeof(*node));
+  return 1;
+}
+
+static int
+header_write(tree_t *tree)
+{
+  return !DB_ERROR(storage_write(tree->fd, &tree->header, 0,
+                                 sizeof(tree->header)));
+}
+
+/*
+ * Count the keys of a node that are less than the key or, if upper is
+ * set, the keys that are not greater than it. Equal keys are inserted
+ * after each other, and searches start from the first of them.
+ */
+static int
+key_position(const node_t *node, long key, int upper)
+{
+  int low;
+  int high;
+  int middle;
+
+  low = 0;
+  high = node->key_count;
+  while(low < high) {
+    middle = (low + high) / 2;
+    if(node->keys[middle] < key || (upper && node->keys[middle] == key)) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+/* Insert a key at a position in a node that is not full. The pointer
+   belongs to the key in a leaf, and to the child after the key in an
+   internal node. */
+static void
+node_insert(node_t *node, int position, bplustree_key_t key,
+            uint32_t pointer)
+{
+  int offset;
+
+  offset = !node->leaf;
+  memmove(&node->keys[position + 1], &node->keys[position],
+          (node->key_count - position) * sizeof(node->keys[0]));
+  memmove(&node->pointers[position + offset + 1],
+          &node->pointers[position + offset],
+          (node->key_count - position) * sizeof(node->pointers[0]));
+  node->keys[position] = key;
+  node->pointers[position + offset] = pointer;
+  node->key_count++;
+}
+
+/* Split a full node into the node and a new sibling while inserting a
+   key. Return the separator, which is the smallest key of the sibling
+   subtree. */
+static bplustree_key_t
+node_split(node_t *node, node_t *sibling, int position,
+           bplustree_key_t key, uint32_t pointer)
+{
+  bplustree_key_t keys[DB_BPLUSTREE_ORDER + 1];
+  uint32_t pointers[DB_BPLUSTREE_ORDER + 2];
+  int offset;
+  int split;
+
+  offset = !node->leaf;
+
+  memcpy(keys, node->keys, position * sizeof(keys[0]));
+  keys[position] = key;
+  memcpy(&keys[position + 1], &node->keys[position],
+         (DB_BPLUSTREE_ORDER - position) * sizeof(keys[0]));
+
+  memcpy(pointers, node->pointers, (position + offset) * sizeof(pointers[0]));
+  pointers[position + offset] = pointer;
+  memcpy(&pointers[position + offset + 1], &node->pointers[position + offset],
+         (DB_BPLUSTREE_ORDER - position) * sizeof(pointers[0]));
+
+  /* Fill the node completely if the key was appended to it, as further
+     keys are likely to be appended to the sibling. */
+  split = position == DB_BPLUSTREE_ORDER ?
+          DB_BPLUSTREE_ORDER : (DB_BPLUSTREE_ORDER + 1) / 2;
+
+  memset(sibling, 0, sizeof(*sibling));
+  sibling->leaf = node->leaf;
+  node->key_count = split;
+  memcpy(node->keys, keys, split * sizeof(keys[0]));
+  memcpy(node->pointers, pointers, (split + offset) * sizeof(pointers[0]));
+
+  /* The separator is moved up from an internal node, whereas it
+     remains as the first key of a leaf. */
+  sibling->key_count = DB_BPLUSTREE_ORDER + 1 - split - offset;
+  memcpy(sibling->keys, &keys[split + offset],
+         sibling->key_count * sizeof(keys[0]));
+  memcpy(sibling->pointers, &pointers[split + offset],
+         (sibling->key_count + offset) * sizeof(pointers[0]));
+
+  return keys[split];
+}
+
+static db_result_t
+tree_insert(tree_t *tree, bplustree_key_t key, tuple_id_t tuple_id)
+{
+  node_id_t path[MAX_HEIGHT];
+  uint8_t slots[MAX_HEIGHT];
+  node_t node;
+  node_t sibling;
+  node_id_t node_id;
+  node_id_t sibling_id;
+  uint32_t pointer;
+  int level;
+  int position;
+
+  /* Refuse the insertion unless every node on the path can be split. */
+  if(tree->header.height >= MAX_HEIGHT ||
+     tree->header.node_count + tree->header.height + 1 >
+     DB_BPLUSTREE_NODE_LIMIT) {
+    PRINTF("DB: No more B+-tree nodes available\n");
+    return DB_LIMIT_ERROR;
+  }
+
+  /* Descend to the leaf that the key belongs in, and remember the path
+     for the splits that the insertion may cause. */
+  node_id = tree->header.root;
+  for(level = 0; level < tree->header.height - 1; level++) {
+    if(!node_read(tree, node_id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+    path[level] = node_id;
+    slots[level] = key_position(&node, key, 1);
+    node_id = node.pointers[slots[level]];
+  }
+
+  if(!node_read(tree, node_id, &node)) {
+    return DB_STORAGE_ERROR;
+  }
+  position = key_position(&node, key, 1);
+  pointer = tuple_id;
+  sibling_id = NO_NODE;
+
+  for(;;) {
+    if(node.key_count < DB_BPLUSTREE_ORDER) {
+      node_insert(&node, position, key, pointer);
+      if(!node_write(tree, node_id, &node)) {
+        return DB_STORAGE_ERROR;
+      }
+      break;
+    }
+
+    sibling_id = ++tree->header.node_count;
+    key = node_split(&node, &sibling, position, key, pointer);
+    if(node.leaf) {
+      sibling.next = node.next;
+      node.next = sibling_id;
+    }
+
+    /* Write the sibling before the node that refers to it. */
+    if(!node_write(tree, sibling_id, &sibling) ||
+       !node_write(tree, node_id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+    pointer = sibling_id;
+
+    if(level == 0) {
+      /* The root was split, so the tree grows by one level. */
+      memset(&node, 0, sizeof(node));
+      node.key_count = 1;
+      node.keys[0] = key;
+      node.pointers[0] = node_id;
+      node.pointers[1] = pointer;
+      node_id = ++tree->header.node_count;
+      if(!node_write(tree, node_id, &node)) {
+        return DB_STORAGE_ERROR;
+      }
+      tree->header.root = node_id;
+      tree->header.height++;
+      break;
+    }
+
+    /* Insert the separator into the parent. */
+    level--;
+    node_id = path[level];
+    if(!node_read(tree, node_id, &node)) {
+      return DB_STORAGE_ERROR;
+    }
+    position = slots[level];
+  }
+
+  if(sibling_id != NO_NODE && !header_write(tree)) {
+    return DB_STORAGE_ERROR;
+  }
+
+  return DB_OK;
+}
+
+/* Find the leaf and the position of the first key that is not less
+   than the given key. The position may be at the end of the leaf. */
+static int
+tree_find(tree_t *tree, long key, node_id_t *leaf_id, node_t *leaf,
+          uint8_t *position)
+{
+  node_id_t node_id;
+  int level;
+
+  node_id = tree->header.root;
+  for(level = 0; level < tree->header.height; level++) {
+    if(!node_read(tree, node_id, leaf)) {
+      return 0;
+    }
+    if(leaf->leaf) {
+      break;
+    }
+    node_id = leaf->pointers[key_position(leaf, key, 0)];
+  }
+
+  *leaf_id = node_id;
+  *position = key_position(leaf, key, 0);
+  return 1;
+}
+
+/* Move the iteration to the next leaf if it is at the end of the
+   current one. Empty leaves are skipped. */
+static int
+iteration_step(void)
+{
+  while(iteration.position >= iteration.leaf.key_count) {
+    if(iteration.leaf.next == NO_NODE ||
+       !node_read(iteration.tree, iteration.leaf.next, &iteration.leaf)) {
+      return 0;
+    }
+    iteration.position = 0;
+  }
+  return 1;
+}
+
+static int
+open_tree(const char *filename)
+{
+  /* Nodes are rewritten, so the file is opened without the flash-aware
+     semantics of storage_open(). */
+  return cfs_open(filename, CFS_READ | CFS_WRITE);
+}
+
+static db_result_t
+create(index_t *index)
+{
+  tree_t *tree;
+  node_t root;
+  char *filename;
+
+  tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  filename = storage_generate_file("btree",
+                                   (DB_BPLUSTREE_NODE_LIMIT + 1UL) *
+                                   sizeof(node_t));
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+#if DB_FEATURE_COFFEE
+  /* Let each record of the micro log hold a rewritten node. */
+  if(cfs_coffee_configure_log(index->descriptor_file,
+                              DB_BPLUSTREE_LOG_NODES * sizeof(node_t),
+                              sizeof(node_t)) < 0) {
+    PRINTF("DB: Using the default micro log for %s\n",
+           index->descriptor_file);
+  }
+#endif /* DB_FEATURE_COFFEE */
+
+  /* The tree starts as a single empty leaf. */
+  tree->header.root = 1;
+  tree->header.node_count = 1;
+  tree->header.height = 1;
+  memset(&root, 0, sizeof(root));
+  root.leaf = 1;
+
+  tree->fd = open_tree(index->descriptor_file);
+  if(tree->fd < 0 ||
+     !node_write(tree, tree->header.root, &root) ||
+     !header_write(tree)) {
+    PRINTF("DB: Failed to initialize the B+-tree file %s\n",
+           index->descriptor_file);
+    invalidate_cache(tree);
+    cfs_close(tree->fd);
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  index->opaque_data = tree;
+
+  PRINTF("DB: Created a B+-tree index in %s\n", index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  release(index);
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  tree_t *tree;
+
+  tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->fd = open_tree(index->descriptor_file);
+  if(tree->fd < 0 ||
+     DB_ERROR(storage_read(tree->fd, &tree->header, 0,
+                           sizeof(tree->header))) ||
+     tree->header.root == NO_NODE) {
+    PRINTF("DB: Failed to load the B+-tree file %s\n",
+           index->descriptor_file);
+    cfs_close(tree->fd);
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  index->opaque_data = tree;
+
+  PRINTF("DB: Loaded a B+-tree index of height %u with %u nodes from %s\n",
+         (unsigned)tree->header.height, (unsigned)tree->header.node_count,
+         index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  tree_t *tree;
+
+  /* The tree may already have been released before it is destroyed. */
+  tree = index->opaque_data;
+  if(tree == NULL) {
+    return DB_OK;
+  }
+
+  invalidate_cache(tree);
+  if(iteration.tree == tree) {
+    iteration.iterator = NULL;
+    iteration.tree = NULL;
+  }
+
+  cfs_close(tree->fd);
+  memb_free(&trees, tree);
+  index->opaque_data = NULL;
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *value, tuple_id_t tuple_id)
+{
+  db_result_t result;
+
+  result = tree_insert(index->opaque_data, db_value_to_long(value),
+                       tuple_id);
+  if(DB_ERROR(result)) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n",
+           db_value_to_long(value));
+  }
+  return result;
+}
+
+/*
+ * Delete the first entry with the given key. The entry is removed from
+ * its leaf without merging the leaf with its neighbors, so leaves may
+ * become empty.
+ */
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  tree_t *tree;
+  node_t leaf;
+  node_id_t leaf_id;
+  uint8_t position;
+  long key;
+
+  tree = index->opaque_data;
+  key = db_value_to_long(value);
+
+  if(!tree_find(tree, key, &leaf_id, &leaf, &position)) {
+    return DB_STORAGE_ERROR;
+  }
+
+  while(position >= leaf.key_count) {
+    if(leaf.next == NO_NODE) {
+      return DB_INDEX_ERROR;
+    }
+    leaf_id = leaf.next;
+    if(!node_read(tree, leaf_id, &leaf)) {
+      return DB_STORAGE_ERROR;
+    }
+    position = 0;
+  }
+
+  if(leaf.keys[position] != key) {
+    return DB_INDEX_ERROR;
+  }
+
+  leaf.key_count--;
+  memmove(&leaf.keys[position], &leaf.keys[position + 1],
+          (leaf.key_count - position) * sizeof(leaf.keys[0]));
+  memmove(&leaf.pointers[position], &leaf.pointers[position + 1],
+          (leaf.key_count - position) * sizeof(leaf.pointers[0]));
+
+  if(iteration.tree == tree) {
+    iteration.iterator = NULL;
+  }
+
+  return node_write(tree, leaf_id, &leaf) ? DB_OK : DB_STORAGE_ERROR;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  tree_t *tree;
+  node_id_t leaf_id;
+  tuple_id_t skip;
+
+  tree = iterator->index->opaque_data;
+
+  if(iteration.iterator != iterator || iteration.tree != tree ||
+     iterator->next_item_no == 0) {
+    /*
+     * Descend to the first key of the range when a new iteration
+     * starts. An iteration that has been interrupted by another one
+     * continues after the items that it has already returned.
+     */
+    iteration.iterator = NULL;
+    iteration.tree = tree;
+    if(!tree_find(tree, db_value_to_long(&iterator->min_value),
+                  &leaf_id, &iteration.leaf, &iteration.position)) {
+      return INVALID_TUPLE;
+    }
+    for(skip = iterator->next_item_no; skip > 0; skip--) {
+      if(!iteration_step()) {
+        return INVALID_TUPLE;
+      }
+      iteration.position++;
+    }
+    iteration.iterator = iterator;
+  }
+
+  if(!iteration_step() ||
+     iteration.leaf.keys[iteration.position] >
+     db_value_to_long(&iterator->max_value)) {
+    PRINTF("DB: Reached the end of the B+-tree range\n");
+    return INVALID_TUPLE;
+  }
+
+  iterator->next_item_no++;
+  return (tuple_id_t)iteration.leaf.pointers[iteration.position++];
+}
+
+#endif /* DB_FEATURE_BPLUSTREE */
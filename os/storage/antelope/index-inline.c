@@ -100,10 +100,15 @@ get_value(tuple_id_t *index, relation_t *rel, attribute_t *attr)
   return &value;
 }
 
+/*
+ * Find the first row whose value is not less than the target value
+ * or, if upper is set, the first row whose value is greater than it.
+ * Rows with equal values are thereby kept together in the iteration.
+ */
 static tuple_id_t
 binary_search(index_iterator_t *index_iterator,
               attribute_value_t *target_value,
-              int exact_match)
+              int upper)
 {
   relation_t *rel;
   attribute_t *attr;
@@ -111,6 +116,8 @@ binary_search(index_iterator_t *index_iterator,
   tuple_id_t min;
   tuple_id_t max;
   tuple_id_t center;
+  long target;
+  long value;
 
   rel = index_iterator->index->rel;
   attr = index_iterator->index->attr;
@@ -119,10 +126,10 @@ binary_search(index_iterator_t *index_iterator,
   if(max == INVALID_TUPLE) {
     return INVALID_TUPLE;
   }
-  max--;
   min = 0;
+  target = db_value_to_long(target_value);
 
-  do {
+  while(min < max) {
     center = min + ((max - min) / 2);
 
     cmp_value = get_value(&center, rel, attr);
@@ -132,31 +139,23 @@ binary_search(index_iterator_t *index_iterator,
       return INVALID_TUPLE;
     }
 
-    if(db_value_to_long(target_value) > db_value_to_long(cmp_value)) {
+    value = db_value_to_long(cmp_value);
+    if(value < target || (upper && value == target)) {
       min = center + 1;
     } else {
-      max = center - 1;
+      max = center;
     }
-  } while(min <= max &&
-          db_value_to_long(target_value) != db_value_to_long(cmp_value));
-
-  if(exact_match &&
-     db_value_to_long(target_value) != db_value_to_long(cmp_value)) {
-    PRINTF("DB: Could not find value %ld in the inline index\n",
-           db_value_to_long(target_value));
-    return INVALID_TUPLE;
   }
 
-  return center;
+  return min;
 }
 
-static tuple_id_t
+static db_result_t
 range_search(index_iterator_t *index_iterator,
              tuple_id_t *start, tuple_id_t *end)
 {
   attribute_value_t *low_target;
   attribute_value_t *high_target;
-  int exact_match;
 
   low_target = &index_iterator->min_value;
   high_target = &index_iterator->max_value;
@@ -164,19 +163,18 @@ range_search(index_iterator_t *index_iterator,
   PRINTF("DB: Search index for value range (%ld, %ld)\n",
     db_value_to_long(low_target), db_value_to_long(high_target));
 
-  exact_match = db_value_to_long(low_target) == db_value_to_long(high_target);
-
-  /* Optimize later so that the other search uses the result
-     from the first one. */
-  *start = binary_search(index_iterator, low_target, exact_match);
+  *start = binary_search(index_iterator, low_target, 0);
   if(*start == INVALID_TUPLE) {
     return DB_INDEX_ERROR;
   }
 
-  *end = binary_search(index_iterator, high_target, exact_match);
-  if(*end == INVALID_TUPLE) {
+  *end = binary_search(index_iterator, high_target, 1);
+  if(*end == INVALID_TUPLE || *end <= *start) {
+    PRINTF("DB: Could not find the value range in the inline index\n");
     return DB_INDEX_ERROR;
   }
+  (*end)--;
+
   return DB_OK;
 }
 
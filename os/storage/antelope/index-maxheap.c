@@ -736,6 +736,8 @@ get_next(index_iterator_t *iterator)
         }
       }
     }
+    /* Search the next bucket from its beginning. */
+    cache.start = 0;
   }
 
   if(VALUE_INT(&iterator->min_value) == VALUE_INT(&iterator->max_value)) {
@@ -49,7 +49,11 @@
 #include "storage.h"
 
 static index_api_t *index_components[] = {&index_inline,
-	&index_maxheap};
+	&index_maxheap,
+#if DB_FEATURE_BPLUSTREE
+	&index_bplustree,
+#endif /* DB_FEATURE_BPLUSTREE */
+};
 
 LIST(indices);
 MEMB(index_memb, index_t, DB_INDEX_POOL_SIZE);
@@ -134,6 +138,8 @@ index_create(index_type_t index_type, relation_t *rel, attribute_t *attr)
   if(index->descriptor_file[0] != '\0' &&
      DB_ERROR(storage_put_index(index))) {
     api->destroy(index);
+    list_remove(indices, index);
+    attr->index = NULL;
     memb_free(&index_memb, index);
     PRINTF("DB: Failed to store index data in file \"%s\"\n",
            index->descriptor_file);
@@ -192,6 +198,7 @@ index_load(relation_t *rel, attribute_t *attr)
   api = find_index_api(index->type);
   if(api == NULL) {
     PRINTF("DB: No API for index type %d\n", index->type);
+    memb_free(&index_memb, index);
     return DB_INDEX_ERROR;
   }
 
@@ -199,6 +206,7 @@ index_load(relation_t *rel, attribute_t *attr)
 
   if(DB_ERROR(api->load(index))) {
     PRINTF("DB: Index-specific load failed\n");
+    memb_free(&index_memb, index);
     return DB_INDEX_ERROR;
   }
 
@@ -388,7 +396,7 @@ PROCESS_THREAD(db_indexer, ev, data)
       continue;
     }
 
-    for(;; row++) {
+    for(row = 0;;) {
       PROCESS_PAUSE();
 
       result = db_process(&handle);
@@ -401,6 +409,9 @@ PROCESS_THREAD(db_indexer, ev, data)
       if(result == DB_FINISHED) {
         break;
       }
+      if(result != DB_GOT_ROW) {
+        continue;
+      }
 
       for(column = 0; column < handle.ncolumns; column++) {
         if(DB_ERROR(db_get_value(&value, &handle, column))) {
@@ -413,6 +424,7 @@ PROCESS_THREAD(db_indexer, ev, data)
 	  goto cleanup;
 	}
       }
+      row++;
     }
 
     PRINTF("DB: Loaded %lu rows into the index\n",
@@ -87,6 +87,9 @@ static variable_t variables[LVM_MAX_VARIABLE_ID];
 /* Range derivations of variables that are used for index searches. */
 static derivation_t derivations[LVM_MAX_VARIABLE_ID];
 
+/* Whether the derived ranges are equivalent to the expression. */
+static uint8_t derivation_exact;
+
 #if DEBUG
 static void
 print_derivations(derivation_t *d)
@@ -309,6 +312,7 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
 
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
+  derivation_exact = 0;
 }
 
 lvm_ip_t
@@ -588,14 +592,10 @@ create_union(derivation_t *result, derivation_t *d1, derivation_t *d2)
   int i;
 
   for(i = 0; i < LVM_MAX_VARIABLE_ID; i++) {
-    if(!d1[i].derived && !d2[i].derived) {
+    if(!d1[i].derived || !d2[i].derived) {
+      /* A variable that is not constrained on one side of the
+         disjunction can take any value. */
       continue;
-    } else if(d1[i].derived && !d2[i].derived) {
-      result[i].min.l = d1[i].min.l;
-      result[i].max.l = d1[i].max.l;
-    } else if(!d1[i].derived && d2[i].derived) {
-      result[i].min.l = d2[i].min.l;
-      result[i].max.l = d2[i].max.l;
     } else {
       /* Both derivations have been made; create a
          union of the ranges. */
@@ -625,6 +625,52 @@ create_union(derivation_t *result, derivation_t *d1, derivation_t *d2)
 #endif /* DEBUG */
 }
 
+static void
+skip_node(lvm_instance_t *p)
+{
+  operator_t *operator;
+  int i;
+  int arguments;
+  operand_t operand;
+
+  switch(get_type(p)) {
+  case LVM_CMP_OP:
+  case LVM_ARITH_OP:
+    operator = get_operator(p);
+    arguments = *operator == LVM_NOT ? 1 : 2;
+    for(i = 0; i < arguments; i++) {
+      skip_node(p);
+    }
+    break;
+  case LVM_OPERAND:
+    get_operand(p, &operand);
+    break;
+  default:
+    break;
+  }
+}
+
+static int derive_relation(lvm_instance_t *p, derivation_t *local_derivations);
+
+static int
+derive_subexpression(lvm_instance_t *p, derivation_t *local_derivations)
+{
+  lvm_ip_t ip;
+  int r;
+
+  ip = p->ip;
+  r = derive_relation(p, local_derivations);
+  if(LVM_ERROR(r)) {
+    /* Move past the subexpression that no ranges could be derived
+       from, and leave its variables unconstrained. */
+    p->ip = ip;
+    skip_node(p);
+    memset(local_derivations, 0, LVM_MAX_VARIABLE_ID * sizeof(derivation_t));
+    derivation_exact = 0;
+  }
+  return r;
+}
+
 static int
 derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
 {
@@ -635,13 +681,18 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
   int variable_id;
   operand_value_t *value;
   derivation_t *derivation;
+  operator_t relation;
 
   type = get_type(p);
+  if(type != LVM_CMP_OP) {
+    return LVM_DERIVATION_ERROR;
+  }
   operator = get_operator(p);
 
   if(IS_CONNECTIVE(*operator)) {
     derivation_t d1[LVM_MAX_VARIABLE_ID];
     derivation_t d2[LVM_MAX_VARIABLE_ID];
+    int r1, r2;
 
     if(*operator != LVM_AND && *operator != LVM_OR) {
       return LVM_DERIVATION_ERROR;
@@ -652,15 +703,21 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
     memset(d1, 0, sizeof(d1));
     memset(d2, 0, sizeof(d2));
 
-    if(LVM_ERROR(derive_relation(p, d1)) ||
-       LVM_ERROR(derive_relation(p, d2))) {
-      return LVM_DERIVATION_ERROR;
-    }
+    r1 = derive_subexpression(p, d1);
+    r2 = derive_subexpression(p, d2);
 
     if(*operator == LVM_AND) {
+      /* The ranges that were derived from one side of a conjunction
+         hold regardless of the other side. */
       create_intersection(local_derivations, d1, d2);
-    } else if(*operator == LVM_OR) {
+    } else {
+      if(LVM_ERROR(r1) || LVM_ERROR(r2)) {
+        return LVM_DERIVATION_ERROR;
+      }
       create_union(local_derivations, d1, d2);
+      /* A union of ranges may include values that match neither
+         side. */
+      derivation_exact = 0;
     }
     return LVM_TRUE;
   }
@@ -676,20 +733,40 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
     }
   }
 
-  if(operand[0].type == LVM_VARIABLE && operand[1].type == LVM_VARIABLE) {
+  if((operand[0].type == LVM_VARIABLE) == (operand[1].type == LVM_VARIABLE)) {
     return LVM_DERIVATION_ERROR;
   }
 
-  /* Determine which of the operands that is the variable. */
+  /* Determine which of the operands that is the variable. If it is
+     the right one, the relation is reversed so that the variable
+     is on the left side of it. */
+  relation = *operator;
   if(operand[0].type == LVM_VARIABLE) {
-    if(operand[1].type == LVM_VARIABLE) {
-      return LVM_DERIVATION_ERROR;
-    }
     variable_id = operand[0].value.id;
     value = &operand[1].value;
   } else {
     variable_id = operand[1].value.id;
     value = &operand[0].value;
+    switch(relation) {
+    case LVM_GE:
+      relation = LVM_LE;
+      break;
+    case LVM_GEQ:
+      relation = LVM_LEQ;
+      break;
+    case LVM_LE:
+      relation = LVM_GE;
+      break;
+    case LVM_LEQ:
+      relation = LVM_GEQ;
+      break;
+    default:
+      break;
+    }
+  }
+
+  if(operand[0].type != LVM_LONG && operand[1].type != LVM_LONG) {
+    return LVM_DERIVATION_ERROR;
   }
 
   if(variable_id >= LVM_MAX_VARIABLE_ID) {
@@ -703,7 +780,7 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
   derivation->max.l = LONG_MAX;
   derivation->min.l = LONG_MIN;
 
-  switch(*operator) {
+  switch(relation) {
   case LVM_EQ:
     derivation->max = *value;
     derivation->min = *value;
@@ -732,7 +809,19 @@ derive_relation(lvm_instance_t *p, derivation_t *local_derivations)
 lvm_status_t
 lvm_derive(lvm_instance_t *p)
 {
-  return derive_relation(p, derivations);
+  p->ip = 0;
+  derivation_exact = 1;
+  if(LVM_ERROR(derive_relation(p, derivations))) {
+    derivation_exact = 0;
+    return LVM_DERIVATION_ERROR;
+  }
+  return LVM_TRUE;
+}
+
+int
+lvm_is_derivation_exact(lvm_instance_t *p)
+{
+  return derivation_exact;
 }
 
 lvm_status_t
@@ -984,7 +1073,7 @@ main(void)
   lvm_print_derivations(&p);
 
   /* Infix: (a < 100 /\ a < 90 /\ a > 80 /\ a < 105) \/ b > 10000 =>
-     a:(81,89), b:(10001:oo) */
+     no derivations, as each variable is unconstrained on one side */
   lvm_reset(&p, code, sizeof(code));
   lvm_register_variable("a", LVM_LONG);
   lvm_register_variable("b", LVM_LONG);
@@ -126,6 +126,7 @@ lvm_status_t lvm_derive(lvm_instance_t *p);
 lvm_status_t lvm_get_derived_range(lvm_instance_t *p, char *name, 
                                    operand_value_t *min,
                                    operand_value_t *max);
+int lvm_is_derivation_exact(lvm_instance_t *p);
 void lvm_print_derivations(lvm_instance_t *p);
 lvm_status_t lvm_execute(lvm_instance_t *p);
 lvm_status_t lvm_register_variable(char *name, operand_type_t type);
@@ -35,6 +35,7 @@
  */
 
 #include <limits.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "lib/crc16.h"
@@ -79,6 +80,69 @@ struct source_map {
 };
 
 static struct source_map source_map[AQL_ATTRIBUTE_LIMIT];
+
+/*
+ * The join_side structure describes one of the relations in a join.
+ * The outer relation is scanned, and for each of its rows, the inner
+ * relation is searched for matching rows, either through an index or
+ * through the hash table of a hash join.
+ */
+struct join_side {
+  relation_t *rel;
+  attribute_t *attr;
+  unsigned char *row;
+  unsigned offset;
+};
+
+static struct join_side outer;
+static struct join_side inner;
+
+#if DB_FEATURE_HASH_JOIN
+#define JOIN_NO_ENTRY		UINT16_MAX
+#define JOIN_BUILD_SIDE		0
+#define JOIN_PROBE_SIDE		1
+#define JOIN_BLOCK_SIZE		(DB_JOIN_PARTITIONS * DB_JOIN_SPILL_BUFFER)
+
+/* A row reference along with the key of its join attribute. Partitions
+   that are spilled to storage consist of arrays of such records. */
+struct join_record {
+  long key;
+  tuple_id_t tuple_id;
+};
+
+struct join_entry {
+  struct join_record record;
+  uint16_t next;
+};
+
+/*
+ * A hash join loads the rows of the inner relation, which is the
+ * smaller one, into a hash table and probes it with each row of the
+ * outer relation. If the inner relation does not fit in the table,
+ * both relations are partitioned by the hash of the join key into files,
+ * and each pair of partitions is joined separately. Partitions that
+ * are still too large are loaded into the table in several rounds.
+ */
+static struct {
+  struct join_entry entries[DB_JOIN_HASH_SIZE];
+  uint16_t buckets[DB_JOIN_HASH_SIZE];
+  struct join_record block[JOIN_BLOCK_SIZE];
+  tuple_id_t partition_size[2][DB_JOIN_PARTITIONS];
+  struct join_record probe;
+  tuple_id_t build_position;
+  tuple_id_t probe_position;
+  tuple_id_t block_start;
+  uint16_t block_count;
+  uint16_t entry_count;
+  uint16_t match;
+  uint8_t block_side;
+  uint8_t partitions;
+  uint8_t partition;
+  uint8_t build_finished;
+  uint8_t probing;
+  uint8_t probe_row_loaded;
+} hash_join;
+#endif /* DB_FEATURE_HASH_JOIN */
 #endif /* DB_FEATURE_JOIN */
 
 static unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
@@ -88,6 +152,47 @@ static unsigned char * const left_row = row;
 static unsigned char * const right_row = extra_row;
 static unsigned char * const join_row = result_row;
 
+#if DB_FEATURE_BLOCK_SCAN
+#define SCAN_REJECT		0
+#define SCAN_ACCEPT		1
+#define SCAN_EVALUATE		2
+
+/*
+ * A scan condition restricts the value of an attribute to the range
+ * derived from the condition of a query. Each condition has a match
+ * function that is specialized for the domain of the attribute and
+ * the kind of range.
+ */
+struct scan_condition {
+  int (*match)(const struct scan_condition *, const unsigned char *);
+  long min;
+  long max;
+  unsigned offset;
+  uint8_t attribute_no;
+};
+
+/*
+ * A scan reads the rows of a relation in blocks, and filters them
+ * through the chain of scan conditions of the query. If the conditions
+ * are equivalent to the condition of the query, the logic engine is
+ * not used at all. Blocks whose summaries show that no row can satisfy
+ * the conditions are skipped without being read.
+ */
+static struct {
+  struct scan_condition conditions[DB_MAX_ATTRIBUTES_PER_RELATION];
+  unsigned char rows[DB_SCAN_BLOCK_ROWS * sizeof(row)];
+  storage_block_summary_t summaries[DB_SCAN_SUMMARY_CACHE];
+  tuple_id_t block_start;
+  tuple_id_t summary_start;
+  uint8_t summary_count;
+  uint8_t row_count;
+  uint8_t condition_count;
+  uint8_t exact;
+  uint8_t inverse;
+  uint8_t skip_blocks;
+} scan;
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
 LIST(relations);
 MEMB(relations_memb, relation_t, DB_RELATION_POOL_SIZE);
 MEMB(attributes_memb, attribute_t, DB_ATTRIBUTE_POOL_SIZE);
@@ -146,6 +251,83 @@ get_attribute_value_offset(relation_t *rel, attribute_t *attr)
   return -1;
 }
 
+static long
+get_number(domain_t domain, const unsigned char *ptr)
+{
+  if(domain == DOMAIN_INT) {
+    return ptr[0] << 8 | ptr[1];
+  }
+  return (uint32_t)ptr[0] << 24 |
+         (uint32_t)ptr[1] << 16 |
+         (uint32_t)ptr[2] << 8 |
+         ptr[3];
+}
+
+#if DB_FEATURE_BLOCK_SCAN
+static void
+summarize_block(relation_t *rel)
+{
+  storage_block_summary_t summary;
+  unsigned char tuple[rel->row_length];
+  tuple_id_t nrows;
+  tuple_id_t tuple_id;
+  attribute_t *attr;
+  unsigned offset;
+  long value;
+  int i;
+
+  if(DB_ERROR(storage_get_row_amount(rel, &nrows)) ||
+     nrows % DB_SCAN_BLOCK_ROWS != 0) {
+    return;
+  }
+
+  for(i = 0; i < DB_MAX_ATTRIBUTES_PER_RELATION; i++) {
+    summary.min[i] = LONG_MIN;
+    summary.max[i] = LONG_MAX;
+  }
+
+  for(tuple_id = nrows - DB_SCAN_BLOCK_ROWS; tuple_id < nrows; tuple_id++) {
+    if(storage_get_row(rel, &tuple_id, tuple) != DB_OK) {
+      return;
+    }
+
+    for(i = 0, offset = 0, attr = list_head(rel->attributes);
+        attr != NULL && i < DB_MAX_ATTRIBUTES_PER_RELATION;
+        offset += attr->element_size, attr = attr->next, i++) {
+      if(attr->domain != DOMAIN_INT && attr->domain != DOMAIN_LONG) {
+        continue;
+      }
+      value = get_number(attr->domain, tuple + offset);
+      if(tuple_id == nrows - DB_SCAN_BLOCK_ROWS) {
+        summary.min[i] = summary.max[i] = value;
+      } else if(value < summary.min[i]) {
+        summary.min[i] = value;
+      } else if(value > summary.max[i]) {
+        summary.max[i] = value;
+      }
+    }
+  }
+
+  /* Blocks without summaries are scanned, so a failure to store the
+     summary does not affect the stored row. */
+  storage_put_block_summary(rel, nrows / DB_SCAN_BLOCK_ROWS - 1, &summary);
+}
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
+static db_result_t
+store_row(relation_t *rel, unsigned char *tuple)
+{
+  db_result_t result;
+
+  result = storage_put_row(rel, tuple);
+#if DB_FEATURE_BLOCK_SCAN
+  if(!DB_ERROR(result)) {
+    summarize_block(rel);
+  }
+#endif /* DB_FEATURE_BLOCK_SCAN */
+  return result;
+}
+
 static void
 attribute_free(relation_t *rel, attribute_t *attr)
 {
@@ -369,6 +551,9 @@ relation_attribute_add(relation_t *rel, db_direction_t dir, char *name,
   if(dir == DB_STORAGE) {
     if(DB_ERROR(storage_put_attribute(rel, attribute))) {
        PRINTF("DB: Failed to store attribute %s\n", attribute->name);
+       list_remove(rel->attributes, attribute);
+       rel->attribute_count--;
+       rel->row_length -= element_size;
        memb_free(&attributes_memb, attribute);
        return NULL;
     }
@@ -498,6 +683,11 @@ relation_insert(relation_t *rel, attribute_value_t *values)
              value->domain, attr->domain, attr->name);
       return DB_RELATIONAL_ERROR;
     }
+    if(attr->domain == DOMAIN_LONG && value->domain == DOMAIN_INT) {
+      /* Parsed integers are kept as longs, which are stored below.
+         Promote the value so that indexes also read the full value. */
+      value->domain = DOMAIN_LONG;
+    }
 
     /* Set the data area for removed attributes to 0. */
     if(attr->flags & ATTRIBUTE_FLAG_INVALID) {
@@ -544,7 +734,7 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 
   rel->cardinality++;
   rel->next_row++;
-  return storage_put_row(rel, record);
+  return store_row(rel, record);
 }
 
 static void
@@ -655,7 +845,7 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
 
       if(range <= min_range) {
         index = attr->index;
-        av_min.domain = av_max.domain = DOMAIN_INT;
+        av_min.domain = av_max.domain = DOMAIN_LONG;
         VALUE_LONG(&av_min) = min.l;
         VALUE_LONG(&av_max) = max.l;
       }
@@ -671,6 +861,201 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
   }
 }
 
+#if DB_FEATURE_BLOCK_SCAN
+static int
+match_int_range(const struct scan_condition *condition,
+                const unsigned char *tuple)
+{
+  long value;
+
+  value = tuple[condition->offset] << 8 | tuple[condition->offset + 1];
+  return value >= condition->min && value <= condition->max;
+}
+
+static int
+match_int_value(const struct scan_condition *condition,
+                const unsigned char *tuple)
+{
+  return (tuple[condition->offset] << 8 | tuple[condition->offset + 1]) ==
+         condition->min;
+}
+
+static int
+match_long_range(const struct scan_condition *condition,
+                 const unsigned char *tuple)
+{
+  long value;
+
+  value = get_number(DOMAIN_LONG, tuple + condition->offset);
+  return value >= condition->min && value <= condition->max;
+}
+
+static int
+match_long_value(const struct scan_condition *condition,
+                 const unsigned char *tuple)
+{
+  return get_number(DOMAIN_LONG, tuple + condition->offset) ==
+         condition->min;
+}
+
+static void
+compile_scan(relation_t *rel, lvm_instance_t *lvm_instance)
+{
+  attribute_t *attr;
+  struct scan_condition *condition;
+  operand_value_t min;
+  operand_value_t max;
+  unsigned offset;
+  int i;
+
+  scan.exact = lvm_is_derivation_exact(lvm_instance);
+
+  for(i = 0, offset = 0, attr = list_head(rel->attributes);
+      attr != NULL && i < DB_MAX_ATTRIBUTES_PER_RELATION;
+      offset += attr->element_size, attr = attr->next, i++) {
+    if(LVM_ERROR(lvm_get_derived_range(lvm_instance, attr->name,
+                                       &min, &max))) {
+      continue;
+    }
+
+    if(attr->domain != DOMAIN_INT && attr->domain != DOMAIN_LONG) {
+      /* Leave conditions on other domains to the logic engine. */
+      scan.exact = 0;
+      continue;
+    }
+
+    condition = &scan.conditions[scan.condition_count++];
+    condition->min = min.l;
+    condition->max = max.l;
+    condition->offset = offset;
+    condition->attribute_no = i;
+    if(attr->domain == DOMAIN_INT) {
+      condition->match = min.l == max.l ? match_int_value : match_int_range;
+    } else {
+      condition->match = min.l == max.l ? match_long_value : match_long_range;
+    }
+    PRINTF("DB: Scan condition %ld <= %s <= %ld\n",
+           min.l, attr->name, max.l);
+  }
+
+  /* A query that selects the rows that do not satisfy its condition
+     can not skip any block. */
+  scan.skip_blocks = !scan.inverse && scan.condition_count > 0;
+}
+
+static int
+filter_row(const unsigned char *tuple)
+{
+  const struct scan_condition *condition;
+
+  for(condition = scan.conditions;
+      condition < &scan.conditions[scan.condition_count];
+      condition++) {
+    if(!condition->match(condition, tuple)) {
+      /* The condition of the query is false for this row. */
+      return scan.inverse ? SCAN_ACCEPT : SCAN_REJECT;
+    }
+  }
+
+  if(!scan.exact) {
+    return SCAN_EVALUATE;
+  }
+  return scan.inverse ? SCAN_REJECT : SCAN_ACCEPT;
+}
+
+static int
+block_may_match(const storage_block_summary_t *summary)
+{
+  const struct scan_condition *condition;
+
+  for(condition = scan.conditions;
+      condition < &scan.conditions[scan.condition_count];
+      condition++) {
+    if(summary->max[condition->attribute_no] < condition->min ||
+       summary->min[condition->attribute_no] > condition->max) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static const storage_block_summary_t *
+get_block_summary(relation_t *rel, tuple_id_t block)
+{
+  unsigned count;
+
+  if(block < scan.summary_start ||
+     block >= scan.summary_start + scan.summary_count) {
+    count = DB_SCAN_SUMMARY_CACHE;
+    if(storage_get_block_summaries(rel, block, scan.summaries,
+                                   &count) != DB_OK) {
+      scan.summary_count = 0;
+      return NULL;
+    }
+    scan.summary_start = block;
+    scan.summary_count = count;
+  }
+
+  return &scan.summaries[block - scan.summary_start];
+}
+
+static db_result_t
+load_scan_block(db_handle_t *handle)
+{
+  const storage_block_summary_t *summary;
+  unsigned count;
+  db_result_t result;
+
+  if(scan.skip_blocks) {
+    while((summary = get_block_summary(handle->rel,
+                                       handle->tuple_id / DB_SCAN_BLOCK_ROWS))
+          != NULL && !block_may_match(summary)) {
+      PRINTF("DB: Skipping the block at row %lu\n",
+             (unsigned long)handle->tuple_id);
+      handle->tuple_id += DB_SCAN_BLOCK_ROWS;
+    }
+  }
+
+  count = DB_SCAN_BLOCK_ROWS;
+  result = storage_get_rows(handle->rel, &handle->tuple_id,
+                            scan.rows, &count);
+  scan.block_start = handle->tuple_id;
+  scan.row_count = count;
+  return result;
+}
+
+/* Get the next row of the current block that may be selected, and
+   read the next block when the current one has been processed. The
+   row is NULL if there is no such row left in the block. */
+static db_result_t
+get_scan_row(db_handle_t *handle, unsigned char **tuple, int *filter)
+{
+  unsigned char *ptr;
+  db_result_t result;
+
+  *tuple = NULL;
+  if(handle->tuple_id >= scan.block_start + scan.row_count) {
+    result = load_scan_block(handle);
+    if(result != DB_OK) {
+      return result;
+    }
+  }
+
+  while(handle->tuple_id < scan.block_start + scan.row_count) {
+    ptr = scan.rows +
+          (handle->tuple_id - scan.block_start) * handle->rel->row_length;
+    handle->tuple_id++;
+    *filter = filter_row(ptr);
+    if(*filter != SCAN_REJECT) {
+      *tuple = ptr;
+      break;
+    }
+  }
+
+  return DB_OK;
+}
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
 static db_result_t
 generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
 {
@@ -696,10 +1081,28 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
+#if DB_FEATURE_BLOCK_SCAN
+  scan.block_start = 0;
+  scan.row_count = 0;
+  scan.summary_count = 0;
+  scan.condition_count = 0;
+  scan.skip_blocks = 0;
+  scan.exact = adt->lvm_instance == NULL;
+  scan.inverse = adt->lvm_instance != NULL &&
+                 (AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC);
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
   if(adt->lvm_instance != NULL) {
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
-      select_index(handle, adt->lvm_instance);
+      /* The rows that do not satisfy the condition of a removal are
+         kept, so all rows must be visited. */
+      if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC)) {
+        select_index(handle, adt->lvm_instance);
+      }
+#if DB_FEATURE_BLOCK_SCAN
+      compile_scan(rel, adt->lvm_instance);
+#endif /* DB_FEATURE_BLOCK_SCAN */
     }
   }
 
@@ -746,9 +1149,16 @@ relation_process_select(void *handle_ptr)
   uint8_t intbuf[2];
   attribute_value_t value;
   lvm_status_t wanted_result;
+  unsigned char *tuple;
+  int evaluate;
+#if DB_FEATURE_BLOCK_SCAN
+  int filter;
+#endif
 
   handle = (db_handle_t *)handle_ptr;
   adt = (aql_adt_t *)handle->adt;
+  tuple = row;
+  evaluate = adt->lvm_instance != NULL;
 
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
@@ -757,10 +1167,6 @@ relation_process_select(void *handle_ptr)
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
       PRINTF("DB: An attribute value could not be found in the index\n");
-      if(handle->index_iterator.next_item_no == 0) {
-        return DB_INDEX_ERROR;
-      }
-
       if(adt->flags & AQL_FLAG_AGGREGATE) {
         goto end_aggregation;
       }
@@ -771,8 +1177,18 @@ relation_process_select(void *handle_ptr)
 
   /* Put the tuples fulfilling the given condition into a new relation.
      The tuples may be projected. */
+#if DB_FEATURE_BLOCK_SCAN
+  filter = SCAN_EVALUATE;
+  if(!(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX)) {
+    result = get_scan_row(handle, &tuple, &filter);
+  } else {
+    result = storage_get_row(handle->rel, &handle->tuple_id, row);
+    handle->tuple_id++;
+  }
+#else
   result = storage_get_row(handle->rel, &handle->tuple_id, row);
   handle->tuple_id++;
+#endif /* DB_FEATURE_BLOCK_SCAN */
   if(DB_ERROR(result)) {
     PRINTF("DB: Failed to get a row in relation %s!\n", handle->rel->name);
     return result;
@@ -783,20 +1199,29 @@ relation_process_select(void *handle_ptr)
     return DB_FINISHED;
   }
 
+#if DB_FEATURE_BLOCK_SCAN
+  if(tuple == NULL) {
+    /* No row in the rest of the block can be selected. */
+    return DB_OK;
+  }
+  if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
+    filter = filter_row(tuple);
+  }
+  if(filter == SCAN_REJECT) {
+    return DB_OK;
+  }
+  evaluate = filter == SCAN_EVALUATE;
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
   /* Process the attributes in the result relation. */
   for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-    from_ptr = row + attr_map_ptr->from_offset;
+    from_ptr = tuple + attr_map_ptr->from_offset;
     result_attr = attr_map_ptr->to_attr;
 
     /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
-      operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
-      operand_value.l = (uint32_t)from_ptr[0] << 24 |
-                        (uint32_t)from_ptr[1] << 16 |
-                        (uint32_t)from_ptr[2] << 8 |
-                        from_ptr[3];
+    if(evaluate && (result_attr->domain == DOMAIN_INT ||
+                    result_attr->domain == DOMAIN_LONG)) {
+      operand_value.l = get_number(result_attr->domain, from_ptr);
       lvm_set_variable_value(result_attr->name, operand_value);
     }
 
@@ -819,11 +1244,10 @@ relation_process_select(void *handle_ptr)
   }
 
   /* Check whether the given predicate is true for this tuple. */
-  if(adt->lvm_instance == NULL ||
-     lvm_execute(adt->lvm_instance) == wanted_result) {
+  if(!evaluate || lvm_execute(adt->lvm_instance) == wanted_result) {
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
       for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-        from_ptr = row + attr_map_ptr->from_offset;
+        from_ptr = tuple + attr_map_ptr->from_offset;
         result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
         if(DB_ERROR(result)) {
 	  return result;
@@ -832,7 +1256,7 @@ relation_process_select(void *handle_ptr)
       }
     } else {
       if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+        if(DB_ERROR(store_row(handle->result_rel, result_row))) {
           PRINTF("DB: Failed to store a row in the result relation!\n");
           return DB_STORAGE_ERROR;
         }
@@ -857,7 +1281,7 @@ end_aggregation:
   }
 
   if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
-    if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+    if(DB_ERROR(store_row(handle->result_rel, result_row))) {
       PRINTF("DB: Failed to store a row in the result relation!\n");
       return DB_STORAGE_ERROR;
     }
@@ -959,97 +1383,550 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 }
 
 #if DB_FEATURE_JOIN
-db_result_t
-relation_process_join(void *handle_ptr)
+static db_result_t
+get_join_key(struct join_side *side, long *key)
+{
+  attribute_value_t value;
+  unsigned char *ptr;
+  unsigned long hash;
+
+  if(DB_ERROR(db_phy_to_value(&value, side->attr, side->row + side->offset))) {
+    return DB_TYPE_ERROR;
+  }
+
+  if(value.domain != DOMAIN_STRING) {
+    *key = db_value_to_long(&value);
+    return DB_OK;
+  }
+
+  /* String keys are represented by a hash of the string, so rows with
+     equal keys must be compared by value before being joined. */
+  for(hash = 5381, ptr = VALUE_STRING(&value); *ptr != '\0'; ptr++) {
+    hash = hash * 33 + *ptr;
+  }
+  *key = (long)hash;
+
+  return DB_OK;
+}
+
+static int
+join_keys_match(void)
+{
+  attribute_value_t outer_value;
+  attribute_value_t inner_value;
+
+  if(DB_ERROR(db_phy_to_value(&outer_value, outer.attr,
+                              outer.row + outer.offset)) ||
+     DB_ERROR(db_phy_to_value(&inner_value, inner.attr,
+                              inner.row + inner.offset))) {
+    return 0;
+  }
+
+  if(outer_value.domain == DOMAIN_STRING) {
+    return strcmp((char *)VALUE_STRING(&outer_value),
+                  (char *)VALUE_STRING(&inner_value)) == 0;
+  }
+
+  return db_value_to_long(&outer_value) == db_value_to_long(&inner_value);
+}
+
+static db_result_t
+emit_join_row(db_handle_t *handle)
 {
-  db_handle_t *handle;
-  db_result_t result;
-  relation_t *left_rel;
-  relation_t *right_rel;
-  relation_t *join_rel;
   unsigned char *join_next_attribute_ptr;
   size_t element_size;
-  tuple_id_t right_tuple_id;
-  attribute_value_t value;
   int i;
 
-  handle = (db_handle_t *)handle_ptr;
-  left_rel = handle->left_rel;
-  right_rel = handle->right_rel;
-  join_rel = handle->join_rel;
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
 
-  if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
-    goto inner_loop;
+  for(i = 0; i < handle->join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
+
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
+
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(store_row(handle->join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
   }
 
-  /* Equi-join for indexed attributes only. In the outer loop, we iterate over
-     each tuple in the left relation. */
-  for(handle->tuple_id = 0;; handle->tuple_id++) {
-    result = storage_get_row(left_rel, &handle->tuple_id, left_row);
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
+static db_result_t
+process_index_join(db_handle_t *handle)
+{
+  db_result_t result;
+  tuple_id_t inner_tuple_id;
+  attribute_value_t value;
+
+  for(;;) {
+    /* In the outer loop, we iterate over each tuple in the outer
+       relation. */
+    if(handle->flags & DB_HANDLE_FLAG_INDEX_STEP) {
+      result = storage_get_row(outer.rel, &handle->tuple_id, outer.row);
+      if(DB_ERROR(result)) {
+        PRINTF("DB: Failed to get a row in outer relation %s!\n",
+               outer.rel->name);
+        return result;
+      } else if(result == DB_FINISHED) {
+        return DB_FINISHED;
+      }
+      handle->tuple_id++;
+
+      if(DB_ERROR(db_phy_to_value(&value, outer.attr,
+                                  outer.row + outer.offset))) {
+        PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
+               outer.attr->name);
+        return DB_IMPLEMENTATION_ERROR;
+      }
+
+      if(DB_ERROR(index_get_iterator(&handle->index_iterator,
+                                     inner.attr->index,
+                                     &value, &value))) {
+        PRINTF("DB: Failed to get an index iterator\n");
+        return DB_INDEX_ERROR;
+      }
+      handle->flags &= ~DB_HANDLE_FLAG_INDEX_STEP;
+    }
+
+    /* In the inner loop, we iterate over all rows with a matching value
+       for the join attribute. The index component provides an iterator
+       for this purpose. */
+    inner_tuple_id = index_get_next(&handle->index_iterator);
+    if(inner_tuple_id == INVALID_TUPLE) {
+      /* Step to the next row in the outer relation. */
+      handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
+      continue;
+    }
+
+    result = storage_get_row(inner.rel, &inner_tuple_id, inner.row);
     if(DB_ERROR(result)) {
-      PRINTF("DB: Failed to get a row in left relation %s!\n", left_rel->name);
+      PRINTF("DB: Failed to get a row in inner relation %s!\n",
+             inner.rel->name);
       return result;
     } else if(result == DB_FINISHED) {
-      return DB_FINISHED;
+      PRINTF("DB: The index refers to an invalid row: %lu\n",
+             (unsigned long)inner_tuple_id);
+      return DB_IMPLEMENTATION_ERROR;
     }
 
-    if(DB_ERROR(relation_get_value(left_rel, handle->left_join_attr, left_row, &value))) {
-      PRINTF("DB: Failed to get a value of the attribute \"%s\" to join on\n",
-	handle->left_join_attr->name);
-      return DB_IMPLEMENTATION_ERROR;
+    /* Indexes may return rows whose keys only collide with the
+       requested one. */
+    if(join_keys_match()) {
+      return emit_join_row(handle);
     }
+  }
+}
 
-    if(DB_ERROR(index_get_iterator(&handle->index_iterator, 
-                                   handle->right_join_attr->index, 
-                                   &value, &value))) { 
-      PRINTF("DB: Failed to get an index iterator\n");
-      return DB_INDEX_ERROR;
-    }
-    handle->flags &= ~DB_HANDLE_FLAG_INDEX_STEP;
-
-    /* In the inner loop, we iterate over all rows with a matching value for the
-       join attribute. The index component provides an iterator for this purpose. */
-inner_loop:
-    for(;;) {
-      /* Get all rows matching the attribute value in the right relation. */
-      right_tuple_id = index_get_next(&handle->index_iterator);
-      if(right_tuple_id == INVALID_TUPLE) {
-        /* Exclude this row from the left relation in the result,
-           and step to the next value in the index iteration. */
-        handle->flags |= DB_HANDLE_FLAG_INDEX_STEP;
-        break;
+#if DB_FEATURE_HASH_JOIN
+static unsigned long
+hash_join_hash(long key)
+{
+  return ((unsigned long)key * 2654435761UL) & 0xffffffffUL;
+}
+
+static void
+get_partition_file(char *filename, int side, unsigned partition)
+{
+  snprintf(filename, DB_MAX_FILENAME_LENGTH, "%s.%c%u", DB_JOIN_SPILL_FILE,
+           side == JOIN_BUILD_SIDE ? 'b' : 'p', partition);
+}
+
+static db_result_t
+flush_partition(int side, unsigned partition, unsigned count)
+{
+  char filename[DB_MAX_FILENAME_LENGTH];
+  db_storage_id_t fd;
+  db_result_t result;
+
+  get_partition_file(filename, side, partition);
+  fd = storage_open(filename);
+  if(fd < 0) {
+    return DB_STORAGE_ERROR;
+  }
+
+  result = storage_write(fd,
+                         &hash_join.block[partition * DB_JOIN_SPILL_BUFFER],
+                         (unsigned long)hash_join.partition_size[side][partition] *
+                         sizeof(struct join_record),
+                         count * sizeof(struct join_record));
+  storage_close(fd);
+
+  hash_join.partition_size[side][partition] += count;
+  return result;
+}
+
+static db_result_t
+spill_relation(struct join_side *side_info, int side)
+{
+  char filename[DB_MAX_FILENAME_LENGTH];
+  uint8_t fill[DB_JOIN_PARTITIONS];
+  struct join_record *record;
+  tuple_id_t tuple_id;
+  tuple_id_t row_id;
+  unsigned long size;
+  unsigned partition;
+  db_result_t result;
+  long key;
+
+  size = (unsigned long)relation_cardinality(side_info->rel) /
+         hash_join.partitions + DB_JOIN_SPILL_BUFFER;
+  for(partition = 0; partition < hash_join.partitions; partition++) {
+    get_partition_file(filename, side, partition);
+    if(DB_ERROR(storage_reserve_file(filename,
+                                     size * sizeof(struct join_record)))) {
+      return DB_STORAGE_ERROR;
+    }
+    hash_join.partition_size[side][partition] = 0;
+    fill[partition] = 0;
+  }
+
+  for(tuple_id = 0;; tuple_id++) {
+    row_id = tuple_id;
+    result = storage_get_row(side_info->rel, &row_id, side_info->row);
+    if(DB_ERROR(result)) {
+      return result;
+    } else if(result == DB_FINISHED) {
+      break;
+    }
+
+    if(DB_ERROR(get_join_key(side_info, &key))) {
+      return DB_TYPE_ERROR;
+    }
+
+    partition = (hash_join_hash(key) >> 24) % hash_join.partitions;
+    record = &hash_join.block[partition * DB_JOIN_SPILL_BUFFER +
+                              fill[partition]];
+    record->key = key;
+    record->tuple_id = tuple_id;
+
+    if(++fill[partition] == DB_JOIN_SPILL_BUFFER) {
+      if(DB_ERROR(flush_partition(side, partition, fill[partition]))) {
+        return DB_STORAGE_ERROR;
       }
+      fill[partition] = 0;
+    }
+  }
+
+  for(partition = 0; partition < hash_join.partitions; partition++) {
+    if(fill[partition] > 0 &&
+       DB_ERROR(flush_partition(side, partition, fill[partition]))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  PRINTF("DB: Spilled %lu rows of relation %s into %u partitions\n",
+         (unsigned long)tuple_id, side_info->rel->name,
+         (unsigned)hash_join.partitions);
+
+  return DB_OK;
+}
+
+static void
+remove_partitions(void)
+{
+  char filename[DB_MAX_FILENAME_LENGTH];
+  unsigned partition;
+
+  for(partition = 0; partition < hash_join.partitions; partition++) {
+    get_partition_file(filename, JOIN_BUILD_SIDE, partition);
+    storage_remove_file(filename);
+    get_partition_file(filename, JOIN_PROBE_SIDE, partition);
+    storage_remove_file(filename);
+  }
+}
+
+static db_result_t
+read_join_record(int side, tuple_id_t position, struct join_record *record)
+{
+  char filename[DB_MAX_FILENAME_LENGTH];
+  struct join_side *side_info;
+  db_storage_id_t fd;
+  tuple_id_t size;
+  db_result_t result;
 
-      result = storage_get_row(right_rel, &right_tuple_id, right_row);
+  side_info = side == JOIN_BUILD_SIDE ? &inner : &outer;
+
+  if(hash_join.partitions == 0) {
+    /* Nothing was spilled, so the records are read from the relation. */
+    result = storage_get_row(side_info->rel, &position, side_info->row);
+    if(result != DB_OK) {
+      return result;
+    }
+    record->tuple_id = position;
+    return get_join_key(side_info, &record->key);
+  }
+
+  size = hash_join.partition_size[side][hash_join.partition];
+  if(position >= size) {
+    return DB_FINISHED;
+  }
+
+  if(hash_join.block_side != side || position < hash_join.block_start ||
+     position >= hash_join.block_start + hash_join.block_count) {
+    /* Read the block of records in which the position is located. */
+    hash_join.block_side = side;
+    hash_join.block_start = position;
+    hash_join.block_count = JOIN_BLOCK_SIZE;
+    if(size - position < JOIN_BLOCK_SIZE) {
+      hash_join.block_count = size - position;
+    }
+
+    get_partition_file(filename, side, hash_join.partition);
+    fd = storage_open(filename);
+    if(fd < 0) {
+      hash_join.block_count = 0;
+      return DB_STORAGE_ERROR;
+    }
+    result = storage_read(fd, hash_join.block,
+                          (unsigned long)position * sizeof(*record),
+                          hash_join.block_count * sizeof(*record));
+    storage_close(fd);
+    if(DB_ERROR(result)) {
+      hash_join.block_count = 0;
+      return result;
+    }
+  }
+
+  *record = hash_join.block[position - hash_join.block_start];
+  return DB_OK;
+}
+
+static db_result_t
+load_hash_table(void)
+{
+  struct join_entry *entry;
+  unsigned bucket;
+  db_result_t result;
+
+  for(;;) {
+    if(hash_join.build_finished) {
+      if(++hash_join.partition >= hash_join.partitions) {
+        return DB_FINISHED;
+      }
+      hash_join.block_count = 0;
+      hash_join.build_position = 0;
+      hash_join.build_finished = 0;
+    }
+
+    memset(hash_join.buckets, 0xff, sizeof(hash_join.buckets));
+    hash_join.entry_count = 0;
+
+    while(hash_join.entry_count < DB_JOIN_HASH_SIZE) {
+      entry = &hash_join.entries[hash_join.entry_count];
+      result = read_join_record(JOIN_BUILD_SIDE, hash_join.build_position,
+                                &entry->record);
       if(DB_ERROR(result)) {
-        PRINTF("DB: Failed to get a row in right relation %s!\n", right_rel->name);
         return result;
       } else if(result == DB_FINISHED) {
-	PRINTF("DB: The index refers to an invalid row: %lu\n",
-	       (unsigned long)right_tuple_id);
-        return DB_IMPLEMENTATION_ERROR;
+        hash_join.build_finished = 1;
+        break;
       }
+      hash_join.build_position++;
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
+      bucket = (hash_join_hash(entry->record.key) >> 8) % DB_JOIN_HASH_SIZE;
+      entry->next = hash_join.buckets[bucket];
+      hash_join.buckets[bucket] = hash_join.entry_count++;
+    }
 
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
+    if(hash_join.entry_count > 0) {
+      PRINTF("DB: Loaded %u rows of partition %u into the hash table\n",
+             hash_join.entry_count, hash_join.partition);
+      hash_join.probe_position = 0;
+      return DB_OK;
+    }
+  }
+}
 
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
-      }
+static db_result_t
+init_hash_join(void)
+{
+  tuple_id_t cardinality;
+  db_result_t result;
 
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
-          return DB_STORAGE_ERROR;
+  memset(&hash_join, 0, sizeof(hash_join));
+  hash_join.match = JOIN_NO_ENTRY;
+  hash_join.block_side = JOIN_BUILD_SIDE;
+
+  cardinality = relation_cardinality(inner.rel);
+  if(cardinality == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
+
+  if(cardinality > DB_JOIN_HASH_SIZE) {
+    cardinality = (cardinality + DB_JOIN_HASH_SIZE - 1) / DB_JOIN_HASH_SIZE;
+    hash_join.partitions = cardinality < DB_JOIN_PARTITIONS ?
+                           cardinality : DB_JOIN_PARTITIONS;
+
+    result = spill_relation(&inner, JOIN_BUILD_SIDE);
+    if(!DB_ERROR(result)) {
+      result = spill_relation(&outer, JOIN_PROBE_SIDE);
+    }
+    if(DB_ERROR(result)) {
+      remove_partitions();
+      return result;
+    }
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+process_hash_join(db_handle_t *handle)
+{
+  struct join_entry *entry;
+  tuple_id_t tuple_id;
+  unsigned bucket;
+  db_result_t result;
+
+  for(;;) {
+    if(hash_join.match == JOIN_NO_ENTRY) {
+      if(!hash_join.probing) {
+        result = load_hash_table();
+        if(result != DB_OK) {
+          break;
         }
+        hash_join.probing = 1;
       }
 
-      handle->current_row++;
-      return DB_GOT_ROW;
+      /* Look up the next row of the outer relation in the hash table. */
+      result = read_join_record(JOIN_PROBE_SIDE, hash_join.probe_position,
+                                &hash_join.probe);
+      if(DB_ERROR(result)) {
+        break;
+      } else if(result == DB_FINISHED) {
+        hash_join.probing = 0;
+        continue;
+      }
+      hash_join.probe_position++;
+      hash_join.probe_row_loaded = hash_join.partitions == 0;
+
+      bucket = (hash_join_hash(hash_join.probe.key) >> 8) % DB_JOIN_HASH_SIZE;
+      hash_join.match = hash_join.buckets[bucket];
+      continue;
+    }
+
+    entry = &hash_join.entries[hash_join.match];
+    hash_join.match = entry->next;
+    if(entry->record.key != hash_join.probe.key) {
+      continue;
     }
+
+    if(!hash_join.probe_row_loaded) {
+      tuple_id = hash_join.probe.tuple_id;
+      result = storage_get_row(outer.rel, &tuple_id, outer.row);
+      if(result != DB_OK) {
+        break;
+      }
+      hash_join.probe_row_loaded = 1;
+    }
+
+    tuple_id = entry->record.tuple_id;
+    result = storage_get_row(inner.rel, &tuple_id, inner.row);
+    if(result != DB_OK) {
+      break;
+    }
+
+    if(join_keys_match()) {
+      return emit_join_row(handle);
+    }
+  }
+
+  if(result == DB_FINISHED && hash_join.probing) {
+    PRINTF("DB: A spilled row could not be found\n");
+    result = DB_IMPLEMENTATION_ERROR;
+  }
+  remove_partitions();
+  return result;
+}
+#endif /* DB_FEATURE_HASH_JOIN */
+
+db_result_t
+relation_process_join(void *handle_ptr)
+{
+  db_handle_t *handle;
+
+  handle = (db_handle_t *)handle_ptr;
+
+#if DB_FEATURE_HASH_JOIN
+  if(handle->flags & DB_HANDLE_FLAG_HASH_JOIN) {
+    return process_hash_join(handle);
+  }
+#endif /* DB_FEATURE_HASH_JOIN */
+
+  return process_index_join(handle);
+}
+
+static db_result_t
+plan_join(db_handle_t *handle)
+{
+  struct join_side left;
+  struct join_side right;
+  tuple_id_t left_cardinality;
+  tuple_id_t right_cardinality;
+  int left_indexed;
+  int right_indexed;
+  int swap;
+
+  left.rel = handle->left_rel;
+  left.attr = handle->left_join_attr;
+  left.row = left_row;
+  right.rel = handle->right_rel;
+  right.attr = handle->right_join_attr;
+  right.row = right_row;
+
+  if((left.attr->domain == DOMAIN_STRING) !=
+     (right.attr->domain == DOMAIN_STRING)) {
+    PRINTF("DB: The attributes to join on have incompatible domains\n");
+    return DB_TYPE_ERROR;
+  }
+
+  left.offset = get_attribute_value_offset(left.rel, left.attr);
+  right.offset = get_attribute_value_offset(right.rel, right.attr);
+
+  left_cardinality = relation_cardinality(left.rel);
+  right_cardinality = relation_cardinality(right.rel);
+  if(left_cardinality == INVALID_TUPLE || right_cardinality == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
+
+  left_indexed = index_exists(left.attr);
+  right_indexed = index_exists(right.attr);
+
+  if(left_indexed || right_indexed) {
+    /* Scan the relation without an index, or the smaller one if both
+       are indexed, and look up its join values in the index of the
+       other relation. */
+    swap = !right_indexed ||
+           (left_indexed && left_cardinality > right_cardinality);
+    PRINTF("DB: Index join using the index of %s\n",
+           swap ? left.rel->name : right.rel->name);
+  } else {
+#if DB_FEATURE_HASH_JOIN
+    /* Build the hash table over the smaller relation. */
+    swap = left_cardinality < right_cardinality;
+    handle->flags |= DB_HANDLE_FLAG_HASH_JOIN;
+    PRINTF("DB: Hash join building on %s\n",
+           swap ? left.rel->name : right.rel->name);
+#else
+    PRINTF("DB: The attribute to join on is not indexed\n");
+    return DB_INDEX_ERROR;
+#endif /* DB_FEATURE_HASH_JOIN */
+  }
+
+  if(swap) {
+    outer = right;
+    inner = left;
+    handle->flags |= DB_HANDLE_FLAG_SWAP_JOIN;
+  } else {
+    outer = left;
+    inner = right;
   }
 
   return DB_OK;
@@ -1120,6 +1997,7 @@ relation_join(void *query_result, void *adt_ptr)
   int i;
   char *attribute_name;
   attribute_t *attr;
+  db_result_t result;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -1158,9 +2036,9 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
-  if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
+  result = plan_join(handle);
+  if(DB_ERROR(result)) {
+    return result;
   }
 
   /*
@@ -1189,7 +2067,14 @@ relation_join(void *query_result, void *adt_ptr)
     handle->ncolumns++;
   }
 
-  return generate_join_result(handle);
+  result = generate_join_result(handle);
+#if DB_FEATURE_HASH_JOIN
+  if(!DB_ERROR(result) && (handle->flags & DB_HANDLE_FLAG_HASH_JOIN)) {
+    result = init_hash_join();
+  }
+#endif /* DB_FEATURE_HASH_JOIN */
+
+  return result;
 }
 #endif /* DB_FEATURE_JOIN */
 
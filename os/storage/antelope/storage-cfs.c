@@ -68,6 +68,13 @@ struct index_record {
 
 #define ROW_XOR 0xf6U
 
+#if DB_FEATURE_BLOCK_SCAN
+/* Block summaries are stored in records that end with a non-zero byte,
+   so that Coffee determines the length of the file correctly. */
+#define SUMMARY_RECORD_SIZE (sizeof(storage_block_summary_t) + 1)
+#define SUMMARY_END 0xffU
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
 static bool
 merge_strings(char *dest, size_t dest_size, char *prefix, char *suffix)
 {
@@ -110,6 +117,55 @@ storage_generate_file(char *prefix, unsigned long size)
 #endif /* DB_FEATURE_COFFEE */
 }
 
+db_result_t
+storage_reserve_file(const char *filename, unsigned long size)
+{
+#if !DB_FEATURE_COFFEE
+  int fd;
+#endif
+
+  cfs_remove(filename);
+
+#if DB_FEATURE_COFFEE
+  PRINTF("DB: Reserving %lu bytes in %s\n", size, filename);
+  return cfs_coffee_reserve(filename, size) < 0 ? DB_STORAGE_ERROR : DB_OK;
+#else
+  fd = cfs_open(filename, CFS_WRITE);
+  cfs_close(fd);
+  return fd < 0 ? DB_STORAGE_ERROR : DB_OK;
+#endif /* DB_FEATURE_COFFEE */
+}
+
+void
+storage_remove_file(const char *filename)
+{
+  cfs_remove(filename);
+}
+
+#if DB_FEATURE_BLOCK_SCAN
+static bool
+get_summary_file(char *filename, size_t size, relation_t *rel)
+{
+  char *suffix;
+
+  /* The summary file shares the random suffix of the tuple file, so that
+     it follows the tuples when a relation is renamed. */
+  suffix = strchr(rel->tuple_filename, '.');
+  return suffix != NULL &&
+         merge_strings(filename, size, SUMMARY_NAME_PREFIX, suffix);
+}
+
+static void
+remove_summary_file(relation_t *rel)
+{
+  char filename[RELATION_NAME_LENGTH + 1];
+
+  if(get_summary_file(filename, sizeof(filename), rel)) {
+    cfs_remove(filename);
+  }
+}
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
 db_result_t
 storage_load(relation_t *rel)
 {
@@ -232,6 +288,12 @@ storage_put_relation(relation_t *rel)
 
     strncpy(rel->tuple_filename, str, sizeof(rel->tuple_filename) - 1);
     rel->tuple_filename[sizeof(rel->tuple_filename) - 1] = '\0';
+
+#if DB_FEATURE_BLOCK_SCAN
+    /* Summaries left from an earlier tuple file with the same name do
+       not describe the new one. */
+    remove_summary_file(rel);
+#endif /* DB_FEATURE_BLOCK_SCAN */
   }
 
   /*
@@ -292,6 +354,9 @@ storage_drop_relation(relation_t *rel, int remove_tuples)
 {
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
+#if DB_FEATURE_BLOCK_SCAN
+    remove_summary_file(rel);
+#endif /* DB_FEATURE_BLOCK_SCAN */
   }
   return cfs_remove(rel->name) < 0 ? DB_STORAGE_ERROR : DB_OK;
 }
@@ -453,6 +518,49 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
   return DB_OK;
 }
 
+db_result_t
+storage_get_rows(relation_t *rel, tuple_id_t *tuple_id, storage_row_t rows,
+                 unsigned *count)
+{
+  tuple_id_t nrows;
+  unsigned length;
+  unsigned i;
+  int r;
+
+  if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  if(*tuple_id >= nrows) {
+    *count = 0;
+    return DB_FINISHED;
+  }
+
+  if(*count > nrows - *tuple_id) {
+    *count = nrows - *tuple_id;
+  }
+
+  if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length, CFS_SEEK_SET) ==
+              (cfs_offset_t)-1) {
+    return DB_STORAGE_ERROR;
+  }
+
+  length = *count * rel->row_length;
+  r = cfs_read(rel->tuple_storage, rows, length);
+  if(r != length) {
+    PRINTF("DB: Incomplete block: %d < %u\n", r, length);
+    return DB_STORAGE_ERROR;
+  }
+
+  for(i = 1; i <= *count; i++) {
+    rows[i * rel->row_length - 1] ^= ROW_XOR;
+  }
+
+  PRINTF("DB: Read %u rows from relation %s\n", *count, rel->name);
+
+  return DB_OK;
+}
+
 db_result_t
 storage_put_row(relation_t *rel, storage_row_t row)
 {
@@ -524,6 +632,78 @@ storage_get_row_amount(relation_t *rel, tuple_id_t *amount)
   return DB_OK;
 }
 
+#if DB_FEATURE_BLOCK_SCAN
+db_result_t
+storage_get_block_summaries(relation_t *rel, tuple_id_t block,
+                            storage_block_summary_t *summaries,
+                            unsigned *count)
+{
+  char filename[RELATION_NAME_LENGTH + 1];
+  unsigned char end;
+  unsigned i;
+  int fd;
+
+  if(!get_summary_file(filename, sizeof(filename), rel)) {
+    return DB_NAME_ERROR;
+  }
+
+  i = 0;
+  fd = cfs_open(filename, CFS_READ);
+  if(fd >= 0) {
+    if(cfs_seek(fd, block * SUMMARY_RECORD_SIZE, CFS_SEEK_SET) !=
+       (cfs_offset_t)-1) {
+      for(; i < *count; i++) {
+        if(cfs_read(fd, &summaries[i], sizeof(summaries[i])) !=
+           sizeof(summaries[i]) ||
+           cfs_read(fd, &end, 1) != 1) {
+          break;
+        }
+      }
+    }
+    cfs_close(fd);
+  }
+
+  /* Blocks that have not been summarized yet must be scanned. */
+  *count = i;
+  return i > 0 ? DB_OK : DB_FINISHED;
+}
+
+db_result_t
+storage_put_block_summary(relation_t *rel, tuple_id_t block,
+                          storage_block_summary_t *summary)
+{
+  char filename[RELATION_NAME_LENGTH + 1];
+  unsigned char end;
+  int fd;
+  db_result_t result;
+
+  if(!get_summary_file(filename, sizeof(filename), rel)) {
+    return DB_NAME_ERROR;
+  }
+
+  fd = cfs_open(filename, CFS_READ | CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    return DB_STORAGE_ERROR;
+  }
+
+  /* The summaries are stored in block order. If an earlier block is
+     missing, the following ones are left without summaries. */
+  result = DB_FINISHED;
+  if(cfs_seek(fd, 0, CFS_SEEK_END) ==
+     (cfs_offset_t)(block * SUMMARY_RECORD_SIZE)) {
+    end = SUMMARY_END;
+    result = DB_OK;
+    if(cfs_write(fd, summary, sizeof(*summary)) != sizeof(*summary) ||
+       cfs_write(fd, &end, 1) != 1) {
+      result = DB_STORAGE_ERROR;
+    }
+  }
+
+  cfs_close(fd);
+  return result;
+}
+#endif /* DB_FEATURE_BLOCK_SCAN */
+
 db_storage_id_t
 storage_open(const char *filename)
 {
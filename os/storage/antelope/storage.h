@@ -48,9 +48,22 @@
 #define INDEX_NAME_LENGTH       (RELATION_NAME_LENGTH + \
                                  sizeof(INDEX_NAME_SUFFIX) - 1)
 
+#define SUMMARY_NAME_PREFIX     "range"
+
 typedef unsigned char * storage_row_t;
 
+/* The range of the values of each numeric attribute in a block of
+   DB_SCAN_BLOCK_ROWS rows, in the order of the attributes of the
+   relation. */
+struct storage_block_summary {
+  long min[DB_MAX_ATTRIBUTES_PER_RELATION];
+  long max[DB_MAX_ATTRIBUTES_PER_RELATION];
+};
+typedef struct storage_block_summary storage_block_summary_t;
+
 char *storage_generate_file(char *, unsigned long);
+db_result_t storage_reserve_file(const char *, unsigned long);
+void storage_remove_file(const char *);
 
 db_result_t storage_load(relation_t *);
 void storage_unload(relation_t *);
@@ -65,9 +78,17 @@ db_result_t storage_get_index(index_t *, relation_t *, attribute_t *);
 db_result_t storage_put_index(index_t *);
 
 db_result_t storage_get_row(relation_t *, tuple_id_t *, storage_row_t);
+db_result_t storage_get_rows(relation_t *, tuple_id_t *, storage_row_t,
+                             unsigned *);
 db_result_t storage_put_row(relation_t *, storage_row_t);
 db_result_t storage_get_row_amount(relation_t *, tuple_id_t *);
 
+db_result_t storage_get_block_summaries(relation_t *, tuple_id_t,
+                                        storage_block_summary_t *,
+                                        unsigned *);
+db_result_t storage_put_block_summary(relation_t *, tuple_id_t,
+                                      storage_block_summary_t *);
+
 db_storage_id_t storage_open(const char *);
 void storage_close(db_storage_id_t);
 db_result_t storage_read(db_storage_id_t, void *, unsigned long, unsigned);
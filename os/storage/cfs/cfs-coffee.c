@@ -84,6 +84,68 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * Keep an index of the file names and a map of the free pages in RAM, so
+ * that opening a file and allocating pages do not need to read the headers
+ * of the whole storage. The index is built from the file headers when
+ * Coffee is first used, and assumes that Coffee is the only writer of its
+ * storage area.
+ */
+#ifdef COFFEE_CONF_RAM_INDEX
+#define COFFEE_RAM_INDEX COFFEE_CONF_RAM_INDEX
+#else
+#define COFFEE_RAM_INDEX 0
+#endif
+
+/*
+ * Maximum number of files in the RAM index of file names. If there are
+ * more files, the remaining ones are found by scanning the storage.
+ */
+#ifdef COFFEE_CONF_NAME_INDEX_SIZE
+#define COFFEE_NAME_INDEX_SIZE COFFEE_CONF_NAME_INDEX_SIZE
+#else
+#define COFFEE_NAME_INDEX_SIZE 32
+#endif
+
+/*
+ * Number of storage pages cached in RAM. Writes stay in the cache until
+ * their page is evicted, a file header is written or a file is closed,
+ * so that adjacent small writes are programmed with one storage write.
+ * 0 disables the cache.
+ */
+#ifdef COFFEE_CONF_CACHE_PAGES
+#define COFFEE_CACHE_PAGES COFFEE_CONF_CACHE_PAGES
+#else
+#define COFFEE_CACHE_PAGES 0
+#endif
+
+/* Number of pages that are read ahead into the cache when the storage
+   is read sequentially. */
+#ifdef COFFEE_CONF_READ_AHEAD
+#define COFFEE_READ_AHEAD COFFEE_CONF_READ_AHEAD
+#else
+#define COFFEE_READ_AHEAD 2
+#endif
+
+#if COFFEE_CACHE_PAGES > 0 && COFFEE_READ_AHEAD >= COFFEE_CACHE_PAGES
+#error COFFEE_READ_AHEAD must be smaller than COFFEE_CACHE_PAGES.
+#endif
+
+/* Number of log record lookups that are remembered in RAM, so that
+   reading a modified file does not search its log index again. */
+#ifdef COFFEE_CONF_LOG_INDEX_CACHE
+#define COFFEE_LOG_INDEX_CACHE COFFEE_CONF_LOG_INDEX_CACHE
+#else
+#define COFFEE_LOG_INDEX_CACHE 0
+#endif
+
+/* Count cache hits and storage operations; see cfs_coffee_stats(). */
+#ifdef COFFEE_CONF_STATS
+#define COFFEE_STATS COFFEE_CONF_STATS
+#else
+#define COFFEE_STATS 0
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -158,6 +220,9 @@ struct sector_status {
   coffee_page_t active;
   coffee_page_t obsolete;
   coffee_page_t free;
+  /* Pages at the start of the sector that belong to a file starting
+     in a previous sector. */
+  coffee_page_t carried;
 };
 
 /* The structure of cached file objects. */
@@ -190,6 +255,34 @@ struct file_header {
   char name[COFFEE_NAME_LENGTH];
 };
 
+#if COFFEE_RAM_INDEX
+/* An entry in the RAM index of file names. */
+struct name_entry {
+  coffee_page_t page;
+  uint16_t hash;
+};
+#endif /* COFFEE_RAM_INDEX */
+
+#if COFFEE_CACHE_PAGES > 0
+/* A page in the storage cache. The data is kept in cache_data. */
+struct cache_page {
+  cfs_offset_t offset;
+  uint16_t dirty_start;
+  uint16_t dirty_end;
+  uint8_t used;
+};
+#endif /* COFFEE_CACHE_PAGES > 0 */
+
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX_CACHE > 0
+/* The most recent record of a region in a log, or -1 if there is none. */
+struct log_index_entry {
+  coffee_page_t log_page;
+  /* The region number as stored in the log index; 0 for a free entry. */
+  uint16_t region;
+  int16_t record;
+};
+#endif /* COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX_CACHE > 0 */
+
 /* This is needed because of a buggy compiler. */
 struct log_param {
   cfs_offset_t offset;
@@ -206,18 +299,281 @@ static struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
 static coffee_page_t next_free;
 static char gc_wait;
 
+#if COFFEE_RAM_INDEX
+/*
+ * An open addressing hash table with the first page of every active file,
+ * and the number of free pages at the end of each sector. Coffee allocates
+ * the pages of a sector in order, so the free pages of a sector always
+ * follow its allocated pages.
+ */
+static struct name_entry name_index[COFFEE_NAME_INDEX_SIZE];
+static coffee_page_t name_index_count;
+static coffee_page_t free_pages[COFFEE_SECTOR_COUNT];
+static uint8_t index_built;
+/* Set if some file did not fit in the index. */
+static uint8_t index_partial;
+#endif /* COFFEE_RAM_INDEX */
+
+#if COFFEE_CACHE_PAGES > 0
+static struct cache_page cache_pages[COFFEE_CACHE_PAGES];
+static uint8_t cache_data[COFFEE_CACHE_PAGES][COFFEE_PAGE_SIZE];
+/* Pages are replaced in order, so that a read-ahead fills consecutive
+   cache pages with one storage read. */
+static uint8_t cache_next;
+/* The storage offset that continues the last read into the cache. */
+static cfs_offset_t cache_sequential;
+#endif /* COFFEE_CACHE_PAGES > 0 */
+
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX_CACHE > 0
+static struct log_index_entry log_index[COFFEE_LOG_INDEX_CACHE];
+static uint8_t log_index_next;
+#endif
+
+#if COFFEE_STATS
+static cfs_coffee_stats_t coffee_stats;
+#define STATS_ADD(field, n) coffee_stats.field += (n)
+#else
+#define STATS_ADD(field, n)
+#endif
+
+/*---------------------------------------------------------------------------*/
+static void
+device_read(void *buf, unsigned size, cfs_offset_t offset)
+{
+  STATS_ADD(storage_reads, 1);
+  STATS_ADD(bytes_read, size);
+  COFFEE_READ(buf, size, offset);
+}
+/*---------------------------------------------------------------------------*/
+static void
+device_write(const void *buf, unsigned size, cfs_offset_t offset)
+{
+  STATS_ADD(storage_writes, 1);
+  STATS_ADD(bytes_written, size);
+  COFFEE_WRITE(buf, size, offset);
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_CACHE_PAGES > 0
+static int
+cache_find(cfs_offset_t offset)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_CACHE_PAGES; i++) {
+    if(cache_pages[i].used && cache_pages[i].offset == offset) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_flush_page(unsigned slot)
+{
+  struct cache_page *cp;
+
+  cp = &cache_pages[slot];
+  if(cp->dirty_end > cp->dirty_start) {
+    device_write(&cache_data[slot][cp->dirty_start],
+                 cp->dirty_end - cp->dirty_start,
+                 cp->offset + cp->dirty_start);
+    cp->dirty_start = cp->dirty_end = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+cache_fill(cfs_offset_t offset, int read)
+{
+  unsigned slot, run, i;
+
+  /* Read the following pages as well if the storage is read in order. */
+  run = 1;
+  if(read && offset == cache_sequential) {
+    while(run <= COFFEE_READ_AHEAD &&
+          offset + run * COFFEE_PAGE_SIZE < COFFEE_SIZE &&
+          cache_find(offset + run * COFFEE_PAGE_SIZE) < 0) {
+      run++;
+    }
+  }
+
+  if(cache_next + run > COFFEE_CACHE_PAGES) {
+    cache_next = 0;
+  }
+  slot = cache_next;
+  cache_next = (slot + run) % COFFEE_CACHE_PAGES;
+
+  for(i = 0; i < run; i++) {
+    cache_flush_page(slot + i);
+    cache_pages[slot + i].used = 1;
+    cache_pages[slot + i].offset = offset + i * COFFEE_PAGE_SIZE;
+  }
+
+  if(read) {
+    device_read(cache_data[slot], run * COFFEE_PAGE_SIZE, offset);
+    cache_sequential = offset + run * COFFEE_PAGE_SIZE;
+  }
+  return slot;
+}
+#endif /* COFFEE_CACHE_PAGES > 0 */
+/*---------------------------------------------------------------------------*/
+static void
+flash_read(void *buf, unsigned size, cfs_offset_t offset)
+{
+#if COFFEE_CACHE_PAGES > 0
+  unsigned page_offset, n;
+  int slot;
+
+  while(size > 0) {
+    page_offset = offset % COFFEE_PAGE_SIZE;
+    n = MIN(size, COFFEE_PAGE_SIZE - page_offset);
+
+    slot = cache_find(offset - page_offset);
+    if(slot < 0) {
+      STATS_ADD(cache_misses, 1);
+      slot = cache_fill(offset - page_offset, 1);
+    } else {
+      STATS_ADD(cache_hits, 1);
+    }
+    memcpy(buf, &cache_data[slot][page_offset], n);
+
+    buf = (char *)buf + n;
+    offset += n;
+    size -= n;
+  }
+#else /* COFFEE_CACHE_PAGES > 0 */
+  device_read(buf, size, offset);
+#endif /* COFFEE_CACHE_PAGES > 0 */
+}
+/*---------------------------------------------------------------------------*/
+static void
+flash_write(const void *buf, unsigned size, cfs_offset_t offset)
+{
+#if COFFEE_CACHE_PAGES > 0
+  struct cache_page *cp;
+  unsigned page_offset, n;
+  int slot;
+
+  while(size > 0) {
+    page_offset = offset % COFFEE_PAGE_SIZE;
+    n = MIN(size, COFFEE_PAGE_SIZE - page_offset);
+
+    slot = cache_find(offset - page_offset);
+    if(slot < 0) {
+      STATS_ADD(cache_misses, 1);
+      /* A page that is written completely need not be read first. */
+      slot = cache_fill(offset - page_offset, n < COFFEE_PAGE_SIZE);
+    } else {
+      STATS_ADD(cache_hits, 1);
+    }
+    memcpy(&cache_data[slot][page_offset], buf, n);
+
+    cp = &cache_pages[slot];
+    if(cp->dirty_end == cp->dirty_start) {
+      cp->dirty_start = page_offset;
+      cp->dirty_end = page_offset + n;
+    } else {
+      cp->dirty_start = MIN(cp->dirty_start, page_offset);
+      cp->dirty_end = MAX(cp->dirty_end, page_offset + n);
+    }
+
+    buf = (const char *)buf + n;
+    offset += n;
+    size -= n;
+  }
+#else /* COFFEE_CACHE_PAGES > 0 */
+  device_write(buf, size, offset);
+#endif /* COFFEE_CACHE_PAGES > 0 */
+}
+/*---------------------------------------------------------------------------*/
+static void
+flash_sync(void)
+{
+#if COFFEE_CACHE_PAGES > 0
+  unsigned i;
+
+  for(i = 0; i < COFFEE_CACHE_PAGES; i++) {
+    cache_flush_page(i);
+  }
+#endif /* COFFEE_CACHE_PAGES > 0 */
+}
+/*---------------------------------------------------------------------------*/
+static void
+flash_erase(coffee_page_t sector)
+{
+#if COFFEE_CACHE_PAGES > 0
+  cfs_offset_t start;
+  unsigned i;
+
+  /* The erasure supersedes pending writes to the sector. */
+  start = (cfs_offset_t)sector * COFFEE_SECTOR_SIZE;
+  for(i = 0; i < COFFEE_CACHE_PAGES; i++) {
+    if(cache_pages[i].offset >= start &&
+       cache_pages[i].offset < start + COFFEE_SECTOR_SIZE) {
+      cache_pages[i].used = 0;
+      cache_pages[i].dirty_start = cache_pages[i].dirty_end = 0;
+    }
+  }
+#endif /* COFFEE_CACHE_PAGES > 0 */
+
+  STATS_ADD(storage_erases, 1);
+  COFFEE_ERASE(sector);
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX_CACHE > 0
+static struct log_index_entry *
+log_index_find(coffee_page_t log_page, uint16_t region)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_LOG_INDEX_CACHE; i++) {
+    if(log_index[i].region == region + 1 && log_index[i].log_page == log_page) {
+      return &log_index[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+log_index_set(coffee_page_t log_page, uint16_t region, int16_t record)
+{
+  struct log_index_entry *entry;
+
+  entry = log_index_find(log_page, region);
+  if(entry == NULL) {
+    entry = &log_index[log_index_next];
+    log_index_next = (log_index_next + 1) % COFFEE_LOG_INDEX_CACHE;
+    entry->log_page = log_page;
+    entry->region = region + 1;
+  }
+  entry->record = record;
+}
+/*---------------------------------------------------------------------------*/
+static void
+log_index_remove(coffee_page_t log_page)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_LOG_INDEX_CACHE; i++) {
+    if(log_index[i].log_page == log_page) {
+      log_index[i].region = 0;
+    }
+  }
+}
+#endif /* COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX_CACHE > 0 */
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
 {
   hdr->flags |= HDR_FLAG_VALID;
-  COFFEE_WRITE(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  flash_write(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  /* File headers are not delayed in the cache. */
+  flash_sync();
 }
 /*---------------------------------------------------------------------------*/
 static void
 read_header(struct file_header *hdr, coffee_page_t page)
 {
-  COFFEE_READ(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  flash_read(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
   if(DEBUG && HDR_ACTIVE(*hdr) && !HDR_VALID(*hdr)) {
     PRINTF("Coffee: Invalid header at page %u!\n", (unsigned)page);
   }
@@ -251,6 +607,8 @@ get_sector_status(coffee_page_t sector, struct sector_status *stats)
     skip_pages = 0;
     last_pages_are_active = 0;
   }
+  stats->carried = skip_pages < COFFEE_PAGES_PER_SECTOR ?
+    skip_pages : COFFEE_PAGES_PER_SECTOR;
 
   sector_start = sector * COFFEE_PAGES_PER_SECTOR;
   sector_end = sector_start + COFFEE_PAGES_PER_SECTOR;
@@ -353,42 +711,62 @@ collect_garbage(int mode)
 {
   coffee_page_t sector;
   struct sector_status stats;
-  coffee_page_t first_page, isolation_count;
+  coffee_page_t first_page, isolation_count, carried;
+  char erased, carried_erased;
 
   PRINTF("Coffee: Running the garbage collector in %s mode\n",
          mode == GC_RELUCTANT ? "reluctant" : "greedy");
   /*
    * The garbage collector erases as many sectors as possible. A sector is
    * erasable if there are only free or obsolete pages in it.
+   *
+   * If a sector starts with pages of a file whose header is in a sector
+   * that is kept, these pages are isolated again after erasing the sector.
+   * Otherwise, scans starting from that header would skip over the files
+   * allocated at the start of the erased sector.
    */
+  carried_erased = 0;
   for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
     isolation_count = get_sector_status(sector, &stats);
     PRINTF("Coffee: Sector %u has %u active, %u obsolete, and %u free pages.\n",
            (unsigned)sector, (unsigned)stats.active,
            (unsigned)stats.obsolete, (unsigned)stats.free);
 
-    if(stats.active > 0) {
-      continue;
-    }
-
-    if((mode == GC_RELUCTANT && stats.free == 0) ||
-       (mode == GC_GREEDY && stats.obsolete > 0)) {
+    erased = 0;
+    carried = carried_erased ? 0 : stats.carried;
+    if(stats.active == 0 && stats.obsolete > carried &&
+       ((mode == GC_RELUCTANT && stats.free == 0) ||
+        (mode == GC_GREEDY && stats.obsolete > 0))) {
+      erased = 1;
       first_page = sector * COFFEE_PAGES_PER_SECTOR;
-      if(first_page < next_free) {
-        next_free = first_page;
+      if(first_page + carried < next_free) {
+        next_free = first_page + carried;
       }
 
       if(isolation_count > 0) {
         isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
       }
 
-      COFFEE_ERASE(sector);
+      flash_erase(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
 
+      if(carried > 0) {
+        isolate_pages(first_page, carried);
+      }
+#if COFFEE_RAM_INDEX
+      free_pages[sector] = COFFEE_PAGES_PER_SECTOR - carried;
+#endif
+
       if(mode == GC_RELUCTANT && isolation_count > 0) {
         break;
       }
     }
+
+    /* Track whether the header of the file that continues into the
+       next sector has been erased. */
+    if(stats.carried < COFFEE_PAGES_PER_SECTOR) {
+      carried_erased = erased;
+    }
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -413,6 +791,156 @@ next_file(coffee_page_t page, struct file_header *hdr)
   return page + hdr->max_pages;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_RAM_INDEX
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+  int i;
+
+  /* File names longer than the header field are truncated on storage. */
+  hash = 5381;
+  for(i = 0; i < COFFEE_NAME_LENGTH - 1 && name[i] != '\0'; i++) {
+    hash = hash * 33 + (uint8_t)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add_file(coffee_page_t page, const char *name)
+{
+  unsigned i;
+  uint16_t hash;
+
+  if(!index_built) {
+    return;
+  }
+
+  if(name_index_count == COFFEE_NAME_INDEX_SIZE) {
+    index_partial = 1;
+    return;
+  }
+
+  hash = name_hash(name);
+  for(i = hash % COFFEE_NAME_INDEX_SIZE;
+      name_index[i].page != INVALID_PAGE;
+      i = (i + 1) % COFFEE_NAME_INDEX_SIZE);
+  name_index[i].page = page;
+  name_index[i].hash = hash;
+  name_index_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove_file(coffee_page_t page, const char *name)
+{
+  unsigned i, j, k, n;
+
+  if(!index_built) {
+    return;
+  }
+
+  for(i = name_hash(name) % COFFEE_NAME_INDEX_SIZE, n = 0;
+      name_index[i].page != page;
+      i = (i + 1) % COFFEE_NAME_INDEX_SIZE) {
+    if(name_index[i].page == INVALID_PAGE ||
+       ++n == COFFEE_NAME_INDEX_SIZE) {
+      /* The file did not fit in the index. */
+      return;
+    }
+  }
+
+  /* Move the following entries that hash before the hole into it. */
+  name_index[i].page = INVALID_PAGE;
+  for(j = (i + 1) % COFFEE_NAME_INDEX_SIZE;
+      name_index[j].page != INVALID_PAGE;
+      j = (j + 1) % COFFEE_NAME_INDEX_SIZE) {
+    k = name_index[j].hash % COFFEE_NAME_INDEX_SIZE;
+    if(i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+      continue;
+    }
+    name_index[i] = name_index[j];
+    name_index[j].page = INVALID_PAGE;
+    i = j;
+  }
+  name_index_count--;
+}
+/*---------------------------------------------------------------------------*/
+static coffee_page_t
+index_find_file(const char *name, struct file_header *hdr)
+{
+  struct file_header candidate;
+  coffee_page_t page;
+  uint16_t hash;
+  unsigned i, n;
+
+  /* Prefer the first file in storage order, like a sequential scan. */
+  page = INVALID_PAGE;
+  hash = name_hash(name);
+  for(i = hash % COFFEE_NAME_INDEX_SIZE, n = 0;
+      n < COFFEE_NAME_INDEX_SIZE && name_index[i].page != INVALID_PAGE;
+      i = (i + 1) % COFFEE_NAME_INDEX_SIZE, n++) {
+    if(name_index[i].hash != hash ||
+       (page != INVALID_PAGE && name_index[i].page > page)) {
+      continue;
+    }
+    read_header(&candidate, name_index[i].page);
+    if(HDR_ACTIVE(candidate) && !HDR_LOG(candidate) &&
+       strcmp(name, candidate.name) == 0) {
+      page = name_index[i].page;
+      memcpy(hdr, &candidate, sizeof(*hdr));
+    }
+  }
+
+  return page;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_allocate_pages(coffee_page_t page, coffee_page_t amount)
+{
+  coffee_page_t sector, sector_end, end;
+
+  if(!index_built) {
+    return;
+  }
+
+  end = page + amount;
+  for(sector = page / COFFEE_PAGES_PER_SECTOR;
+      sector * COFFEE_PAGES_PER_SECTOR < end; sector++) {
+    sector_end = (sector + 1) * COFFEE_PAGES_PER_SECTOR;
+    free_pages[sector] = end < sector_end ? sector_end - end : 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_index(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+  unsigned i;
+
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    name_index[i].page = INVALID_PAGE;
+  }
+  memset(free_pages, 0, sizeof(free_pages));
+  name_index_count = 0;
+  index_partial = 0;
+  index_built = 1;
+
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      index_add_file(page, hdr.name);
+    } else if(HDR_FREE(hdr)) {
+      free_pages[page / COFFEE_PAGES_PER_SECTOR] =
+        COFFEE_PAGES_PER_SECTOR - page % COFFEE_PAGES_PER_SECTOR;
+    }
+  }
+
+  PRINTF("Coffee: Indexed %u files%s\n", (unsigned)name_index_count,
+         index_partial ? " (partial)" : "");
+}
+#endif /* COFFEE_RAM_INDEX */
+/*---------------------------------------------------------------------------*/
 static struct file *
 load_file(coffee_page_t start, struct file_header *hdr)
 {
@@ -459,6 +987,26 @@ find_file(const char *name)
   struct file_header hdr;
   coffee_page_t page;
 
+#if COFFEE_RAM_INDEX
+  if(!index_built) {
+    build_index();
+  }
+
+  page = index_find_file(name, &hdr);
+  if(page != INVALID_PAGE) {
+    for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
+      if(!FILE_FREE(&coffee_files[i]) && coffee_files[i].page == page) {
+        return &coffee_files[i];
+      }
+    }
+    return load_file(page, &hdr);
+  }
+
+  if(!index_partial) {
+    return NULL;
+  }
+#endif /* COFFEE_RAM_INDEX */
+
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
     if(FILE_FREE(&coffee_files[i])) {
@@ -501,7 +1049,7 @@ file_end(coffee_page_t start)
    */
 
   for(page = hdr.max_pages - 1; page >= 0; page--) {
-    COFFEE_READ(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
+    flash_read(buf, sizeof(buf), (start + page) * COFFEE_PAGE_SIZE);
     for(i = COFFEE_PAGE_SIZE - 1; i >= 0; i--) {
       if(buf[i] != 0) {
         if(page == 0 && i < sizeof(hdr)) {
@@ -519,6 +1067,48 @@ file_end(coffee_page_t start)
 static coffee_page_t
 find_contiguous_pages(coffee_page_t amount)
 {
+#if COFFEE_RAM_INDEX
+  coffee_page_t sector, start, end;
+
+  if(!index_built) {
+    build_index();
+  }
+
+  for(sector = next_free / COFFEE_PAGES_PER_SECTOR;
+      sector < COFFEE_SECTOR_COUNT; sector++) {
+    if(free_pages[sector] == 0) {
+      continue;
+    }
+
+    start = (sector + 1) * COFFEE_PAGES_PER_SECTOR - free_pages[sector];
+    if(start < next_free) {
+      start = next_free;
+    }
+    if(start + amount >= COFFEE_PAGE_COUNT) {
+      /* We can stop immediately if the remaining pages are not enough. */
+      break;
+    }
+
+    /* Extend the free extent over the following sectors that are free. */
+    end = (sector + 1) * COFFEE_PAGES_PER_SECTOR;
+    while(end < start + amount && end < COFFEE_PAGE_COUNT &&
+          free_pages[end / COFFEE_PAGES_PER_SECTOR] ==
+          COFFEE_PAGES_PER_SECTOR) {
+      end += COFFEE_PAGES_PER_SECTOR;
+    }
+
+    if(start + amount <= end) {
+      if(start == next_free) {
+        next_free = start + amount;
+      }
+      return start;
+    }
+
+    /* Continue with the sector that ended the extent. */
+    sector = end / COFFEE_PAGES_PER_SECTOR - 1;
+  }
+  return INVALID_PAGE;
+#else /* COFFEE_RAM_INDEX */
   coffee_page_t page, start;
   struct file_header hdr;
 
@@ -550,6 +1140,7 @@ find_contiguous_pages(coffee_page_t amount)
     }
   }
   return INVALID_PAGE;
+#endif /* COFFEE_RAM_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -572,6 +1163,16 @@ remove_by_page(coffee_page_t page, int remove_log,
 
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
+#if COFFEE_RAM_INDEX
+  if(!HDR_LOG(hdr)) {
+    index_remove_file(page, hdr.name);
+  }
+#endif
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX_CACHE > 0
+  if(HDR_LOG(hdr)) {
+    log_index_remove(page);
+  }
+#endif
 
   gc_wait = 0;
 
@@ -636,6 +1237,12 @@ reserve(const char *name, coffee_page_t pages,
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
+#if COFFEE_RAM_INDEX
+  index_allocate_pages(page, pages);
+  if(!HDR_LOG(hdr)) {
+    index_add_file(page, hdr.name);
+  }
+#endif
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          (unsigned)pages, (unsigned)page, name);
@@ -687,6 +1294,18 @@ get_record_index(coffee_page_t log_page, uint16_t search_records,
   uint16_t processed;
   uint16_t batch_size;
   int16_t match_index, i;
+#if COFFEE_LOG_INDEX_CACHE > 0
+  struct log_index_entry *entry;
+
+  /* Every search covers all records written so far, so the result stays
+     valid until write_log_page() writes a new record for the region. */
+  entry = log_index_find(log_page, region);
+  if(entry != NULL && entry->record < (int16_t)search_records) {
+    STATS_ADD(log_index_hits, 1);
+    return entry->record;
+  }
+  STATS_ADD(log_index_misses, 1);
+#endif /* COFFEE_LOG_INDEX_CACHE > 0 */
 
   base = absolute_offset(log_page, sizeof(uint16_t) * search_records);
   batch_size = search_records > COFFEE_LOG_TABLE_LIMIT ?
@@ -703,7 +1322,7 @@ get_record_index(coffee_page_t log_page, uint16_t search_records,
       }
 
       base -= batch_size * sizeof(indices[0]);
-      COFFEE_READ(&indices, sizeof(indices[0]) * batch_size, base);
+      flash_read(&indices, sizeof(indices[0]) * batch_size, base);
 
       for(i = batch_size - 1; i >= 0; i--) {
         if(indices[i] - 1 == region) {
@@ -716,6 +1335,9 @@ get_record_index(coffee_page_t log_page, uint16_t search_records,
     }
   }
 
+#if COFFEE_LOG_INDEX_CACHE > 0
+  log_index_set(log_page, region, match_index);
+#endif
   return match_index;
 }
 #endif /* COFFEE_MICRO_LOGS */
@@ -744,7 +1366,7 @@ read_log_page(struct file_header *hdr, int16_t record_count,
   base = absolute_offset(hdr->log_page, log_records * sizeof(region));
   base += (cfs_offset_t)match_index * log_record_size;
   base += lp->offset;
-  COFFEE_READ(lp->buf, lp->size, base);
+  flash_read(lp->buf, lp->size, base);
 
   return lp->size;
 }
@@ -814,7 +1436,7 @@ merge_log(coffee_page_t file_page, int extend)
       cfs_close(fd);
       return -1;
     } else if(n > 0) {
-      COFFEE_WRITE(buf, n, absolute_offset(new_file->page, offset));
+      flash_write(buf, n, absolute_offset(new_file->page, offset));
       offset += n;
     }
   } while(n != 0);
@@ -871,7 +1493,7 @@ find_next_record(struct file *file, coffee_page_t log_page,
       batch_size = log_records - processed >= preferred_batch_size ?
         preferred_batch_size : log_records - processed;
 
-      COFFEE_READ(&indices, batch_size * sizeof(indices[0]),
+      flash_read(&indices, batch_size * sizeof(indices[0]),
                   absolute_offset(log_page, processed * sizeof(indices[0])));
       for(log_record = 0; log_record < batch_size; log_record++) {
         if(indices[log_record] == 0) {
@@ -935,23 +1557,27 @@ write_log_page(struct file *file, struct log_param *lp)
 
     if((lp->offset > 0 || lp->size != log_record_size) &&
        read_log_page(&hdr, log_record, &lp_out) < 0) {
-      COFFEE_READ(copy_buf, sizeof(copy_buf),
+      flash_read(copy_buf, sizeof(copy_buf),
                   absolute_offset(file->page, offset));
     }
 
     memcpy(&copy_buf[lp->offset], lp->buf, lp->size);
 
+#if COFFEE_LOG_INDEX_CACHE > 0
+    log_index_set(log_page, region, log_record);
+#endif
+
     /*
      * Write the region number in the region index table.
      * The region number is incremented to avoid values of zero.
      */
     offset = absolute_offset(log_page, 0);
     ++region;
-    COFFEE_WRITE(&region, sizeof(region),
+    flash_write(&region, sizeof(region),
                  offset + log_record * sizeof(region));
 
     offset += log_records * sizeof(region);
-    COFFEE_WRITE(copy_buf, sizeof(copy_buf),
+    flash_write(copy_buf, sizeof(copy_buf),
                  offset + log_record * log_record_size);
     file->record_count = log_record + 1;
   }
@@ -1017,6 +1643,7 @@ cfs_close(int fd)
     coffee_fd_set[fd].flags = COFFEE_FD_FREE;
     coffee_fd_set[fd].file->references--;
     coffee_fd_set[fd].file = NULL;
+    flash_sync();
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -1105,7 +1732,7 @@ cfs_read(int fd, void *buf, unsigned size)
 
   /* If the file is not modified, read directly from the file extent. */
   if(!FILE_MODIFIED(file)) {
-    COFFEE_READ(buf, size, absolute_offset(file->page, fdp->offset));
+    flash_read(buf, size, absolute_offset(file->page, fdp->offset));
     fdp->offset += size;
     return size;
   }
@@ -1126,7 +1753,7 @@ cfs_read(int fd, void *buf, unsigned size)
 
     /* Read from the original file if we cannot find the data in the log. */
     if(r < 0) {
-      COFFEE_READ(buf, lp.size, absolute_offset(file->page, fdp->offset));
+      flash_read(buf, lp.size, absolute_offset(file->page, fdp->offset));
       r = lp.size;
     }
     fdp->offset += r;
@@ -1209,7 +1836,7 @@ cfs_write(int fd, const void *buf, unsigned size)
        * corresponding end offset in the original extent to ensure that
        * the correct file size is calculated when opening the file again.
        */
-      COFFEE_WRITE(dummy, 1, absolute_offset(file->page, fdp->offset - 1));
+      flash_write(dummy, 1, absolute_offset(file->page, fdp->offset - 1));
     }
   } else {
 #endif /* COFFEE_MICRO_LOGS */
@@ -1217,7 +1844,7 @@ cfs_write(int fd, const void *buf, unsigned size)
       return -1;
     }
 
-    COFFEE_WRITE(buf, size, absolute_offset(file->page, fdp->offset));
+    flash_write(buf, size, absolute_offset(file->page, fdp->offset));
     fdp->offset += size;
 #if COFFEE_MICRO_LOGS
   }
@@ -1331,7 +1958,7 @@ cfs_coffee_format(void)
   PRINTF("Coffee: Formatting %u sectors", (unsigned)COFFEE_SECTOR_COUNT);
 
   for(i = 0; i < COFFEE_SECTOR_COUNT; i++) {
-    COFFEE_ERASE(i);
+    flash_erase(i);
     PRINTF(".");
   }
 
@@ -1340,9 +1967,25 @@ cfs_coffee_format(void)
   memset(&coffee_fd_set, 0, sizeof(coffee_fd_set));
   next_free = 0;
   gc_wait = 1;
+#if COFFEE_RAM_INDEX
+  index_built = 0;
+#endif
+#if COFFEE_MICRO_LOGS && COFFEE_LOG_INDEX_CACHE > 0
+  memset(log_index, 0, sizeof(log_index));
+#endif
 
   PRINTF(" done!\n");
 
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+void
+cfs_coffee_stats(cfs_coffee_stats_t *stats)
+{
+#if COFFEE_STATS
+  memcpy(stats, &coffee_stats, sizeof(*stats));
+#else
+  memset(stats, 0, sizeof(*stats));
+#endif
+}
+/*---------------------------------------------------------------------------*/
@@ -140,6 +140,30 @@ int cfs_coffee_set_io_semantics(int fd, unsigned flags);
  */
 int cfs_coffee_format(void);
 
+/**
+ * Cache and storage statistics of Coffee.
+ */
+typedef struct cfs_coffee_stats {
+  uint32_t cache_hits;       /**< Page accesses served by the page cache. */
+  uint32_t cache_misses;     /**< Page accesses that filled a cache page. */
+  uint32_t log_index_hits;   /**< Log record lookups served from RAM. */
+  uint32_t log_index_misses; /**< Log record lookups in the log index. */
+  uint32_t storage_reads;    /**< Reads from the storage. */
+  uint32_t storage_writes;   /**< Writes to the storage. */
+  uint32_t storage_erases;   /**< Erased sectors. */
+  uint32_t bytes_read;       /**< Bytes read from the storage. */
+  uint32_t bytes_written;    /**< Bytes written to the storage. */
+} cfs_coffee_stats_t;
+
+/**
+ * \brief Obtain the cache and storage statistics of Coffee.
+ * \param stats A pointer to an object that receives the statistics.
+ *
+ * The statistics are counted from boot. They are only maintained if
+ * COFFEE_CONF_STATS is enabled, and are zero otherwise.
+ */
+void cfs_coffee_stats(cfs_coffee_stats_t *stats);
+
 /** @} */
 /** @} */
 
@@ -45,6 +45,7 @@
 #include "sys/ctimer.h"
 #include "contiki.h"
 #include "lib/list.h"
+#include "sys/profile.h"
 
 #include "sys/log.h"
 #define LOG_MODULE "CTimer"
@@ -72,7 +73,14 @@ PROCESS_THREAD(ctimer_process, ev, data)
         list_remove(ctimer_list, c);
         PROCESS_CONTEXT_BEGIN(c->p);
         if(c->f != NULL) {
-          c->f(c->ptr);
+          /* The callback may reuse the ctimer. */
+          void (*f)(void *) = c->f;
+          struct profile_frame frame;
+
+          PROFILE_ENTER(&frame);
+          f(c->ptr);
+          PROFILE_EXIT(&frame, PROFILE_TYPE_CTIMER, f,
+                       PROCESS_NAME_STRING(c->p));
         }
         PROCESS_CONTEXT_END(c->p);
         break;
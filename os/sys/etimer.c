@@ -54,6 +54,181 @@ static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_HEAP
+/*
+ * When ETIMER_HEAP is enabled, timerlist points to the root of a
+ * pairing heap ordered on expiration time. The children of a timer
+ * form a doubly linked list through the next and prev pointers, with
+ * the prev pointer of the leftmost child pointing to the parent.
+ */
+static bool
+expires_before(struct etimer *a, struct etimer *b)
+{
+  return CLOCK_LT(etimer_expiration_time(a), etimer_expiration_time(b));
+}
+/*---------------------------------------------------------------------------*/
+static bool
+is_queued(struct etimer *t)
+{
+  return t == timerlist || t->prev != NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Merge two detached heaps and return the new root. */
+static struct etimer *
+heap_meld(struct etimer *a, struct etimer *b)
+{
+  struct etimer *t;
+
+  if(a == NULL) {
+    return b;
+  }
+  if(b == NULL) {
+    return a;
+  }
+
+  if(expires_before(b, a)) {
+    t = a;
+    a = b;
+    b = t;
+  }
+
+  /* Make b the leftmost child of a. */
+  b->prev = a;
+  b->next = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+/* Merge a list of sibling heaps into a single heap using the standard
+   two-pass pairing. */
+static struct etimer *
+heap_merge_pairs(struct etimer *first)
+{
+  struct etimer *a, *b, *pairs, *root;
+
+  /* First pass: meld pairs from left to right, and collect the
+     results in reverse order through the next pointer. */
+  pairs = NULL;
+  while(first != NULL) {
+    a = first;
+    b = a->next;
+    first = b != NULL ? b->next : NULL;
+
+    a->next = a->prev = NULL;
+    if(b != NULL) {
+      b->next = b->prev = NULL;
+    }
+    a = heap_meld(a, b);
+    a->next = pairs;
+    pairs = a;
+  }
+
+  /* Second pass: meld the pairs from right to left. */
+  root = NULL;
+  while(pairs != NULL) {
+    a = pairs;
+    pairs = a->next;
+    a->next = NULL;
+    root = heap_meld(root, a);
+  }
+
+  return root;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_insert(struct etimer *t)
+{
+  t->next = t->prev = t->child = NULL;
+  timerlist = heap_meld(timerlist, t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(struct etimer *t)
+{
+  if(t == timerlist) {
+    timerlist = heap_merge_pairs(t->child);
+  } else {
+    if(t->prev->child == t) {
+      t->prev->child = t->next;
+    } else {
+      t->prev->next = t->next;
+    }
+    if(t->next != NULL) {
+      t->next->prev = t->prev;
+    }
+    timerlist = heap_meld(timerlist, heap_merge_pairs(t->child));
+  }
+
+  t->next = t->prev = t->child = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  next_expiration = timerlist == NULL ? 0 :
+    etimer_expiration_time(timerlist);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  struct etimer *t, *remaining;
+
+  PROCESS_BEGIN();
+
+  timerlist = NULL;
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      struct process *p = data;
+
+      /* Empty the heap and put back the timers of the other
+         processes. This is O(n log n), but processes rarely exit. */
+      remaining = NULL;
+      while(timerlist != NULL) {
+        t = timerlist;
+        heap_remove(t);
+        if(t->p != p) {
+          t->next = remaining;
+          remaining = t;
+        }
+      }
+      while(remaining != NULL) {
+        t = remaining;
+        remaining = t->next;
+        heap_insert(t);
+      }
+      update_time();
+      continue;
+    } else if(ev != PROCESS_EVENT_POLL) {
+      continue;
+    }
+
+    /* Expired timers are always found at the root of the heap. */
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+        etimer_request_poll();
+        break;
+      }
+
+      /* Reset the process ID of the event timer, to signal that the
+         etimer has expired. This is later checked in the
+         etimer_expired() function. */
+      t->p = PROCESS_NONE;
+      heap_remove(t);
+    }
+    update_time();
+  }
+
+  PROCESS_END();
+}
+#else /* ETIMER_HEAP */
 static void
 update_time(void)
 {
@@ -105,6 +280,7 @@ PROCESS_THREAD(etimer_process, ev, data)
           }
         }
       }
+      update_time();
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
@@ -140,6 +316,7 @@ again:
 
   PROCESS_END();
 }
+#endif /* ETIMER_HEAP */
 /*---------------------------------------------------------------------------*/
 void
 etimer_request_poll(void)
@@ -150,10 +327,19 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
-  struct etimer *t;
-
   etimer_request_poll();
 
+#if ETIMER_HEAP
+  if(timer->p != PROCESS_NONE && is_queued(timer)) {
+    /* The expiration time may have changed, so the timer must be
+       repositioned in the heap. */
+    heap_remove(timer);
+  }
+  timer->p = PROCESS_CURRENT();
+  heap_insert(timer);
+#else /* ETIMER_HEAP */
+  struct etimer *t;
+
   if(timer->p != PROCESS_NONE) {
     for(t = timerlist; t != NULL; t = t->next) {
       if(t == timer) {
@@ -169,6 +355,7 @@ add_timer(struct etimer *timer)
   timer->p = PROCESS_CURRENT();
   timer->next = timerlist;
   timerlist = timer;
+#endif /* ETIMER_HEAP */
 
   update_time();
 }
@@ -205,7 +392,17 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_HEAP
+  if(et->p != PROCESS_NONE && is_queued(et)) {
+    heap_remove(et);
+    et->timer.start += timediff;
+    heap_insert(et);
+  } else {
+    et->timer.start += timediff;
+  }
+#else /* ETIMER_HEAP */
   et->timer.start += timediff;
+#endif /* ETIMER_HEAP */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -236,6 +433,12 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_HEAP
+  if(et->p != PROCESS_NONE && is_queued(et)) {
+    heap_remove(et);
+    update_time();
+  }
+#else /* ETIMER_HEAP */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -260,6 +463,7 @@ etimer_stop(struct etimer *et)
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
+#endif /* ETIMER_HEAP */
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
@@ -68,6 +68,23 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+/**
+ * \brief Keep pending event timers in a pairing heap.
+ *
+ * By default, pending event timers are kept in an unsorted list,
+ * which makes finding expired timers linear in the number of
+ * timers. With this option enabled, the timers are instead kept in
+ * an intrusive pairing heap ordered on expiration time. Setting and
+ * stopping a timer then costs O(log n) amortized, and the next
+ * expiration is always found at the root. Each event timer grows by
+ * two pointers.
+ */
+#ifdef ETIMER_CONF_HEAP
+#define ETIMER_HEAP ETIMER_CONF_HEAP
+#else /* ETIMER_CONF_HEAP */
+#define ETIMER_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
 /**
  * A timer.
  *
@@ -80,6 +97,11 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_HEAP
+  /* The parent if this is the leftmost child, otherwise the left sibling. */
+  struct etimer *prev;
+  struct etimer *child;
+#endif /* ETIMER_HEAP */
 };
 
 /**
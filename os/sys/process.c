@@ -47,6 +47,10 @@
 
 #include "contiki.h"
 #include "sys/process.h"
+#include "sys/profile.h"
+#if PROCESS_POLL_LIST
+#include "sys/critical.h"
+#endif /* PROCESS_POLL_LIST */
 
 #include "sys/log.h"
 #define LOG_MODULE "Process"
@@ -65,6 +69,9 @@ static_assert(PROCESS_CONF_NUMEVENTS > 0 && PROCESS_CONF_NUMEVENTS <= 128,
 static_assert(!(PROCESS_CONF_NUMEVENTS & (PROCESS_CONF_NUMEVENTS - 1)),
   "PROCESS_CONF_NUMEVENTS must be a power of 2.");
 
+static_assert(PROCESS_CONF_NUMEVENTS * PROCESS_PRIORITY_CLASSES <= 128,
+  "The event queues of all priority classes must hold at most 128 events.");
+
 /*
  * A configurable function called after a process poll been requested.
  */
@@ -92,13 +99,46 @@ struct event_data {
   process_event_t ev;
 };
 
-static process_num_events_t nevents, fevent;
-static struct event_data events[PROCESS_CONF_NUMEVENTS];
+/*
+ * An event queue for each priority class.
+ */
+static struct event_queue {
+  struct event_data events[PROCESS_CONF_NUMEVENTS];
+  process_num_events_t nevents, fevent;
+} queues[PROCESS_PRIORITY_CLASSES];
+
+/* The number of events in all queues. */
+static process_num_events_t nevents;
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+uint32_t process_dropped_events;
 #endif
 
+#if PROCESS_PRIORITY_CLASSES > 1
+#define PRIORITY(p) ((p)->priority)
+#else /* PROCESS_PRIORITY_CLASSES > 1 */
+#define PRIORITY(p) PROCESS_PRIORITY_NORMAL
+#endif /* PROCESS_PRIORITY_CLASSES > 1 */
+
+#if PROCESS_POLL_LIST
+/*
+ * The processes that have requested a poll in each priority class, in
+ * the order of the requests. The lists are linked through next_poll.
+ */
+static struct process *poll_head[PROCESS_PRIORITY_CLASSES];
+static struct process *poll_tail[PROCESS_PRIORITY_CLASSES];
+#endif /* PROCESS_POLL_LIST */
+
+#if PROCESS_SUBSCRIPTIONS
+/* The subscriptions to each broadcast event, in subscription order. */
+static struct process_subscription *subscriptions[UINT8_MAX + 1];
+static unsigned num_subscriptions;
+/* The subscription to deliver to after the current one. Moved past
+   subscriptions that are removed during the delivery. */
+static struct process_subscription *delivery_next;
+#endif /* PROCESS_SUBSCRIPTIONS */
+
 static volatile bool poll_requested;
 
 #define PROCESS_STATE_NONE        0
@@ -106,6 +146,9 @@ static volatile bool poll_requested;
 #define PROCESS_STATE_CALLED      2
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
+#if PROCESS_SUBSCRIPTIONS
+static void remove_subscriptions(struct process *p);
+#endif /* PROCESS_SUBSCRIPTIONS */
 /*---------------------------------------------------------------------------*/
 process_event_t
 process_alloc_event(void)
@@ -178,6 +221,10 @@ exit_process(struct process *p, const struct process *fromprocess)
     }
   }
 
+#if PROCESS_SUBSCRIPTIONS
+  remove_subscriptions(p);
+#endif /* PROCESS_SUBSCRIPTIONS */
+
   if(process_is_running(p)) {
     /* Process was running */
     p->state = PROCESS_STATE_NONE;
@@ -209,7 +256,10 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
             PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+    struct profile_frame frame;
+    PROFILE_ENTER(&frame);
     int ret = p->thread(&p->pt, ev, data);
+    PROFILE_EXIT(&frame, PROFILE_TYPE_PROCESS, p, PROCESS_NAME_STRING(p));
     if(ret == PT_EXITED || ret == PT_ENDED || ev == PROCESS_EVENT_EXIT) {
       exit_process(p, p);
     } else {
@@ -234,6 +284,35 @@ process_init(void)
  * Call each process' poll handler.
  */
 /*---------------------------------------------------------------------------*/
+#if PROCESS_POLL_LIST
+static void
+do_poll(void)
+{
+  struct process *p;
+  struct process *next;
+  int_master_status_t status;
+
+  poll_requested = false;
+  for(int c = PROCESS_PRIORITY_CLASSES - 1; c >= 0; c--) {
+    /* Take the list, as polls may be requested by the processes that
+       we call, or from interrupts. These go on a new list. */
+    status = critical_enter();
+    p = poll_head[c];
+    poll_head[c] = NULL;
+    critical_exit(status);
+
+    for(; p != NULL; p = next) {
+      next = p->next_poll;
+      p->needspoll = false;
+      /* The process may have exited after requesting the poll. */
+      if(process_is_running(p)) {
+        p->state = PROCESS_STATE_RUNNING;
+        call_process(p, PROCESS_EVENT_POLL, NULL);
+      }
+    }
+  }
+}
+#else /* PROCESS_POLL_LIST */
 static void
 do_poll(void)
 {
@@ -247,6 +326,57 @@ do_poll(void)
     }
   }
 }
+#endif /* PROCESS_POLL_LIST */
+/*---------------------------------------------------------------------------*/
+#if PROCESS_SUBSCRIPTIONS
+static void
+deliver_to_subscribers(process_event_t ev, process_data_t data)
+{
+  struct process_subscription *s;
+  struct process_subscription *saved_next;
+
+  /* The calls may remove subscriptions, including the one after s, so
+     the walk continues from delivery_next. */
+  saved_next = delivery_next;
+  for(s = subscriptions[ev]; s != NULL; s = delivery_next) {
+    delivery_next = s->next;
+    if(poll_requested) {
+      do_poll();
+    }
+    call_process(s->p, ev, data);
+  }
+  delivery_next = saved_next;
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlink_subscription(struct process_subscription **sp)
+{
+  struct process_subscription *s = *sp;
+
+  if(delivery_next == s) {
+    delivery_next = s->next;
+  }
+  *sp = s->next;
+  s->next = NULL;
+  num_subscriptions--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_subscriptions(struct process *p)
+{
+  struct process_subscription **sp;
+
+  for(int i = 0; i <= UINT8_MAX && num_subscriptions > 0; i++) {
+    for(sp = &subscriptions[i]; *sp != NULL;) {
+      if((*sp)->p == p) {
+        unlink_subscription(sp);
+      } else {
+        sp = &(*sp)->next;
+      }
+    }
+  }
+}
+#endif /* PROCESS_SUBSCRIPTIONS */
 /*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
@@ -265,19 +395,32 @@ do_event(void)
    */
   if(nevents > 0) {
 
-    /* There are events that we should deliver. */
-    process_event_t ev = events[fevent].ev;
-    process_data_t data = events[fevent].data;
-    struct process *receiver = events[fevent].p;
+    /* There are events that we should deliver. Take the first event of
+       the highest priority class that has any. */
+    struct event_queue *q = &queues[PROCESS_PRIORITY_CLASSES - 1];
+    while(q->nevents == 0) {
+      q--;
+    }
+
+    process_event_t ev = q->events[q->fevent].ev;
+    process_data_t data = q->events[q->fevent].data;
+    struct process *receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    --q->nevents;
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
     if(receiver == PROCESS_BROADCAST) {
+#if PROCESS_SUBSCRIPTIONS
+      if(subscriptions[ev] != NULL) {
+        deliver_to_subscribers(ev, data);
+        return;
+      }
+#endif /* PROCESS_SUBSCRIPTIONS */
       for(struct process *p = process_list; p != NULL; p = p->next) {
         /* If we have been requested to poll a process, we do this in
            between processing the broadcast event. */
@@ -324,11 +467,17 @@ process_nevents(void)
 int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  struct event_queue *q =
+    &queues[p == PROCESS_BROADCAST ? PROCESS_PRIORITY_NORMAL : PRIORITY(p)];
+
+  if(q->nevents == PROCESS_CONF_NUMEVENTS) {
     LOG_WARN("Cannot post event %d to %s from %s because the queue is full\n",
              ev,
              p == PROCESS_BROADCAST ? "<broadcast>" : PROCESS_NAME_STRING(p),
              PROCESS_NAME_STRING(process_current));
+#if PROCESS_CONF_STATS
+    process_dropped_events++;
+#endif /* PROCESS_CONF_STATS */
     return PROCESS_ERR_FULL;
   }
 
@@ -338,10 +487,11 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
           nevents);
 
   process_num_events_t snum =
-    (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+    (process_num_events_t)(q->fevent + q->nevents) % PROCESS_CONF_NUMEVENTS;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -367,7 +517,23 @@ process_poll(struct process *p)
 {
   if(p != NULL &&
      (p->state == PROCESS_STATE_RUNNING || p->state == PROCESS_STATE_CALLED)) {
+#if PROCESS_POLL_LIST
+    int_master_status_t status = critical_enter();
+    if(!p->needspoll) {
+      int c = PRIORITY(p);
+      p->needspoll = true;
+      p->next_poll = NULL;
+      if(poll_head[c] == NULL) {
+        poll_head[c] = p;
+      } else {
+        poll_tail[c]->next_poll = p;
+      }
+      poll_tail[c] = p;
+    }
+    critical_exit(status);
+#else /* PROCESS_POLL_LIST */
     p->needspoll = true;
+#endif /* PROCESS_POLL_LIST */
     poll_requested = true;
     PROCESS_POLL_REQUESTED();
   }
@@ -379,4 +545,43 @@ process_is_running(struct process *p)
   return p->state != PROCESS_STATE_NONE;
 }
 /*---------------------------------------------------------------------------*/
+void
+process_set_priority(struct process *p, uint8_t priority)
+{
+#if PROCESS_PRIORITY_CLASSES > 1
+  p->priority = MIN(priority, PROCESS_PRIORITY_HIGH);
+#endif /* PROCESS_PRIORITY_CLASSES > 1 */
+}
+/*---------------------------------------------------------------------------*/
+void
+process_subscribe(struct process_subscription *s, struct process *p,
+                  process_event_t ev)
+{
+#if PROCESS_SUBSCRIPTIONS
+  struct process_subscription **sp;
+
+  s->p = p;
+  s->ev = ev;
+  s->next = NULL;
+  for(sp = &subscriptions[ev]; *sp != NULL; sp = &(*sp)->next);
+  *sp = s;
+  num_subscriptions++;
+#endif /* PROCESS_SUBSCRIPTIONS */
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(struct process_subscription *s)
+{
+#if PROCESS_SUBSCRIPTIONS
+  struct process_subscription **sp;
+
+  for(sp = &subscriptions[s->ev]; *sp != NULL; sp = &(*sp)->next) {
+    if(*sp == s) {
+      unlink_subscription(sp);
+      return;
+    }
+  }
+#endif /* PROCESS_SUBSCRIPTIONS */
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
@@ -90,6 +90,46 @@ typedef uint8_t       process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * Keep the processes that have requested a poll on a list, so that
+ * polling only visits these processes instead of all processes.
+ */
+#ifdef PROCESS_CONF_POLL_LIST
+#define PROCESS_POLL_LIST PROCESS_CONF_POLL_LIST
+#else /* PROCESS_CONF_POLL_LIST */
+#define PROCESS_POLL_LIST 0
+#endif /* PROCESS_CONF_POLL_LIST */
+
+/*
+ * The number of process priority classes. Polls and events for
+ * processes in a higher class are handled before those for processes in
+ * lower classes. Each class has an event queue of PROCESS_CONF_NUMEVENTS
+ * events. Requires PROCESS_CONF_POLL_LIST.
+ */
+#ifdef PROCESS_CONF_PRIORITY_CLASSES
+#define PROCESS_PRIORITY_CLASSES PROCESS_CONF_PRIORITY_CLASSES
+#else /* PROCESS_CONF_PRIORITY_CLASSES */
+#define PROCESS_PRIORITY_CLASSES 1
+#endif /* PROCESS_CONF_PRIORITY_CLASSES */
+
+#if PROCESS_PRIORITY_CLASSES > 1 && !PROCESS_POLL_LIST
+#error "PROCESS_CONF_PRIORITY_CLASSES requires PROCESS_CONF_POLL_LIST"
+#endif
+
+/*
+ * Support subscriptions to broadcast events, see process_subscribe().
+ */
+#ifdef PROCESS_CONF_SUBSCRIPTIONS
+#define PROCESS_SUBSCRIPTIONS PROCESS_CONF_SUBSCRIPTIONS
+#else /* PROCESS_CONF_SUBSCRIPTIONS */
+#define PROCESS_SUBSCRIPTIONS 0
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
+/** The priority class of processes by default. */
+#define PROCESS_PRIORITY_NORMAL 0
+/** The highest priority class, used for network processes. */
+#define PROCESS_PRIORITY_HIGH   (PROCESS_PRIORITY_CLASSES - 1)
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -325,6 +365,21 @@ struct process {
   struct pt pt;
   uint8_t state;
   bool needspoll;
+#if PROCESS_POLL_LIST
+  struct process *next_poll;
+#endif /* PROCESS_POLL_LIST */
+#if PROCESS_PRIORITY_CLASSES > 1
+  uint8_t priority;
+#endif /* PROCESS_PRIORITY_CLASSES > 1 */
+};
+
+/**
+ * A subscription of a process to a broadcast event.
+ */
+struct process_subscription {
+  struct process_subscription *next;
+  struct process *p;
+  process_event_t ev;
 };
 
 /**
@@ -460,6 +515,53 @@ process_current = p
  */
 process_event_t process_alloc_event(void);
 
+/**
+ * \brief      Set the priority class of a process.
+ * \param p    The process.
+ * \param priority The priority class, from PROCESS_PRIORITY_NORMAL to
+ *             PROCESS_PRIORITY_HIGH.
+ *
+ *             Polls and events for processes in a higher class are
+ *             handled before those for processes in lower classes.
+ *             Broadcast events are handled in the normal class. Does
+ *             nothing unless PROCESS_CONF_PRIORITY_CLASSES is larger
+ *             than 1.
+ */
+void process_set_priority(struct process *p, uint8_t priority);
+
+/**
+ * \brief      Subscribe a process to a broadcast event.
+ * \param s    The subscription, which must not be subscribed already
+ *             and must stay allocated until process_unsubscribe() is
+ *             called or the process exits. Its fields are set by this
+ *             function and need no initialization.
+ * \param p    The process.
+ * \param ev   The event.
+ *
+ *             Once an event has subscribers, broadcasts of it are only
+ *             delivered to the subscribers rather than to all processes.
+ *             Only use this for events whose receivers all subscribe,
+ *             such as an event number from process_alloc_event() that
+ *             is documented to require a subscription. Subscriptions of
+ *             a process are removed when it exits.
+ *
+ *             Without PROCESS_CONF_SUBSCRIPTIONS, broadcasts are
+ *             delivered to all processes, including the subscribers.
+ */
+void process_subscribe(struct process_subscription *s, struct process *p,
+                       process_event_t ev);
+
+/**
+ * \brief      Remove a subscription to a broadcast event.
+ * \param s    The subscription, which must have been passed to
+ *             process_subscribe(). It may be subscribed again
+ *             afterwards, also to another event.
+ *
+ *             Subscriptions may be removed while the event is being
+ *             delivered, also by the subscribers' event handlers.
+ */
+void process_unsubscribe(struct process_subscription *s);
+
 /** @} */
 
 /**
@@ -527,6 +629,13 @@ bool process_is_running(struct process *p);
  */
 process_num_events_t process_nevents(void);
 
+#if PROCESS_CONF_STATS
+/** The largest number of events that have been waiting at once. */
+extern process_num_events_t process_maxevents;
+/** The number of events that could not be posted as the queue was full. */
+extern uint32_t process_dropped_events;
+#endif /* PROCESS_CONF_STATS */
+
 /** @} */
 
 extern struct process *process_list;
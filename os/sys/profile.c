@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/**
+ * \addtogroup profile
+ * @{
+ */
+
+/**
+ * \file
+ *         Implementation of the CPU profiler.
+ */
+
+#include "contiki.h"
+#include "sys/profile.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#if PROFILE_ON
+
+/* Log configuration */
+#include "sys/log.h"
+#define LOG_MODULE "Profile"
+#define LOG_LEVEL LOG_LEVEL_MAIN
+
+static_assert((PROFILE_MAX_ENTRIES & (PROFILE_MAX_ENTRIES - 1)) == 0,
+              "PROFILE_CONF_MAX_ENTRIES must be a power of two");
+
+/* The entries are placed by hashing their keys, and are found by
+   linear probing. A zero key marks an unused entry. */
+static struct profile_entry entries[PROFILE_MAX_ENTRIES];
+static uint32_t dropped;
+
+/* The innermost invocation that is being measured. */
+static struct profile_frame *current_frame;
+
+#if PROFILE_LOG_PERIOD
+PROCESS(profile_process, "Profile");
+#endif /* PROFILE_LOG_PERIOD */
+/*---------------------------------------------------------------------------*/
+static struct profile_entry *
+get_entry(uintptr_t key)
+{
+  /* Processes and functions are at least word-aligned, so the lowest
+     bits of their addresses carry no information. */
+  unsigned i = (key >> 2) ^ (key >> 9);
+
+  for(unsigned probes = 0; probes < PROFILE_MAX_ENTRIES; probes++, i++) {
+    struct profile_entry *e = &entries[i & (PROFILE_MAX_ENTRIES - 1)];
+    if(e->key == key) {
+      return e;
+    }
+    if(e->key == 0) {
+      e->key = key;
+      return e;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+profile_enter(struct profile_frame *frame)
+{
+  frame->parent = current_frame;
+  frame->nested = 0;
+  current_frame = frame;
+  frame->start = PROFILE_CURRENT_TIME();
+}
+/*---------------------------------------------------------------------------*/
+void
+profile_exit(struct profile_frame *frame, profile_type_t type,
+             uintptr_t key, const char *name)
+{
+  PROFILE_TIME_T elapsed =
+    (PROFILE_TIME_T)(PROFILE_CURRENT_TIME() - frame->start);
+
+  current_frame = frame->parent;
+  if(current_frame != NULL) {
+    current_frame->nested += elapsed;
+  }
+
+  struct profile_entry *e = get_entry(key);
+  if(e == NULL) {
+    dropped++;
+    return;
+  }
+
+  e->type = type;
+  e->name = name;
+  e->calls++;
+  e->time += (PROFILE_TIME_T)(elapsed - frame->nested);
+  if(elapsed > e->max_time) {
+    e->max_time = elapsed;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+profile_reset(void)
+{
+  memset(entries, 0, sizeof(entries));
+  dropped = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+profile_get_entries(const struct profile_entry *sorted[], int max)
+{
+  int count = 0;
+
+  /* Insertion sort into the caller's array, which is short. */
+  for(int i = 0; i < PROFILE_MAX_ENTRIES; i++) {
+    const struct profile_entry *e = &entries[i];
+    if(e->key == 0) {
+      continue;
+    }
+
+    int j = count < max ? count++ : max;
+    while(j > 0 && sorted[j - 1]->time < e->time) {
+      if(j < max) {
+        sorted[j] = sorted[j - 1];
+      }
+      j--;
+    }
+    if(j < max) {
+      sorted[j] = e;
+    }
+  }
+
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+const char *
+profile_type_name(profile_type_t type)
+{
+  switch(type) {
+  case PROFILE_TYPE_PROCESS:
+    return "process";
+  case PROFILE_TYPE_CTIMER:
+    return "ctimer";
+  default:
+    return "handler";
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+profile_dropped(void)
+{
+  return dropped;
+}
+/*---------------------------------------------------------------------------*/
+void
+profile_log(void)
+{
+  const struct profile_entry *sorted[PROFILE_MAX_ENTRIES];
+  int count = profile_get_entries(sorted, PROFILE_MAX_ENTRIES);
+
+  LOG_INFO("%d entries, %"PRIu32" dropped invocations\n", count, dropped);
+  for(int i = 0; i < count; i++) {
+    const struct profile_entry *e = sorted[i];
+    LOG_INFO("%-7s %p %-20s calls %8"PRIu32", time %10"PRIu64
+             " us, max %8"PRIu64" us\n",
+             profile_type_name(e->type), (void *)e->key, e->name != NULL ? e->name : "-", e->calls,
+             e->time * 1000000 / PROFILE_SECOND,
+             (uint64_t)e->max_time * 1000000 / PROFILE_SECOND);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if PROFILE_LOG_PERIOD
+PROCESS_THREAD(profile_process, ev, data)
+{
+  static struct etimer periodic_timer;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&periodic_timer, PROFILE_LOG_PERIOD);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&periodic_timer));
+    etimer_reset(&periodic_timer);
+    profile_log();
+  }
+
+  PROCESS_END();
+}
+#endif /* PROFILE_LOG_PERIOD */
+/*---------------------------------------------------------------------------*/
+void
+profile_init(void)
+{
+  profile_reset();
+  current_frame = NULL;
+#if PROFILE_LOG_PERIOD
+  process_start(&profile_process, NULL);
+#endif /* PROFILE_LOG_PERIOD */
+}
+/*---------------------------------------------------------------------------*/
+#endif /* PROFILE_ON */
+
+/** @} */
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup profile CPU profiler
+ *
+ * The profiler measures how much CPU time is spent in each process,
+ * ctimer callback and instrumented protocol handler. Time is
+ * accumulated in a fixed table, together with the number of
+ * invocations and the longest invocation.
+ *
+ * The time of an entry excludes the time spent in nested profiled
+ * code, such as a process that is called with process_post_synch()
+ * by another process, so that the time of each entry reflects the
+ * code that it runs itself.
+ *
+ * The profiler is disabled by default, and is enabled by setting
+ * PROFILE_CONF_ON to a non-zero value.
+ *
+ * @{
+ */
+
+/**
+ * \file
+ *         Header file for the CPU profiler.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include "contiki.h"
+
+#include <stdint.h>
+
+#ifdef PROFILE_CONF_ON
+#define PROFILE_ON PROFILE_CONF_ON
+#else
+#define PROFILE_ON 0
+#endif /* PROFILE_CONF_ON */
+
+/* The time source of the profiler. Platforms whose rtimer is too
+   coarse for short invocations can provide a finer one. */
+#ifdef PROFILE_CONF_CURRENT_TIME
+#define PROFILE_CURRENT_TIME PROFILE_CONF_CURRENT_TIME
+#define PROFILE_SECOND PROFILE_CONF_SECOND
+#define PROFILE_TIME_T PROFILE_CONF_TIME_T
+#else
+#define PROFILE_CURRENT_TIME RTIMER_NOW
+#define PROFILE_SECOND RTIMER_SECOND
+#define PROFILE_TIME_T rtimer_clock_t
+#endif /* PROFILE_CONF_CURRENT_TIME */
+
+/* The number of entries in the profile table. Must be a power of two. */
+#ifdef PROFILE_CONF_MAX_ENTRIES
+#define PROFILE_MAX_ENTRIES PROFILE_CONF_MAX_ENTRIES
+#else
+#define PROFILE_MAX_ENTRIES 32
+#endif /* PROFILE_CONF_MAX_ENTRIES */
+
+/* If non-zero, the profile table is logged with this period in clock
+   ticks. */
+#ifdef PROFILE_CONF_LOG_PERIOD
+#define PROFILE_LOG_PERIOD PROFILE_CONF_LOG_PERIOD
+#else
+#define PROFILE_LOG_PERIOD 0
+#endif /* PROFILE_CONF_LOG_PERIOD */
+
+typedef enum profile_type {
+  PROFILE_TYPE_PROCESS,
+  PROFILE_TYPE_CTIMER,
+  PROFILE_TYPE_HANDLER,
+} profile_type_t;
+
+/** \brief A profiled process, callback or handler. */
+struct profile_entry {
+  /** The process or function that the entry belongs to. */
+  uintptr_t key;
+  /** The process name, or the name of the process that owns a callback. */
+  const char *name;
+  /** Time spent, excluding nested profiled code. */
+  uint64_t time;
+  /** The longest invocation, including nested profiled code. */
+  PROFILE_TIME_T max_time;
+  uint32_t calls;
+  profile_type_t type;
+};
+
+/** \brief The state of one profiled invocation. */
+struct profile_frame {
+  struct profile_frame *parent;
+  PROFILE_TIME_T start;
+  PROFILE_TIME_T nested;
+};
+
+#if PROFILE_ON
+
+/**
+ * \brief Initialize the profiler.
+ */
+void profile_init(void);
+
+/**
+ * \brief Clear all entries of the profile table.
+ */
+void profile_reset(void);
+
+/**
+ * \brief       Start measuring an invocation.
+ * \param frame The frame of the invocation, typically on the stack.
+ */
+void profile_enter(struct profile_frame *frame);
+
+/**
+ * \brief       Stop measuring an invocation and account for it.
+ * \param frame The frame that was passed to profile_enter().
+ * \param type  The type of code that was invoked.
+ * \param key   The process or function that was invoked.
+ * \param name  A name to show for the entry.
+ */
+void profile_exit(struct profile_frame *frame, profile_type_t type,
+                  uintptr_t key, const char *name);
+
+/**
+ * \brief         Get the profile entries in decreasing order of time.
+ * \param entries An array that will hold pointers to the entries.
+ * \param max     The size of the array.
+ * \return        The number of entries that were stored in the array.
+ */
+int profile_get_entries(const struct profile_entry *entries[], int max);
+
+/**
+ * \brief Get a short name for a profile entry type.
+ */
+const char *profile_type_name(profile_type_t type);
+
+/**
+ * \brief Get the number of invocations that could not be accounted
+ *        for because the profile table was full.
+ */
+uint32_t profile_dropped(void);
+
+/**
+ * \brief Log all profile entries.
+ */
+void profile_log(void);
+
+#define PROFILE_ENTER(frame) profile_enter(frame)
+#define PROFILE_EXIT(frame, type, key, name) \
+  profile_exit((frame), (type), (uintptr_t)(key), (name))
+
+#else /* PROFILE_ON */
+
+static inline void profile_init(void) { }
+
+#define PROFILE_ENTER(frame) ((void)(frame))
+#define PROFILE_EXIT(frame, type, key, name) ((void)(frame))
+
+#endif /* PROFILE_ON */
+
+#endif /* PROFILE_H_ */
+
+/** @} */
+/** @} */
@@ -36,6 +36,7 @@
 #include "lib/circular-list.h"
 #include "lib/dbl-list.h"
 #include "lib/dbl-circ-list.h"
+#include "lib/memb.h"
 #include "lib/random.h"
 #include "services/unit-test/unit-test.h"
 
@@ -1024,6 +1025,64 @@ UNIT_TEST(test_cdll)
   UNIT_TEST_END();
 }
 /*---------------------------------------------------------------------------*/
+#define MEMB_COUNT 4
+MEMB(demo_memb, demo_struct_t, MEMB_COUNT);
+
+UNIT_TEST_REGISTER(test_memb, "Memory block allocation");
+UNIT_TEST(test_memb)
+{
+  demo_struct_t *blocks[MEMB_COUNT];
+  memb_stats_t stats;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  memb_init(&demo_memb);
+  UNIT_TEST_ASSERT(memb_numfree(&demo_memb) == MEMB_COUNT);
+
+  for(i = 0; i < MEMB_COUNT; i++) {
+    blocks[i] = memb_alloc(&demo_memb);
+    UNIT_TEST_ASSERT(blocks[i] != NULL);
+    UNIT_TEST_ASSERT(memb_inmemb(&demo_memb, blocks[i]));
+    UNIT_TEST_ASSERT(memb_numfree(&demo_memb) == MEMB_COUNT - i - 1);
+  }
+  UNIT_TEST_ASSERT(memb_alloc(&demo_memb) == NULL);
+
+  /* Blocks must be distinct and must not overlap. */
+  for(i = 1; i < MEMB_COUNT; i++) {
+    UNIT_TEST_ASSERT((char *)blocks[i] - (char *)blocks[i - 1] >=
+                     (int)sizeof(demo_struct_t) ||
+                     (char *)blocks[i - 1] - (char *)blocks[i] >=
+                     (int)sizeof(demo_struct_t));
+  }
+
+  /* Free a block in the middle and get it back. */
+  UNIT_TEST_ASSERT(memb_free(&demo_memb, blocks[1]) == 0);
+  UNIT_TEST_ASSERT(memb_numfree(&demo_memb) == 1);
+#if MEMB_WITH_USED_FLAGS
+  UNIT_TEST_ASSERT(memb_free(&demo_memb, blocks[1]) == -1);
+#endif /* MEMB_WITH_USED_FLAGS */
+  UNIT_TEST_ASSERT(memb_alloc(&demo_memb) == blocks[1]);
+
+  /* Invalid pointers are rejected. */
+  UNIT_TEST_ASSERT(memb_free(&demo_memb, &elements[0]) == -1);
+  UNIT_TEST_ASSERT(memb_free(&demo_memb, (char *)blocks[0] + 1) == -1);
+
+  for(i = 0; i < MEMB_COUNT; i++) {
+    UNIT_TEST_ASSERT(memb_free(&demo_memb, blocks[i]) == 0);
+  }
+  UNIT_TEST_ASSERT(memb_numfree(&demo_memb) == MEMB_COUNT);
+
+  memb_stats(&demo_memb, &stats);
+  UNIT_TEST_ASSERT(stats.allocated == 0);
+#if MEMB_STATS
+  UNIT_TEST_ASSERT(stats.max_allocated == MEMB_COUNT);
+  UNIT_TEST_ASSERT(stats.failed_allocations == 1);
+#endif /* MEMB_STATS */
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(data_structure_test_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -1039,6 +1098,7 @@ PROCESS_THREAD(data_structure_test_process, ev, data)
   UNIT_TEST_RUN(test_csll);
   UNIT_TEST_RUN(test_dll);
   UNIT_TEST_RUN(test_cdll);
+  UNIT_TEST_RUN(test_memb);
 
   printf("=check-me= DONE\n");
 
@@ -29,7 +29,9 @@
 
 /*
  * \file
- *      A set of unit tests for the heap memory module.
+ *      A set of unit tests for the heap memory module, and a
+ *      throughput benchmark. Build with HEAPMEM_CONF_BINS=0 to compare
+ *      with the allocator without size-class bins.
  * \author
  *      Nicolas Tsiftes <nicolas.tsiftes@ri.se>
  */
@@ -38,6 +40,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "contiki.h"
 #include "lib/heapmem.h"
@@ -66,10 +69,26 @@
 #else
 #define TEST_MAX_SIZE       200
 #endif
+
+/* Number of allocations in the throughput benchmark. */
+#ifdef TEST_CONF_BENCH_LIMIT
+#define TEST_BENCH_LIMIT TEST_CONF_BENCH_LIMIT
+#else
+#define TEST_BENCH_LIMIT  200000
+#endif
 /*****************************************************************************/
 PROCESS(test_heapmem_process, "Heapmem test process");
 AUTOSTART_PROCESSES(&test_heapmem_process);
 /*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
 UNIT_TEST_REGISTER(do_many_allocations, "Many allocations");
 UNIT_TEST(do_many_allocations)
 {
@@ -269,6 +288,119 @@ UNIT_TEST(zero_init_alloc)
   UNIT_TEST_END();
 }
 /*****************************************************************************/
+UNIT_TEST_REGISTER(reuse, "Reuse of freed chunks");
+UNIT_TEST(reuse)
+{
+  UNIT_TEST_BEGIN();
+
+  heapmem_stats_t stats;
+  heapmem_stats(&stats);
+  size_t hits = stats.bin_hits;
+
+  /* The second chunk keeps the first one from being released into
+     the unused heap space when it is freed. */
+  char *ptr1 = heapmem_alloc(40);
+  char *ptr2 = heapmem_alloc(40);
+  UNIT_TEST_ASSERT(ptr1 != NULL);
+  UNIT_TEST_ASSERT(ptr2 != NULL);
+  UNIT_TEST_ASSERT(heapmem_free(ptr1) == true);
+  UNIT_TEST_ASSERT(heapmem_free(ptr1) == false);
+
+  /* A freed chunk of the same size is reused. */
+  char *ptr3 = heapmem_alloc(40);
+  UNIT_TEST_ASSERT(ptr3 == ptr1);
+
+  /* Growing a chunk may absorb a free neighbor, but never one that is
+     kept for reuse in a bin. */
+  char *guard = heapmem_alloc(40);
+  UNIT_TEST_ASSERT(guard != NULL);
+  UNIT_TEST_ASSERT(heapmem_free(ptr2) == true);
+  memset(ptr3, 'a', 40);
+  ptr3 = heapmem_realloc(ptr3, 80);
+  UNIT_TEST_ASSERT(ptr3 != NULL);
+  UNIT_TEST_ASSERT(ptr3[39] == 'a');
+  char *ptr4 = heapmem_alloc(40);
+  UNIT_TEST_ASSERT(ptr4 != NULL);
+  UNIT_TEST_ASSERT(ptr4 + 40 <= ptr3 || ptr4 >= ptr3 + 80);
+
+  UNIT_TEST_ASSERT(heapmem_free(ptr3) == true);
+  UNIT_TEST_ASSERT(heapmem_free(ptr4) == true);
+  UNIT_TEST_ASSERT(heapmem_free(guard) == true);
+
+  heapmem_stats(&stats);
+  UNIT_TEST_ASSERT(stats.allocated == 0);
+#if HEAPMEM_CONF_BINS
+  /* The earlier tests may have left chunks of the same size in the
+     bins, so there may be more hits than the two reuses above. */
+  UNIT_TEST_ASSERT(stats.bin_hits >= hits + 2);
+  UNIT_TEST_ASSERT(stats.binned > 0);
+#else
+  UNIT_TEST_ASSERT(stats.bin_hits == hits);
+#endif
+
+  /* Reading the statistics leaves the bins and the heap as they are. */
+  heapmem_stats_t stats_again;
+  heapmem_stats(&stats_again);
+  UNIT_TEST_ASSERT(stats_again.binned == stats.binned);
+  UNIT_TEST_ASSERT(stats_again.binned_chunks == stats.binned_chunks);
+  UNIT_TEST_ASSERT(stats_again.bin_hits == stats.bin_hits);
+  UNIT_TEST_ASSERT(stats_again.bin_misses == stats.bin_misses);
+  UNIT_TEST_ASSERT(stats_again.footprint == stats.footprint);
+  UNIT_TEST_ASSERT(stats_again.available == stats.available);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(throughput, "Allocation throughput");
+UNIT_TEST(throughput)
+{
+  /* Object sizes typical for protocol messages and block transfers. */
+  static const size_t sizes[] = { 16, 24, 48, 64, 100, 128, 200 };
+  static char *ptrs[TEST_CONCURRENT];
+
+  UNIT_TEST_BEGIN();
+
+  unsigned failed_allocations = 0;
+  unsigned alloc_index = 0;
+  uint64_t start = cpu_time_ns();
+
+  for(unsigned count = 0; count < TEST_BENCH_LIMIT; count++) {
+    /* Free objects in a random order to fragment the heap. */
+    alloc_index = rand() % TEST_CONCURRENT;
+    if(ptrs[alloc_index] != NULL) {
+      heapmem_free(ptrs[alloc_index]);
+    }
+    ptrs[alloc_index] = heapmem_alloc(sizes[rand() % (sizeof(sizes) /
+                                                      sizeof(sizes[0]))]);
+    if(ptrs[alloc_index] == NULL) {
+      failed_allocations++;
+    }
+  }
+
+  uint64_t elapsed = cpu_time_ns() - start;
+
+  heapmem_stats_t stats;
+  heapmem_stats(&stats);
+
+  for(unsigned i = 0; i < TEST_CONCURRENT; i++) {
+    heapmem_free(ptrs[i]);
+    ptrs[i] = NULL;
+  }
+
+  printf("Bins: %d\n", HEAPMEM_CONF_BINS);
+  printf("* %10.0f alloc/free pairs/s\n",
+         TEST_BENCH_LIMIT * 1e9 / (elapsed ? elapsed : 1));
+  printf("* failed allocations %u\n", failed_allocations);
+  printf("* footprint %zu, free chunks %zu, largest free %zu\n",
+         stats.footprint, stats.free_chunks, stats.largest_free);
+  printf("* binned %zu, bin hits %zu, bin misses %zu\n",
+         stats.binned, stats.bin_hits, stats.bin_misses);
+
+  UNIT_TEST_ASSERT(failed_allocations == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
 UNIT_TEST_REGISTER(stats_check, "Heapmem statistics validation");
 UNIT_TEST(stats_check)
 {
@@ -284,8 +416,15 @@ UNIT_TEST(stats_check)
 
   UNIT_TEST_ASSERT(stats.allocated == 0);
   UNIT_TEST_ASSERT(stats.overhead == 0);
+#if HEAPMEM_CONF_BINS
+  /* Freed chunks stay in the bins, which are counted as available. */
+  UNIT_TEST_ASSERT(stats.footprint == 0 || stats.binned_chunks > 0);
+  UNIT_TEST_ASSERT(stats.available >=
+                   HEAPMEM_CONF_ARENA_SIZE - stats.footprint + stats.binned);
+#else
   UNIT_TEST_ASSERT(stats.available == HEAPMEM_CONF_ARENA_SIZE);
   UNIT_TEST_ASSERT(stats.footprint == 0);
+#endif
   UNIT_TEST_ASSERT(stats.max_footprint > stats.available / 2);
   UNIT_TEST_ASSERT(stats.chunks == 0);
 
@@ -335,12 +474,16 @@ PROCESS_THREAD(test_heapmem_process, ev, data)
   UNIT_TEST_RUN(zero_init_alloc);
   UNIT_TEST_RUN(stats_check);
   UNIT_TEST_RUN(zones);
+  UNIT_TEST_RUN(reuse);
+  UNIT_TEST_RUN(throughput);
 
   if(!UNIT_TEST_PASSED(do_many_allocations) ||
      !UNIT_TEST_PASSED(max_alloc) ||
      !UNIT_TEST_PASSED(invalid_freeing) ||
      !UNIT_TEST_PASSED(reallocations) ||
      !UNIT_TEST_PASSED(zero_init_alloc) ||
+     !UNIT_TEST_PASSED(reuse) ||
+     !UNIT_TEST_PASSED(throughput) ||
      !UNIT_TEST_PASSED(stats_check) ||
      !UNIT_TEST_PASSED(zones)) {
     printf("=check-me= FAILED\n");
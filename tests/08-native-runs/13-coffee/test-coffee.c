@@ -42,8 +42,10 @@
 
 #include "unit-test/unit-test.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 /*---------------------------------------------------------------------------*/
 PROCESS(testcoffee_process, "Test CFS/Coffee process");
 AUTOSTART_PROCESSES(&testcoffee_process);
@@ -53,6 +55,52 @@ AUTOSTART_PROCESSES(&testcoffee_process);
 #else
 #define FILE_SIZE	4096
 #endif /* FILE_CONF_SIZE */
+
+/* Number of files in the index test; more than the default index size. */
+#define INDEX_FILES	48
+
+/* Number of files on the storage in the open/create/remove benchmark. */
+#ifdef BENCH_CONF_FILES
+#define BENCH_FILES BENCH_CONF_FILES
+#else
+#define BENCH_FILES	800
+#endif /* BENCH_CONF_FILES */
+
+#ifdef BENCH_CONF_ROUNDS
+#define BENCH_ROUNDS BENCH_CONF_ROUNDS
+#else
+#define BENCH_ROUNDS	4
+#endif /* BENCH_CONF_ROUNDS */
+
+/* Size of the file that is modified and read in random order. */
+#define CACHE_FILE_SIZE	4096
+
+/* Size of the file that is read sequentially in the cache benchmark. */
+#define SEQUENTIAL_SIZE	65536
+
+#ifdef COFFEE_CONF_CACHE_PAGES
+#define BENCH_CACHE_PAGES COFFEE_CONF_CACHE_PAGES
+#else
+#define BENCH_CACHE_PAGES 0
+#endif
+
+#ifdef COFFEE_CONF_LOG_INDEX_CACHE
+#define BENCH_LOG_INDEX_CACHE COFFEE_CONF_LOG_INDEX_CACHE
+#else
+#define BENCH_LOG_INDEX_CACHE 0
+#endif
+
+#if defined(COFFEE_CONF_MICRO_LOGS) && COFFEE_CONF_MICRO_LOGS
+#define BENCH_LOGS "micro logs"
+#else
+#define BENCH_LOGS "no micro logs"
+#endif
+
+#if defined(COFFEE_CONF_RAM_INDEX) && COFFEE_CONF_RAM_INDEX
+#define BENCH_INDEX "RAM index"
+#else
+#define BENCH_INDEX "storage scan"
+#endif
 /*---------------------------------------------------------------------------*/
 static int wfd, rfd, afd;
 /*---------------------------------------------------------------------------*/
@@ -252,6 +300,380 @@ UNIT_TEST(coffee_gc)
   UNIT_TEST_END();
 }
 /*---------------------------------------------------------------------------*/
+/* Coffee determines the size of a file from its last nonzero byte. */
+#define VALUE(i)	(0x5a5a0000 | (i))
+/*---------------------------------------------------------------------------*/
+static int
+read_value(const char *name)
+{
+  int fd;
+  int value;
+
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return -1;
+  }
+  if(cfs_read(fd, &value, sizeof(value)) != sizeof(value)) {
+    value = -1;
+  }
+  cfs_close(fd);
+  return value;
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_value(const char *name, int value)
+{
+  int fd;
+  int r;
+
+  fd = cfs_open(name, CFS_WRITE);
+  if(fd < 0) {
+    return -1;
+  }
+  r = cfs_write(fd, &value, sizeof(value));
+  cfs_close(fd);
+  return r == sizeof(value) ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(coffee_index, "Coffee file lookup and allocation");
+UNIT_TEST(coffee_index)
+{
+  UNIT_TEST_BEGIN();
+
+  struct cfs_dir dir;
+  struct cfs_dirent dirent;
+  char name[16];
+  int count, filled, refilled;
+  int i;
+
+  UNIT_TEST_ASSERT(cfs_coffee_format() == 0);
+
+  for(i = 0; i < INDEX_FILES; i++) {
+    snprintf(name, sizeof(name), "I%d", i);
+    UNIT_TEST_ASSERT(cfs_coffee_reserve(name, 100 + 300 * (i % 4)) == 0);
+    UNIT_TEST_ASSERT(cfs_coffee_reserve(name, 100) < 0);
+    UNIT_TEST_ASSERT(write_value(name, VALUE(i)) == 0);
+  }
+
+  /* Remove every third file and create it again with the default size. */
+  for(i = 0; i < INDEX_FILES; i += 3) {
+    snprintf(name, sizeof(name), "I%d", i);
+    UNIT_TEST_ASSERT(cfs_remove(name) == 0);
+    UNIT_TEST_ASSERT(cfs_remove(name) < 0);
+    UNIT_TEST_ASSERT(read_value(name) < 0);
+  }
+  for(i = 0; i < INDEX_FILES; i++) {
+    snprintf(name, sizeof(name), "I%d", i);
+    if(i % 3 == 0) {
+      UNIT_TEST_ASSERT(write_value(name, VALUE(INDEX_FILES + i)) == 0);
+    } else {
+      UNIT_TEST_ASSERT(read_value(name) == VALUE(i));
+    }
+  }
+  UNIT_TEST_ASSERT(read_value("I") < 0);
+  UNIT_TEST_ASSERT(read_value("I1x") < 0);
+
+  count = 0;
+  UNIT_TEST_ASSERT(cfs_opendir(&dir, "/") == 0);
+  while(cfs_readdir(&dir, &dirent) == 0) {
+    count++;
+  }
+  cfs_closedir(&dir);
+  UNIT_TEST_ASSERT(count == INDEX_FILES);
+
+  /* Fill the storage, remove the fill and let the garbage collector
+     erase it to fill the storage again. */
+  for(filled = 0;; filled++) {
+    snprintf(name, sizeof(name), "G%d", filled);
+    if(cfs_coffee_reserve(name, 60000) < 0) {
+      break;
+    }
+  }
+  UNIT_TEST_ASSERT(filled > 0);
+  for(i = 0; i < filled; i++) {
+    snprintf(name, sizeof(name), "G%d", i);
+    UNIT_TEST_ASSERT(cfs_remove(name) == 0);
+  }
+  for(refilled = 0; refilled < filled; refilled++) {
+    snprintf(name, sizeof(name), "G%d", refilled);
+    if(cfs_coffee_reserve(name, 60000) < 0) {
+      break;
+    }
+  }
+  /* The pages of the first file that continue from the sector holding
+     the other files stay isolated. */
+  UNIT_TEST_ASSERT(refilled >= filled - 1);
+
+  for(i = 0; i < INDEX_FILES; i++) {
+    snprintf(name, sizeof(name), "I%d", i);
+    UNIT_TEST_ASSERT(read_value(name) ==
+                     VALUE(i % 3 == 0 ? INDEX_FILES + i : i));
+  }
+  for(i = 0; i < refilled; i++) {
+    snprintf(name, sizeof(name), "G%d", i);
+    UNIT_TEST_ASSERT(cfs_remove(name) == 0);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(coffee_bench, "Coffee open, create and remove cost");
+UNIT_TEST(coffee_bench)
+{
+  UNIT_TEST_BEGIN();
+
+  char name[16];
+  uint64_t start, open_time, miss_time, create_time;
+  int fd;
+  int i;
+
+  UNIT_TEST_ASSERT(cfs_coffee_format() == 0);
+
+  for(i = 0; i < BENCH_FILES; i++) {
+    snprintf(name, sizeof(name), "B%d", i);
+    UNIT_TEST_ASSERT(cfs_coffee_reserve(name, 64) == 0);
+  }
+
+  start = cpu_time_ns();
+  for(i = 0; i < BENCH_FILES * BENCH_ROUNDS; i++) {
+    snprintf(name, sizeof(name), "B%d", (int)(random_rand() % BENCH_FILES));
+    fd = cfs_open(name, CFS_READ);
+    UNIT_TEST_ASSERT(fd >= 0);
+    cfs_close(fd);
+  }
+  open_time = cpu_time_ns() - start;
+
+  start = cpu_time_ns();
+  for(i = 0; i < BENCH_FILES * BENCH_ROUNDS; i++) {
+    snprintf(name, sizeof(name), "M%d", i);
+    UNIT_TEST_ASSERT(cfs_open(name, CFS_READ) < 0);
+  }
+  miss_time = cpu_time_ns() - start;
+
+  /* Each cycle leaves an obsolete page, so the garbage collector runs. */
+  start = cpu_time_ns();
+  for(i = 0; i < BENCH_FILES * BENCH_ROUNDS; i++) {
+    snprintf(name, sizeof(name), "C%d", i);
+    UNIT_TEST_ASSERT(cfs_coffee_reserve(name, 64) == 0);
+    UNIT_TEST_ASSERT(cfs_remove(name) == 0);
+  }
+  create_time = cpu_time_ns() - start;
+
+  printf("Coffee with %s, %d files:\n", BENCH_INDEX, BENCH_FILES);
+  printf("* open existing file:   %7.0f ns\n",
+         (double)open_time / (BENCH_FILES * BENCH_ROUNDS));
+  printf("* open missing file:    %7.0f ns\n",
+         (double)miss_time / (BENCH_FILES * BENCH_ROUNDS));
+  printf("* create and remove:    %7.0f ns\n",
+         (double)create_time / (BENCH_FILES * BENCH_ROUNDS));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static unsigned char shadow[CACHE_FILE_SIZE];
+/*---------------------------------------------------------------------------*/
+static int
+check_shadow(const char *name)
+{
+  unsigned char buf[CACHE_FILE_SIZE];
+  int fd;
+  int r;
+
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  r = cfs_read(fd, buf, sizeof(buf));
+  cfs_close(fd);
+  return r == sizeof(buf) && memcmp(buf, shadow, sizeof(buf)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+modify(int fd, unsigned offset, unsigned size)
+{
+  unsigned char buf[32];
+  unsigned i;
+
+  for(i = 0; i < size; i++) {
+    buf[i] = 1 + (random_rand() % 255);
+  }
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+     cfs_write(fd, buf, size) != size) {
+    return 0;
+  }
+  memcpy(&shadow[offset], buf, size);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_shadow(const char *name, unsigned chunk)
+{
+  unsigned offset;
+  int fd;
+
+  fd = cfs_open(name, CFS_WRITE);
+  if(fd < 0) {
+    return 0;
+  }
+  for(offset = 0; offset < CACHE_FILE_SIZE; offset += chunk) {
+    if(!modify(fd, offset, chunk)) {
+      cfs_close(fd);
+      return 0;
+    }
+  }
+  cfs_close(fd);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(coffee_cache, "Coffee reads and writes through the cache");
+UNIT_TEST(coffee_cache)
+{
+  UNIT_TEST_BEGIN();
+
+  unsigned char buf[32];
+  unsigned offset, size;
+  int round, i;
+
+  UNIT_TEST_ASSERT(cfs_coffee_format() == 0);
+  UNIT_TEST_ASSERT(cfs_coffee_reserve("C", CACHE_FILE_SIZE) == 0);
+  UNIT_TEST_ASSERT(cfs_coffee_configure_log("C", CACHE_FILE_SIZE / 4, 64) == 0);
+
+  /* Small appends, then small modifications read back in random order
+     through a second file descriptor. */
+  UNIT_TEST_ASSERT(write_shadow("C", 16));
+  UNIT_TEST_ASSERT(check_shadow("C"));
+  for(round = 0; round < 8; round++) {
+    wfd = cfs_open("C", CFS_READ | CFS_WRITE);
+    rfd = cfs_open("C", CFS_READ);
+    UNIT_TEST_ASSERT(wfd >= 0 && rfd >= 0);
+    for(i = 0; i < 50; i++) {
+      size = 1 + random_rand() % sizeof(buf);
+      offset = random_rand() % (CACHE_FILE_SIZE - size);
+      UNIT_TEST_ASSERT(modify(wfd, offset, size));
+
+      size = 1 + random_rand() % sizeof(buf);
+      offset = random_rand() % (CACHE_FILE_SIZE - size);
+      UNIT_TEST_ASSERT(cfs_seek(rfd, offset, CFS_SEEK_SET) == offset);
+      UNIT_TEST_ASSERT(cfs_read(rfd, buf, size) == size);
+      UNIT_TEST_ASSERT(memcmp(buf, &shadow[offset], size) == 0);
+    }
+    cfs_close(rfd);
+    cfs_close(wfd);
+    UNIT_TEST_ASSERT(check_shadow("C"));
+  }
+  rfd = wfd = -1;
+
+  /* The file is intact after removing other files and collecting garbage. */
+  for(i = 0; i < 20; i++) {
+    UNIT_TEST_ASSERT(cfs_coffee_reserve("D", 60000) == 0);
+    UNIT_TEST_ASSERT(cfs_remove("D") == 0);
+  }
+  UNIT_TEST_ASSERT(check_shadow("C"));
+  UNIT_TEST_ASSERT(cfs_remove("C") == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_stats(const char *name, const cfs_coffee_stats_t *before,
+            uint64_t time, unsigned ops)
+{
+  cfs_coffee_stats_t after;
+  uint32_t hits, misses, log_hits, log_misses;
+
+  cfs_coffee_stats(&after);
+  hits = after.cache_hits - before->cache_hits;
+  misses = after.cache_misses - before->cache_misses;
+  log_hits = after.log_index_hits - before->log_index_hits;
+  log_misses = after.log_index_misses - before->log_index_misses;
+
+  printf("* %-16s %7.0f ns/op, %6lu reads (%7lu bytes), %5lu writes, "
+         "cache %3.0f%%, log index %3.0f%%\n", name, (double)time / ops,
+         (unsigned long)(after.storage_reads - before->storage_reads),
+         (unsigned long)(after.bytes_read - before->bytes_read),
+         (unsigned long)(after.storage_writes - before->storage_writes),
+         hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0,
+         log_hits + log_misses > 0 ?
+         100.0 * log_hits / (log_hits + log_misses) : 0.0);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(coffee_cache_bench, "Coffee cache and storage operations");
+UNIT_TEST(coffee_cache_bench)
+{
+  UNIT_TEST_BEGIN();
+
+  cfs_coffee_stats_t stats;
+  unsigned char buf[32];
+  unsigned offset;
+  uint64_t start;
+  int fd;
+  int i;
+
+  UNIT_TEST_ASSERT(cfs_coffee_format() == 0);
+
+  printf("Coffee with %d cache pages, %d log index entries, %s:\n",
+         BENCH_CACHE_PAGES, BENCH_LOG_INDEX_CACHE, BENCH_LOGS);
+
+  /* Sequential reads of a large file in small chunks */
+  UNIT_TEST_ASSERT(cfs_coffee_reserve("S", SEQUENTIAL_SIZE) == 0);
+  fd = cfs_open("S", CFS_WRITE);
+  UNIT_TEST_ASSERT(fd >= 0);
+  memset(buf, 0x5a, sizeof(buf));
+  for(offset = 0; offset < SEQUENTIAL_SIZE; offset += sizeof(buf)) {
+    UNIT_TEST_ASSERT(cfs_write(fd, buf, sizeof(buf)) == sizeof(buf));
+  }
+  cfs_close(fd);
+
+  cfs_coffee_stats(&stats);
+  start = cpu_time_ns();
+  fd = cfs_open("S", CFS_READ);
+  UNIT_TEST_ASSERT(fd >= 0);
+  for(i = 0; cfs_read(fd, buf, sizeof(buf)) == sizeof(buf); i++);
+  cfs_close(fd);
+  UNIT_TEST_ASSERT(i == SEQUENTIAL_SIZE / sizeof(buf));
+  print_stats("sequential read", &stats, cpu_time_ns() - start, i);
+
+  /* Appends in small chunks */
+  UNIT_TEST_ASSERT(cfs_coffee_reserve("C", CACHE_FILE_SIZE) == 0);
+  UNIT_TEST_ASSERT(cfs_coffee_configure_log("C", CACHE_FILE_SIZE / 2, 64) == 0);
+  cfs_coffee_stats(&stats);
+  start = cpu_time_ns();
+  UNIT_TEST_ASSERT(write_shadow("C", 16));
+  print_stats("append", &stats, cpu_time_ns() - start, CACHE_FILE_SIZE / 16);
+
+  /* Modifications, and random reads of the modified file */
+  fd = cfs_open("C", CFS_READ | CFS_WRITE);
+  UNIT_TEST_ASSERT(fd >= 0);
+  cfs_coffee_stats(&stats);
+  start = cpu_time_ns();
+  for(i = 0; i < 24; i++) {
+    UNIT_TEST_ASSERT(modify(fd, 64 * (random_rand() % (CACHE_FILE_SIZE / 64)), 16));
+  }
+  print_stats("modify", &stats, cpu_time_ns() - start, i);
+
+  cfs_coffee_stats(&stats);
+  start = cpu_time_ns();
+  for(i = 0; i < 2000; i++) {
+    offset = random_rand() % (CACHE_FILE_SIZE - 16);
+    UNIT_TEST_ASSERT(cfs_seek(fd, offset, CFS_SEEK_SET) == offset);
+    UNIT_TEST_ASSERT(cfs_read(fd, buf, 16) == 16);
+    UNIT_TEST_ASSERT(memcmp(buf, &shadow[offset], 16) == 0);
+  }
+  print_stats("random read", &stats, cpu_time_ns() - start, i);
+  cfs_close(fd);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(testcoffee_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -263,6 +685,10 @@ PROCESS_THREAD(testcoffee_process, ev, data)
   UNIT_TEST_RUN(coffee_append);
   UNIT_TEST_RUN(coffee_modify);
   UNIT_TEST_RUN(coffee_gc);
+  UNIT_TEST_RUN(coffee_index);
+  UNIT_TEST_RUN(coffee_bench);
+  UNIT_TEST_RUN(coffee_cache);
+  UNIT_TEST_RUN(coffee_cache_bench);
 
   cfs_close(wfd);
   cfs_close(rfd);
@@ -274,7 +700,11 @@ PROCESS_THREAD(testcoffee_process, ev, data)
   if(!UNIT_TEST_PASSED(coffee_basic_io) ||
      !UNIT_TEST_PASSED(coffee_append) ||
      !UNIT_TEST_PASSED(coffee_modify) ||
-     !UNIT_TEST_PASSED(coffee_gc)) {
+     !UNIT_TEST_PASSED(coffee_gc) ||
+     !UNIT_TEST_PASSED(coffee_index) ||
+     !UNIT_TEST_PASSED(coffee_bench) ||
+     !UNIT_TEST_PASSED(coffee_cache) ||
+     !UNIT_TEST_PASSED(coffee_cache_bench)) {
     printf("=check-me= FAILED\n");
     printf("---\n");
   }
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests and a benchmark for the event timer module. Build
+ *      with ETIMER_CONF_HEAP=0 and ETIMER_CONF_HEAP=1 to compare the
+ *      list and heap backends.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of concurrently active timers in the benchmark. */
+#ifdef TEST_CONF_TIMERS
+#define TEST_TIMERS TEST_CONF_TIMERS
+#else
+#define TEST_TIMERS 10000
+#endif
+
+/* Number of stop/set operations on random active timers. */
+#ifdef TEST_CONF_CHURN
+#define TEST_CHURN TEST_CONF_CHURN
+#else
+#define TEST_CHURN 10000
+#endif
+
+/* All benchmark timers expire within this interval. */
+#define TEST_MAX_INTERVAL (CLOCK_SECOND / 2)
+/*****************************************************************************/
+PROCESS(test_etimer_process, "Etimer test process");
+PROCESS(timer_sink_process, "Etimer sink process");
+PROCESS(short_lived_process, "Short-lived process");
+AUTOSTART_PROCESSES(&test_etimer_process);
+/*****************************************************************************/
+static struct etimer timers[TEST_TIMERS];
+static bool fired[TEST_TIMERS];
+static unsigned fired_count;
+static unsigned bad_events;
+static struct etimer exit_timer;
+/*****************************************************************************/
+static uint64_t
+cpu_time_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*****************************************************************************/
+static clock_time_t
+random_interval(void)
+{
+  return 1 + rand() % TEST_MAX_INTERVAL;
+}
+/*****************************************************************************/
+PROCESS_THREAD(timer_sink_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+
+    struct etimer *et = data;
+    if(et < &timers[0] || et >= &timers[TEST_TIMERS] ||
+       fired[et - timers] || !etimer_expired(et) ||
+       !timer_expired(&et->timer)) {
+      bad_events++;
+      continue;
+    }
+
+    fired[et - timers] = true;
+    if(++fired_count == TEST_TIMERS) {
+      process_poll(&test_etimer_process);
+    }
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(short_lived_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  etimer_set(&exit_timer, 1);
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(next_expiration, "Next expiration time");
+UNIT_TEST(next_expiration)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(!etimer_pending());
+
+  PROCESS_CONTEXT_BEGIN(&timer_sink_process);
+  etimer_set(&timers[0], 300);
+  etimer_set(&timers[1], 100);
+  etimer_set(&timers[2], 200);
+  PROCESS_CONTEXT_END(&timer_sink_process);
+
+  UNIT_TEST_ASSERT(etimer_pending());
+  UNIT_TEST_ASSERT(etimer_next_expiration_time() ==
+                   etimer_expiration_time(&timers[1]));
+
+  etimer_stop(&timers[1]);
+  UNIT_TEST_ASSERT(etimer_expired(&timers[1]));
+  UNIT_TEST_ASSERT(etimer_next_expiration_time() ==
+                   etimer_expiration_time(&timers[2]));
+
+  /* Moving a timer past another must update the next expiration. */
+  etimer_adjust(&timers[2], 200);
+  UNIT_TEST_ASSERT(etimer_next_expiration_time() ==
+                   etimer_expiration_time(&timers[0]));
+
+  /* Restarting a pending timer must not add it twice. */
+  PROCESS_CONTEXT_BEGIN(&timer_sink_process);
+  etimer_restart(&timers[0]);
+  etimer_restart(&timers[0]);
+  etimer_set(&timers[2], 50);
+  PROCESS_CONTEXT_END(&timer_sink_process);
+  UNIT_TEST_ASSERT(etimer_next_expiration_time() ==
+                   etimer_expiration_time(&timers[2]));
+
+  etimer_stop(&timers[2]);
+  etimer_stop(&timers[0]);
+  etimer_stop(&timers[0]);
+  UNIT_TEST_ASSERT(!etimer_pending());
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(process_exit, "Timers of exited processes");
+UNIT_TEST(process_exit)
+{
+  UNIT_TEST_BEGIN();
+
+  PROCESS_CONTEXT_BEGIN(&timer_sink_process);
+  etimer_set(&timers[0], 100);
+  PROCESS_CONTEXT_END(&timer_sink_process);
+
+  /* The process sets a timer and exits immediately. */
+  process_start(&short_lived_process, NULL);
+
+  UNIT_TEST_ASSERT(etimer_next_expiration_time() ==
+                   etimer_expiration_time(&timers[0]));
+
+  etimer_stop(&timers[0]);
+  UNIT_TEST_ASSERT(!etimer_pending());
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Many active timers");
+UNIT_TEST(benchmark)
+{
+  static uint64_t start;
+  static uint64_t set_time;
+  static uint64_t churn_time;
+  static uint64_t expire_time;
+
+  UNIT_TEST_BEGIN();
+
+  start = cpu_time_us();
+  PROCESS_CONTEXT_BEGIN(&timer_sink_process);
+  for(unsigned i = 0; i < TEST_TIMERS; i++) {
+    etimer_set(&timers[i], random_interval());
+  }
+  PROCESS_CONTEXT_END(&timer_sink_process);
+  set_time = cpu_time_us() - start;
+
+  start = cpu_time_us();
+  PROCESS_CONTEXT_BEGIN(&timer_sink_process);
+  for(unsigned i = 0; i < TEST_CHURN; i++) {
+    struct etimer *et = &timers[rand() % TEST_TIMERS];
+    etimer_stop(et);
+    etimer_set(et, random_interval());
+  }
+  PROCESS_CONTEXT_END(&timer_sink_process);
+  churn_time = cpu_time_us() - start;
+
+  /* Let all timers expire, and measure the CPU time spent until the
+     last timer event has been delivered. */
+  start = cpu_time_us();
+  PT_WAIT_UNTIL(&unit_test_pt, fired_count == TEST_TIMERS);
+  expire_time = cpu_time_us() - start;
+
+  printf("Backend: %s, timers: %u\n",
+         ETIMER_HEAP ? "heap" : "list", TEST_TIMERS);
+  printf("* set:    %8lu us\n", (unsigned long)set_time);
+  printf("* churn:  %8lu us (%u stop/set)\n",
+         (unsigned long)churn_time, TEST_CHURN);
+  printf("* expire: %8lu us (CPU time)\n", (unsigned long)expire_time);
+
+  UNIT_TEST_ASSERT(bad_events == 0);
+  UNIT_TEST_ASSERT(!etimer_pending());
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_etimer_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  process_start(&timer_sink_process, NULL);
+
+  UNIT_TEST_RUN(next_expiration);
+  UNIT_TEST_RUN(process_exit);
+  UNIT_TEST_RUN(benchmark);
+
+  if(!UNIT_TEST_PASSED(next_expiration) ||
+     !UNIT_TEST_PASSED(process_exit) ||
+     !UNIT_TEST_PASSED(benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests and a lookup benchmark for the neighbor table. Build
+ *      with NBR_TABLE_CONF_HASH_INDEX=0 and NBR_TABLE_CONF_HASH_INDEX=1
+ *      to compare the linear and the hashed lookups.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of lookups per table size in the benchmark. */
+#ifdef TEST_CONF_LOOKUPS
+#define TEST_LOOKUPS TEST_CONF_LOOKUPS
+#else
+#define TEST_LOOKUPS 200000
+#endif
+/*****************************************************************************/
+PROCESS(test_nbr_table_process, "Neighbor table test process");
+AUTOSTART_PROCESSES(&test_nbr_table_process);
+/*****************************************************************************/
+typedef struct {
+  uint32_t id;
+} test_entry_t;
+
+NBR_TABLE(test_entry_t, test_table);
+
+static unsigned removed_count;
+/*****************************************************************************/
+static void
+make_lladdr(linkaddr_t *lladdr, uint32_t id)
+{
+  int i;
+
+  /* Mimic EUI-64 addresses that only differ in the last bytes. */
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    lladdr->u8[i] = 0x02 + i;
+  }
+  lladdr->u8[LINKADDR_SIZE - 1] = id & 0xff;
+  lladdr->u8[LINKADDR_SIZE - 2] = (id >> 8) & 0xff;
+  lladdr->u8[LINKADDR_SIZE - 3] = (id >> 16) & 0xff;
+}
+/*****************************************************************************/
+static test_entry_t *
+add_neighbor(uint32_t id)
+{
+  linkaddr_t lladdr;
+  test_entry_t *entry;
+
+  make_lladdr(&lladdr, id);
+  entry = nbr_table_add_lladdr(test_table, &lladdr,
+                               NBR_TABLE_REASON_UNDEFINED, NULL);
+  if(entry != NULL) {
+    entry->id = id;
+  }
+  return entry;
+}
+/*****************************************************************************/
+static test_entry_t *
+get_neighbor(uint32_t id)
+{
+  linkaddr_t lladdr;
+
+  make_lladdr(&lladdr, id);
+  return nbr_table_get_from_lladdr(test_table, &lladdr);
+}
+/*****************************************************************************/
+static void
+entry_removed(void *item)
+{
+  removed_count++;
+}
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(add_lookup, "Add and look up neighbors");
+UNIT_TEST(add_lookup)
+{
+  UNIT_TEST_BEGIN();
+
+  nbr_table_clear();
+  UNIT_TEST_ASSERT(nbr_table_count_entries() == 0);
+
+  for(uint32_t id = 0; id < NBR_TABLE_MAX_NEIGHBORS; id++) {
+    UNIT_TEST_ASSERT(add_neighbor(id) != NULL);
+  }
+  UNIT_TEST_ASSERT(nbr_table_count_entries() == NBR_TABLE_MAX_NEIGHBORS);
+
+  for(uint32_t id = 0; id < NBR_TABLE_MAX_NEIGHBORS; id++) {
+    test_entry_t *entry = get_neighbor(id);
+    UNIT_TEST_ASSERT(entry != NULL);
+    UNIT_TEST_ASSERT(entry->id == id);
+  }
+  UNIT_TEST_ASSERT(get_neighbor(NBR_TABLE_MAX_NEIGHBORS) == NULL);
+
+  /* Adding an existing neighbor again must not create a new entry. */
+  UNIT_TEST_ASSERT(add_neighbor(7) == get_neighbor(7));
+  UNIT_TEST_ASSERT(nbr_table_count_entries() == NBR_TABLE_MAX_NEIGHBORS);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(replacement, "Replace neighbors in a full table");
+UNIT_TEST(replacement)
+{
+  UNIT_TEST_BEGIN();
+
+  /* The table is full. Lock all neighbors except a few of them, and
+     replace these with new neighbors. */
+  for(uint32_t id = 0; id < NBR_TABLE_MAX_NEIGHBORS; id++) {
+    if(id % 64 != 5) {
+      nbr_table_lock(test_table, get_neighbor(id));
+    }
+  }
+
+  removed_count = 0;
+  for(uint32_t id = 0; id < NBR_TABLE_MAX_NEIGHBORS / 64; id++) {
+    test_entry_t *entry = add_neighbor(1000 + id);
+    UNIT_TEST_ASSERT(entry != NULL);
+    nbr_table_lock(test_table, entry);
+  }
+  UNIT_TEST_ASSERT(removed_count == NBR_TABLE_MAX_NEIGHBORS / 64);
+  UNIT_TEST_ASSERT(add_neighbor(2000) == NULL);
+
+  for(uint32_t id = 0; id < NBR_TABLE_MAX_NEIGHBORS; id++) {
+    test_entry_t *entry = get_neighbor(id);
+    if(id % 64 != 5) {
+      UNIT_TEST_ASSERT(entry != NULL && entry->id == id);
+    } else {
+      UNIT_TEST_ASSERT(entry == NULL);
+    }
+  }
+  for(uint32_t id = 0; id < NBR_TABLE_MAX_NEIGHBORS / 64; id++) {
+    test_entry_t *entry = get_neighbor(1000 + id);
+    UNIT_TEST_ASSERT(entry != NULL && entry->id == 1000 + id);
+  }
+
+  nbr_table_clear();
+  UNIT_TEST_ASSERT(nbr_table_count_entries() == 0);
+  UNIT_TEST_ASSERT(get_neighbor(0) == NULL);
+  UNIT_TEST_ASSERT(get_neighbor(1000) == NULL);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(lookup_cost, "Lookup cost");
+UNIT_TEST(lookup_cost)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Lookup: %s\n", NBR_TABLE_HASH_INDEX ? "hash index" : "linear");
+
+  for(unsigned count = 8; count <= NBR_TABLE_MAX_NEIGHBORS; count *= 2) {
+    uint64_t start;
+    uint64_t hit_time;
+    uint64_t miss_time;
+    unsigned errors = 0;
+
+    nbr_table_clear();
+    for(uint32_t id = 0; id < count; id++) {
+      UNIT_TEST_ASSERT(add_neighbor(id) != NULL);
+    }
+
+    start = cpu_time_ns();
+    for(unsigned i = 0; i < TEST_LOOKUPS; i++) {
+      if(get_neighbor(rand() % count) == NULL) {
+        errors++;
+      }
+    }
+    hit_time = cpu_time_ns() - start;
+
+    start = cpu_time_ns();
+    for(unsigned i = 0; i < TEST_LOOKUPS; i++) {
+      if(get_neighbor(count + rand() % count) != NULL) {
+        errors++;
+      }
+    }
+    miss_time = cpu_time_ns() - start;
+
+    printf("* %3u neighbors: hit %6.1f ns, miss %6.1f ns\n", count,
+           (double)hit_time / TEST_LOOKUPS, (double)miss_time / TEST_LOOKUPS);
+    UNIT_TEST_ASSERT(errors == 0);
+  }
+
+  nbr_table_clear();
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_nbr_table_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  nbr_table_register(test_table, entry_removed);
+
+  UNIT_TEST_RUN(add_lookup);
+  UNIT_TEST_RUN(replacement);
+  UNIT_TEST_RUN(lookup_cost);
+
+  if(!UNIT_TEST_PASSED(add_lookup) ||
+     !UNIT_TEST_PASSED(replacement) ||
+     !UNIT_TEST_PASSED(lookup_cost)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
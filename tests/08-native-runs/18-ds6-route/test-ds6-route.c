@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests and a forwarding lookup benchmark for the IPv6
+ *      routing table. Build with UIP_DS6_ROUTE_CONF_HASH_INDEX=0 and
+ *      UIP_DS6_ROUTE_CONF_HASH_INDEX=1 to compare the list walk with
+ *      the prefix index.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of lookups per routing table size in the benchmark. */
+#ifdef TEST_CONF_LOOKUPS
+#define TEST_LOOKUPS TEST_CONF_LOOKUPS
+#else
+#define TEST_LOOKUPS 200000
+#endif
+
+/* Number of next-hop neighbors that the routes are spread over. */
+#define TEST_NEXTHOPS 16
+/*****************************************************************************/
+PROCESS(test_ds6_route_process, "IPv6 route test process");
+AUTOSTART_PROCESSES(&test_ds6_route_process);
+/*****************************************************************************/
+static uip_ipaddr_t nexthops[TEST_NEXTHOPS];
+/*****************************************************************************/
+static void
+make_dest(uip_ipaddr_t *addr, uint32_t id)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0x0212, 0x4b00,
+              (id >> 16) & 0xffff, id & 0xffff);
+}
+/*****************************************************************************/
+static void
+add_nexthops(void)
+{
+  uip_lladdr_t lladdr;
+
+  for(int i = 0; i < TEST_NEXTHOPS; i++) {
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[0] = 0x02;
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                    NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+}
+/*****************************************************************************/
+static void
+remove_all_routes(void)
+{
+  uip_ds6_route_t *r;
+
+  while((r = uip_ds6_route_head()) != NULL) {
+    uip_ds6_route_rm(r);
+  }
+}
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(longest_match, "Longest prefix match");
+UNIT_TEST(longest_match)
+{
+  uip_ipaddr_t addr;
+  uip_ds6_route_t *host;
+  uip_ds6_route_t *prefix;
+  uip_ds6_route_t *wide;
+
+  UNIT_TEST_BEGIN();
+
+  remove_all_routes();
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 0);
+
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 5);
+  host = uip_ds6_route_add(&addr, 128, &nexthops[0]);
+  UNIT_TEST_ASSERT(host != NULL);
+
+  /* The bits after the prefix length must not matter. */
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0xffff);
+  prefix = uip_ds6_route_add(&addr, 64, &nexthops[1]);
+  UNIT_TEST_ASSERT(prefix != NULL);
+
+  uip_ip6addr(&addr, 0xfd00, 0, 1, 0, 0, 0, 0, 0);
+  wide = uip_ds6_route_add(&addr, 48, &nexthops[2]);
+  UNIT_TEST_ASSERT(wide != NULL);
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 3);
+
+  /* Prefix lengths beyond the address are rejected. */
+  UNIT_TEST_ASSERT(uip_ds6_route_add(&addr, 129, &nexthops[2]) == NULL);
+  UNIT_TEST_ASSERT(uip_ds6_route_add(&addr, 255, &nexthops[2]) == NULL);
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 3);
+
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 5);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == host);
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 6);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == prefix);
+  uip_ip6addr(&addr, 0xfd00, 0, 1, 0x8001, 0, 0, 0, 1);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == wide);
+  uip_ip6addr(&addr, 0xfd00, 0, 2, 0, 0, 0, 0, 1);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == NULL);
+  uip_ip6addr(&addr, 0xfd01, 0, 0, 0, 0, 0, 0, 5);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == NULL);
+  UNIT_TEST_ASSERT(uip_ds6_route_nexthop(host) != NULL);
+  UNIT_TEST_ASSERT(uip_ipaddr_cmp(uip_ds6_route_nexthop(host),
+                                  &nexthops[0]));
+
+  /* Removing the host route exposes the prefix route. */
+  uip_ds6_route_rm(host);
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 5);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == prefix);
+
+  /* Removing all routes of a next hop. */
+  uip_ds6_route_rm_by_nexthop(&nexthops[1]);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == NULL);
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 1);
+
+  remove_all_routes();
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(forwarding, "Forwarding lookups");
+UNIT_TEST(forwarding)
+{
+  static const unsigned sizes[] = { 16, 256, 1024 };
+  uip_ipaddr_t addr;
+
+  UNIT_TEST_BEGIN();
+
+  printf("Route lookup: %s\n",
+         UIP_DS6_ROUTE_HASH_INDEX ? "prefix index" : "list");
+
+  for(unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    unsigned count = sizes[s];
+    unsigned errors = 0;
+    uint64_t start;
+    uint64_t elapsed;
+
+    remove_all_routes();
+    for(uint32_t id = 0; id < count; id++) {
+      make_dest(&addr, id);
+      if(uip_ds6_route_add(&addr, 128,
+                           &nexthops[id % TEST_NEXTHOPS]) == NULL) {
+        errors++;
+      }
+    }
+    UNIT_TEST_ASSERT(errors == 0);
+    UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == count);
+
+    start = cpu_time_ns();
+    for(unsigned i = 0; i < TEST_LOOKUPS; i++) {
+      uint32_t id = rand() % count;
+      make_dest(&addr, id);
+      uip_ds6_route_t *r = uip_ds6_route_lookup(&addr);
+      if(r == NULL || r->length != 128) {
+        errors++;
+      }
+    }
+    elapsed = cpu_time_ns() - start;
+
+    printf("* %4u routes: %10.0f lookups/s\n", count,
+           TEST_LOOKUPS * 1e9 / (elapsed ? elapsed : 1));
+    UNIT_TEST_ASSERT(errors == 0);
+  }
+
+  remove_all_routes();
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_ds6_route_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  add_nexthops();
+
+  UNIT_TEST_RUN(longest_match);
+  UNIT_TEST_RUN(forwarding);
+
+  if(!UNIT_TEST_PASSED(longest_match) ||
+     !UNIT_TEST_PASSED(forwarding)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
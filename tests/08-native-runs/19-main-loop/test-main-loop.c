@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests and a benchmark for the main loop of the native
+ *      platform. Build with SELECT_CONF_EPOLL=0 and SELECT_CONF_EPOLL=1
+ *      to compare the select and epoll backends.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "contiki.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of timer wakeups to measure. */
+#define TEST_WAKEUPS 20
+
+/* Number of registered file descriptors that never become ready. */
+#ifdef TEST_CONF_IDLE_PIPES
+#define TEST_IDLE_PIPES TEST_CONF_IDLE_PIPES
+#else
+#define TEST_IDLE_PIPES 200
+#endif
+
+/* Number of bytes passed through the active pipe. */
+#ifdef TEST_CONF_ROUNDS
+#define TEST_ROUNDS TEST_CONF_ROUNDS
+#else
+#define TEST_ROUNDS 20000
+#endif
+
+#ifdef SELECT_CONF_EPOLL
+#define TEST_BACKEND (SELECT_CONF_EPOLL ? "epoll" : "select")
+#else
+#define TEST_BACKEND "default"
+#endif
+/*****************************************************************************/
+PROCESS(test_main_loop_process, "Main loop test process");
+AUTOSTART_PROCESSES(&test_main_loop_process);
+/*****************************************************************************/
+static struct etimer et;
+
+static int null_fd = -1;
+static unsigned null_reads;
+
+static int active_pipe[2] = { -1, -1 };
+static unsigned active_rounds;
+static unsigned active_errors;
+static unsigned write_ready;
+
+static int idle_fds[TEST_IDLE_PIPES][2];
+
+static int reused_pipe[2] = { -1, -1 };
+static unsigned reused_wants_write;
+static unsigned reused_reads;
+/*****************************************************************************/
+static uint64_t
+time_us(clockid_t clock_id)
+{
+  struct timespec ts;
+
+  clock_gettime(clock_id, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*****************************************************************************/
+/* /dev/null is always readable. */
+static int
+null_set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(null_fd, rset);
+  return 1;
+}
+static void
+null_handle_fd(fd_set *rset, fd_set *wset)
+{
+  char c;
+
+  if(FD_ISSET(null_fd, rset) && read(null_fd, &c, 1) == 0) {
+    if(++null_reads == 10) {
+      select_set_callback(null_fd, NULL);
+      process_poll(&test_main_loop_process);
+    }
+  }
+}
+static const struct select_callback null_callback = {
+  null_set_fd, null_handle_fd
+};
+/*****************************************************************************/
+/* Passes a byte through the active pipe in each main loop round. */
+static int
+active_set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(active_pipe[0], rset);
+  return 1;
+}
+static void
+active_handle_fd(fd_set *rset, fd_set *wset)
+{
+  char c;
+
+  if(FD_ISSET(active_pipe[0], rset)) {
+    if(read(active_pipe[0], &c, 1) != 1 || c != (char)active_rounds) {
+      active_errors++;
+    }
+    if(++active_rounds < TEST_ROUNDS) {
+      c = active_rounds;
+      if(write(active_pipe[1], &c, 1) != 1) {
+        active_errors++;
+      }
+    } else {
+      process_poll(&test_main_loop_process);
+    }
+  }
+}
+static const struct select_callback active_callback = {
+  active_set_fd, active_handle_fd
+};
+/*****************************************************************************/
+/* The write end of the active pipe is only monitored until it has been
+   found writable. */
+static int
+writer_set_fd(fd_set *rset, fd_set *wset)
+{
+  if(write_ready == 0) {
+    FD_SET(active_pipe[1], wset);
+    return 1;
+  }
+  return 0;
+}
+static void
+writer_handle_fd(fd_set *rset, fd_set *wset)
+{
+  if(FD_ISSET(active_pipe[1], wset)) {
+    if(write_ready++ != 0) {
+      active_errors++;
+    }
+  }
+}
+static const struct select_callback writer_callback = {
+  writer_set_fd, writer_handle_fd
+};
+/*****************************************************************************/
+/* One callback is registered for all idle pipes. It is called once per
+   registered descriptor, so it only fills in the set the first time. */
+static int
+idle_set_fd(fd_set *rset, fd_set *wset)
+{
+  if(!FD_ISSET(idle_fds[0][0], rset)) {
+    for(int i = 0; i < TEST_IDLE_PIPES; i++) {
+      FD_SET(idle_fds[i][0], rset);
+    }
+  }
+  return 1;
+}
+static void
+idle_handle_fd(fd_set *rset, fd_set *wset)
+{
+}
+static const struct select_callback idle_callback = {
+  idle_set_fd, idle_handle_fd
+};
+/*****************************************************************************/
+/* The read end of a pipe, which is also monitored for writing until the
+   descriptor has been replaced. */
+static int
+reused_set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(reused_pipe[0], rset);
+  if(reused_wants_write) {
+    FD_SET(reused_pipe[0], wset);
+  }
+  return 1;
+}
+static void
+reused_handle_fd(fd_set *rset, fd_set *wset)
+{
+  char c;
+
+  if(FD_ISSET(reused_pipe[0], rset) && read(reused_pipe[0], &c, 1) == 1) {
+    reused_reads++;
+    process_poll(&test_main_loop_process);
+  }
+}
+static const struct select_callback reused_callback = {
+  reused_set_fd, reused_handle_fd
+};
+/*****************************************************************************/
+UNIT_TEST_REGISTER(timer_wakeup, "Timer wakeup latency");
+UNIT_TEST(timer_wakeup)
+{
+  static unsigned round;
+  static uint64_t start;
+  static uint64_t latency;
+  static uint64_t max_latency;
+  uint64_t elapsed;
+
+  UNIT_TEST_BEGIN();
+
+  latency = 0;
+  max_latency = 0;
+  for(round = 0; round < TEST_WAKEUPS; round++) {
+    start = time_us(CLOCK_MONOTONIC);
+    etimer_set(&et, CLOCK_SECOND / 100);
+    PT_WAIT_UNTIL(&unit_test_pt, etimer_expired(&et));
+
+    /* The time past the requested interval. */
+    elapsed = time_us(CLOCK_MONOTONIC) - start;
+    elapsed = elapsed > 10000 ? elapsed - 10000 : 0;
+    latency += elapsed;
+    if(elapsed > max_latency) {
+      max_latency = elapsed;
+    }
+  }
+
+  printf("Timer wakeup latency: average %lu us, max %lu us\n",
+         (unsigned long)(latency / TEST_WAKEUPS),
+         (unsigned long)max_latency);
+  UNIT_TEST_ASSERT(latency / TEST_WAKEUPS < 50000);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(idle_cpu, "CPU time while idle");
+UNIT_TEST(idle_cpu)
+{
+  static uint64_t start;
+  uint64_t cpu_time;
+
+  UNIT_TEST_BEGIN();
+
+  start = time_us(CLOCK_PROCESS_CPUTIME_ID);
+  etimer_set(&et, CLOCK_SECOND / 2);
+  PT_WAIT_UNTIL(&unit_test_pt, etimer_expired(&et));
+  cpu_time = time_us(CLOCK_PROCESS_CPUTIME_ID) - start;
+
+  printf("CPU time while idle for 500 ms: %lu us\n", (unsigned long)cpu_time);
+  UNIT_TEST_ASSERT(cpu_time < 100000);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(always_ready, "Descriptors that are always ready");
+UNIT_TEST(always_ready)
+{
+  UNIT_TEST_BEGIN();
+
+  null_fd = open("/dev/null", O_RDONLY);
+  UNIT_TEST_ASSERT(null_fd >= 0);
+  UNIT_TEST_ASSERT(select_set_callback(null_fd, &null_callback));
+
+  PT_WAIT_UNTIL(&unit_test_pt, null_reads >= 10);
+  UNIT_TEST_ASSERT(null_reads == 10);
+
+  close(null_fd);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(reused_fd, "Descriptor number reused while monitored");
+UNIT_TEST(reused_fd)
+{
+  int other_pipe[2];
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(pipe(reused_pipe) == 0);
+  reused_wants_write = 1;
+  UNIT_TEST_ASSERT(select_set_callback(reused_pipe[0], &reused_callback));
+  etimer_set(&et, CLOCK_SECOND / 100);
+  PT_WAIT_UNTIL(&unit_test_pt, etimer_expired(&et));
+
+  /* Replace the descriptor behind the callback. Closing the old pipe
+     removes it from epoll, while the callback now asks for other
+     events on the same descriptor number. */
+  UNIT_TEST_ASSERT(pipe(other_pipe) == 0);
+  UNIT_TEST_ASSERT(dup2(other_pipe[0], reused_pipe[0]) == reused_pipe[0]);
+  close(other_pipe[0]);
+  close(reused_pipe[1]);
+  reused_pipe[1] = other_pipe[1];
+  reused_wants_write = 0;
+
+  UNIT_TEST_ASSERT(write(reused_pipe[1], "x", 1) == 1);
+  etimer_set(&et, CLOCK_SECOND / 2);
+  PT_WAIT_UNTIL(&unit_test_pt, reused_reads > 0 || etimer_expired(&et));
+  UNIT_TEST_ASSERT(reused_reads == 1);
+
+  select_set_callback(reused_pipe[0], NULL);
+  close(reused_pipe[0]);
+  close(reused_pipe[1]);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(many_fds, "Many monitored descriptors");
+UNIT_TEST(many_fds)
+{
+  static uint64_t start_cpu;
+  static uint64_t start_wall;
+  uint64_t cpu_time;
+  uint64_t wall_time;
+  char c = 0;
+
+  UNIT_TEST_BEGIN();
+
+  for(int i = 0; i < TEST_IDLE_PIPES; i++) {
+    UNIT_TEST_ASSERT(pipe(idle_fds[i]) == 0);
+    UNIT_TEST_ASSERT(select_set_callback(idle_fds[i][0], &idle_callback));
+  }
+
+  UNIT_TEST_ASSERT(pipe(active_pipe) == 0);
+  UNIT_TEST_ASSERT(select_set_callback(active_pipe[0], &active_callback));
+  UNIT_TEST_ASSERT(select_set_callback(active_pipe[1], &writer_callback));
+  UNIT_TEST_ASSERT(!select_set_callback(-1, &active_callback));
+
+  start_cpu = time_us(CLOCK_PROCESS_CPUTIME_ID);
+  start_wall = time_us(CLOCK_MONOTONIC);
+  UNIT_TEST_ASSERT(write(active_pipe[1], &c, 1) == 1);
+  PT_WAIT_UNTIL(&unit_test_pt, active_rounds >= TEST_ROUNDS);
+  cpu_time = time_us(CLOCK_PROCESS_CPUTIME_ID) - start_cpu;
+  wall_time = time_us(CLOCK_MONOTONIC) - start_wall;
+
+  printf("Backend: %s, %u idle descriptors\n",
+         TEST_BACKEND, TEST_IDLE_PIPES);
+  printf("* %u rounds: %.2f us CPU, %.2f us wall per round\n", TEST_ROUNDS,
+         (double)cpu_time / TEST_ROUNDS, (double)wall_time / TEST_ROUNDS);
+
+  UNIT_TEST_ASSERT(active_rounds == TEST_ROUNDS);
+  UNIT_TEST_ASSERT(active_errors == 0);
+  UNIT_TEST_ASSERT(write_ready == 1);
+
+  select_set_callback(active_pipe[0], NULL);
+  select_set_callback(active_pipe[1], NULL);
+  close(active_pipe[0]);
+  close(active_pipe[1]);
+  for(int i = 0; i < TEST_IDLE_PIPES; i++) {
+    select_set_callback(idle_fds[i][0], NULL);
+    close(idle_fds[i][0]);
+    close(idle_fds[i][1]);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_main_loop_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(timer_wakeup);
+  UNIT_TEST_RUN(idle_cpu);
+  UNIT_TEST_RUN(always_ready);
+  UNIT_TEST_RUN(reused_fd);
+  UNIT_TEST_RUN(many_fds);
+
+  if(!UNIT_TEST_PASSED(timer_wakeup) ||
+     !UNIT_TEST_PASSED(idle_cpu) ||
+     !UNIT_TEST_PASSED(always_ready) ||
+     !UNIT_TEST_PASSED(reused_fd) ||
+     !UNIT_TEST_PASSED(many_fds)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Packet rate benchmark for the tun6 network driver. The host sends
+ *      UDP datagrams to the node through the tun device. Build with
+ *      TUN6_NET_CONF_INPUT_BATCH=1 to compare with reading a single
+ *      packet per main loop round. Needs permission to open the tun
+ *      device, and is skipped otherwise.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "contiki.h"
+#include "net/ipv6/simple-udp.h"
+#include "net/ipv6/uip-ds6.h"
+#include "tun6-net.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of datagrams sent to the node. */
+#ifdef TEST_CONF_PACKETS
+#define TEST_PACKETS TEST_CONF_PACKETS
+#else
+#define TEST_PACKETS 50000
+#endif
+
+/* Datagrams sent at a time, fewer than the tun device queue holds. */
+#define TEST_BURST 64
+
+#ifdef TUN6_NET_CONF_INPUT_BATCH
+#define TEST_INPUT_BATCH TUN6_NET_CONF_INPUT_BATCH
+#else
+#define TEST_INPUT_BATCH 0
+#endif
+
+#define TEST_PORT 5678
+#define TEST_PAYLOAD_LEN 64
+/*****************************************************************************/
+PROCESS(test_tun6_process, "Tun6 test process");
+AUTOSTART_PROCESSES(&test_tun6_process);
+/*****************************************************************************/
+static struct simple_udp_connection conn;
+static struct etimer et;
+static int host_fd = -1;
+static unsigned sent;
+static unsigned received;
+static unsigned bad_packets;
+/*****************************************************************************/
+static uint64_t
+time_us(clockid_t clock_id)
+{
+  struct timespec ts;
+
+  clock_gettime(clock_id, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*****************************************************************************/
+static void
+udp_rx_callback(struct simple_udp_connection *c,
+                const uip_ipaddr_t *sender_addr,
+                uint16_t sender_port,
+                const uip_ipaddr_t *receiver_addr,
+                uint16_t receiver_port,
+                const uint8_t *data,
+                uint16_t datalen)
+{
+  if(datalen != TEST_PAYLOAD_LEN) {
+    bad_packets++;
+  }
+  if(++received == sent) {
+    process_poll(&test_tun6_process);
+  }
+}
+/*****************************************************************************/
+/* Opens a host socket that sends through the tun device. */
+static int
+open_host_socket(void)
+{
+  const char *tun_name = tun6_net_get_tun_name();
+  int fd;
+
+  fd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if(fd == -1) {
+    return -1;
+  }
+  if(setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE,
+                tun_name, strlen(tun_name)) == -1) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(input_rate, "Tun input packet rate");
+UNIT_TEST(input_rate)
+{
+  static struct sockaddr_in6 node;
+  static uint64_t start_cpu;
+  static uint64_t start_wall;
+  static unsigned lost_bursts;
+  uint8_t payload[TEST_PAYLOAD_LEN];
+  uint64_t cpu_time;
+  uint64_t wall_time;
+  uip_ds6_addr_t *addr;
+
+  UNIT_TEST_BEGIN();
+
+  host_fd = open_host_socket();
+  if(host_fd == -1) {
+    printf("Tun device not available (%s), skipping\n", strerror(errno));
+    UNIT_TEST_SUCCEED();
+  }
+
+  addr = uip_ds6_get_global(ADDR_PREFERRED);
+  UNIT_TEST_ASSERT(addr != NULL);
+
+  memset(&node, 0, sizeof(node));
+  node.sin6_family = AF_INET6;
+  node.sin6_port = htons(TEST_PORT);
+  memcpy(&node.sin6_addr, &addr->ipaddr, sizeof(node.sin6_addr));
+  memset(payload, 0x55, sizeof(payload));
+
+  start_cpu = time_us(CLOCK_PROCESS_CPUTIME_ID);
+  start_wall = time_us(CLOCK_MONOTONIC);
+  lost_bursts = 0;
+  while(sent < TEST_PACKETS && lost_bursts < 10) {
+    for(unsigned i = 0; i < TEST_BURST && sent < TEST_PACKETS; i++) {
+      if(sendto(host_fd, payload, sizeof(payload), 0,
+                (struct sockaddr *)&node, sizeof(node)) != sizeof(payload)) {
+        break;
+      }
+      sent++;
+    }
+
+    etimer_set(&et, CLOCK_SECOND);
+    PT_WAIT_UNTIL(&unit_test_pt, received >= sent || etimer_expired(&et));
+    if(received < sent) {
+      /* Datagrams were dropped on the way. Start over from the current
+         count. */
+      lost_bursts++;
+      sent = received;
+    }
+  }
+  etimer_stop(&et);
+  cpu_time = time_us(CLOCK_PROCESS_CPUTIME_ID) - start_cpu;
+  wall_time = time_us(CLOCK_MONOTONIC) - start_wall;
+
+  if(TEST_INPUT_BATCH > 0) {
+    printf("Input batch: %d packets\n", TEST_INPUT_BATCH);
+  } else {
+    printf("Input batch: default\n");
+  }
+  printf("* %u packets: %.0f packets/s, %.2f us CPU per packet\n",
+         received, received * 1e6 / (wall_time ? wall_time : 1),
+         (double)cpu_time / (received ? received : 1));
+
+  UNIT_TEST_ASSERT(received == TEST_PACKETS);
+  UNIT_TEST_ASSERT(lost_bursts == 0);
+  UNIT_TEST_ASSERT(bad_packets == 0);
+
+  close(host_fd);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_tun6_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  simple_udp_register(&conn, TEST_PORT, NULL, 0, udp_rx_callback);
+
+  UNIT_TEST_RUN(input_rate);
+
+  if(!UNIT_TEST_PASSED(input_rate)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests and a benchmark for the process scheduler. Build with
+ *      PROCESS_CONF_POLL_LIST=0 to compare with polling by scanning all
+ *      processes, and with PROCESS_CONF_PRIORITY_CLASSES=2 and
+ *      PROCESS_CONF_SUBSCRIPTIONS=1 to test these features.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of idle processes in the benchmark. */
+#ifdef TEST_CONF_PROCESSES
+#define TEST_PROCESSES TEST_CONF_PROCESSES
+#else
+#define TEST_PROCESSES 256
+#endif
+
+/* Number of polls and broadcasts in the benchmark. */
+#ifdef TEST_CONF_ROUNDS
+#define TEST_ROUNDS TEST_CONF_ROUNDS
+#else
+#define TEST_ROUNDS 100000
+#endif
+/*****************************************************************************/
+PROCESS(test_process, "Process test process");
+PROCESS(normal_process, "Normal priority process");
+PROCESS(high_process, "High priority process");
+PROCESS(subscriber_process, "Subscriber process");
+PROCESS(cancelling_process, "Cancelling subscriber process");
+AUTOSTART_PROCESSES(&test_process);
+/*****************************************************************************/
+/* The processes that have been called, in order. */
+static struct process *calls[8];
+static unsigned num_calls;
+
+static struct process bench_processes[TEST_PROCESSES];
+static unsigned bench_calls[TEST_PROCESSES];
+
+static struct process_subscription subscription;
+static struct process_subscription cancelling_subscription;
+static process_event_t test_event;
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+static void
+record_call(void)
+{
+  if(num_calls < sizeof(calls) / sizeof(calls[0])) {
+    calls[num_calls] = PROCESS_CURRENT();
+  }
+  num_calls++;
+}
+/*****************************************************************************/
+static void
+run_all(void)
+{
+  /* Run the scheduler from within the test process. Nothing may be
+     posted to the test process meanwhile. */
+  while(process_run() > 0);
+}
+/*****************************************************************************/
+PROCESS_THREAD(normal_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD();
+    if(ev == PROCESS_EVENT_POLL || ev == PROCESS_EVENT_CONTINUE ||
+       ev == test_event) {
+      record_call();
+    }
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(high_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  process_set_priority(PROCESS_CURRENT(), PROCESS_PRIORITY_HIGH);
+
+  while(1) {
+    PROCESS_YIELD();
+    if(ev == PROCESS_EVENT_POLL || ev == PROCESS_EVENT_CONTINUE ||
+       ev == test_event) {
+      record_call();
+    }
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(subscriber_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  process_subscribe(&subscription, PROCESS_CURRENT(), test_event);
+
+  while(1) {
+    PROCESS_YIELD();
+    if(ev == test_event) {
+      record_call();
+    } else if(ev == PROCESS_EVENT_CONTINUE) {
+      break;
+    }
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(cancelling_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  process_subscribe(&cancelling_subscription, PROCESS_CURRENT(), test_event);
+
+  while(1) {
+    PROCESS_YIELD();
+    if(ev == test_event) {
+      record_call();
+      /* Remove the subscription that is delivered to next. */
+      process_unsubscribe(&subscription);
+    }
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(bench, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD();
+    bench_calls[(struct process *)PROCESS_CURRENT() - bench_processes]++;
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(polls, "Polls");
+UNIT_TEST(polls)
+{
+  UNIT_TEST_BEGIN();
+
+  num_calls = 0;
+  process_poll(&normal_process);
+  process_poll(&normal_process);
+  process_poll(&high_process);
+  run_all();
+
+  /* A process is polled once, however many times it is requested. */
+  UNIT_TEST_ASSERT(num_calls == 2);
+  if(PROCESS_PRIORITY_CLASSES > 1) {
+    UNIT_TEST_ASSERT(calls[0] == &high_process);
+    UNIT_TEST_ASSERT(calls[1] == &normal_process);
+  } else {
+    UNIT_TEST_ASSERT(calls[0] != calls[1]);
+  }
+
+  /* Processes that have exited are not polled. */
+  num_calls = 0;
+  process_poll(&subscriber_process);
+  process_post_synch(&subscriber_process, PROCESS_EVENT_CONTINUE, NULL);
+  UNIT_TEST_ASSERT(!process_is_running(&subscriber_process));
+  run_all();
+  UNIT_TEST_ASSERT(num_calls == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(events, "Event order");
+UNIT_TEST(events)
+{
+  UNIT_TEST_BEGIN();
+
+  num_calls = 0;
+  UNIT_TEST_ASSERT(process_post(&normal_process, PROCESS_EVENT_CONTINUE,
+                                NULL) == PROCESS_ERR_OK);
+  UNIT_TEST_ASSERT(process_post(&high_process, PROCESS_EVENT_CONTINUE,
+                                NULL) == PROCESS_ERR_OK);
+  UNIT_TEST_ASSERT(process_nevents() >= 2);
+  run_all();
+
+  UNIT_TEST_ASSERT(num_calls == 2);
+  if(PROCESS_PRIORITY_CLASSES > 1) {
+    UNIT_TEST_ASSERT(calls[0] == &high_process);
+    UNIT_TEST_ASSERT(calls[1] == &normal_process);
+  } else {
+    UNIT_TEST_ASSERT(calls[0] == &normal_process);
+    UNIT_TEST_ASSERT(calls[1] == &high_process);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(subscriptions, "Broadcast subscriptions");
+UNIT_TEST(subscriptions)
+{
+  UNIT_TEST_BEGIN();
+
+  process_start(&subscriber_process, NULL);
+
+  num_calls = 0;
+  process_post(PROCESS_BROADCAST, test_event, NULL);
+  run_all();
+
+  if(PROCESS_SUBSCRIPTIONS) {
+    UNIT_TEST_ASSERT(num_calls == 1);
+    UNIT_TEST_ASSERT(calls[0] == &subscriber_process);
+  } else {
+    UNIT_TEST_ASSERT(num_calls == 3);
+  }
+
+  /* The subscription is removed when the process exits. */
+  process_exit(&subscriber_process);
+  num_calls = 0;
+  process_post(PROCESS_BROADCAST, test_event, NULL);
+  run_all();
+  UNIT_TEST_ASSERT(num_calls == 2);
+
+  /* Subscribing again, and unsubscribing. */
+  process_start(&subscriber_process, NULL);
+  process_unsubscribe(&subscription);
+  num_calls = 0;
+  process_post(PROCESS_BROADCAST, test_event, NULL);
+  run_all();
+  UNIT_TEST_ASSERT(num_calls == 3);
+
+  /* A subscriber removes the subscription after its own. */
+  process_start(&cancelling_process, NULL);
+  process_subscribe(&subscription, &subscriber_process, test_event);
+  num_calls = 0;
+  process_post(PROCESS_BROADCAST, test_event, NULL);
+  run_all();
+  if(PROCESS_SUBSCRIPTIONS) {
+    UNIT_TEST_ASSERT(num_calls == 1);
+    UNIT_TEST_ASSERT(calls[0] == &cancelling_process);
+  } else {
+    UNIT_TEST_ASSERT(num_calls == 4);
+  }
+  process_exit(&cancelling_process);
+  process_exit(&subscriber_process);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(full_queue, "Full event queue");
+UNIT_TEST(full_queue)
+{
+  unsigned posted = 0;
+
+  UNIT_TEST_BEGIN();
+
+  while(process_post(&normal_process, PROCESS_EVENT_MSG, NULL) ==
+        PROCESS_ERR_OK) {
+    posted++;
+  }
+  UNIT_TEST_ASSERT(posted > 0 && posted <= PROCESS_CONF_NUMEVENTS);
+  UNIT_TEST_ASSERT(process_post(&normal_process, PROCESS_EVENT_MSG, NULL) ==
+                   PROCESS_ERR_FULL);
+
+#if PROCESS_CONF_STATS
+  UNIT_TEST_ASSERT(process_dropped_events == 2);
+  UNIT_TEST_ASSERT(process_maxevents >= posted);
+#endif /* PROCESS_CONF_STATS */
+
+  if(PROCESS_PRIORITY_CLASSES > 1) {
+    /* Each priority class has its own queue. */
+    UNIT_TEST_ASSERT(process_post(&high_process, PROCESS_EVENT_MSG, NULL) ==
+                     PROCESS_ERR_OK);
+  }
+
+  run_all();
+  UNIT_TEST_ASSERT(process_nevents() == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Many processes");
+UNIT_TEST(benchmark)
+{
+  uint64_t start;
+  uint64_t poll_time;
+  uint64_t broadcast_time;
+  unsigned total = 0;
+
+  UNIT_TEST_BEGIN();
+
+  for(int i = 0; i < TEST_PROCESSES; i++) {
+    memset(&bench_processes[i], 0, sizeof(bench_processes[i]));
+#if !PROCESS_CONF_NO_PROCESS_NAMES
+    bench_processes[i].name = "Benchmark process";
+#endif
+    bench_processes[i].thread = process_thread_bench;
+    process_start(&bench_processes[i], NULL);
+  }
+
+  start = cpu_time_ns();
+  for(int i = 0; i < TEST_ROUNDS; i++) {
+    process_poll(&bench_processes[rand() % TEST_PROCESSES]);
+    process_run();
+  }
+  poll_time = cpu_time_ns() - start;
+
+  for(int i = 0; i < TEST_PROCESSES; i++) {
+    total += bench_calls[i];
+  }
+  UNIT_TEST_ASSERT(total == TEST_ROUNDS);
+
+  /* A broadcast that only one process needs. */
+  process_start(&subscriber_process, NULL);
+  num_calls = 0;
+  start = cpu_time_ns();
+  for(int i = 0; i < TEST_ROUNDS / 10; i++) {
+    process_post(PROCESS_BROADCAST, test_event, NULL);
+    process_run();
+  }
+  broadcast_time = cpu_time_ns() - start;
+  UNIT_TEST_ASSERT(num_calls >= TEST_ROUNDS / 10);
+  process_exit(&subscriber_process);
+
+  printf("Poll list: %s, subscriptions: %s, %u processes\n",
+         PROCESS_POLL_LIST ? "yes" : "no",
+         PROCESS_SUBSCRIPTIONS ? "yes" : "no", TEST_PROCESSES);
+  printf("* poll:      %6.1f ns\n", (double)poll_time / TEST_ROUNDS);
+  printf("* broadcast: %6.1f ns\n", (double)broadcast_time / (TEST_ROUNDS / 10));
+
+  for(int i = 0; i < TEST_PROCESSES; i++) {
+    process_exit(&bench_processes[i]);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  test_event = process_alloc_event();
+  process_start(&normal_process, NULL);
+  process_start(&high_process, NULL);
+  process_start(&subscriber_process, NULL);
+
+  UNIT_TEST_RUN(polls);
+  UNIT_TEST_RUN(events);
+  UNIT_TEST_RUN(subscriptions);
+  UNIT_TEST_RUN(full_queue);
+  UNIT_TEST_RUN(benchmark);
+
+  if(!UNIT_TEST_PASSED(polls) ||
+     !UNIT_TEST_PASSED(events) ||
+     !UNIT_TEST_PASSED(subscriptions) ||
+     !UNIT_TEST_PASSED(full_queue) ||
+     !UNIT_TEST_PASSED(benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests for the CPU profiler, and a measurement of its
+ *      overhead per profiled invocation.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "sys/profile.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of profiled invocations in the overhead measurement. */
+#ifdef TEST_CONF_INVOCATIONS
+#define TEST_INVOCATIONS TEST_CONF_INVOCATIONS
+#else
+#define TEST_INVOCATIONS 1000000
+#endif
+
+/* Busy times of the profiled code, in microseconds. */
+#define OUTER_BUSY_TIME 2000
+#define INNER_BUSY_TIME 5000
+#define CALLBACK_BUSY_TIME 1000
+/*****************************************************************************/
+PROCESS(test_profile_process, "Profile test process");
+PROCESS(outer_process, "Outer process");
+PROCESS(inner_process, "Inner process");
+AUTOSTART_PROCESSES(&test_profile_process);
+/*****************************************************************************/
+static struct ctimer callback_timer;
+static bool callback_done;
+/*****************************************************************************/
+static void
+busy_wait(uint64_t usecs)
+{
+  uint64_t start = clock_usecs();
+
+  while(clock_usecs() - start < usecs);
+}
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+static const struct profile_entry *
+find_entry(uintptr_t key)
+{
+  const struct profile_entry *entries[PROFILE_MAX_ENTRIES];
+  int count = profile_get_entries(entries, PROFILE_MAX_ENTRIES);
+
+  for(int i = 0; i < count; i++) {
+    if(entries[i]->key == key) {
+      return entries[i];
+    }
+  }
+  return NULL;
+}
+/*****************************************************************************/
+static void
+callback(void *ptr)
+{
+  busy_wait(CALLBACK_BUSY_TIME);
+  callback_done = true;
+  process_poll(&test_profile_process);
+}
+/*****************************************************************************/
+PROCESS_THREAD(inner_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    busy_wait(INNER_BUSY_TIME);
+    process_poll(&test_profile_process);
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(outer_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    busy_wait(OUTER_BUSY_TIME);
+    process_post_synch(&inner_process, PROCESS_EVENT_CONTINUE, NULL);
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(nested, "Nested invocations");
+UNIT_TEST(nested)
+{
+  const struct profile_entry *outer;
+  const struct profile_entry *inner;
+
+  UNIT_TEST_BEGIN();
+
+  profile_reset();
+  process_post(&outer_process, PROCESS_EVENT_CONTINUE, NULL);
+  PT_WAIT_UNTIL(&unit_test_pt, find_entry((uintptr_t)&outer_process));
+
+  outer = find_entry((uintptr_t)&outer_process);
+  inner = find_entry((uintptr_t)&inner_process);
+  UNIT_TEST_ASSERT(outer != NULL && inner != NULL);
+  UNIT_TEST_ASSERT(outer->type == PROFILE_TYPE_PROCESS);
+  UNIT_TEST_ASSERT(outer->calls == 1 && inner->calls == 1);
+
+  /* The time of the outer process excludes the inner one, but its
+     longest invocation includes it. */
+  UNIT_TEST_ASSERT(outer->time >= OUTER_BUSY_TIME);
+  UNIT_TEST_ASSERT(outer->max_time - outer->time >= INNER_BUSY_TIME);
+  UNIT_TEST_ASSERT(inner->time >= INNER_BUSY_TIME);
+  UNIT_TEST_ASSERT(outer->max_time >= OUTER_BUSY_TIME + INNER_BUSY_TIME);
+
+  /* The entries are sorted by time. Other processes may have been
+     profiled since the reset, and preemption of the test can add to
+     the time of any entry, so only the order is checked. */
+  const struct profile_entry *entries[PROFILE_CONF_MAX_ENTRIES];
+  int count = profile_get_entries(entries, PROFILE_CONF_MAX_ENTRIES);
+  int found = 0;
+  UNIT_TEST_ASSERT(count >= 2);
+  for(int i = 0; i < count; i++) {
+    UNIT_TEST_ASSERT(i == 0 || entries[i - 1]->time >= entries[i]->time);
+    found += entries[i] == inner || entries[i] == outer;
+  }
+  UNIT_TEST_ASSERT(found == 2);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(callbacks, "Callback timers");
+UNIT_TEST(callbacks)
+{
+  const struct profile_entry *e;
+
+  UNIT_TEST_BEGIN();
+
+  ctimer_set(&callback_timer, 1, callback, NULL);
+  PT_WAIT_UNTIL(&unit_test_pt, callback_done);
+
+  e = find_entry((uintptr_t)callback);
+  UNIT_TEST_ASSERT(e != NULL);
+  UNIT_TEST_ASSERT(e->type == PROFILE_TYPE_CTIMER);
+  UNIT_TEST_ASSERT(e->calls == 1);
+  UNIT_TEST_ASSERT(e->time >= CALLBACK_BUSY_TIME);
+  UNIT_TEST_ASSERT(!strcmp(e->name, PROCESS_NAME_STRING(&test_profile_process)));
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(full_table, "Full profile table");
+UNIT_TEST(full_table)
+{
+  struct profile_frame frame;
+
+  UNIT_TEST_BEGIN();
+
+  profile_reset();
+  for(uintptr_t key = 1; key <= PROFILE_MAX_ENTRIES + 1; key++) {
+    PROFILE_ENTER(&frame);
+    PROFILE_EXIT(&frame, PROFILE_TYPE_HANDLER, key * 64, "Handler");
+  }
+  UNIT_TEST_ASSERT(profile_dropped() == 1);
+  UNIT_TEST_ASSERT(find_entry(64) != NULL);
+  UNIT_TEST_ASSERT(find_entry(64 * PROFILE_MAX_ENTRIES) != NULL);
+
+  profile_reset();
+  UNIT_TEST_ASSERT(profile_dropped() == 0);
+  UNIT_TEST_ASSERT(find_entry(64) == NULL);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(overhead, "Profiling overhead");
+UNIT_TEST(overhead)
+{
+  struct profile_frame outer;
+  struct profile_frame inner;
+
+  UNIT_TEST_BEGIN();
+
+  uint64_t start = cpu_time_ns();
+  PROFILE_ENTER(&outer);
+  for(unsigned i = 0; i < TEST_INVOCATIONS; i++) {
+    PROFILE_ENTER(&inner);
+    PROFILE_EXIT(&inner, PROFILE_TYPE_HANDLER, 64 + (i & 7) * 64, "Handler");
+  }
+  PROFILE_EXIT(&outer, PROFILE_TYPE_HANDLER, 1024, "Outer");
+  uint64_t elapsed = cpu_time_ns() - start;
+
+  printf("Profiled invocation: %.1f ns\n", (double)elapsed / TEST_INVOCATIONS);
+  UNIT_TEST_ASSERT(find_entry(64)->calls == TEST_INVOCATIONS / 8);
+  UNIT_TEST_ASSERT(find_entry(1024)->calls == 1);
+
+  profile_log();
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_profile_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  process_start(&outer_process, NULL);
+  process_start(&inner_process, NULL);
+
+  UNIT_TEST_RUN(nested);
+  UNIT_TEST_RUN(callbacks);
+  UNIT_TEST_RUN(full_table);
+  UNIT_TEST_RUN(overhead);
+
+  if(!UNIT_TEST_PASSED(nested) ||
+     !UNIT_TEST_PASSED(callbacks) ||
+     !UNIT_TEST_PASSED(full_table) ||
+     !UNIT_TEST_PASSED(overhead)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,3 @@
+#!/bin/sh -e
+
+./run-one.sh 23-queuebuf
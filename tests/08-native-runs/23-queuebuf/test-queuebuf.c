@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests for queuebufs that are referenced by the packetbuf,
+ *      and a count of the bytes copied per frame sent through CSMA.
+ *      Build with QUEUEBUF_CONF_REF=0 and QUEUEBUF_CONF_REF=1 to
+ *      compare copying with referencing the queued packets.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/nullnet/nullnet.h"
+#include "dev/radio.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of destinations, and frames sent to each of them. */
+#define TEST_NEIGHBORS 8
+#define TEST_FRAMES_PER_NEIGHBOR 4
+#define TEST_FRAMES (TEST_NEIGHBORS * TEST_FRAMES_PER_NEIGHBOR)
+
+/* No frame is acknowledged, so each one is sent the maximum number of
+   times. */
+#define TEST_TRANSMISSIONS (TEST_FRAMES * (CSMA_CONF_MAX_FRAME_RETRIES + 1))
+/*****************************************************************************/
+PROCESS(test_queuebuf_process, "Queuebuf test process");
+AUTOSTART_PROCESSES(&test_queuebuf_process);
+/*****************************************************************************/
+static struct {
+  uint8_t frame[PACKETBUF_SIZE];
+  uint16_t len;
+} first_tx[TEST_FRAMES];
+static unsigned transmissions;
+static unsigned bad_frames;
+static uint8_t payload[PACKETBUF_SIZE];
+/*****************************************************************************/
+static void
+make_payload(uint8_t *buf, uint8_t id, uint8_t len)
+{
+  buf[0] = id;
+  buf[1] = len;
+  for(int i = 2; i < len; i++) {
+    buf[i] = id + i;
+  }
+}
+/*****************************************************************************/
+static int
+radio_init(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_prepare(const void *frame, unsigned short frame_len)
+{
+  const uint8_t *p;
+  uint8_t id;
+
+  /* The payload is the last part of the frame. */
+  if(frame_len < packetbuf_datalen() || packetbuf_datalen() < 2) {
+    bad_frames++;
+    return 1;
+  }
+  p = (const uint8_t *)frame + frame_len - packetbuf_datalen();
+  id = p[0];
+  make_payload(payload, id, p[1]);
+  if(id >= TEST_FRAMES || p[1] != packetbuf_datalen() ||
+     memcmp(p, payload, p[1]) != 0) {
+    bad_frames++;
+    return 1;
+  }
+
+  /* Every retransmission must be identical to the first transmission. */
+  if(first_tx[id].len == 0) {
+    memcpy(first_tx[id].frame, frame, frame_len);
+    first_tx[id].len = frame_len;
+  } else if(first_tx[id].len != frame_len ||
+            memcmp(first_tx[id].frame, frame, frame_len) != 0) {
+    bad_frames++;
+  }
+  return 1;
+}
+/*****************************************************************************/
+static int
+radio_transmit(unsigned short transmit_len)
+{
+  transmissions++;
+  process_poll(&test_queuebuf_process);
+  return RADIO_TX_OK;
+}
+/*****************************************************************************/
+static int
+radio_send(const void *frame, unsigned short frame_len)
+{
+  radio_prepare(frame, frame_len);
+  return radio_transmit(frame_len);
+}
+/*****************************************************************************/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_channel_clear(void)
+{
+  return 1;
+}
+/*****************************************************************************/
+static int
+radio_receiving_packet(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_pending_packet(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_on(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_off(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_get_value(radio_param_t param, radio_value_t *value)
+{
+  if(param == RADIO_CONST_MAX_PAYLOAD_LEN) {
+    *value = PACKETBUF_SIZE;
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+const struct radio_driver test_radio_driver = {
+  radio_init,
+  radio_prepare,
+  radio_transmit,
+  radio_send,
+  radio_read,
+  radio_channel_clear,
+  radio_receiving_packet,
+  radio_pending_packet,
+  radio_on,
+  radio_off,
+  radio_get_value,
+  radio_set_value,
+  radio_get_object,
+  radio_set_object
+};
+/*****************************************************************************/
+UNIT_TEST_REGISTER(reference, "Reference a queuebuf");
+UNIT_TEST(reference)
+{
+  struct queuebuf *q;
+  struct queuebuf *all[QUEUEBUF_NUM];
+  unsigned allocated;
+
+  UNIT_TEST_BEGIN();
+
+  make_payload(payload, 1, 60);
+  packetbuf_copyfrom(payload, 60);
+  q = queuebuf_new_from_packetbuf();
+  UNIT_TEST_ASSERT(q != NULL);
+
+  /* Headers must not overwrite the queued packet. */
+  queuebuf_to_packetbuf_ref(q);
+  UNIT_TEST_ASSERT(packetbuf_datalen() == 60);
+  UNIT_TEST_ASSERT(packetbuf_hdralloc(20));
+  memset(packetbuf_hdrptr(), 0xaa, 20);
+  UNIT_TEST_ASSERT(packetbuf_totlen() == 80);
+  UNIT_TEST_ASSERT(memcmp(packetbuf_dataptr(), payload, 60) == 0);
+  UNIT_TEST_ASSERT(queuebuf_datalen(q) == 60);
+  UNIT_TEST_ASSERT(memcmp(queuebuf_dataptr(q), payload, 60) == 0);
+
+  /* A header larger than the headroom makes the packetbuf copy the
+     packet. */
+  queuebuf_to_packetbuf_ref(q);
+  UNIT_TEST_ASSERT(packetbuf_hdralloc(PACKETBUF_SIZE - 60));
+  UNIT_TEST_ASSERT(memcmp(packetbuf_dataptr(), payload, 60) == 0);
+  UNIT_TEST_ASSERT(!packetbuf_hdralloc(1));
+  UNIT_TEST_ASSERT(memcmp(queuebuf_dataptr(q), payload, 60) == 0);
+
+  /* The packet stays valid after the queuebuf has been freed. */
+  queuebuf_to_packetbuf_ref(q);
+  queuebuf_free(q);
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+  UNIT_TEST_ASSERT(memcmp(packetbuf_dataptr(), payload, 60) == 0);
+
+  /* All queuebufs can be allocated while the packetbuf holds the last
+     reference to freed data. */
+  for(allocated = 0; allocated < QUEUEBUF_NUM; allocated++) {
+    all[allocated] = queuebuf_new_from_packetbuf();
+    if(all[allocated] == NULL) {
+      break;
+    }
+  }
+  UNIT_TEST_ASSERT(allocated == QUEUEBUF_NUM);
+  UNIT_TEST_ASSERT(memcmp(queuebuf_dataptr(all[QUEUEBUF_NUM - 1]),
+                          payload, 60) == 0);
+  for(unsigned i = 0; i < allocated; i++) {
+    queuebuf_free(all[i]);
+  }
+  packetbuf_clear();
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(csma_tx, "Send frames through CSMA");
+UNIT_TEST(csma_tx)
+{
+  static uint32_t copied;
+  static uint8_t buf[PACKETBUF_SIZE];
+  linkaddr_t dest;
+
+  UNIT_TEST_BEGIN();
+
+  copied = queuebuf_copied_bytes;
+  nullnet_buf = buf;
+  for(unsigned i = 0; i < TEST_FRAMES; i++) {
+    memset(&dest, 0, sizeof(dest));
+    dest.u8[0] = 0x02;
+    dest.u8[LINKADDR_SIZE - 1] = 1 + i % TEST_NEIGHBORS;
+    nullnet_len = 10 + (i * 13) % 80;
+    make_payload(buf, i, nullnet_len);
+    NETSTACK_NETWORK.output(&dest);
+  }
+
+  PT_WAIT_UNTIL(&unit_test_pt, transmissions >= TEST_TRANSMISSIONS &&
+                queuebuf_numfree() == QUEUEBUF_NUM);
+  copied = queuebuf_copied_bytes - copied;
+
+  printf("Queuebuf: %s\n", QUEUEBUF_REF ? "reference" : "copy");
+  printf("* %u frames, %u transmissions\n", TEST_FRAMES, transmissions);
+  printf("* %lu bytes copied per frame\n",
+         (unsigned long)(copied / TEST_FRAMES));
+
+  UNIT_TEST_ASSERT(transmissions == TEST_TRANSMISSIONS);
+  UNIT_TEST_ASSERT(bad_frames == 0);
+  for(unsigned i = 0; i < TEST_FRAMES; i++) {
+    UNIT_TEST_ASSERT(first_tx[i].len > 0);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_queuebuf_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(reference);
+  UNIT_TEST_RUN(csma_tx);
+
+  if(!UNIT_TEST_PASSED(reference) ||
+     !UNIT_TEST_PASSED(csma_tx)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
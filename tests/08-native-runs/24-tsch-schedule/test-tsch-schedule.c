@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests and a lookup benchmark for the TSCH schedule. Build
+ *      with TSCH_SCHEDULE_CONF_INDEX=0 and TSCH_SCHEDULE_CONF_INDEX=1 to
+ *      compare the walk over all links with the per-slotframe index.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of lookups per schedule size in the benchmark. */
+#ifdef TEST_CONF_LOOKUPS
+#define TEST_LOOKUPS TEST_CONF_LOOKUPS
+#else
+#define TEST_LOOKUPS 200000
+#endif
+
+/* Number of random schedules checked against a full scan. */
+#define TEST_RANDOM_SCHEDULES 50
+/*****************************************************************************/
+PROCESS(test_tsch_schedule_process, "TSCH schedule test process");
+AUTOSTART_PROCESSES(&test_tsch_schedule_process);
+/*****************************************************************************/
+/* Stubs for the parts of TSCH that the schedule depends on. TSCH itself
+   does not run on native. */
+const linkaddr_t tsch_broadcast_address = { { 0xff, 0xff, 0xff, 0xff,
+                                              0xff, 0xff, 0xff, 0xff } };
+struct tsch_link *current_link;
+static int locked;
+
+int
+tsch_is_locked(void)
+{
+  return locked;
+}
+
+int
+tsch_get_lock(void)
+{
+  if(locked) {
+    return 0;
+  }
+  locked = 1;
+  return 1;
+}
+
+void
+tsch_release_lock(void)
+{
+  locked = 0;
+}
+
+struct tsch_neighbor *
+tsch_queue_add_nbr(const linkaddr_t *addr)
+{
+  return NULL;
+}
+
+struct tsch_neighbor *
+tsch_queue_get_nbr(const linkaddr_t *addr)
+{
+  return NULL;
+}
+/*****************************************************************************/
+static void
+make_lladdr(linkaddr_t *lladdr, unsigned id)
+{
+  memset(lladdr, 0, sizeof(*lladdr));
+  lladdr->u8[0] = 0x02;
+  lladdr->u8[LINKADDR_SIZE - 1] = id & 0xff;
+  lladdr->u8[LINKADDR_SIZE - 2] = (id >> 8) & 0xff;
+}
+/*****************************************************************************/
+static struct tsch_link *
+add_link(struct tsch_slotframe *sf, uint8_t options, unsigned nbr,
+         uint16_t timeslot, uint16_t channel_offset, uint8_t do_remove)
+{
+  linkaddr_t lladdr;
+
+  make_lladdr(&lladdr, nbr);
+  return tsch_schedule_add_link(sf, options, LINK_TYPE_NORMAL, &lladdr,
+                                timeslot, channel_offset, do_remove);
+}
+/*****************************************************************************/
+static struct tsch_link *
+next_link(uint32_t asn_ls4b, uint16_t *offset, struct tsch_link **backup)
+{
+  struct tsch_asn_t asn;
+
+  TSCH_ASN_INIT(asn, 0, asn_ls4b);
+  return tsch_schedule_get_next_active_link(&asn, offset, backup);
+}
+/*****************************************************************************/
+/* Returns the distance from an ASN to the next occurrence of a link */
+static uint16_t
+link_distance(struct tsch_slotframe *sf, struct tsch_link *l, uint32_t asn_ls4b)
+{
+  uint16_t timeslot = asn_ls4b % sf->size.val;
+
+  return l->timeslot > timeslot ?
+    l->timeslot - timeslot : sf->size.val + l->timeslot - timeslot;
+}
+/*****************************************************************************/
+/* Checks the selected link against a scan of the whole schedule. */
+static int
+check_next_link(uint32_t asn_ls4b)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *best;
+  struct tsch_link *backup;
+  struct tsch_slotframe *best_sf = NULL;
+  uint16_t offset;
+  uint16_t min_distance = 0xffff;
+  int tx_at_min = 0;
+
+  best = next_link(asn_ls4b, &offset, &backup);
+
+  for(sf = tsch_schedule_slotframe_head(); sf != NULL;
+      sf = tsch_schedule_slotframe_next(sf)) {
+    struct tsch_link *l;
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      uint16_t distance = link_distance(sf, l, asn_ls4b);
+      if(distance < min_distance) {
+        min_distance = distance;
+        tx_at_min = 0;
+      }
+      if(distance == min_distance && (l->link_options & LINK_OPTION_TX)) {
+        tx_at_min = 1;
+      }
+      if(l == best) {
+        best_sf = sf;
+      }
+    }
+  }
+
+  if(best == NULL || best_sf == NULL || offset != min_distance
+     || link_distance(best_sf, best, asn_ls4b) != min_distance) {
+    return 0;
+  }
+  /* Tx links have precedence */
+  if(tx_at_min != !!(best->link_options & LINK_OPTION_TX)) {
+    return 0;
+  }
+  if(backup != NULL) {
+    struct tsch_slotframe *backup_sf =
+      tsch_schedule_get_slotframe_by_handle(backup->slotframe_handle);
+    if(!(backup->link_options & LINK_OPTION_RX)
+       || link_distance(backup_sf, backup, asn_ls4b) != min_distance) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(selection, "Next active link selection");
+UNIT_TEST(selection)
+{
+  struct tsch_slotframe *sf1;
+  struct tsch_slotframe *sf2;
+  struct tsch_link *rx1;
+  struct tsch_link *rx2;
+  struct tsch_link *tx2;
+  struct tsch_link *first;
+  struct tsch_link *second;
+  struct tsch_link *backup;
+  uint16_t offset;
+  uint16_t handle;
+
+  UNIT_TEST_BEGIN();
+
+  tsch_schedule_remove_all_slotframes();
+  UNIT_TEST_ASSERT(next_link(0, &offset, &backup) == NULL);
+
+  sf1 = tsch_schedule_add_slotframe(1, 10);
+  sf2 = tsch_schedule_add_slotframe(2, 10);
+  UNIT_TEST_ASSERT(sf1 != NULL && sf2 != NULL);
+
+  /* Neither link is Tx: the lowest slotframe handle wins. */
+  rx2 = add_link(sf2, LINK_OPTION_RX, 1, 4, 0, 1);
+  rx1 = add_link(sf1, LINK_OPTION_RX, 1, 4, 1, 1);
+  UNIT_TEST_ASSERT(next_link(0, &offset, &backup) == rx1);
+  UNIT_TEST_ASSERT(offset == 4);
+
+  /* A Tx link wins over an Rx link at the same time, and the Rx link
+     with the lowest slotframe handle is the backup. */
+  tx2 = add_link(sf2, LINK_OPTION_TX, 2, 4, 2, 0);
+  UNIT_TEST_ASSERT(tx2 != NULL);
+  UNIT_TEST_ASSERT(tsch_schedule_get_link_by_timeslot(sf2, 4) == rx2);
+  UNIT_TEST_ASSERT(tsch_schedule_get_link_by_offsets(sf2, 4, 2) == tx2);
+  UNIT_TEST_ASSERT(next_link(0, &offset, &backup) == tx2);
+  UNIT_TEST_ASSERT(offset == 4 && backup == rx1);
+
+  /* An earlier link wins, and the search wraps around the slotframe. */
+  first = add_link(sf1, LINK_OPTION_RX, 3, 1, 0, 1);
+  UNIT_TEST_ASSERT(next_link(0, &offset, &backup) == first);
+  UNIT_TEST_ASSERT(offset == 1 && backup == NULL);
+  UNIT_TEST_ASSERT(next_link(5, &offset, &backup) == first);
+  UNIT_TEST_ASSERT(offset == 6);
+  UNIT_TEST_ASSERT(next_link(4, &offset, &backup) == first);
+  UNIT_TEST_ASSERT(offset == 7);
+
+  /* Two links at the same timeslot of the same slotframe: the first
+     one added is selected and the second one is the backup. */
+  tsch_schedule_remove_link(sf1, first);
+  first = add_link(sf1, LINK_OPTION_RX, 3, 7, 3, 0);
+  second = add_link(sf1, LINK_OPTION_RX, 4, 7, 5, 0);
+  UNIT_TEST_ASSERT(next_link(5, &offset, &backup) == first);
+  UNIT_TEST_ASSERT(offset == 2 && backup == second);
+  UNIT_TEST_ASSERT(tsch_schedule_get_link_by_timeslot(sf1, 7) == first);
+  UNIT_TEST_ASSERT(tsch_schedule_get_link_by_offsets(sf1, 7, 5) == second);
+  UNIT_TEST_ASSERT(tsch_schedule_get_link_by_offsets(sf1, 7, 4) == NULL);
+
+  /* Removed links are no longer selected. */
+  tsch_schedule_remove_link_by_offsets(sf1, 7, 3);
+  UNIT_TEST_ASSERT(next_link(5, &offset, &backup) == second);
+  UNIT_TEST_ASSERT(backup == NULL);
+  tsch_schedule_remove_link(sf1, second);
+  tsch_schedule_remove_link(sf2, tx2);
+  UNIT_TEST_ASSERT(tsch_schedule_get_link_by_timeslot(sf2, 4) == rx2);
+  UNIT_TEST_ASSERT(next_link(5, &offset, &backup) == rx1);
+  UNIT_TEST_ASSERT(offset == 9);
+
+  handle = rx1->handle;
+  UNIT_TEST_ASSERT(tsch_schedule_get_link_by_handle(handle) == rx1);
+  tsch_schedule_remove_all_slotframes();
+  UNIT_TEST_ASSERT(tsch_schedule_get_link_by_handle(handle) == NULL);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(random_schedules, "Random schedules");
+UNIT_TEST(random_schedules)
+{
+  static const uint16_t sizes[] = { 7, 17, 31 };
+  static const uint8_t options[] = {
+    LINK_OPTION_RX, LINK_OPTION_TX, LINK_OPTION_TX | LINK_OPTION_RX,
+    LINK_OPTION_TX | LINK_OPTION_RX | LINK_OPTION_SHARED
+  };
+  unsigned errors = 0;
+
+  UNIT_TEST_BEGIN();
+
+  for(unsigned n = 0; n < TEST_RANDOM_SCHEDULES; n++) {
+    tsch_schedule_remove_all_slotframes();
+    for(unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      struct tsch_slotframe *sf = tsch_schedule_add_slotframe(i, sizes[i]);
+      UNIT_TEST_ASSERT(sf != NULL);
+      for(unsigned j = 0; j < sizes[i] / 2; j++) {
+        add_link(sf, options[rand() % 4], rand() % 8,
+                 rand() % sizes[i], rand() % 4, rand() % 2);
+      }
+      /* Remove a few links again */
+      for(unsigned j = 0; j < sizes[i] / 4; j++) {
+        tsch_schedule_remove_link_by_offsets(sf, rand() % sizes[i],
+                                             rand() % 4);
+      }
+    }
+    for(uint32_t asn = 0; asn < 7 * 17 * 31; asn++) {
+      if(!check_next_link(asn)) {
+        errors++;
+      }
+    }
+  }
+  UNIT_TEST_ASSERT(errors == 0);
+
+  tsch_schedule_remove_all_slotframes();
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(lookup_cost, "Lookup cost");
+UNIT_TEST(lookup_cost)
+{
+  static const unsigned counts[] = { 16, 64, 256 };
+
+  UNIT_TEST_BEGIN();
+
+  printf("Schedule lookup: %s\n", TSCH_SCHEDULE_INDEX ? "index" : "list");
+
+  for(unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    unsigned count = counts[c];
+    struct tsch_slotframe *sf_eb;
+    struct tsch_slotframe *sf_common;
+    struct tsch_slotframe *sf_unicast;
+    struct tsch_asn_t asn;
+    uint64_t start;
+    uint64_t elapsed;
+    unsigned errors = 0;
+
+    /* An Orchestra-like schedule: an EB slotframe, a shared slotframe
+       and a unicast slotframe with one link per neighbor. */
+    tsch_schedule_remove_all_slotframes();
+    sf_eb = tsch_schedule_add_slotframe(0, 397);
+    sf_common = tsch_schedule_add_slotframe(1, 31);
+    sf_unicast = tsch_schedule_add_slotframe(2, 2 * count + 1);
+    tsch_schedule_add_link(sf_eb, LINK_OPTION_TX, LINK_TYPE_ADVERTISING_ONLY,
+                           &tsch_broadcast_address, 0, 0, 1);
+    tsch_schedule_add_link(sf_common,
+                           LINK_OPTION_RX | LINK_OPTION_TX | LINK_OPTION_SHARED,
+                           LINK_TYPE_ADVERTISING, &tsch_broadcast_address,
+                           0, 1, 1);
+    for(unsigned i = 0; i < count - 2; i++) {
+      if(add_link(sf_unicast, LINK_OPTION_RX, i, 2 * i + 1, 2, 1) == NULL) {
+        errors++;
+      }
+    }
+    UNIT_TEST_ASSERT(errors == 0);
+
+    TSCH_ASN_INIT(asn, 0, 0);
+    start = cpu_time_ns();
+    for(unsigned i = 0; i < TEST_LOOKUPS; i++) {
+      uint16_t offset;
+      struct tsch_link *backup;
+      if(tsch_schedule_get_next_active_link(&asn, &offset, &backup) == NULL) {
+        errors++;
+        offset = 1;
+      }
+      TSCH_ASN_INC(asn, offset);
+    }
+    elapsed = cpu_time_ns() - start;
+
+    printf("* %3u links: %6.1f ns per lookup\n", count,
+           (double)elapsed / TEST_LOOKUPS);
+    UNIT_TEST_ASSERT(errors == 0);
+  }
+
+  tsch_schedule_remove_all_slotframes();
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_tsch_schedule_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+
+  UNIT_TEST_RUN(selection);
+  UNIT_TEST_RUN(random_schedules);
+  UNIT_TEST_RUN(lookup_cost);
+
+  if(!UNIT_TEST_PASSED(selection) ||
+     !UNIT_TEST_PASSED(random_schedules) ||
+     !UNIT_TEST_PASSED(lookup_cost)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests and benchmarks for the CSMA neighbor queues. Build
+ *      with CSMA_CONF_NEIGHBOR_HASH_INDEX=0 and =1 to compare the
+ *      neighbor queue lookups, and with CSMA_CONF_BURST_MAX_LEN=0 and
+ *      a larger value to compare the time needed to drain the queues.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/nullnet/nullnet.h"
+#include "net/mac/csma/csma-output.h"
+#include "dev/radio.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of rounds of the benchmarks. */
+#ifdef TEST_CONF_ROUNDS
+#define TEST_ROUNDS TEST_CONF_ROUNDS
+#else
+#define TEST_ROUNDS 50
+#endif
+
+/* Fan-out of the drain benchmark: frames queued to each of a number
+   of neighbors at once. */
+#define TEST_FANOUT_NEIGHBORS 8
+#define TEST_FANOUT_FRAMES 8
+/*****************************************************************************/
+PROCESS(test_csma_process, "CSMA test process");
+AUTOSTART_PROCESSES(&test_csma_process);
+/*****************************************************************************/
+static unsigned transmissions;
+static unsigned sent_ok;
+static unsigned sent_failed;
+static uint8_t last_dsn;
+static int ack_pending;
+static uint8_t payload[64];
+/*****************************************************************************/
+static void
+make_lladdr(linkaddr_t *addr, unsigned id)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->u8[0] = 0x02;
+  addr->u8[LINKADDR_SIZE - 2] = (id >> 8) & 0xff;
+  addr->u8[LINKADDR_SIZE - 1] = id & 0xff;
+}
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+/* A radio driver that acknowledges every frame */
+static int
+radio_init(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_prepare(const void *frame, unsigned short frame_len)
+{
+  last_dsn = ((const uint8_t *)frame)[2];
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_transmit(unsigned short transmit_len)
+{
+  transmissions++;
+  ack_pending = 1;
+  return RADIO_TX_OK;
+}
+/*****************************************************************************/
+static int
+radio_send(const void *frame, unsigned short frame_len)
+{
+  radio_prepare(frame, frame_len);
+  return radio_transmit(frame_len);
+}
+/*****************************************************************************/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  uint8_t *ack = buf;
+
+  if(!ack_pending || buf_len < 3) {
+    return 0;
+  }
+  ack_pending = 0;
+  ack[0] = FRAME802154_ACKFRAME;
+  ack[1] = 0;
+  ack[2] = last_dsn;
+  return 3;
+}
+/*****************************************************************************/
+static int
+radio_channel_clear(void)
+{
+  return 1;
+}
+/*****************************************************************************/
+static int
+radio_receiving_packet(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_pending_packet(void)
+{
+  return ack_pending;
+}
+/*****************************************************************************/
+static int
+radio_on(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_off(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_get_value(radio_param_t param, radio_value_t *value)
+{
+  if(param == RADIO_CONST_MAX_PAYLOAD_LEN) {
+    *value = PACKETBUF_SIZE;
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+const struct radio_driver test_radio_driver = {
+  radio_init,
+  radio_prepare,
+  radio_transmit,
+  radio_send,
+  radio_read,
+  radio_channel_clear,
+  radio_receiving_packet,
+  radio_pending_packet,
+  radio_on,
+  radio_off,
+  radio_get_value,
+  radio_set_value,
+  radio_get_object,
+  radio_set_object
+};
+/*****************************************************************************/
+static void
+packet_sent(void *ptr, int status, int num_tx)
+{
+  if(status == MAC_TX_OK) {
+    sent_ok++;
+  } else {
+    sent_failed++;
+  }
+  process_poll(&test_csma_process);
+}
+/*****************************************************************************/
+static void
+send_to(unsigned id)
+{
+  linkaddr_t dest;
+
+  make_lladdr(&dest, id);
+  packetbuf_clear();
+  packetbuf_copyfrom(payload, sizeof(payload));
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+  NETSTACK_MAC.send(packet_sent, NULL);
+}
+/*****************************************************************************/
+static const struct csma_nbr_stats *
+stats_of(unsigned id)
+{
+  const struct csma_nbr_stats *entries[CSMA_STATS_MAX_NEIGHBORS];
+  linkaddr_t addr;
+  int count;
+
+  make_lladdr(&addr, id);
+  count = csma_output_get_stats(entries, CSMA_STATS_MAX_NEIGHBORS);
+  for(int i = 0; i < count; i++) {
+    if(linkaddr_cmp(&entries[i]->addr, &addr)) {
+      return entries[i];
+    }
+  }
+  return NULL;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(queues, "Neighbor queues");
+UNIT_TEST(queues)
+{
+  static unsigned expected;
+  static unsigned round;
+  const struct csma_nbr_stats *stats;
+
+  UNIT_TEST_BEGIN();
+
+  csma_output_reset_stats();
+  sent_ok = sent_failed = 0;
+
+  /* Interleave the frames of many neighbors, so that neighbor queues
+     are added to and removed from the index in all orders. */
+  expected = 0;
+  for(round = 0; round < 4; round++) {
+    for(unsigned id = 0; id < CSMA_CONF_MAX_NEIGHBOR_QUEUES; id += round + 2) {
+      send_to(id);
+      send_to(id);
+      expected += 2;
+    }
+    PT_WAIT_UNTIL(&unit_test_pt, sent_ok + sent_failed == expected);
+  }
+  UNIT_TEST_ASSERT(sent_failed == 0);
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+
+  /* Each neighbor saw its own two frames in its queue. */
+  stats = stats_of(0);
+  UNIT_TEST_ASSERT(stats != NULL);
+  UNIT_TEST_ASSERT(stats->queued == 8 && stats->packets == 8);
+  UNIT_TEST_ASSERT(stats->failed == 0 && stats->depth_max == 2);
+  stats = stats_of(3);
+  UNIT_TEST_ASSERT(stats != NULL);
+  UNIT_TEST_ASSERT(stats->queued == 2 && stats->packets == 2);
+  UNIT_TEST_ASSERT(stats_of(1) == NULL);
+
+  /* More neighbors than neighbor queues: the last ones are dropped. */
+  sent_ok = sent_failed = 0;
+  for(unsigned id = 0; id <= CSMA_CONF_MAX_NEIGHBOR_QUEUES; id++) {
+    send_to(1000 + id);
+  }
+  PT_WAIT_UNTIL(&unit_test_pt, sent_ok + sent_failed ==
+                CSMA_CONF_MAX_NEIGHBOR_QUEUES + 1);
+  UNIT_TEST_ASSERT(sent_failed == 1);
+
+  csma_output_reset_stats();
+  UNIT_TEST_ASSERT(stats_of(0) == NULL);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(lookup_cost, "Enqueue cost");
+UNIT_TEST(lookup_cost)
+{
+  static const unsigned counts[] = { 8, 32, 64 };
+  static unsigned c;
+  static unsigned round;
+  static uint64_t elapsed;
+
+  UNIT_TEST_BEGIN();
+
+  printf("Neighbor queue lookup: %s\n",
+         CSMA_CONF_NEIGHBOR_HASH_INDEX ? "hash index" : "list");
+
+  for(c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    elapsed = 0;
+    sent_ok = sent_failed = 0;
+    for(round = 0; round < TEST_ROUNDS; round++) {
+      uint64_t start = cpu_time_ns();
+      for(unsigned id = 0; id < counts[c]; id++) {
+        send_to(id);
+      }
+      elapsed += cpu_time_ns() - start;
+      PT_WAIT_UNTIL(&unit_test_pt,
+                    sent_ok + sent_failed == (round + 1) * counts[c]);
+    }
+    printf("* %2u neighbors: %6.1f ns per queued frame\n", counts[c],
+           (double)elapsed / (TEST_ROUNDS * counts[c]));
+    UNIT_TEST_ASSERT(sent_failed == 0);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(fanout, "Fan-out drain time");
+UNIT_TEST(fanout)
+{
+  static unsigned round;
+  static clock_time_t start;
+  static clock_time_t elapsed;
+  static unsigned start_transmissions;
+  uint32_t latency_sum = 0;
+  clock_time_t latency_max = 0;
+
+  UNIT_TEST_BEGIN();
+
+  printf("Burst length: %u\n", CSMA_CONF_BURST_MAX_LEN);
+
+  csma_output_reset_stats();
+  elapsed = 0;
+  sent_ok = sent_failed = 0;
+  start_transmissions = transmissions;
+  for(round = 0; round < TEST_ROUNDS; round++) {
+    start = clock_time();
+    for(unsigned f = 0; f < TEST_FANOUT_FRAMES; f++) {
+      for(unsigned id = 0; id < TEST_FANOUT_NEIGHBORS; id++) {
+        send_to(id);
+      }
+    }
+    PT_WAIT_UNTIL(&unit_test_pt, sent_ok + sent_failed ==
+                  (round + 1) * TEST_FANOUT_NEIGHBORS * TEST_FANOUT_FRAMES);
+    elapsed += clock_time() - start;
+  }
+
+  for(unsigned id = 0; id < TEST_FANOUT_NEIGHBORS; id++) {
+    const struct csma_nbr_stats *stats = stats_of(id);
+    UNIT_TEST_ASSERT(stats != NULL);
+    UNIT_TEST_ASSERT(stats->packets == TEST_ROUNDS * TEST_FANOUT_FRAMES);
+    UNIT_TEST_ASSERT(stats->depth_max == TEST_FANOUT_FRAMES);
+    latency_sum += stats->latency_sum;
+    if(stats->latency_max > latency_max) {
+      latency_max = stats->latency_max;
+    }
+  }
+
+  printf("* %u x %u frames: drained in %.1f ms, latency avg %.1f ms max %u ms\n",
+         TEST_FANOUT_NEIGHBORS, TEST_FANOUT_FRAMES,
+         (double)elapsed * 1000 / CLOCK_SECOND / TEST_ROUNDS,
+         (double)latency_sum * 1000 / CLOCK_SECOND /
+         (TEST_ROUNDS * TEST_FANOUT_NEIGHBORS * TEST_FANOUT_FRAMES),
+         (unsigned)(latency_max * 1000 / CLOCK_SECOND));
+  UNIT_TEST_ASSERT(sent_failed == 0);
+  UNIT_TEST_ASSERT(transmissions - start_transmissions ==
+                   TEST_ROUNDS * TEST_FANOUT_NEIGHBORS * TEST_FANOUT_FRAMES);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_csma_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  for(unsigned i = 0; i < sizeof(payload); i++) {
+    payload[i] = i;
+  }
+
+  UNIT_TEST_RUN(queues);
+  UNIT_TEST_RUN(lookup_cost);
+  UNIT_TEST_RUN(fanout);
+
+  if(!UNIT_TEST_PASSED(queues) ||
+     !UNIT_TEST_PASSED(lookup_cost) ||
+     !UNIT_TEST_PASSED(fanout)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests and a traffic replay benchmark for the MPL multicast
+ *      engine. Build with MPL_CONF_HASH_INDEX=0 and MPL_CONF_HASH_INDEX=1
+ *      to compare the seed set scans with the seed set index.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/ipv6/uipbuf.h"
+#include "net/ipv6/multicast/uip-mcast6.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of messages that each seed sends per benchmark run. */
+#ifdef TEST_CONF_ROUNDS
+#define TEST_ROUNDS TEST_CONF_ROUNDS
+#else
+#define TEST_ROUNDS 60
+#endif
+
+/* The number of times that each message is received. */
+#define TEST_COPIES 3
+
+#define TEST_MAX_SEEDS 64
+#define TEST_PAYLOAD_LEN 64
+/*****************************************************************************/
+PROCESS(test_mpl_process, "MPL test process");
+AUTOSTART_PROCESSES(&test_mpl_process);
+/*****************************************************************************/
+static uint8_t next_seq[TEST_MAX_SEEDS];
+/*****************************************************************************/
+static void
+make_data(uint16_t seed, uint8_t seq)
+{
+  uint8_t *hbho;
+  struct uip_udp_hdr *udp;
+
+  uipbuf_clear();
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->tcflow = 0;
+  UIP_IP_BUF->flow = 0;
+  UIP_IP_BUF->proto = UIP_PROTO_HBHO;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, seed);
+  uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xff03, 0, 0, 0, 0, 0, 0, 0xfc);
+
+  /* Hop-by-hop options header with an MPL option and a 16 bit seed id */
+  hbho = UIP_IP_PAYLOAD(0);
+  hbho[0] = UIP_PROTO_UDP;
+  hbho[1] = 0;
+  hbho[2] = HBHO_OPT_TYPE_MPL;
+  hbho[3] = MPL_OPT_LEN_S1;
+  hbho[4] = 1 << 6;
+  hbho[5] = seq;
+  hbho[6] = seed >> 8;
+  hbho[7] = seed & 0xff;
+
+  udp = (struct uip_udp_hdr *)UIP_IP_PAYLOAD(HBHO_BASE_LEN);
+  udp->srcport = UIP_HTONS(5683);
+  udp->destport = UIP_HTONS(5683);
+  udp->udplen = UIP_HTONS(UIP_UDPH_LEN + TEST_PAYLOAD_LEN);
+  udp->udpchksum = 0;
+  memset((uint8_t *)udp + UIP_UDPH_LEN, seq, TEST_PAYLOAD_LEN);
+
+  uip_len = UIP_IPH_LEN + HBHO_BASE_LEN + UIP_UDPH_LEN + TEST_PAYLOAD_LEN;
+  uip_ext_len = HBHO_BASE_LEN;
+  uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+}
+/*****************************************************************************/
+static uint8_t
+receive_data(uint16_t seed, uint8_t seq)
+{
+  uint8_t ret;
+
+  make_data(seed, seq);
+  ret = UIP_MCAST6.in();
+  uipbuf_clear();
+  return ret;
+}
+/*****************************************************************************/
+static void
+make_control(unsigned seeds)
+{
+  uint8_t *info;
+
+  uipbuf_clear();
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->tcflow = 0;
+  UIP_IP_BUF->flow = 0;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = MPL_IP_HOP_LIMIT;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0x99);
+  uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xff02, 0, 0, 0, 0, 0, 0, 0xfc);
+  uip_ext_len = 0;
+  UIP_ICMP_BUF->type = ICMP6_MPL;
+  UIP_ICMP_BUF->icode = 0;
+
+  /* One seed info with a 16 bit seed id per seed, advertising the last
+     message of the seed */
+  info = UIP_ICMP_PAYLOAD;
+  for(unsigned i = 0; i < seeds; i++) {
+    info[0] = next_seq[i];
+    info[1] = (1 << 2) | 1;
+    info[2] = (0x3000 + i) >> 8;
+    info[3] = (0x3000 + i) & 0xff;
+    info[4] = 0x80;
+    info += 5;
+  }
+
+  uip_len = info - uip_buf;
+  uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+}
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(reclaim, "Reclaim buffered messages");
+UNIT_TEST(reclaim)
+{
+  UNIT_TEST_BEGIN();
+
+  /* Fill the buffered message set from a single seed */
+  for(unsigned seq = 1; seq <= MPL_BUFFERED_MESSAGE_SET_SIZE; seq++) {
+    UNIT_TEST_ASSERT(receive_data(0x1001, seq) == UIP_MCAST6_ACCEPT);
+  }
+
+  /* The message of a new seed takes the buffer of the oldest message */
+  UNIT_TEST_ASSERT(receive_data(0x1002, 1) == UIP_MCAST6_ACCEPT);
+  UNIT_TEST_ASSERT(receive_data(0x1001, 1) == UIP_MCAST6_DROP);
+  UNIT_TEST_ASSERT(receive_data(0x1001, 2) == UIP_MCAST6_DROP);
+  UNIT_TEST_ASSERT(receive_data(0x1002, 1) == UIP_MCAST6_DROP);
+
+  UNIT_TEST_ASSERT(receive_data(0x1001, MPL_BUFFERED_MESSAGE_SET_SIZE + 1)
+                   == UIP_MCAST6_ACCEPT);
+  UNIT_TEST_ASSERT(receive_data(0x1001, 2) == UIP_MCAST6_DROP);
+  UNIT_TEST_ASSERT(receive_data(0x1001, 3) == UIP_MCAST6_DROP);
+  UNIT_TEST_ASSERT(receive_data(0x1001, MPL_BUFFERED_MESSAGE_SET_SIZE + 1)
+                   == UIP_MCAST6_DROP);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(window, "Sequence number window");
+UNIT_TEST(window)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(receive_data(0x2001, 10) == UIP_MCAST6_ACCEPT);
+  UNIT_TEST_ASSERT(receive_data(0x2001, 11) == UIP_MCAST6_ACCEPT);
+  UNIT_TEST_ASSERT(receive_data(0x2001, 12) == UIP_MCAST6_ACCEPT);
+  UNIT_TEST_ASSERT(receive_data(0x2001, 14) == UIP_MCAST6_ACCEPT);
+  UNIT_TEST_ASSERT(receive_data(0x2001, 11) == UIP_MCAST6_DROP);
+  UNIT_TEST_ASSERT(receive_data(0x2001, 14) == UIP_MCAST6_DROP);
+
+  /* A gap in the window is filled */
+  UNIT_TEST_ASSERT(receive_data(0x2001, 13) == UIP_MCAST6_ACCEPT);
+  UNIT_TEST_ASSERT(receive_data(0x2001, 13) == UIP_MCAST6_DROP);
+  UNIT_TEST_ASSERT(receive_data(0x2001, 15) == UIP_MCAST6_ACCEPT);
+
+  /* Older than the window */
+  UNIT_TEST_ASSERT(receive_data(0x2001, 9) == UIP_MCAST6_DROP);
+
+  /* Seeds have separate windows */
+  UNIT_TEST_ASSERT(receive_data(0x2002, 11) == UIP_MCAST6_ACCEPT);
+  UNIT_TEST_ASSERT(receive_data(0x2002, 11) == UIP_MCAST6_DROP);
+  UNIT_TEST_ASSERT(receive_data(0x2001, 11) == UIP_MCAST6_DROP);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(replay, "Replay traffic from many seeds");
+UNIT_TEST(replay)
+{
+  static const unsigned seed_counts[] = { 8, 32, TEST_MAX_SEEDS };
+
+  UNIT_TEST_BEGIN();
+
+  printf("Seed set: %s\n", MPL_HASH_INDEX ? "index" : "scan");
+
+  for(unsigned c = 0; c < sizeof(seed_counts) / sizeof(seed_counts[0]); c++) {
+    unsigned seeds = seed_counts[c];
+    unsigned unique = 0;
+    unsigned accepted = 0;
+    unsigned control_errors = 0;
+    uint64_t data_time = 0;
+    uint64_t control_time = 0;
+    uint64_t start;
+
+    for(unsigned round = 0; round < TEST_ROUNDS; round++) {
+      start = cpu_time_ns();
+      for(unsigned i = 0; i < seeds; i++) {
+        uint8_t seq = ++next_seq[i];
+
+        /* The new message, a duplicate, and an older message */
+        for(unsigned copy = 0; copy < TEST_COPIES; copy++) {
+          if(receive_data(0x3000 + i, copy < 2 || seq <= 2 ? seq : seq - 2)
+             == UIP_MCAST6_ACCEPT) {
+            accepted++;
+          }
+        }
+        unique++;
+      }
+      data_time += cpu_time_ns() - start;
+
+      make_control(seeds);
+      start = cpu_time_ns();
+      if(uip_icmp6_input(ICMP6_MPL, 0) != UIP_ICMP6_INPUT_SUCCESS) {
+        control_errors++;
+      }
+      control_time += cpu_time_ns() - start;
+      uipbuf_clear();
+    }
+
+    printf("* %2u seeds: data %6.0f ns/msg, control %7.0f ns/msg\n", seeds,
+           (double)data_time / (unique * TEST_COPIES),
+           (double)control_time / TEST_ROUNDS);
+    UNIT_TEST_ASSERT(accepted == unique);
+    UNIT_TEST_ASSERT(control_errors == 0);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_mpl_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(reclaim);
+  UNIT_TEST_RUN(window);
+  UNIT_TEST_RUN(replay);
+
+  if(!UNIT_TEST_PASSED(reclaim) ||
+     !UNIT_TEST_PASSED(window) ||
+     !UNIT_TEST_PASSED(replay)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
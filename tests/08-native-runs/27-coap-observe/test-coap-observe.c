@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests and a benchmark for CoAP observe notifications. Build
+ *      with COAP_CONF_OBSERVE_BATCH=0 and COAP_CONF_OBSERVE_BATCH=1 to
+ *      compare rendering per observer with rendering once, and with
+ *      COAP_CONF_OBSERVE_MIN_INTERVAL to test notification coalescing.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uipbuf.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "coap-engine.h"
+#include "coap-observe.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of notifications per observer count in the benchmark. */
+#ifdef TEST_CONF_ROUNDS
+#define TEST_ROUNDS TEST_CONF_ROUNDS
+#else
+#define TEST_ROUNDS 200
+#endif
+
+#define TEST_OBSERVERS 8
+#define TEST_REMOVED 2
+#define TEST_PORT 6000
+#define TEST_URL "test/obs"
+/*****************************************************************************/
+PROCESS(test_coap_observe_process, "CoAP observe test process");
+AUTOSTART_PROCESSES(&test_coap_observe_process);
+/*****************************************************************************/
+static unsigned handler_calls;
+static unsigned value;
+
+/* The last notification received by each observer */
+static struct {
+  unsigned count;
+  uint32_t first_observe;
+  uint32_t observe;
+  uint8_t type;
+  uint8_t token_ok;
+  char payload[16];
+} received[COAP_MAX_OBSERVERS];
+static unsigned errors;
+/*****************************************************************************/
+static void
+res_get_handler(coap_message_t *request, coap_message_t *response,
+                uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  handler_calls++;
+  coap_set_header_content_format(response, TEXT_PLAIN);
+  coap_set_payload(response, buffer,
+                   snprintf((char *)buffer, preferred_size,
+                            "value %u %s", value,
+                            "padding to make the payload realistic"));
+}
+EVENT_RESOURCE(res_obs, "title=\"Observable\";obs",
+               res_get_handler, NULL, NULL, NULL, NULL);
+/*****************************************************************************/
+static void
+init(void)
+{
+}
+/*****************************************************************************/
+static void
+input(void)
+{
+}
+/*****************************************************************************/
+static uint8_t
+output(const linkaddr_t *localdest)
+{
+  coap_message_t message[1];
+  const uint8_t *payload;
+  unsigned observer;
+  int len;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_UDP) {
+    return 0;
+  }
+
+  observer = uip_ntohs(UIP_UDP_BUF->destport) - TEST_PORT;
+  if(observer >= COAP_MAX_OBSERVERS ||
+     coap_parse_message(message, uip_buf + UIP_IPUDPH_LEN,
+                        uip_len - UIP_IPUDPH_LEN) != NO_ERROR) {
+    errors++;
+    return 0;
+  }
+
+  received[observer].count++;
+  received[observer].type = message->type;
+  if(!coap_get_header_observe(message, &received[observer].observe)) {
+    errors++;
+  }
+  if(received[observer].count == 1) {
+    received[observer].first_observe = received[observer].observe;
+  }
+  received[observer].token_ok = message->token_len == 2 &&
+    message->token[0] == (observer >> 8) &&
+    message->token[1] == (observer & 0xff);
+  len = coap_get_payload(message, &payload);
+  if(len >= sizeof(received[observer].payload)) {
+    len = sizeof(received[observer].payload) - 1;
+  }
+  memcpy(received[observer].payload, payload, len);
+  received[observer].payload[len] = '\0';
+  return 0;
+}
+/*****************************************************************************/
+const struct network_driver test_network_driver = {
+  "test",
+  init,
+  input,
+  output
+};
+/*****************************************************************************/
+static void
+make_endpoint(coap_endpoint_t *ep, unsigned observer)
+{
+  memset(ep, 0, sizeof(*ep));
+  /* All observers share one neighbor and are told apart by their port */
+  uip_ip6addr(&ep->ipaddr, 0xfe80, 0, 0, 0, 0x0212, 0x7402, 0x0002, 0x0202);
+  ep->port = UIP_HTONS(TEST_PORT + observer);
+}
+/*****************************************************************************/
+static void
+add_neighbor(void)
+{
+  coap_endpoint_t ep;
+  uip_lladdr_t lladdr;
+
+  make_endpoint(&ep, 0);
+  uip_ds6_set_lladdr_from_iid(&lladdr, &ep.ipaddr);
+  uip_ds6_nbr_add(&ep.ipaddr, &lladdr, 0, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+}
+/*****************************************************************************/
+static int
+add_observers(unsigned count)
+{
+  coap_message_t request[1];
+  coap_message_t response[1];
+  coap_endpoint_t ep;
+  uint8_t token[2];
+
+  for(unsigned i = 0; i < count; i++) {
+    make_endpoint(&ep, i);
+    token[0] = i >> 8;
+    token[1] = i & 0xff;
+    coap_init_message(request, COAP_TYPE_CON, COAP_GET, i);
+    coap_set_token(request, token, sizeof(token));
+    coap_set_header_observe(request, 0);
+    coap_set_header_uri_path(request, TEST_URL);
+    coap_set_src_endpoint(request, &ep);
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, i);
+    coap_observe_handler(&res_obs, request, response);
+    if(response->code != CONTENT_2_05) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*****************************************************************************/
+static void
+remove_observers(unsigned count)
+{
+  coap_endpoint_t ep;
+
+  for(unsigned i = 0; i < count; i++) {
+    make_endpoint(&ep, i);
+    coap_remove_observer_by_client(&ep);
+  }
+}
+/*****************************************************************************/
+static void
+reset_received(void)
+{
+  memset(received, 0, sizeof(received));
+  handler_calls = 0;
+  errors = 0;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(notify, "Notify all observers");
+UNIT_TEST(notify)
+{
+  char expected[16];
+
+  UNIT_TEST_BEGIN();
+
+  reset_received();
+  UNIT_TEST_ASSERT(add_observers(TEST_OBSERVERS));
+  UNIT_TEST_ASSERT(coap_has_observers(TEST_URL));
+
+  /* Observers that have been removed are not notified */
+  remove_observers(TEST_REMOVED);
+
+  value = 1;
+  coap_notify_observers(&res_obs);
+
+  UNIT_TEST_ASSERT(errors == 0);
+  UNIT_TEST_ASSERT(handler_calls ==
+                   (COAP_OBSERVE_BATCH ? 1 : TEST_OBSERVERS - TEST_REMOVED));
+  snprintf(expected, sizeof(expected), "value %u %s", value, "padding");
+  for(unsigned i = 0; i < TEST_REMOVED; i++) {
+    UNIT_TEST_ASSERT(received[i].count == 0);
+  }
+  for(unsigned i = TEST_REMOVED; i < TEST_OBSERVERS; i++) {
+    UNIT_TEST_ASSERT(received[i].count == 1);
+    UNIT_TEST_ASSERT(received[i].token_ok);
+    UNIT_TEST_ASSERT(received[i].type == COAP_TYPE_NON);
+    /* The registration response carried observe 0 */
+    UNIT_TEST_ASSERT(received[i].observe == 1);
+    UNIT_TEST_ASSERT(strncmp(received[i].payload, expected,
+                             sizeof(received[i].payload) - 1) == 0);
+  }
+  UNIT_TEST_ASSERT(received[TEST_OBSERVERS].count == 0);
+
+  remove_observers(TEST_OBSERVERS);
+  UNIT_TEST_ASSERT(!coap_has_observers(TEST_URL));
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+/* Notifies three times in a row. With a notification interval, the first
+   notification is sent and the others are coalesced into one that is sent
+   when the interval has passed. */
+UNIT_TEST_REGISTER(coalesce_start, "Trigger notifications in a row");
+UNIT_TEST(coalesce_start)
+{
+  UNIT_TEST_BEGIN();
+
+  reset_received();
+  UNIT_TEST_ASSERT(add_observers(TEST_OBSERVERS));
+
+  for(value = 10; value < 13; value++) {
+    coap_notify_observers(&res_obs);
+  }
+  value--;
+
+  UNIT_TEST_ASSERT(errors == 0);
+  for(unsigned i = 0; i < TEST_OBSERVERS; i++) {
+    UNIT_TEST_ASSERT(received[i].count ==
+                     (COAP_OBSERVE_MIN_INTERVAL > 0 ? 1 : 3));
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(coalesce_end, "Send the coalesced notification");
+UNIT_TEST(coalesce_end)
+{
+  char expected[16];
+
+  UNIT_TEST_BEGIN();
+
+  snprintf(expected, sizeof(expected), "value %u %s", value, "padding");
+  UNIT_TEST_ASSERT(errors == 0);
+  for(unsigned i = 0; i < TEST_OBSERVERS; i++) {
+    UNIT_TEST_ASSERT(received[i].count ==
+                     (COAP_OBSERVE_MIN_INTERVAL > 0 ? 2 : 3));
+    UNIT_TEST_ASSERT(received[i].observe ==
+                     received[i].first_observe + received[i].count - 1);
+    /* The latest representation is sent */
+    UNIT_TEST_ASSERT(strncmp(received[i].payload, expected,
+                             sizeof(received[i].payload) - 1) == 0);
+  }
+
+  remove_observers(TEST_OBSERVERS);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+#if COAP_OBSERVE_MIN_INTERVAL == 0
+/* With a notification interval, the benchmark would measure coalescing */
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Notification throughput");
+UNIT_TEST(benchmark)
+{
+  static const unsigned observer_counts[] = { 16, 64, COAP_MAX_OBSERVERS };
+
+  UNIT_TEST_BEGIN();
+
+  printf("Notifications: %s\n",
+         COAP_OBSERVE_BATCH ? "rendered once" : "rendered per observer");
+
+  for(unsigned c = 0; c < sizeof(observer_counts) / sizeof(observer_counts[0]);
+      c++) {
+    unsigned observers = observer_counts[c];
+    unsigned sent = 0;
+    uint64_t start;
+    uint64_t time;
+
+    reset_received();
+    UNIT_TEST_ASSERT(add_observers(observers));
+
+    start = cpu_time_ns();
+    for(unsigned round = 0; round < TEST_ROUNDS; round++) {
+      value = round;
+      coap_notify_observers(&res_obs);
+    }
+    time = cpu_time_ns() - start;
+
+    for(unsigned i = 0; i < observers; i++) {
+      sent += received[i].count;
+    }
+    printf("* %3u observers: %6.0f ns/notification, %8.0f notifications/s\n",
+           observers, (double)time / sent, sent * 1e9 / time);
+    UNIT_TEST_ASSERT(errors == 0);
+    UNIT_TEST_ASSERT(sent == observers * TEST_ROUNDS);
+
+    remove_observers(observers);
+  }
+
+  UNIT_TEST_END();
+}
+#endif /* COAP_OBSERVE_MIN_INTERVAL == 0 */
+/*****************************************************************************/
+PROCESS_THREAD(test_coap_observe_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  coap_engine_init();
+  coap_activate_resource(&res_obs, TEST_URL);
+  add_neighbor();
+  /* Let the CoAP engine set up its connection */
+  PROCESS_PAUSE();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(notify);
+  /* Start the next test outside of the notification interval */
+  etimer_set(&et, CLOCK_SECOND / 2 +
+             COAP_OBSERVE_MIN_INTERVAL * CLOCK_SECOND / 1000);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  UNIT_TEST_RUN(coalesce_start);
+  etimer_reset(&et);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  UNIT_TEST_RUN(coalesce_end);
+#if COAP_OBSERVE_MIN_INTERVAL == 0
+  UNIT_TEST_RUN(benchmark);
+#endif
+
+  if(!UNIT_TEST_PASSED(notify) ||
+     !UNIT_TEST_PASSED(coalesce_start) ||
+     !UNIT_TEST_PASSED(coalesce_end)
+#if COAP_OBSERVE_MIN_INTERVAL == 0
+     || !UNIT_TEST_PASSED(benchmark)
+#endif
+     ) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,681 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests and a publish throughput benchmark for the MQTT engine,
+ *      run against a broker stub on the node itself. Build with
+ *      MQTT_CONF_STREAM_INPUT=0 and MQTT_CONF_STREAM_INPUT=1 to test both
+ *      ways of receiving PUBLISH payload, and with different
+ *      MQTT_CONF_MAX_INFLIGHT to compare QoS 1 throughput.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/tcp-socket.h"
+#include "mqtt.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of messages per payload size in the benchmark. */
+#ifdef TEST_CONF_ROUNDS
+#define TEST_ROUNDS TEST_CONF_ROUNDS
+#else
+#define TEST_ROUNDS 2000
+#endif
+
+/* Number of QoS 1 messages and the emulated round-trip time in the window
+   benchmark. */
+#define TEST_WINDOW_ROUNDS 100
+#define TEST_WINDOW_PAYLOAD_LEN 64
+#define TEST_RTT (CLOCK_SECOND / 50)
+
+#define TEST_ADDR "fd00::1"
+#define TEST_PORT 1883
+#define TEST_TOPIC "test/pub"
+/* Larger than the MQTT output and input buffers */
+#define TEST_PAYLOAD_LEN 1500
+#define TEST_TIMEOUT (5 * CLOCK_SECOND)
+
+#define STUB_HEADER_LEN 16
+#define STUB_BODY_LEN (TEST_PAYLOAD_LEN + STUB_HEADER_LEN)
+#define STUB_MAX_PENDING 32
+/*****************************************************************************/
+PROCESS(test_mqtt_process, "MQTT test process");
+AUTOSTART_PROCESSES(&test_mqtt_process);
+/*****************************************************************************/
+static uint8_t payload[TEST_PAYLOAD_LEN];
+static char topic[] = TEST_TOPIC;
+static struct mqtt_connection conn;
+
+/* What the client has received */
+static struct {
+  unsigned pubacks;
+  unsigned pubacks_in_order;
+  uint16_t mids[TEST_WINDOW_ROUNDS];
+  unsigned chunks;
+  unsigned complete;
+  uint32_t received;
+  unsigned errors;
+} client;
+
+/* The broker stub parses the stream of packets from the client */
+enum {
+  STUB_FHDR,
+  STUB_LENGTH,
+  STUB_BODY
+};
+
+static struct {
+  struct tcp_socket socket;
+  uint8_t in[MQTT_TCP_OUTPUT_BUFF_SIZE];
+  uint8_t out[TEST_PAYLOAD_LEN + STUB_HEADER_LEN];
+  uint8_t state;
+  uint8_t fhdr;
+  uint32_t remaining;
+  uint32_t multiplier;
+  uint32_t body_pos;
+  uint8_t body[STUB_BODY_LEN];
+  /* Compare the payload of every PUBLISH with the expected one */
+  uint8_t verify;
+  /* PUBACKs are held back for ack_delay and may be sent in reverse order */
+  clock_time_t ack_delay;
+  uint8_t ack_reverse;
+  uint8_t drop_acks;
+  struct ctimer ack_timer;
+  uint16_t pending[STUB_MAX_PENDING];
+  unsigned pending_count;
+  unsigned publishes;
+  unsigned dups;
+  uint32_t payload_bytes;
+  unsigned errors;
+} stub;
+/*****************************************************************************/
+static uint8_t
+test_byte(uint32_t i)
+{
+  return (uint8_t)(i * 7 + 3);
+}
+/*****************************************************************************/
+static void
+init(void)
+{
+}
+/*****************************************************************************/
+static void
+input(void)
+{
+}
+/*****************************************************************************/
+static uint8_t
+output(const linkaddr_t *localdest)
+{
+  /* All traffic is for the node itself and never reaches the driver */
+  return 0;
+}
+/*****************************************************************************/
+const struct network_driver test_network_driver = {
+  "test",
+  init,
+  input,
+  output
+};
+/*****************************************************************************/
+static void
+stub_send(const uint8_t *data, int len)
+{
+  if(tcp_socket_send(&stub.socket, data, len) != len) {
+    stub.errors++;
+  }
+}
+/*****************************************************************************/
+static void
+stub_send_acks(void *ptr)
+{
+  uint8_t acks[4 * STUB_MAX_PENDING];
+  uint16_t mid;
+
+  /* All PUBACKs go out in one segment */
+  for(unsigned i = 0; i < stub.pending_count; i++) {
+    mid = stub.pending[stub.ack_reverse ? stub.pending_count - 1 - i : i];
+    acks[4 * i] = 0x40;
+    acks[4 * i + 1] = 2;
+    acks[4 * i + 2] = mid >> 8;
+    acks[4 * i + 3] = mid & 0xFF;
+  }
+  stub_send(acks, 4 * stub.pending_count);
+  stub.pending_count = 0;
+}
+/*****************************************************************************/
+static void
+stub_publish(void)
+{
+  uint16_t topic_len;
+  uint32_t offset;
+  uint8_t qos;
+
+  qos = (stub.fhdr >> 1) & 0x03;
+  topic_len = (stub.body[0] << 8) | stub.body[1];
+  offset = 2 + topic_len + (qos > 0 ? 2 : 0);
+  if(topic_len != strlen(TEST_TOPIC) ||
+     memcmp(&stub.body[2], TEST_TOPIC, topic_len) != 0 ||
+     offset > stub.remaining) {
+    stub.errors++;
+    return;
+  }
+
+  stub.publishes++;
+  stub.payload_bytes += stub.remaining - offset;
+  if(stub.verify) {
+    for(uint32_t i = 0; offset + i < stub.remaining; i++) {
+      if(stub.body[offset + i] != test_byte(i)) {
+        stub.errors++;
+        break;
+      }
+    }
+  }
+
+  if(stub.fhdr & 0x08) {
+    stub.dups++;
+  }
+
+  if(qos > 0 && !stub.drop_acks) {
+    if(stub.pending_count == STUB_MAX_PENDING) {
+      stub.errors++;
+      return;
+    }
+    stub.pending[stub.pending_count++] =
+      (stub.body[2 + topic_len] << 8) | stub.body[3 + topic_len];
+    if(stub.ack_delay == 0) {
+      stub_send_acks(NULL);
+    } else if(ctimer_expired(&stub.ack_timer)) {
+      ctimer_set(&stub.ack_timer, stub.ack_delay, stub_send_acks, NULL);
+    }
+  }
+}
+/*****************************************************************************/
+static void
+stub_packet(void)
+{
+  static const uint8_t connack[] = { 0x20, 2, 0, 0 };
+  static const uint8_t pingresp[] = { 0xD0, 0 };
+
+  stub.state = STUB_FHDR;
+
+  switch(stub.fhdr & 0xF0) {
+  case 0x10:
+    stub_send(connack, sizeof(connack));
+    break;
+  case 0x30:
+    stub_publish();
+    break;
+  case 0xC0:
+    stub_send(pingresp, sizeof(pingresp));
+    break;
+  case 0xE0:
+    break;
+  default:
+    stub.errors++;
+    break;
+  }
+}
+/*****************************************************************************/
+static int
+stub_input(struct tcp_socket *s, void *ptr,
+           const uint8_t *data, int len)
+{
+  uint32_t copy;
+  uint32_t n;
+  int pos = 0;
+
+  while(pos < len) {
+    switch(stub.state) {
+    case STUB_FHDR:
+      stub.fhdr = data[pos++];
+      stub.remaining = 0;
+      stub.multiplier = 1;
+      stub.body_pos = 0;
+      stub.state = STUB_LENGTH;
+      break;
+    case STUB_LENGTH:
+      stub.remaining += (data[pos] & 0x7F) * stub.multiplier;
+      stub.multiplier *= 128;
+      if((data[pos++] & 0x80) == 0) {
+        stub.state = STUB_BODY;
+        if(stub.remaining == 0) {
+          stub_packet();
+        }
+      }
+      break;
+    default:
+      n = MIN(len - pos, stub.remaining - stub.body_pos);
+      /* The payload is only kept when it is verified */
+      copy = stub.verify ? STUB_BODY_LEN : STUB_HEADER_LEN;
+      if(stub.body_pos < copy) {
+        memcpy(&stub.body[stub.body_pos], &data[pos],
+               MIN(n, copy - stub.body_pos));
+      }
+      stub.body_pos += n;
+      pos += n;
+      if(stub.body_pos == stub.remaining) {
+        stub_packet();
+      }
+      break;
+    }
+  }
+  return 0;
+}
+/*****************************************************************************/
+static void
+stub_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
+{
+  if(event == TCP_SOCKET_CONNECTED) {
+    stub.state = STUB_FHDR;
+  }
+}
+/*****************************************************************************/
+static void
+stub_send_publish(void)
+{
+  uint8_t header[5 + sizeof(TEST_TOPIC) - 1];
+  uint32_t remaining;
+
+  remaining = 2 + strlen(TEST_TOPIC) + TEST_PAYLOAD_LEN;
+  header[0] = 0x30;
+  header[1] = 0x80 | (remaining & 0x7F);
+  header[2] = remaining >> 7;
+  header[3] = 0;
+  header[4] = strlen(TEST_TOPIC);
+  memcpy(&header[5], TEST_TOPIC, strlen(TEST_TOPIC));
+  stub_send(header, sizeof(header));
+  stub_send(payload, TEST_PAYLOAD_LEN);
+}
+/*****************************************************************************/
+static void
+mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+  struct mqtt_message *msg;
+
+  switch(event) {
+  case MQTT_EVENT_PUBACK:
+    if(client.pubacks < TEST_WINDOW_ROUNDS &&
+       client.mids[client.pubacks] == *(uint16_t *)data) {
+      client.pubacks_in_order++;
+    }
+    client.pubacks++;
+    break;
+  case MQTT_EVENT_PUBLISH:
+    msg = data;
+    if(msg->first_chunk != (client.received == 0) ||
+       msg->payload_length != TEST_PAYLOAD_LEN ||
+       strcmp(msg->topic, TEST_TOPIC) != 0) {
+      client.errors++;
+    }
+    for(unsigned i = 0; i < msg->payload_chunk_length; i++) {
+      if(msg->payload_chunk[i] != test_byte(client.received + i)) {
+        client.errors++;
+        break;
+      }
+    }
+    client.received += msg->payload_chunk_length;
+    client.chunks++;
+    if(msg->payload_left == 0) {
+      client.complete++;
+    }
+    break;
+  default:
+    break;
+  }
+}
+/*****************************************************************************/
+static mqtt_status_t
+publish(uint32_t len, int scattered, mqtt_qos_level_t qos)
+{
+  static struct mqtt_iovec iov[3];
+
+  if(!scattered) {
+    return mqtt_publish(&conn, NULL, topic, payload, len, qos,
+                        MQTT_RETAIN_OFF);
+  }
+
+  /* An application header, the data and a trailer */
+  iov[0].data = payload;
+  iov[0].len = MIN(len, 8);
+  iov[1].data = payload + iov[0].len;
+  iov[1].len = len > 16 ? len - 16 : 0;
+  iov[2].data = payload + iov[0].len + iov[1].len;
+  iov[2].len = len - iov[0].len - iov[1].len;
+  return mqtt_publish_iov(&conn, NULL, topic, iov, 3, qos, MQTT_RETAIN_OFF);
+}
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+static uint64_t
+wall_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+static void
+reset_pubacks(void)
+{
+  client.pubacks = 0;
+  client.pubacks_in_order = 0;
+  memset(client.mids, 0, sizeof(client.mids));
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(connect, "Connect to the broker stub");
+UNIT_TEST(connect)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(mqtt_connected(&conn));
+  UNIT_TEST_ASSERT(stub.errors == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(publish, "Publish from a buffer and a segment list");
+UNIT_TEST(publish)
+{
+  UNIT_TEST_BEGIN();
+
+  /* One message with QoS 1 and one with QoS 0 per way to publish */
+  UNIT_TEST_ASSERT(stub.errors == 0);
+  UNIT_TEST_ASSERT(stub.publishes == 4);
+  UNIT_TEST_ASSERT(stub.payload_bytes == 4 * TEST_PAYLOAD_LEN);
+  UNIT_TEST_ASSERT(client.pubacks == 2);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(receive, "Receive a PUBLISH in chunks");
+UNIT_TEST(receive)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Received %u payload bytes in %u chunks (%s)\n",
+         (unsigned)client.received, client.chunks,
+         MQTT_STREAM_INPUT ? "streamed" : "buffered");
+  UNIT_TEST_ASSERT(client.errors == 0);
+  UNIT_TEST_ASSERT(client.complete == 1);
+  UNIT_TEST_ASSERT(client.received == TEST_PAYLOAD_LEN);
+  UNIT_TEST_ASSERT(client.chunks > 1);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+#if MQTT_MAX_INFLIGHT > 1
+UNIT_TEST_REGISTER(ordered, "Report PUBACKs in publish order");
+UNIT_TEST(ordered)
+{
+  UNIT_TEST_BEGIN();
+
+  /* The stub acknowledged the whole window in reverse order */
+  UNIT_TEST_ASSERT(stub.errors == 0);
+  UNIT_TEST_ASSERT(client.pubacks == MQTT_MAX_INFLIGHT);
+  UNIT_TEST_ASSERT(client.pubacks_in_order == MQTT_MAX_INFLIGHT);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(resend, "Retransmit unacknowledged messages");
+UNIT_TEST(resend)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(mqtt_connected(&conn));
+  UNIT_TEST_ASSERT(stub.errors == 0);
+  UNIT_TEST_ASSERT(stub.dups == MQTT_MAX_INFLIGHT);
+  UNIT_TEST_ASSERT(client.pubacks == MQTT_MAX_INFLIGHT);
+  UNIT_TEST_ASSERT(client.pubacks_in_order == MQTT_MAX_INFLIGHT);
+  UNIT_TEST_ASSERT(conn.inflight_count == 0);
+
+  UNIT_TEST_END();
+}
+#endif /* MQTT_MAX_INFLIGHT > 1 */
+/*****************************************************************************/
+static uint64_t window_time;
+
+UNIT_TEST_REGISTER(window, "QoS 1 throughput");
+UNIT_TEST(window)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Window of %u, RTT %u ms: %6.0f QoS 1 messages/s\n",
+         MQTT_MAX_INFLIGHT, (unsigned)(TEST_RTT * 1000 / CLOCK_SECOND),
+         TEST_WINDOW_ROUNDS * 1e9 / window_time);
+  UNIT_TEST_ASSERT(stub.errors == 0);
+  UNIT_TEST_ASSERT(client.pubacks == TEST_WINDOW_ROUNDS);
+  UNIT_TEST_ASSERT(client.pubacks_in_order == TEST_WINDOW_ROUNDS);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+static const uint32_t payload_sizes[] = { 16, 256, 1024 };
+static struct {
+  uint64_t time[2];
+  unsigned publishes[2];
+} results[sizeof(payload_sizes) / sizeof(payload_sizes[0])];
+
+UNIT_TEST_REGISTER(benchmark, "Publish throughput");
+UNIT_TEST(benchmark)
+{
+  UNIT_TEST_BEGIN();
+
+  for(unsigned s = 0; s < sizeof(payload_sizes) / sizeof(payload_sizes[0]);
+      s++) {
+    for(unsigned scattered = 0; scattered < 2; scattered++) {
+      printf("* %4u bytes, %s: %6.0f ns/publish, %8.0f publishes/s\n",
+             (unsigned)payload_sizes[s],
+             scattered ? "segment list" : "buffer      ",
+             (double)results[s].time[scattered] / TEST_ROUNDS,
+             TEST_ROUNDS * 1e9 / results[s].time[scattered]);
+      UNIT_TEST_ASSERT(results[s].publishes[scattered] == TEST_ROUNDS);
+    }
+  }
+  UNIT_TEST_ASSERT(stub.errors == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_mqtt_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned s;
+  static unsigned scattered;
+  static unsigned sent;
+  static uint64_t start;
+  uip_ipaddr_t addr;
+
+  PROCESS_BEGIN();
+
+  for(unsigned i = 0; i < TEST_PAYLOAD_LEN; i++) {
+    payload[i] = test_byte(i);
+  }
+
+  uiplib_ip6addrconv(TEST_ADDR, &addr);
+  uip_ds6_addr_add(&addr, 0, ADDR_MANUAL);
+
+  tcp_socket_register(&stub.socket, NULL,
+                      stub.in, sizeof(stub.in), stub.out, sizeof(stub.out),
+                      stub_input, stub_event);
+  tcp_socket_listen(&stub.socket, TEST_PORT);
+
+  mqtt_register(&conn, &test_mqtt_process, "test", mqtt_event,
+                MQTT_TCP_OUTPUT_BUFF_SIZE);
+  mqtt_connect(&conn, TEST_ADDR, TEST_PORT, 60, 1);
+
+  etimer_set(&et, TEST_TIMEOUT);
+  PROCESS_WAIT_EVENT_UNTIL(mqtt_connected(&conn) || etimer_expired(&et));
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(connect);
+
+  /* Publish the whole payload in all four ways */
+  stub.verify = 1;
+  for(sent = 0; sent < 4 && !etimer_expired(&et);) {
+    if(publish(TEST_PAYLOAD_LEN, sent / 2, sent % 2) == MQTT_STATUS_OK) {
+      sent++;
+    }
+    PROCESS_PAUSE();
+  }
+  PROCESS_WAIT_EVENT_UNTIL((mqtt_ready(&conn) && client.pubacks == 2) ||
+                           etimer_expired(&et));
+  UNIT_TEST_RUN(publish);
+
+  stub_send_publish();
+  etimer_restart(&et);
+  PROCESS_WAIT_EVENT_UNTIL(client.complete || etimer_expired(&et));
+  UNIT_TEST_RUN(receive);
+
+#if MQTT_MAX_INFLIGHT > 1
+  stub.ack_delay = TEST_RTT;
+  stub.ack_reverse = 1;
+  reset_pubacks();
+  etimer_restart(&et);
+  for(sent = 0; sent < MQTT_MAX_INFLIGHT;) {
+    if(mqtt_publish(&conn, &client.mids[sent], topic, payload,
+                    TEST_WINDOW_PAYLOAD_LEN, MQTT_QOS_LEVEL_1,
+                    MQTT_RETAIN_OFF) == MQTT_STATUS_OK) {
+      sent++;
+    }
+    PROCESS_PAUSE();
+  }
+  PROCESS_WAIT_EVENT_UNTIL(client.pubacks == MQTT_MAX_INFLIGHT ||
+                           etimer_expired(&et));
+  UNIT_TEST_RUN(ordered);
+
+  /* Lose the connection while a window of messages is unacknowledged */
+  stub.ack_reverse = 0;
+  stub.drop_acks = 1;
+  stub.publishes = 0;
+  stub.dups = 0;
+  reset_pubacks();
+  etimer_restart(&et);
+  for(sent = 0; sent < MQTT_MAX_INFLIGHT;) {
+    if(mqtt_publish(&conn, &client.mids[sent], topic, payload,
+                    TEST_WINDOW_PAYLOAD_LEN, MQTT_QOS_LEVEL_1,
+                    MQTT_RETAIN_OFF) == MQTT_STATUS_OK) {
+      sent++;
+    }
+    PROCESS_PAUSE();
+  }
+  while(stub.publishes < MQTT_MAX_INFLIGHT && !etimer_expired(&et)) {
+    PROCESS_PAUSE();
+  }
+  /* The client reconnects by itself and resends what is in flight */
+  stub.drop_acks = 0;
+  tcp_socket_close(&stub.socket);
+  PROCESS_WAIT_EVENT_UNTIL(!mqtt_connected(&conn) || etimer_expired(&et));
+  etimer_set(&et, TEST_TIMEOUT);
+  PROCESS_WAIT_EVENT_UNTIL(client.pubacks == MQTT_MAX_INFLIGHT ||
+                           etimer_expired(&et));
+  UNIT_TEST_RUN(resend);
+#endif
+
+  /* QoS 1 messages over a link with a round-trip time */
+  stub.ack_delay = TEST_RTT;
+  reset_pubacks();
+  etimer_set(&et, TEST_TIMEOUT);
+  start = wall_time_ns();
+  for(sent = 0; sent < TEST_WINDOW_ROUNDS && !etimer_expired(&et);) {
+    if(mqtt_publish(&conn, &client.mids[sent], topic, payload,
+                    TEST_WINDOW_PAYLOAD_LEN, MQTT_QOS_LEVEL_1,
+                    MQTT_RETAIN_OFF) == MQTT_STATUS_OK) {
+      sent++;
+    }
+    PROCESS_PAUSE();
+  }
+  while(client.pubacks < TEST_WINDOW_ROUNDS && !etimer_expired(&et)) {
+    PROCESS_PAUSE();
+  }
+  window_time = wall_time_ns() - start;
+  UNIT_TEST_RUN(window);
+  stub.ack_delay = 0;
+
+  stub.verify = 0;
+  for(s = 0; s < sizeof(payload_sizes) / sizeof(payload_sizes[0]); s++) {
+    for(scattered = 0; scattered < 2; scattered++) {
+      stub.publishes = 0;
+      start = cpu_time_ns();
+      for(sent = 0; sent < TEST_ROUNDS;) {
+        if(publish(payload_sizes[s], scattered,
+                   MQTT_QOS_LEVEL_0) == MQTT_STATUS_OK) {
+          sent++;
+        } else {
+          PROCESS_PAUSE();
+        }
+      }
+      while(stub.publishes < TEST_ROUNDS && mqtt_connected(&conn)) {
+        PROCESS_PAUSE();
+      }
+      results[s].time[scattered] = cpu_time_ns() - start;
+      results[s].publishes[scattered] = stub.publishes;
+    }
+  }
+  UNIT_TEST_RUN(benchmark);
+
+  if(!UNIT_TEST_PASSED(connect) ||
+     !UNIT_TEST_PASSED(publish) ||
+     !UNIT_TEST_PASSED(receive) ||
+#if MQTT_MAX_INFLIGHT > 1
+     !UNIT_TEST_PASSED(ordered) ||
+     !UNIT_TEST_PASSED(resend) ||
+#endif
+     !UNIT_TEST_PASSED(window) ||
+     !UNIT_TEST_PASSED(benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,552 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests and benchmarks for block-wise reads of LWM2M objects
+ *      with many instances, in TLV, JSON and plain text, and for looking
+ *      up and registering instances. Build with
+ *      LWM2M_ENGINE_CONF_HASH_INDEX=0 and LWM2M_ENGINE_CONF_HASH_INDEX=1
+ *      to compare walking the instance list with the hash index.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "coap-engine.h"
+#include "lwm2m-engine.h"
+#include "lwm2m-object.h"
+#include "lwm2m-tlv.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of full reads of each object in the benchmark. */
+#ifdef TEST_CONF_ROUNDS
+#define TEST_ROUNDS TEST_CONF_ROUNDS
+#else
+#define TEST_ROUNDS 20
+#endif
+
+/* Number of lookups of each instance in the lookup benchmark. */
+#ifdef TEST_CONF_LOOKUP_ROUNDS
+#define TEST_LOOKUP_ROUNDS TEST_CONF_LOOKUP_ROUNDS
+#else
+#define TEST_LOOKUP_ROUNDS 200
+#endif
+
+#define TEST_OBJECT_ID 3300
+#define TEST_OBJECTS 3
+#define TEST_MAX_INSTANCES 256
+#define TEST_INSTANCES (16 + 64 + TEST_MAX_INSTANCES)
+#define TEST_TEXT_OBJECT_ID 3341
+#define TEST_TEXT_ID 5527
+#define TEST_TEXT_LEN 100
+#define TEST_PORT 5683
+#define TEST_MAX_OUTPUT 8192
+#define TEST_MAX_BLOCKS (TEST_MAX_OUTPUT / COAP_MAX_BLOCK_SIZE)
+/*****************************************************************************/
+PROCESS(test_lwm2m_process, "LWM2M test process");
+AUTOSTART_PROCESSES(&test_lwm2m_process);
+/*****************************************************************************/
+static const lwm2m_resource_id_t resources[] = {
+  RO(5700), RO(5601), RO(5602)
+};
+#define TEST_RESOURCES (sizeof(resources) / sizeof(resources[0]))
+#define TEST_RESOURCE_ID(r) (resources[r] & 0xffff)
+static const lwm2m_resource_id_t text_resources[] = { RO(TEST_TEXT_ID) };
+static const unsigned instance_counts[TEST_OBJECTS] = {
+  16, 64, TEST_MAX_INSTANCES
+};
+
+static lwm2m_object_instance_t instances[TEST_INSTANCES];
+static lwm2m_object_instance_t text_instance;
+static char text[TEST_TEXT_LEN + 1];
+static unsigned callbacks;
+static uint16_t mid;
+
+static uint8_t output[TEST_MAX_OUTPUT];
+static uint8_t expected[TEST_MAX_OUTPUT];
+/*****************************************************************************/
+static int32_t
+resource_value(uint16_t instance_id, uint16_t resource_id)
+{
+  return instance_id * 100000 + resource_id;
+}
+/*****************************************************************************/
+static lwm2m_status_t
+instance_callback(lwm2m_object_instance_t *object, lwm2m_context_t *ctx)
+{
+  callbacks++;
+  if(ctx->operation != LWM2M_OP_READ) {
+    return LWM2M_STATUS_OPERATION_NOT_ALLOWED;
+  }
+  if(object->object_id == TEST_TEXT_OBJECT_ID) {
+    lwm2m_object_write_string(ctx, text, strlen(text));
+  } else {
+    lwm2m_object_write_int(ctx,
+                           resource_value(object->instance_id,
+                                          ctx->resource_id));
+  }
+  return LWM2M_STATUS_OK;
+}
+/*****************************************************************************/
+static int
+add_instances(void)
+{
+  unsigned i = 0;
+
+  for(unsigned o = 0; o < TEST_OBJECTS; o++) {
+    for(unsigned n = 0; n < instance_counts[o]; n++, i++) {
+      instances[i].object_id = TEST_OBJECT_ID + o;
+      instances[i].instance_id = n;
+      instances[i].resource_ids = resources;
+      instances[i].resource_count = TEST_RESOURCES;
+      instances[i].callback = instance_callback;
+      if(!lwm2m_engine_add_object(&instances[i])) {
+        return 0;
+      }
+    }
+  }
+
+  for(i = 0; i < TEST_TEXT_LEN; i++) {
+    text[i] = 'a' + i % 26;
+  }
+  text_instance.object_id = TEST_TEXT_OBJECT_ID;
+  text_instance.instance_id = 0;
+  text_instance.resource_ids = text_resources;
+  text_instance.resource_count = 1;
+  text_instance.callback = instance_callback;
+  return lwm2m_engine_add_object(&text_instance);
+}
+/*****************************************************************************/
+static void
+make_endpoint(coap_endpoint_t *ep, unsigned client)
+{
+  memset(ep, 0, sizeof(*ep));
+  uip_ip6addr(&ep->ipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  ep->port = UIP_HTONS(TEST_PORT + client);
+}
+/*****************************************************************************/
+/* Request one block, append it to output and return the next offset */
+static int32_t
+read_block(const char *path, unsigned accept, unsigned client,
+           int32_t offset, size_t *len)
+{
+  static uint8_t buffer[COAP_MAX_BLOCK_SIZE];
+  coap_message_t request[1];
+  coap_message_t response[1];
+  coap_endpoint_t ep;
+  const uint8_t *payload;
+  int n;
+
+  make_endpoint(&ep, client);
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, mid);
+  coap_set_header_uri_path(request, path);
+  coap_set_header_accept(request, accept);
+  coap_set_src_endpoint(request, &ep);
+  coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, mid);
+  mid++;
+
+  if(coap_call_handlers(request, response, buffer, sizeof(buffer),
+                        &offset) != COAP_HANDLER_STATUS_PROCESSED ||
+     response->code != CONTENT_2_05) {
+    return -2;
+  }
+  n = coap_get_payload(response, &payload);
+  if(n <= 0 || *len + n > sizeof(output)) {
+    return -2;
+  }
+  memcpy(&output[*len], payload, n);
+  *len += n;
+  return offset;
+}
+/*****************************************************************************/
+/*
+ * Read a resource block by block. With alternate set, every other block is
+ * requested from another client, so that no read can continue where the
+ * previous block ended.
+ */
+static int
+read_all(const char *path, unsigned accept, int alternate, unsigned *blocks)
+{
+  int32_t offset = 0;
+  size_t len = 0;
+
+  *blocks = 0;
+  do {
+    offset = read_block(path, accept, alternate ? *blocks & 1 : 0,
+                        offset, &len);
+    (*blocks)++;
+  } while(offset >= 0 && *blocks < TEST_MAX_BLOCKS);
+  return offset == -1 ? len : -1;
+}
+/*****************************************************************************/
+static size_t
+expected_tlv(unsigned object)
+{
+  size_t len = 0;
+
+  for(unsigned i = 0; i < instance_counts[object]; i++) {
+    for(unsigned r = 0; r < TEST_RESOURCES; r++) {
+      len += lwm2m_tlv_write_int32(LWM2M_TLV_TYPE_RESOURCE,
+                                   TEST_RESOURCE_ID(r),
+                                   resource_value(i, TEST_RESOURCE_ID(r)),
+                                   &expected[len], sizeof(expected) - len);
+    }
+  }
+  return len;
+}
+/*****************************************************************************/
+static size_t
+expected_json(unsigned object)
+{
+  size_t len = 0;
+
+  for(unsigned i = 0; i < instance_counts[object]; i++) {
+    len += snprintf((char *)&expected[len], sizeof(expected) - len,
+                    "{\"bn\":\"/%u/%u/\",\"e\":[", TEST_OBJECT_ID + object, i);
+    for(unsigned r = 0; r < TEST_RESOURCES; r++) {
+      len += snprintf((char *)&expected[len], sizeof(expected) - len,
+                      "%s{\"n\":\"%u\",\"v\":%ld}", r > 0 ? "," : "",
+                      (unsigned)TEST_RESOURCE_ID(r),
+                      (long)resource_value(i, TEST_RESOURCE_ID(r)));
+    }
+    len += snprintf((char *)&expected[len], sizeof(expected) - len, "]}");
+  }
+  return len;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(tlv, "Block-wise TLV read");
+UNIT_TEST(tlv)
+{
+  unsigned blocks;
+  size_t len;
+
+  UNIT_TEST_BEGIN();
+
+  len = expected_tlv(1);
+  UNIT_TEST_ASSERT(len > 4 * COAP_MAX_BLOCK_SIZE);
+  UNIT_TEST_ASSERT(read_all("3301", LWM2M_TLV, 0, &blocks) == len);
+  UNIT_TEST_ASSERT(blocks == (len + COAP_MAX_BLOCK_SIZE - 1) /
+                   COAP_MAX_BLOCK_SIZE);
+  UNIT_TEST_ASSERT(memcmp(output, expected, len) == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(json, "Block-wise JSON read");
+UNIT_TEST(json)
+{
+  unsigned blocks;
+  size_t len;
+
+  UNIT_TEST_BEGIN();
+
+  len = expected_json(1);
+  UNIT_TEST_ASSERT(read_all("3301", LWM2M_JSON, 0, &blocks) == len);
+  UNIT_TEST_ASSERT(memcmp(output, expected, len) == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(text, "Block-wise plain text read");
+UNIT_TEST(text)
+{
+  unsigned blocks;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(read_all("3341/0/5527", LWM2M_TEXT_PLAIN, 0, &blocks) ==
+                   TEST_TEXT_LEN);
+  UNIT_TEST_ASSERT(blocks == 2);
+  UNIT_TEST_ASSERT(memcmp(output, text, TEST_TEXT_LEN) == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(repeat, "Blocks requested again or by another client");
+UNIT_TEST(repeat)
+{
+  static const unsigned order[] = { 0, 1, 1, 3, 4, 2, 3 };
+  size_t len;
+  size_t pos;
+  int32_t offset;
+  unsigned blocks;
+
+  UNIT_TEST_BEGIN();
+
+  /* Every block from a fresh read */
+  len = expected_json(1);
+  UNIT_TEST_ASSERT(read_all("3301", LWM2M_JSON, 1, &blocks) == len);
+  UNIT_TEST_ASSERT(memcmp(output, expected, len) == 0);
+
+  /* Blocks out of order, again and by two clients */
+  for(unsigned i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+    pos = 0;
+    offset = read_block("3301", LWM2M_JSON, i & 1,
+                        order[i] * COAP_MAX_BLOCK_SIZE, &pos);
+    UNIT_TEST_ASSERT(offset == (order[i] + 1) * COAP_MAX_BLOCK_SIZE);
+    UNIT_TEST_ASSERT(pos == COAP_MAX_BLOCK_SIZE);
+    UNIT_TEST_ASSERT(memcmp(output, &expected[order[i] * COAP_MAX_BLOCK_SIZE],
+                            COAP_MAX_BLOCK_SIZE) == 0);
+  }
+
+  /* Finish the read so that the engine is free for other requests */
+  pos = 0;
+  while(offset >= 0 && pos < len) {
+    offset = read_block("3301", LWM2M_JSON, 0, offset, &pos);
+  }
+  UNIT_TEST_ASSERT(offset == -1);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+static int
+read_rd_data(void)
+{
+  static uint8_t buffer[COAP_MAX_BLOCK_SIZE];
+  lwm2m_buffer_t outbuf;
+  unsigned block = 0;
+  size_t len = 0;
+  int more;
+
+  do {
+    memset(&outbuf, 0, sizeof(outbuf));
+    outbuf.buffer = buffer;
+    outbuf.size = sizeof(buffer);
+    more = lwm2m_engine_set_rd_data(&outbuf, block++);
+    if(len + outbuf.len > sizeof(output)) {
+      return -1;
+    }
+    memcpy(&output[len], buffer, outbuf.len);
+    len += outbuf.len;
+  } while(more && block < TEST_MAX_BLOCKS);
+  return more ? -1 : len;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(registry, "Register, look up and remove instances");
+UNIT_TEST(registry)
+{
+  lwm2m_object_instance_t *last = &instances[TEST_INSTANCES - 1];
+  lwm2m_object_instance_t extra;
+  unsigned blocks;
+  size_t len = 0;
+  unsigned i = 0;
+
+  UNIT_TEST_BEGIN();
+
+  for(unsigned o = 0; o < TEST_OBJECTS; o++) {
+    for(unsigned n = 0; n < instance_counts[o]; n++, i++) {
+      UNIT_TEST_ASSERT(lwm2m_engine_has_instance(TEST_OBJECT_ID + o, n));
+    }
+    UNIT_TEST_ASSERT(!lwm2m_engine_has_instance(TEST_OBJECT_ID + o,
+                                                instance_counts[o]));
+  }
+  UNIT_TEST_ASSERT(!lwm2m_engine_has_instance(TEST_OBJECT_ID + TEST_OBJECTS,
+                                              0));
+  UNIT_TEST_ASSERT(!lwm2m_engine_add_object(&instances[0]));
+
+  /* The registration payload lists the instances in registration order */
+  for(i = 0; i < TEST_INSTANCES; i++) {
+    len += snprintf((char *)&expected[len], sizeof(expected) - len,
+                    "%s</%u/%u>", i > 0 ? "," : "",
+                    instances[i].object_id, instances[i].instance_id);
+  }
+  len += snprintf((char *)&expected[len], sizeof(expected) - len,
+                  ",</%u/0>", TEST_TEXT_OBJECT_ID);
+  UNIT_TEST_ASSERT(read_rd_data() == len);
+  UNIT_TEST_ASSERT(memcmp(output, expected, len) == 0);
+
+  /* Gone after removal and back after registering again */
+  lwm2m_engine_remove_object(last);
+  UNIT_TEST_ASSERT(!lwm2m_engine_has_instance(last->object_id,
+                                              last->instance_id));
+  UNIT_TEST_ASSERT(read_all("3302/255/5700", LWM2M_TLV, 0, &blocks) == -1);
+  UNIT_TEST_ASSERT(lwm2m_engine_add_object(last));
+  UNIT_TEST_ASSERT(lwm2m_engine_has_instance(last->object_id,
+                                             last->instance_id));
+  UNIT_TEST_ASSERT(read_all("3302/255/5700", LWM2M_TLV, 0, &blocks) > 0);
+
+  /* An instance without an id gets one below the lowest id in use */
+  memcpy(&extra, &text_instance, sizeof(extra));
+  extra.instance_id = LWM2M_OBJECT_INSTANCE_NONE;
+  UNIT_TEST_ASSERT(lwm2m_engine_add_object(&extra));
+  UNIT_TEST_ASSERT(extra.instance_id == 1);
+  UNIT_TEST_ASSERT(lwm2m_engine_has_instance(TEST_TEXT_OBJECT_ID, 1));
+  lwm2m_engine_remove_object(&extra);
+  UNIT_TEST_ASSERT(!lwm2m_engine_has_instance(TEST_TEXT_OBJECT_ID, 1));
+  UNIT_TEST_ASSERT(lwm2m_engine_has_instance(TEST_TEXT_OBJECT_ID, 0));
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Block-wise read cost");
+UNIT_TEST(benchmark)
+{
+  static const char *paths[TEST_OBJECTS] = { "3300", "3301", "3302" };
+
+  UNIT_TEST_BEGIN();
+
+  for(unsigned alternate = 0; alternate < 2; alternate++) {
+    printf("Blocks %s:\n", alternate ? "regenerated from the start" :
+           "continued from the previous block");
+    for(unsigned o = 0; o < TEST_OBJECTS; o++) {
+      unsigned blocks = 0;
+      unsigned total_blocks = 0;
+      uint64_t start;
+      uint64_t time;
+
+      callbacks = 0;
+      start = cpu_time_ns();
+      for(unsigned round = 0; round < TEST_ROUNDS; round++) {
+        UNIT_TEST_ASSERT(read_all(paths[o], LWM2M_TLV, alternate, &blocks) ==
+                         expected_tlv(o));
+        total_blocks += blocks;
+      }
+      time = cpu_time_ns() - start;
+
+      printf("* %3u instances, %3u blocks: %7.0f ns/block, "
+             "%6.1f resource reads/block\n",
+             instance_counts[o], blocks, (double)time / total_blocks,
+             (double)callbacks / total_blocks);
+    }
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(lookup, "Instance lookup and registration cost");
+UNIT_TEST(lookup)
+{
+  lwm2m_object_instance_t *first = &instances[TEST_INSTANCES -
+                                              TEST_MAX_INSTANCES];
+  char path[24];
+  size_t len;
+  unsigned found;
+  unsigned requests;
+  uint64_t start;
+  uint64_t time;
+
+  UNIT_TEST_BEGIN();
+
+  printf("Instances: %s\n", LWM2M_ENGINE_HASH_INDEX ? "hash index" : "list");
+
+  for(unsigned o = 0; o < TEST_OBJECTS; o++) {
+    found = 0;
+    start = cpu_time_ns();
+    for(unsigned round = 0; round < TEST_LOOKUP_ROUNDS; round++) {
+      for(unsigned n = 0; n < instance_counts[o]; n++) {
+        found += lwm2m_engine_has_instance(TEST_OBJECT_ID + o, n);
+      }
+    }
+    time = cpu_time_ns() - start;
+    UNIT_TEST_ASSERT(found == instance_counts[o] * TEST_LOOKUP_ROUNDS);
+
+    requests = 0;
+    start = cpu_time_ns();
+    for(unsigned round = 0; round < TEST_ROUNDS; round++) {
+      for(unsigned n = 0; n < instance_counts[o]; n++) {
+        snprintf(path, sizeof(path), "%u/%u/5700", TEST_OBJECT_ID + o, n);
+        len = 0;
+        UNIT_TEST_ASSERT(read_block(path, LWM2M_TLV, 0, 0, &len) == -1);
+        requests++;
+      }
+    }
+
+    printf("* %3u instances: %5.0f ns/lookup, %6.0f ns/read request\n",
+           instance_counts[o], (double)time / found,
+           (double)(cpu_time_ns() - start) / requests);
+  }
+
+  /* Register the largest object again, in the same order */
+  for(unsigned n = 0; n < TEST_MAX_INSTANCES; n++) {
+    lwm2m_engine_remove_object(&first[n]);
+  }
+  start = cpu_time_ns();
+  for(unsigned n = 0; n < TEST_MAX_INSTANCES; n++) {
+    UNIT_TEST_ASSERT(lwm2m_engine_add_object(&first[n]));
+  }
+  time = cpu_time_ns() - start;
+  printf("* register %u instances: %5.0f ns/instance\n", TEST_MAX_INSTANCES,
+         (double)time / TEST_MAX_INSTANCES);
+  UNIT_TEST_ASSERT(lwm2m_engine_has_instance(first->object_id,
+                                             TEST_MAX_INSTANCES - 1));
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_lwm2m_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  lwm2m_engine_init();
+  if(!add_instances()) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(tlv);
+  UNIT_TEST_RUN(json);
+  UNIT_TEST_RUN(text);
+  UNIT_TEST_RUN(repeat);
+  UNIT_TEST_RUN(registry);
+  UNIT_TEST_RUN(benchmark);
+  UNIT_TEST_RUN(lookup);
+
+  if(!UNIT_TEST_PASSED(tlv) ||
+     !UNIT_TEST_PASSED(json) ||
+     !UNIT_TEST_PASSED(text) ||
+     !UNIT_TEST_PASSED(repeat) ||
+     !UNIT_TEST_PASSED(registry) ||
+     !UNIT_TEST_PASSED(benchmark) ||
+     !UNIT_TEST_PASSED(lookup)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
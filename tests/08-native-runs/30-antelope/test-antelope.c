@@ -0,0 +1,805 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for joins in the Antelope database: index joins through
+ *      inline and MaxHeap indexes, and hash joins, which spill to
+ *      storage when the smaller relation does not fit in the hash table.
+ *      Build with small DB_JOIN_HASH_SIZE and DB_JOIN_PARTITIONS values
+ *      to join large partitions in several rounds.
+ *
+ *      The selection tests compare the rows selected by conditions that
+ *      the ranges derived for block scans describe exactly, partially,
+ *      or not at all, with the rows that the condition holds for.
+ *      The B+-tree tests select the same rows through B+-tree indexes
+ *      over keys that are inserted in order and out of order. Build
+ *      with a small DB_BPLUSTREE_ORDER to split nodes at every level.
+ */
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "antelope.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of rows in the small relation. Rows share join keys, and some
+   of the keys are missing in the large relations. */
+#define SENSORS 40
+/* Number of rows in each of the large relations. */
+#define READINGS 600
+/* Number of distinct join keys in the large relations. */
+#define NODES 50
+
+#define MAX_PAIRS (NODES * (READINGS / NODES) * (READINGS / NODES))
+
+/* Number of rows in the relation of the selection tests, which is not
+   a multiple of the block size. */
+#define SAMPLES 301
+/*****************************************************************************/
+PROCESS(test_antelope_process, "Antelope test process");
+AUTOSTART_PROCESSES(&test_antelope_process);
+/*****************************************************************************/
+struct pair {
+  long a;
+  long b;
+};
+
+static struct pair expected[MAX_PAIRS];
+static struct pair result[MAX_PAIRS];
+static unsigned expected_count;
+/*****************************************************************************/
+static int
+sensor_node(int i)
+{
+  return (i * 3) % 60;
+}
+/*****************************************************************************/
+static int
+reading_node(int i)
+{
+  return (i * 7) % NODES;
+}
+/*****************************************************************************/
+static int
+event_node(int i)
+{
+  return (i * 11) % NODES;
+}
+/*****************************************************************************/
+static int
+compare_pairs(const void *a, const void *b)
+{
+  const struct pair *pa = a;
+  const struct pair *pb = b;
+
+  if(pa->a != pb->a) {
+    return pa->a < pb->a ? -1 : 1;
+  }
+  if(pa->b != pb->b) {
+    return pa->b < pb->b ? -1 : 1;
+  }
+  return 0;
+}
+/*****************************************************************************/
+static bool
+query(const char *format, ...)
+{
+  char query_string[AQL_MAX_QUERY_LENGTH];
+  db_result_t r;
+  va_list ap;
+
+  va_start(ap, format);
+  vsnprintf(query_string, sizeof(query_string), format, ap);
+  va_end(ap);
+
+  r = db_query(NULL, "%s", query_string);
+  if(DB_ERROR(r)) {
+    printf("Query \"%s\" failed: %s\n", query_string,
+           db_get_result_message(r));
+    return false;
+  }
+  return true;
+}
+/*****************************************************************************/
+static bool
+create_relation(const char *name, const char *attr_a, const char *attr_b)
+{
+  return query("REMOVE RELATION %s;", name) &&
+         query("CREATE RELATION %s;", name) &&
+         query("CREATE ATTRIBUTE %s IN %s;", attr_a, name) &&
+         query("CREATE ATTRIBUTE %s IN %s;", attr_b, name);
+}
+/*****************************************************************************/
+/* Run a query and collect the first two values of each resulting row. */
+static int
+collect_rows(const char *query_string, uint8_t *flags)
+{
+  db_handle_t handle;
+  attribute_value_t value;
+  db_result_t r;
+  int count;
+
+  r = db_query(&handle, "%s", query_string);
+  if(DB_ERROR(r)) {
+    printf("Query \"%s\" failed: %s\n", query_string,
+           db_get_result_message(r));
+    db_free(&handle);
+    return -1;
+  }
+  *flags = handle.flags;
+
+  for(count = 0;;) {
+    r = db_process(&handle);
+    if(r == DB_OK) {
+      continue;
+    } else if(r != DB_GOT_ROW) {
+      break;
+    }
+    if(count < MAX_PAIRS) {
+      if(DB_ERROR(db_get_value(&value, &handle, 0))) {
+        break;
+      }
+      result[count].a = db_value_to_long(&value);
+      if(DB_ERROR(db_get_value(&value, &handle, 1))) {
+        break;
+      }
+      result[count].b = db_value_to_long(&value);
+    }
+    count++;
+  }
+  db_free(&handle);
+
+  if(r != DB_FINISHED) {
+    printf("Processing \"%s\" failed: %s\n", query_string,
+           db_get_result_message(r));
+    return -1;
+  }
+  return count;
+}
+/*****************************************************************************/
+static bool
+check_join(const char *query_string, uint8_t *flags)
+{
+  int count;
+
+  count = collect_rows(query_string, flags);
+  if(count != expected_count) {
+    printf("\"%s\" returned %d rows, expected %u\n", query_string, count,
+           expected_count);
+    return false;
+  }
+
+  qsort(result, count, sizeof(result[0]), compare_pairs);
+  return memcmp(result, expected, count * sizeof(result[0])) == 0;
+}
+/*****************************************************************************/
+/* The expected result of joining sensors with readings or events,
+   projected on the room and value attributes. */
+static void
+expect_sensor_join(int (*node)(int), int value_base)
+{
+  expected_count = 0;
+  for(int s = 0; s < SENSORS; s++) {
+    for(int r = 0; r < READINGS; r++) {
+      if(sensor_node(s) == node(r)) {
+        expected[expected_count].a = 100 + s;
+        expected[expected_count].b = value_base + r;
+        expected_count++;
+      }
+    }
+  }
+  qsort(expected, expected_count, sizeof(expected[0]), compare_pairs);
+}
+/*****************************************************************************/
+static bool
+spill_files_exist(void)
+{
+  int fd;
+
+  fd = cfs_open(DB_JOIN_SPILL_FILE ".b0", CFS_READ);
+  cfs_close(fd);
+  return fd >= 0;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(hash_join, "Hash join");
+UNIT_TEST(hash_join)
+{
+  uint8_t flags;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(create_relation("sensors", "node DOMAIN INT",
+                                   "room DOMAIN INT"));
+  UNIT_TEST_ASSERT(create_relation("readings", "node DOMAIN INT",
+                                   "value DOMAIN INT"));
+  for(int i = 0; i < SENSORS; i++) {
+    UNIT_TEST_ASSERT(query("INSERT (%d, %d) INTO sensors;",
+                           sensor_node(i), 100 + i));
+  }
+  for(int i = 0; i < READINGS; i++) {
+    UNIT_TEST_ASSERT(query("INSERT (%d, %d) INTO readings;",
+                           reading_node(i), i));
+  }
+
+  /* The hash table is built over the smaller relation, whichever side
+     of the join it is on. */
+  expect_sensor_join(reading_node, 0);
+  UNIT_TEST_ASSERT(check_join("JOIN sensors, readings ON node PROJECT room, value;",
+                              &flags));
+  UNIT_TEST_ASSERT(flags & DB_HANDLE_FLAG_HASH_JOIN);
+  UNIT_TEST_ASSERT(flags & DB_HANDLE_FLAG_SWAP_JOIN);
+
+  UNIT_TEST_ASSERT(check_join("JOIN readings, sensors ON node PROJECT room, value;",
+                              &flags));
+  UNIT_TEST_ASSERT(flags & DB_HANDLE_FLAG_HASH_JOIN);
+  UNIT_TEST_ASSERT(!(flags & DB_HANDLE_FLAG_SWAP_JOIN));
+  UNIT_TEST_ASSERT(!spill_files_exist());
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(spill, "Hash join spilled to storage");
+UNIT_TEST(spill)
+{
+  db_handle_t handle;
+  uint8_t flags;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(create_relation("events", "node DOMAIN INT",
+                                   "level DOMAIN INT"));
+  for(int i = 0; i < READINGS; i++) {
+    UNIT_TEST_ASSERT(query("INSERT (%d, %d) INTO events;",
+                           event_node(i), 1000 + i));
+  }
+
+  /* Both relations are larger than the hash table. */
+  expected_count = 0;
+  for(int e = 0; e < READINGS; e++) {
+    for(int r = 0; r < READINGS; r++) {
+      if(event_node(e) == reading_node(r)) {
+        expected[expected_count].a = 1000 + e;
+        expected[expected_count].b = r;
+        expected_count++;
+      }
+    }
+  }
+  qsort(expected, expected_count, sizeof(expected[0]), compare_pairs);
+
+  UNIT_TEST_ASSERT(check_join("JOIN events, readings ON node PROJECT level, value;",
+                              &flags));
+  UNIT_TEST_ASSERT(flags & DB_HANDLE_FLAG_HASH_JOIN);
+  UNIT_TEST_ASSERT(!spill_files_exist());
+
+  /* The partitions are kept until the join has finished. */
+  UNIT_TEST_ASSERT(db_query(&handle,
+                            "JOIN events, readings ON node PROJECT level, value;")
+                   == DB_OK);
+  UNIT_TEST_ASSERT(spill_files_exist());
+  UNIT_TEST_ASSERT(db_process(&handle) == DB_GOT_ROW);
+  UNIT_TEST_ASSERT(spill_files_exist());
+  db_free(&handle);
+
+  /* The small relation is spilled only if it is larger than the table. */
+  expect_sensor_join(event_node, 1000);
+  UNIT_TEST_ASSERT(check_join("JOIN sensors, events ON node PROJECT room, level;",
+                              &flags));
+  UNIT_TEST_ASSERT(flags & DB_HANDLE_FLAG_HASH_JOIN);
+  UNIT_TEST_ASSERT(query("REMOVE RELATION events;"));
+  UNIT_TEST_ASSERT(query("REMOVE RELATION readings;"));
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(index_join, "Index joins");
+UNIT_TEST(index_join)
+{
+  uint8_t flags;
+
+  UNIT_TEST_BEGIN();
+
+  /* A MaxHeap index over the join attribute of the large relation. */
+  UNIT_TEST_ASSERT(create_relation("heaped", "node DOMAIN INT",
+                                   "value DOMAIN INT"));
+  UNIT_TEST_ASSERT(query("CREATE INDEX heaped.node TYPE MAXHEAP;"));
+  for(int i = 0; i < READINGS; i++) {
+    UNIT_TEST_ASSERT(query("INSERT (%d, %d) INTO heaped;",
+                           reading_node(i), i));
+  }
+
+  expect_sensor_join(reading_node, 0);
+  UNIT_TEST_ASSERT(check_join("JOIN sensors, heaped ON node PROJECT room, value;",
+                              &flags));
+  UNIT_TEST_ASSERT(!(flags & DB_HANDLE_FLAG_HASH_JOIN));
+  UNIT_TEST_ASSERT(!(flags & DB_HANDLE_FLAG_SWAP_JOIN));
+
+  /* The relation without an index is scanned, even if it is the left
+     one. */
+  UNIT_TEST_ASSERT(check_join("JOIN heaped, sensors ON node PROJECT room, value;",
+                              &flags));
+  UNIT_TEST_ASSERT(!(flags & DB_HANDLE_FLAG_HASH_JOIN));
+  UNIT_TEST_ASSERT(flags & DB_HANDLE_FLAG_SWAP_JOIN);
+  UNIT_TEST_ASSERT(query("REMOVE RELATION heaped;"));
+
+  /* An inline index over a relation inserted in key order, with
+     several rows for each key. */
+  UNIT_TEST_ASSERT(create_relation("sorted", "node DOMAIN INT",
+                                   "value DOMAIN INT"));
+  UNIT_TEST_ASSERT(query("CREATE INDEX sorted.node TYPE INLINE;"));
+  for(int node = 0; node < NODES; node++) {
+    for(int i = 0; i < READINGS; i++) {
+      if(reading_node(i) == node) {
+        UNIT_TEST_ASSERT(query("INSERT (%d, %d) INTO sorted;", node, i));
+      }
+    }
+  }
+
+  UNIT_TEST_ASSERT(check_join("JOIN sensors, sorted ON node PROJECT room, value;",
+                              &flags));
+  UNIT_TEST_ASSERT(!(flags & DB_HANDLE_FLAG_HASH_JOIN));
+  UNIT_TEST_ASSERT(check_join("JOIN sorted, sensors ON node PROJECT room, value;",
+                              &flags));
+  UNIT_TEST_ASSERT(flags & DB_HANDLE_FLAG_SWAP_JOIN);
+  UNIT_TEST_ASSERT(query("REMOVE RELATION sorted;"));
+  UNIT_TEST_ASSERT(query("REMOVE RELATION sensors;"));
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(string_join, "Hash join on strings");
+UNIT_TEST(string_join)
+{
+  static const char *tags[] = {"ab", "ba", "abc", "", "z"};
+  uint8_t flags;
+  int count;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(create_relation("owners", "tag DOMAIN STRING(6)",
+                                   "id DOMAIN INT"));
+  UNIT_TEST_ASSERT(create_relation("items", "tag DOMAIN STRING(6)",
+                                   "num DOMAIN INT"));
+  for(int i = 0; i < 4; i++) {
+    UNIT_TEST_ASSERT(query("INSERT ('%s', %d) INTO owners;",
+                           tags[i], i));
+  }
+  for(int i = 0; i < 20; i++) {
+    UNIT_TEST_ASSERT(query("INSERT ('%s', %d) INTO items;",
+                           tags[i % 5], i));
+  }
+
+  count = collect_rows("JOIN owners, items ON tag PROJECT id, num;", &flags);
+  UNIT_TEST_ASSERT(flags & DB_HANDLE_FLAG_HASH_JOIN);
+  UNIT_TEST_ASSERT(count == 16);
+  for(int i = 0; i < count; i++) {
+    UNIT_TEST_ASSERT(result[i].b % 5 == result[i].a);
+  }
+
+  /* Strings and numbers cannot be compared. */
+  UNIT_TEST_ASSERT(create_relation("numbers", "tag DOMAIN INT",
+                                   "num DOMAIN INT"));
+  UNIT_TEST_ASSERT(collect_rows("JOIN owners, numbers ON tag PROJECT id, num;",
+                            &flags) < 0);
+  UNIT_TEST_ASSERT(query("REMOVE RELATION numbers;"));
+  UNIT_TEST_ASSERT(query("REMOVE RELATION items;"));
+  UNIT_TEST_ASSERT(query("REMOVE RELATION owners;"));
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+static long
+sample_time(int i)
+{
+  return 100000L + i * 3;
+}
+/*****************************************************************************/
+static int
+sample_level(int i)
+{
+  return (i * 37) % 101;
+}
+/*****************************************************************************/
+/* Check that a selection returns the samples that a predicate holds
+   for. The samples are selected by their time and level. */
+static bool
+check_select(const char *relation, const char *condition,
+             bool (*predicate)(long time, int level))
+{
+  char query_string[AQL_MAX_QUERY_LENGTH];
+  uint8_t flags;
+  int count;
+
+  expected_count = 0;
+  for(int i = 0; i < SAMPLES; i++) {
+    if(predicate(sample_time(i), sample_level(i))) {
+      expected[expected_count].a = sample_time(i);
+      expected[expected_count].b = sample_level(i);
+      expected_count++;
+    }
+  }
+
+  snprintf(query_string, sizeof(query_string),
+           "SELECT time, level FROM %s WHERE %s;", relation, condition);
+  count = collect_rows(query_string, &flags);
+  if(count != expected_count) {
+    printf("\"%s\" returned %d rows, expected %u\n", query_string, count,
+           expected_count);
+    return false;
+  }
+
+  qsort(result, count, sizeof(result[0]), compare_pairs);
+  return memcmp(result, expected, count * sizeof(result[0])) == 0;
+}
+/*****************************************************************************/
+static bool
+level_equal(long time, int level)
+{
+  return level == 17;
+}
+/*****************************************************************************/
+static bool
+time_range(long time, int level)
+{
+  return time >= 100300 && time < 100450;
+}
+/*****************************************************************************/
+static bool
+time_early(long time, int level)
+{
+  return time < 100100;
+}
+/*****************************************************************************/
+static bool
+time_late(long time, int level)
+{
+  return time > 100800;
+}
+/*****************************************************************************/
+static bool
+time_point(long time, int level)
+{
+  return time == 100300;
+}
+/*****************************************************************************/
+static bool
+time_and_level(long time, int level)
+{
+  return level > 50 && time < 100200;
+}
+/*****************************************************************************/
+static bool
+time_or(long time, int level)
+{
+  return time < 100030 || time > 100870;
+}
+/*****************************************************************************/
+static bool
+time_and_not_level(long time, int level)
+{
+  return time > 100100 && level != 5;
+}
+/*****************************************************************************/
+static bool
+level_low(long time, int level)
+{
+  return level < 3;
+}
+/*****************************************************************************/
+static bool
+level_high(long time, int level)
+{
+  return level >= 90;
+}
+/*****************************************************************************/
+static bool
+level_band(long time, int level)
+{
+  return level > 40 && level < 45;
+}
+/*****************************************************************************/
+static bool
+level_sum(long time, int level)
+{
+  return level + 1 == 18;
+}
+/*****************************************************************************/
+static bool
+nothing(long time, int level)
+{
+  return false;
+}
+/*****************************************************************************/
+static bool
+time_and_or(long time, int level)
+{
+  /* Connectives are grouped from the right. */
+  return time < 100120 && (level == 3 || time < 100060);
+}
+/*****************************************************************************/
+static bool
+all(long time, int level)
+{
+  return true;
+}
+/*****************************************************************************/
+static bool
+not_early(long time, int level)
+{
+  return !(time < 100150);
+}
+/*****************************************************************************/
+static bool
+not_high(long time, int level)
+{
+  return !(level > 90);
+}
+/*****************************************************************************/
+/* Insert the samples in steps through the sample numbers, which are
+   in increasing order of time if the step is 1. */
+static bool
+fill_samples(const char *relation, const char *index, int step)
+{
+  int i;
+
+  if(!create_relation(relation, "time DOMAIN LONG", "level DOMAIN INT") ||
+     !query("CREATE ATTRIBUTE tag DOMAIN STRING(4) IN %s;", relation)) {
+    return false;
+  }
+  if(index != NULL &&
+     !query("CREATE INDEX %s.%s;", relation, index)) {
+    return false;
+  }
+  for(int n = 0; n < SAMPLES; n++) {
+    i = (n * step) % SAMPLES;
+    if(!query("INSERT (%ld, %d, 't%d') INTO %s;",
+              sample_time(i), sample_level(i), i % 10, relation)) {
+      return false;
+    }
+  }
+  return true;
+}
+/*****************************************************************************/
+static bool
+uses_index(const char *relation, const char *condition)
+{
+  db_handle_t handle;
+  uint8_t flags;
+
+  if(DB_ERROR(db_query(&handle, "SELECT time, level FROM %s WHERE %s;",
+                       relation, condition))) {
+    db_free(&handle);
+    return false;
+  }
+  flags = handle.flags;
+  db_free(&handle);
+  return (flags & DB_HANDLE_FLAG_SEARCH_INDEX) != 0;
+}
+/*****************************************************************************/
+/* Fill the relation pool, so that the relations that are not in use
+   are freed, and loaded again from storage when they are queried. */
+static bool
+unload_relations(void)
+{
+  for(int i = 0; i < DB_RELATION_POOL_SIZE; i++) {
+    if(!query("REMOVE RELATION pad%d;", i) ||
+       !query("CREATE RELATION pad%d;", i)) {
+      return false;
+    }
+  }
+  for(int i = 0; i < DB_RELATION_POOL_SIZE; i++) {
+    if(!query("REMOVE RELATION pad%d;", i)) {
+      return false;
+    }
+  }
+  return true;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(select, "Selections");
+UNIT_TEST(select)
+{
+  uint8_t flags;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(fill_samples("samples", NULL, 1));
+
+  /* Conditions that are described exactly by derived ranges. */
+  UNIT_TEST_ASSERT(check_select("samples", "time > 0", all));
+  UNIT_TEST_ASSERT(check_select("samples", "level = 17", level_equal));
+  UNIT_TEST_ASSERT(check_select("samples", "time >= 100300 AND time < 100450",
+                                time_range));
+  UNIT_TEST_ASSERT(check_select("samples", "100450 > time AND 100300 <= time",
+                                time_range));
+  UNIT_TEST_ASSERT(check_select("samples", "level > 50 AND time < 100200",
+                                time_and_level));
+  UNIT_TEST_ASSERT(check_select("samples", "time > 100600 AND time < 100300",
+                                nothing));
+
+  /* Conditions that are described partially or not at all. */
+  UNIT_TEST_ASSERT(check_select("samples", "time < 100030 OR time > 100870",
+                                time_or));
+  UNIT_TEST_ASSERT(check_select("samples", "time > 100100 AND level <> 5",
+                                time_and_not_level));
+  UNIT_TEST_ASSERT(check_select("samples", "level + 1 = 18", level_sum));
+  UNIT_TEST_ASSERT(check_select("samples",
+                                "time < 100120 AND level = 3 OR time < 100060",
+                                time_and_or));
+
+  /* A removal keeps the rows that do not satisfy its condition. */
+  UNIT_TEST_ASSERT(collect_rows("REMOVE FROM samples WHERE level > 90 OR time < 0;",
+                                &flags) >= 0);
+  UNIT_TEST_ASSERT(check_select("samples", "time > 0", not_high));
+  UNIT_TEST_ASSERT(query("REMOVE RELATION samples;"));
+
+  /* Rows found through an index are filtered in the same way. */
+  UNIT_TEST_ASSERT(fill_samples("indexed", "time TYPE INLINE", 1));
+  UNIT_TEST_ASSERT(check_select("indexed", "time >= 100300 AND time < 100450",
+                                time_range));
+  UNIT_TEST_ASSERT(check_select("indexed", "level > 50 AND time < 100200",
+                                time_and_level));
+  UNIT_TEST_ASSERT(collect_rows("REMOVE FROM indexed WHERE time < 100150;",
+                                &flags) >= 0);
+  UNIT_TEST_ASSERT(check_select("indexed", "time > 0", not_early));
+  UNIT_TEST_ASSERT(query("REMOVE RELATION indexed;"));
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+static bool
+check_time_index(const char *relation)
+{
+  return uses_index(relation, "time >= 100300 AND time < 100450") &&
+         check_select(relation, "time >= 100300 AND time < 100450",
+                      time_range) &&
+         check_select(relation, "time < 100100", time_early) &&
+         check_select(relation, "time > 100800", time_late) &&
+         check_select(relation, "time = 100300", time_point) &&
+         check_select(relation, "time > 200000", nothing) &&
+         check_select(relation, "level > 50 AND time < 100200",
+                      time_and_level) &&
+         check_select(relation, "time < 100030 OR time > 100870", time_or);
+}
+/*****************************************************************************/
+static int
+count_selected(const char *relation, const char *condition)
+{
+  char query_string[AQL_MAX_QUERY_LENGTH];
+  uint8_t flags;
+
+  snprintf(query_string, sizeof(query_string),
+           "SELECT time, level FROM %s WHERE %s;", relation, condition);
+  return collect_rows(query_string, &flags);
+}
+/*****************************************************************************/
+/* Check that LONG keys outside the range of int32_t are ordered in the
+   index as they are compared in a scan. */
+static bool
+check_wide_keys(void)
+{
+#if LONG_MAX > 0x7fffffffL
+  static const long keys[] = {
+    5, 2147483647L, 2147483648L, 3000000000L, 100, 4294967295L
+  };
+
+  if(!create_relation("wide", "time DOMAIN LONG", "level DOMAIN INT") ||
+     !query("CREATE INDEX wide.time TYPE BPLUSTREE;")) {
+    return false;
+  }
+  for(int i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+    if(!query("INSERT (%ld, %d) INTO wide;", keys[i], i)) {
+      return false;
+    }
+  }
+
+  return uses_index("wide", "time >= 2147483648") &&
+         count_selected("wide", "time >= 2147483648") == 3 &&
+         count_selected("wide", "time < 2147483648") == 3 &&
+         count_selected("wide", "time > 2147483647 AND time < 4294967295") == 2 &&
+         count_selected("wide", "time = 4294967295") == 1 &&
+         query("REMOVE RELATION wide;");
+#else /* LONG_MAX > 0x7fffffffL */
+  return true;
+#endif /* LONG_MAX > 0x7fffffffL */
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(bplustree, "B+-tree index");
+UNIT_TEST(bplustree)
+{
+  UNIT_TEST_BEGIN();
+
+  /* Keys that are inserted in increasing order. */
+  UNIT_TEST_ASSERT(fill_samples("tree", "time TYPE BPLUSTREE", 1));
+  UNIT_TEST_ASSERT(check_time_index("tree"));
+
+  /* The index is loaded from storage together with the relation. */
+  UNIT_TEST_ASSERT(unload_relations());
+  UNIT_TEST_ASSERT(check_time_index("tree"));
+
+  UNIT_TEST_ASSERT(query("REMOVE INDEX tree.time;"));
+  UNIT_TEST_ASSERT(!uses_index("tree", "time >= 100300 AND time < 100450"));
+  UNIT_TEST_ASSERT(check_select("tree", "time >= 100300 AND time < 100450",
+                                time_range));
+  UNIT_TEST_ASSERT(query("REMOVE RELATION tree;"));
+
+  /* Keys that are inserted out of order, with several rows per key. */
+  UNIT_TEST_ASSERT(fill_samples("shuffled", "level TYPE BPLUSTREE", 97));
+  UNIT_TEST_ASSERT(uses_index("shuffled", "level = 17"));
+  UNIT_TEST_ASSERT(check_select("shuffled", "level = 17", level_equal));
+  UNIT_TEST_ASSERT(check_select("shuffled", "level < 3", level_low));
+  UNIT_TEST_ASSERT(check_select("shuffled", "level >= 90", level_high));
+  UNIT_TEST_ASSERT(check_select("shuffled", "level > 40 AND level < 45",
+                                level_band));
+  UNIT_TEST_ASSERT(check_select("shuffled", "level > 50 AND time < 100200",
+                                time_and_level));
+  UNIT_TEST_ASSERT(check_select("shuffled", "level + 1 = 18", level_sum));
+  UNIT_TEST_ASSERT(query("REMOVE RELATION shuffled;"));
+
+  UNIT_TEST_ASSERT(check_wide_keys());
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_antelope_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(hash_join);
+  UNIT_TEST_RUN(spill);
+  UNIT_TEST_RUN(index_join);
+  UNIT_TEST_RUN(string_join);
+  UNIT_TEST_RUN(select);
+  UNIT_TEST_RUN(bplustree);
+
+  if(!UNIT_TEST_PASSED(hash_join) ||
+     !UNIT_TEST_PASSED(spill) ||
+     !UNIT_TEST_PASSED(index_join) ||
+     !UNIT_TEST_PASSED(string_join) ||
+     !UNIT_TEST_PASSED(select) ||
+     !UNIT_TEST_PASSED(bplustree)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,18 @@
+#!/bin/bash
+source ../utils.sh
+
+# Reassembly benchmark: fragmented packets from several interleaved
+# senders are injected into the 6LoWPAN layer.
+export TEST_PROTOCOL=sicslowpan-reassembly
+
+CODE_DIR=packet-injector
+CODE=packet-injector
+
+timeout -k 1s 60s "$CODE_DIR/build/native/$CODE.native"
+INJECTOR_EXIT_CODE=$?
+echo "exit code:" $INJECTOR_EXIT_CODE
+
+if [ $INJECTOR_EXIT_CODE -ne 0 ]; then
+  printf "%-32s TEST FAIL\n" "$CODE-reassembly"
+  exit 1
+fi
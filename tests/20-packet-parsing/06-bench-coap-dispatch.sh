@@ -0,0 +1,18 @@
+#!/bin/bash
+source ../utils.sh
+
+# CoAP dispatch benchmark: requests for many resources are injected
+# into the CoAP engine.
+export TEST_PROTOCOL=coap-dispatch
+
+CODE_DIR=packet-injector
+CODE=packet-injector
+
+timeout -k 1s 60s "$CODE_DIR/build/native/$CODE.native"
+INJECTOR_EXIT_CODE=$?
+echo "exit code:" $INJECTOR_EXIT_CODE
+
+if [ $INJECTOR_EXIT_CODE -ne 0 ]; then
+  printf "%-32s TEST FAIL\n" "$CODE-coap-dispatch"
+  exit 1
+fi
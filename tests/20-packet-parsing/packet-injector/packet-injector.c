@@ -44,6 +44,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <time.h>
 #include <unistd.h>
 
 /* Contiki-NG headers. */
@@ -68,6 +69,32 @@
 #define TEST_COAP_ENDPOINT "fdfd::100"
 #define TEST_COAP_PORT 8293
 
+/* Reassembly benchmark: the packets sent by each sender, the size of
+   each packet, and the payload of each fragment. The uncompressed
+   first fragment and all other fragments except the last one must be
+   multiples of eight bytes. */
+#ifdef TEST_CONF_REASS_PACKETS
+#define TEST_REASS_PACKETS TEST_CONF_REASS_PACKETS
+#else
+#define TEST_REASS_PACKETS 2000
+#endif
+#define TEST_REASS_PACKET_SIZE 640
+#define TEST_REASS_FRAG_SIZE 96
+#define TEST_REASS_MAX_SENDERS 8
+#define TEST_REASS_FRAGS \
+  ((TEST_REASS_PACKET_SIZE + TEST_REASS_FRAG_SIZE - 1) / TEST_REASS_FRAG_SIZE)
+
+/* CoAP dispatch benchmark: the requests sent to each resource, and the
+   resources, laid out like the resources of LwM2M object instances. */
+#ifdef TEST_CONF_COAP_REQUESTS
+#define TEST_COAP_REQUESTS TEST_CONF_COAP_REQUESTS
+#else
+#define TEST_COAP_REQUESTS 200
+#endif
+#define TEST_COAP_RESOURCES_PER_OBJECT 8
+#define TEST_COAP_MAX_RESOURCES 256
+#define TEST_COAP_URL_LEN 32
+
 extern int contiki_argc;
 extern char **contiki_argv;
 
@@ -172,6 +199,314 @@ inject_sicslowpan_packet(char *data, int len)
   return true;
 }
 /*---------------------------------------------------------------------------*/
+static unsigned reass_delivered;
+static unsigned reass_corrupt;
+/*---------------------------------------------------------------------------*/
+static enum netstack_ip_action
+count_reassembled_packet(void)
+{
+  const uint8_t *payload = uip_buf + UIP_IPH_LEN;
+
+  /* The payload is a sequence that starts at an arbitrary value. */
+  if(uip_len != TEST_REASS_PACKET_SIZE) {
+    reass_corrupt++;
+    return NETSTACK_IP_DROP;
+  }
+  for(int i = 1; i < TEST_REASS_PACKET_SIZE - UIP_IPH_LEN; i++) {
+    if(payload[i] != (uint8_t)(payload[0] + i)) {
+      reass_corrupt++;
+      return NETSTACK_IP_DROP;
+    }
+  }
+  reass_delivered++;
+  return NETSTACK_IP_DROP;
+}
+/*---------------------------------------------------------------------------*/
+static struct netstack_ip_packet_processor reass_counter = {
+  .process_input = count_reassembled_packet
+};
+/*---------------------------------------------------------------------------*/
+/* Build an uncompressed IPv6 packet with a sequence as payload */
+static void
+make_packet(uint8_t *packet, uint8_t first_byte)
+{
+  memset(packet, 0, UIP_IPH_LEN);
+  packet[0] = 0x60;
+  packet[4] = (TEST_REASS_PACKET_SIZE - UIP_IPH_LEN) >> 8;
+  packet[5] = (TEST_REASS_PACKET_SIZE - UIP_IPH_LEN) & 0xff;
+  packet[6] = UIP_PROTO_NONE;
+  packet[7] = 64;
+  packet[8] = 0xfe;
+  packet[9] = 0x80;
+  packet[39] = 1;
+  for(int i = UIP_IPH_LEN; i < TEST_REASS_PACKET_SIZE; i++) {
+    packet[i] = first_byte + i - UIP_IPH_LEN;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Build fragment number frag of a packet */
+static int
+make_fragment(uint8_t *frame, const uint8_t *packet, uint16_t tag, int frag)
+{
+  int offset = frag * TEST_REASS_FRAG_SIZE;
+  int len = MIN(TEST_REASS_FRAG_SIZE, TEST_REASS_PACKET_SIZE - offset);
+
+  frame[0] = (frag == 0 ? SICSLOWPAN_DISPATCH_FRAG1 : SICSLOWPAN_DISPATCH_FRAGN) |
+    (TEST_REASS_PACKET_SIZE >> 8);
+  frame[1] = TEST_REASS_PACKET_SIZE & 0xff;
+  frame[2] = tag >> 8;
+  frame[3] = tag & 0xff;
+  /* The first fragment carries the dispatch, the others the offset. */
+  frame[4] = frag == 0 ? SICSLOWPAN_DISPATCH_IPV6 : offset >> 3;
+  memcpy(frame + 5, packet + offset, len);
+  return 5 + len;
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+cpu_time_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+/* Send TEST_REASS_PACKETS fragmented packets from each sender, with the
+   fragments of all senders interleaved. Every other sender sends its
+   fragments in reverse order. */
+static void
+reassembly_round(int senders)
+{
+  static uint8_t packets[TEST_REASS_MAX_SENDERS][TEST_REASS_PACKET_SIZE];
+  static uint8_t frame[TEST_REASS_FRAG_SIZE + 5];
+  linkaddr_t sender;
+  uint64_t start;
+  uint64_t elapsed;
+  int len;
+
+  reass_delivered = reass_corrupt = 0;
+  start = cpu_time_ns();
+  for(int p = 0; p < TEST_REASS_PACKETS; p++) {
+    for(int s = 0; s < senders; s++) {
+      make_packet(packets[s], s + p);
+    }
+    for(int f = 0; f < TEST_REASS_FRAGS; f++) {
+      for(int s = 0; s < senders; s++) {
+        int frag = s % 2 ? TEST_REASS_FRAGS - 1 - f : f;
+        len = make_fragment(frame, packets[s], p, frag);
+        memset(&sender, 0, sizeof(sender));
+        sender.u8[0] = 0x02;
+        sender.u8[LINKADDR_SIZE - 1] = s + 1;
+        packetbuf_copyfrom(frame, len);
+        packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &sender);
+        packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+        sicslowpan_driver.input();
+      }
+    }
+  }
+  elapsed = cpu_time_ns() - start;
+
+  printf("* %d senders: %u/%u packets, %.0f reassemblies/s\n",
+         senders, reass_delivered, senders * TEST_REASS_PACKETS,
+         reass_delivered * 1e9 / (elapsed ? elapsed : 1));
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_reassembly_benchmark(void)
+{
+  unsigned contexts;
+  size_t memory;
+  unsigned corrupt = 0;
+  bool complete;
+
+  log_set_level("all", LOG_LEVEL_NONE);
+  netstack_ip_packet_processor_add(&reass_counter);
+
+  memory = sicslowpan_reass_memory(&contexts);
+  printf("Reassembly: %u contexts, %u bytes per context\n",
+         contexts, (unsigned)(memory / contexts));
+
+  /* A single sender is reassembled by every configuration. */
+  reassembly_round(1);
+  complete = reass_delivered == TEST_REASS_PACKETS;
+  corrupt += reass_corrupt;
+  for(int senders = 2; senders <= TEST_REASS_MAX_SENDERS; senders *= 2) {
+    reassembly_round(senders);
+    corrupt += reass_corrupt;
+  }
+
+  if(!complete || corrupt > 0) {
+    printf("Reassembly failed, %u corrupt packets\n", corrupt);
+    exit(EXIT_FAILURE);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned coap_leaf_calls;
+static unsigned coap_parent_calls;
+/*---------------------------------------------------------------------------*/
+static void
+coap_leaf_handler(coap_message_t *request, coap_message_t *response,
+                  uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  coap_leaf_calls++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+coap_parent_handler(coap_message_t *request, coap_message_t *response,
+                    uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  coap_parent_calls++;
+}
+/*---------------------------------------------------------------------------*/
+static coap_resource_t coap_resources[TEST_COAP_MAX_RESOURCES];
+static char coap_urls[TEST_COAP_MAX_RESOURCES][TEST_COAP_URL_LEN];
+static int coap_resource_count;
+PARENT_RESOURCE(coap_parent, "", coap_parent_handler, NULL, NULL, NULL);
+/*---------------------------------------------------------------------------*/
+static void
+setup_coap_engine(void)
+{
+  log_set_level("all", LOG_LEVEL_NONE);
+  coap_engine_init();
+  coap_activate_resource(&coap_parent, "3300");
+}
+/*---------------------------------------------------------------------------*/
+static void
+activate_coap_resources(int count)
+{
+  for(; coap_resource_count < count; coap_resource_count++) {
+    snprintf(coap_urls[coap_resource_count], TEST_COAP_URL_LEN, "%d/0/%d",
+             3301 + coap_resource_count / TEST_COAP_RESOURCES_PER_OBJECT,
+             5700 + coap_resource_count % TEST_COAP_RESOURCES_PER_OBJECT);
+    coap_resources[coap_resource_count].get_handler = coap_leaf_handler;
+    coap_activate_resource(&coap_resources[coap_resource_count],
+                           coap_urls[coap_resource_count]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Serialize a confirmable GET request for the URL */
+static int
+make_coap_request(uint8_t *packet, const char *url, uint16_t mid)
+{
+  coap_message_t request[1];
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, mid);
+  coap_set_header_uri_path(request, url);
+  return coap_serialize_message(request, packet);
+}
+/*---------------------------------------------------------------------------*/
+/* Send TEST_COAP_REQUESTS requests to every resource, to sub-resources
+   of the parent resource and to a URL without a resource. */
+static bool
+coap_dispatch_round(int resources)
+{
+  static const char *other_urls[] = { "3300/1/5700", "3300/0", "4000/0/5700" };
+  static coap_endpoint_t end_point;
+  static uint8_t packet[COAP_MAX_HEADER_SIZE];
+  uint64_t start;
+  uint64_t elapsed;
+  unsigned requests = 0;
+  int len;
+  int i;
+  int r;
+
+  activate_coap_resources(resources);
+  uiplib_ipaddrconv(TEST_COAP_ENDPOINT, &end_point.ipaddr);
+  end_point.port = TEST_COAP_PORT;
+
+  coap_leaf_calls = coap_parent_calls = 0;
+  start = cpu_time_ns();
+  for(r = 0; r < TEST_COAP_REQUESTS; r++) {
+    for(i = 0; i < resources; i++) {
+      len = make_coap_request(packet, coap_urls[i], requests++);
+      coap_receive(&end_point, packet, len);
+    }
+    for(i = 0; i < sizeof(other_urls) / sizeof(other_urls[0]); i++) {
+      len = make_coap_request(packet, other_urls[i], requests++);
+      coap_receive(&end_point, packet, len);
+    }
+  }
+  elapsed = cpu_time_ns() - start;
+
+  printf("* %3d resources: %.0f ns/request, %.0f requests/s\n", resources,
+         (double)elapsed / requests, requests * 1e9 / (elapsed ? elapsed : 1));
+
+  return coap_leaf_calls == resources * TEST_COAP_REQUESTS &&
+    coap_parent_calls == 2 * TEST_COAP_REQUESTS;
+}
+/*---------------------------------------------------------------------------*/
+/* Read /.well-known/core block by block and compare it with the links of
+   all resources */
+static bool
+coap_discovery_round(void)
+{
+  extern coap_resource_t res_well_known_core;
+  static char expected[TEST_COAP_MAX_RESOURCES * (TEST_COAP_URL_LEN + 4)];
+  static uint8_t buffer[COAP_MAX_BLOCK_SIZE + 1];
+  coap_message_t request[1];
+  coap_message_t response[1];
+  coap_resource_t *resource;
+  int32_t offset = 0;
+  size_t expected_len = 0;
+  unsigned blocks = 0;
+  bool match = true;
+  uint64_t start;
+  uint64_t elapsed;
+
+  for(resource = coap_get_first_resource(); resource != NULL;
+      resource = coap_get_next_resource(resource)) {
+    const char *attributes = resource->attributes ? resource->attributes : "";
+
+    expected_len += snprintf(expected + expected_len,
+                             sizeof(expected) - expected_len, "%s</%s>%s%s",
+                             expected_len > 0 ? "," : "", resource->url,
+                             attributes[0] ? ";" : "", attributes);
+  }
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+  start = cpu_time_ns();
+  while(offset >= 0) {
+    int32_t block_offset = offset;
+
+    coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, 0);
+    res_well_known_core.get_handler(request, response, buffer,
+                                    COAP_MAX_BLOCK_SIZE, &offset);
+    if(block_offset + response->payload_len > expected_len ||
+       memcmp(expected + block_offset, response->payload,
+              response->payload_len) != 0) {
+      match = false;
+      break;
+    }
+    blocks++;
+  }
+  elapsed = cpu_time_ns() - start;
+
+  printf("* /.well-known/core: %u blocks, %.0f ns/block\n", blocks,
+         (double)elapsed / (blocks ? blocks : 1));
+
+  return match && blocks == (expected_len + COAP_MAX_BLOCK_SIZE - 1) /
+    COAP_MAX_BLOCK_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_coap_dispatch_benchmark(void)
+{
+  bool dispatched = true;
+
+  printf("CoAP dispatch: %s\n", COAP_RESOURCE_INDEX ? "index" : "list");
+
+  for(int resources = 16; resources <= TEST_COAP_MAX_RESOURCES;
+      resources *= 4) {
+    dispatched &= coap_dispatch_round(resources);
+  }
+  dispatched &= coap_discovery_round();
+
+  if(!dispatched) {
+    printf("CoAP dispatch failed\n");
+    exit(EXIT_FAILURE);
+  }
+}
+/*---------------------------------------------------------------------------*/
 protocol_function_t
 select_protocol(const char *protocol_name)
 {
@@ -234,6 +569,19 @@ PROCESS_THREAD(packet_injector_process, ev, data)
     protocol_name = TEST_PROTOCOL_DEFAULT;
   }
 
+  if(strcasecmp(protocol_name, "sicslowpan-reassembly") == 0) {
+    run_reassembly_benchmark();
+    exit(EXIT_SUCCESS);
+  }
+
+  if(strcasecmp(protocol_name, "coap-dispatch") == 0) {
+    setup_coap_engine();
+    /* Let the CoAP engine set up its connection */
+    PROCESS_PAUSE();
+    run_coap_dispatch_benchmark();
+    exit(EXIT_SUCCESS);
+  }
+
   protocol_input = select_protocol(protocol_name);
   if(protocol_input == NULL) {
     LOG_ERR("unsupported protocol: \"%s\"\n",